@@ -29,6 +29,8 @@
 #include <gio/gio.h>
 
 #include "cheese-camera-device.h"
+#include "cheese-caps-cache.h"
+#include "cheese-format-cost.h"
 
 /**
  * SECTION:cheese-camera-device
@@ -75,11 +77,11 @@ static const gchar * const supported_formats[] = {
     NULL
 };
 
-/* FIXME: make this configurable */
 /*
  * CHEESE_MAXIMUM_RATE:
  *
- * The maximum framerate, in frames per second.
+ * The maximum framerate, in frames per second, unless a higher one is asked
+ * for explicitly.
  */
 static const guint CHEESE_MAXIMUM_RATE = 30;
 
@@ -179,7 +181,7 @@ format_caps (const gchar * const formats[])
                          gst_caps_new_simple (formats[i],
                                               "framerate",
                                               GST_TYPE_FRACTION_RANGE,
-                                              0, 1, CHEESE_MAXIMUM_RATE, 1,
+                                              0, 1, CHEESE_CAMERA_DEVICE_MAX_FRAMERATE, 1,
                                               NULL));
     }
 
@@ -193,8 +195,8 @@ format_caps (const gchar * const formats[])
  * @formats: an array of strings of video formats, in the form axb, where a and
  * b are in units of pixels
  *
- * Filter the supplied @caps with %CHEESE_MAXIMUM_RATE to only allow @formats
- * which can reach the desired framerate.
+ * Filter the supplied @caps with %CHEESE_CAMERA_DEVICE_MAX_FRAMERATE to only
+ * allow @formats which can reach the desired framerate.
  *
  * Returns: the filtered #GstCaps
  */
@@ -222,17 +224,16 @@ cheese_camera_device_filter_caps (CheeseCameraDevice *device,
 /*
  * cheese_camera_device_get_highest_framerate:
  * @framerate: a #GValue holding a framerate cap
+ * @max_rate: the highest framerate to consider, in frames per second
  * @numerator: destination to store the numerator of the highest rate
  * @denominator: destination to store the denominator of the highest rate
  *
- * Get the numerator and denominator for the highest framerate stored in
- * a framerate cap.
- *
- * Note this function does not handle framerate ranges, if @framerate
- * contains a range it will return 0/0 as framerate
+ * Get the numerator and denominator for the highest framerate up to
+ * @max_rate stored in a framerate cap, or 0/0 if there is none.
  */
 static void
 cheese_camera_device_get_highest_framerate (const GValue *framerate,
+                                            guint max_rate,
                                             gint *numerator, gint *denominator)
 {
   *numerator = 0;
@@ -240,8 +241,12 @@ cheese_camera_device_get_highest_framerate (const GValue *framerate,
 
   if (GST_VALUE_HOLDS_FRACTION (framerate))
   {
-    *numerator = gst_value_get_fraction_numerator (framerate);
-    *denominator = gst_value_get_fraction_denominator (framerate);
+    if (gst_value_get_fraction_numerator (framerate) <=
+        (gint) max_rate * gst_value_get_fraction_denominator (framerate))
+    {
+      *numerator = gst_value_get_fraction_numerator (framerate);
+      *denominator = gst_value_get_fraction_denominator (framerate);
+    }
   }
   else if (GST_VALUE_HOLDS_ARRAY (framerate))
   {
@@ -260,7 +265,7 @@ cheese_camera_device_get_highest_framerate (const GValue *framerate,
       curr = (float)gst_value_get_fraction_numerator (val) /
              (float)gst_value_get_fraction_denominator (val);
 
-      if (curr > highest && curr <= CHEESE_MAXIMUM_RATE)
+      if (curr > highest && curr <= max_rate)
       {
         highest = curr;
         *numerator = gst_value_get_fraction_numerator (val);
@@ -286,7 +291,7 @@ cheese_camera_device_get_highest_framerate (const GValue *framerate,
       curr = (float)gst_value_get_fraction_numerator (val) /
              (float)gst_value_get_fraction_denominator (val);
 
-      if (curr > highest && curr <= CHEESE_MAXIMUM_RATE)
+      if (curr > highest && curr <= max_rate)
       {
         highest = curr;
         *numerator = gst_value_get_fraction_numerator (val);
@@ -297,11 +302,25 @@ cheese_camera_device_get_highest_framerate (const GValue *framerate,
   else if (GST_VALUE_HOLDS_FRACTION_RANGE (framerate))
   {
     const GValue *val = gst_value_get_fraction_range_max (framerate);
+    const GValue *min = gst_value_get_fraction_range_min (framerate);
 
     if (GST_VALUE_HOLDS_FRACTION (val))
     {
       *numerator = gst_value_get_fraction_numerator (val);
       *denominator = gst_value_get_fraction_denominator (val);
+
+      /* Clamp the range to @max_rate, if it reaches that far down. */
+      if (*numerator > (gint) max_rate * *denominator)
+      {
+        *numerator = 0;
+        *denominator = 0;
+        if (gst_value_get_fraction_numerator (min) <=
+            (gint) max_rate * gst_value_get_fraction_denominator (min))
+        {
+          *numerator = max_rate;
+          *denominator = 1;
+        }
+      }
     }
   }
 }
@@ -322,7 +341,8 @@ cheese_camera_device_format_update_framerate (CheeseVideoFormatFull *format,
   float high, curr = (float)format->fr_numerator / format->fr_denominator;
   gint high_numerator, high_denominator;
 
-  cheese_camera_device_get_highest_framerate (framerate, &high_numerator,
+  cheese_camera_device_get_highest_framerate (framerate, CHEESE_MAXIMUM_RATE,
+                                              &high_numerator,
                                               &high_denominator);
   if (high_denominator == 0)
     return;
@@ -372,7 +392,9 @@ cheese_camera_device_find_full_format (CheeseCameraDevice *device,
  * @device: a #CheeseCameraDevice
  * @format: the #CheeseVideoFormatFull to add
  *
- * Add the supplied @format to the list of formats supported by the @device.
+ * Add the supplied @format to the list of formats supported by the @device,
+ * unless it is only offered above %CHEESE_MAXIMUM_RATE. Such formats are
+ * left to high frame rate mode, which does not need them in the list.
  */
 static void
 cheese_camera_device_add_format (CheeseCameraDevice *device,
@@ -393,8 +415,16 @@ cheese_camera_device_add_format (CheeseCameraDevice *device,
     return;
   }
 
-  cheese_camera_device_get_highest_framerate (framerate, &format->fr_numerator,
+  cheese_camera_device_get_highest_framerate (framerate, CHEESE_MAXIMUM_RATE,
+                                              &format->fr_numerator,
                                               &format->fr_denominator);
+  if (framerate != NULL && format->fr_denominator == 0)
+  {
+    GST_INFO ("%dx%d is only offered above %u fps", format->width,
+              format->height, CHEESE_MAXIMUM_RATE);
+    g_slice_free (CheeseVideoFormatFull, format);
+    return;
+  }
   GST_INFO ("%dx%d framerate %d/%d", format->width, format->height,
             format->fr_numerator, format->fr_denominator);
 
@@ -546,11 +576,114 @@ cheese_camera_device_update_format_table (CheeseCameraDevice *device)
   }
 }
 
+/*
+ * cheese_camera_device_get_driver:
+ * @device: a #CheeseCameraDevice
+ *
+ * Returns: (transfer none): the name of the driver of the @device, or %NULL
+ * if the device provider does not tell
+ */
+static const gchar *
+cheese_camera_device_get_driver (CheeseCameraDevice *device)
+{
+  CheeseCameraDevicePrivate *priv;
+  GstStructure *props;
+  const gchar *driver;
+
+  priv = cheese_camera_device_get_instance_private (device);
+
+  props = gst_device_get_properties (priv->device);
+  if (props == NULL)
+    return NULL;
+
+  driver = gst_structure_get_string (props, "v4l2.device.driver");
+  if (driver == NULL)
+    driver = gst_structure_get_string (props, "api.v4l2.cap.driver");
+
+  /* Intern the name, so that it outlives the structure. */
+  driver = g_intern_string (driver);
+  gst_structure_free (props);
+
+  return driver;
+}
+
+/*
+ * cheese_camera_device_load_cache:
+ * @device: a #CheeseCameraDevice
+ * @caps: the #GstCaps reported by the @device
+ *
+ * Take the filtered caps and the format table of the @device from the caps
+ * cache, instead of working them out again.
+ *
+ * Returns: %TRUE if the cache had a valid entry for the @device
+ */
+static gboolean
+cheese_camera_device_load_cache (CheeseCameraDevice *device, GstCaps *caps)
+{
+  CheeseCameraDevicePrivate *priv;
+  CheeseCapsCache *cache = cheese_caps_cache_get_default ();
+  GstCaps *filtered;
+  GArray *formats;
+  guint i;
+
+  priv = cheese_camera_device_get_instance_private (device);
+
+  if (!cheese_caps_cache_lookup (cache, priv->path,
+                                 cheese_camera_device_get_driver (device),
+                                 caps, &filtered, &formats))
+    return FALSE;
+
+  gst_caps_unref (priv->caps);
+  priv->caps = filtered;
+
+  /* The table was stored sorted. */
+  G_STATIC_ASSERT (sizeof (CheeseCapsCacheFormat) == sizeof (CheeseVideoFormatFull));
+  free_format_list (device);
+  for (i = formats->len; i > 0; i--)
+  {
+    CheeseVideoFormatFull *format = g_slice_new (CheeseVideoFormatFull);
+
+    *format = g_array_index (formats, CheeseVideoFormatFull, i - 1);
+    priv->formats = g_list_prepend (priv->formats, format);
+  }
+  g_array_unref (formats);
+
+  return priv->formats != NULL;
+}
+
+/*
+ * cheese_camera_device_save_cache:
+ * @device: a #CheeseCameraDevice
+ * @caps: the #GstCaps reported by the @device
+ *
+ * Store the filtered caps and the format table of the @device in the caps
+ * cache.
+ */
+static void
+cheese_camera_device_save_cache (CheeseCameraDevice *device, GstCaps *caps)
+{
+  CheeseCameraDevicePrivate *priv;
+  GArray *formats;
+  GList *l;
+
+  priv = cheese_camera_device_get_instance_private (device);
+
+  formats = g_array_new (FALSE, FALSE, sizeof (CheeseCapsCacheFormat));
+  for (l = priv->formats; l != NULL; l = g_list_next (l))
+    g_array_append_vals (formats, l->data, 1);
+
+  cheese_caps_cache_store (cheese_caps_cache_get_default (), priv->path,
+                           cheese_camera_device_get_driver (device), caps,
+                           priv->caps, formats);
+  g_array_unref (formats);
+}
+
 /*
  * cheese_camera_device_get_caps:
  * @device: a #CheeseCameraDevice
  *
- * Probe the #GstCaps that the @device supports.
+ * Probe the #GstCaps that the @device supports, unless the caps cache holds
+ * them already.
  */
 static void
 cheese_camera_device_get_caps (CheeseCameraDevice *device)
@@ -564,11 +697,21 @@ cheese_camera_device_get_caps (CheeseCameraDevice *device)
   if (caps == NULL)
     caps = gst_caps_new_empty_simple ("video/x-raw");
 
+  if (priv->path != NULL && cheese_camera_device_load_cache (device, caps))
+  {
+    gst_caps_unref (caps);
+    return;
+  }
+
   gst_caps_unref (priv->caps);
   priv->caps = cheese_camera_device_filter_caps (device, caps, supported_formats);
 
   if (!gst_caps_is_empty (priv->caps))
+  {
     cheese_camera_device_update_format_table (device);
+    if (priv->path != NULL && priv->formats != NULL)
+      cheese_camera_device_save_cache (device, caps);
+  }
   else
   {
     g_set_error_literal (&priv->construct_error,
@@ -791,7 +934,8 @@ cheese_camera_device_new (GstDevice *device,
  * cheese_camera_device_get_format_list:
  * @device: a #CheeseCameraDevice
  *
- * Get the sorted list of #CheeseVideoFormat that the @device supports.
+ * Get the sorted list of #CheeseVideoFormat that the @device supports at up
+ * to 30 FPS.
  *
  * Returns: (element-type Cheese.VideoFormat) (transfer container): list of
  * #CheeseVideoFormat
@@ -868,46 +1012,199 @@ cheese_camera_device_get_src (CheeseCameraDevice *device)
     return gst_device_create_element (priv->device, NULL);
 }
 
+/*
+ * cheese_camera_device_get_type_framerate:
+ * @device: a #CheeseCameraDevice
+ * @media_type: the media type, raw video or JPEG
+ * @format: the #CheeseVideoFormatFull to get the framerate for
+ * @max_rate: the highest framerate to consider, in frames per second
+ * @numerator: return location for the numerator of the highest framerate
+ * @denominator: return location for the denominator of the highest
+ * framerate, 0 if the @device does not tell
+ *
+ * Get the highest framerate of a @format in one media type, which can be
+ * lower than the highest framerate of the @format over all media types.
+ *
+ * Returns: %TRUE if the @device offers the @format as @media_type, at no
+ * more than @max_rate
+ */
+static gboolean
+cheese_camera_device_get_type_framerate (CheeseCameraDevice *device,
+                                         const gchar *media_type,
+                                         CheeseVideoFormatFull *format,
+                                         guint max_rate,
+                                         gint *numerator, gint *denominator)
+{
+  CheeseCameraDevicePrivate *priv;
+  GstCaps *desired, *subset;
+  float highest = 0;
+  gboolean offered;
+  guint i;
+
+  priv = cheese_camera_device_get_instance_private (device);
+
+  *numerator = 0;
+  *denominator = 0;
+
+  desired = gst_caps_new_simple (media_type,
+                                 "width", G_TYPE_INT, format->width,
+                                 "height", G_TYPE_INT, format->height, NULL);
+  subset = gst_caps_intersect (desired, priv->caps);
+  offered = FALSE;
+
+  for (i = 0; i < gst_caps_get_size (subset); i++)
+  {
+    const GValue *framerate;
+    gint num, den;
+
+    framerate = gst_structure_get_value (gst_caps_get_structure (subset, i),
+                                         "framerate");
+    if (framerate == NULL)
+    {
+      offered = TRUE;
+      continue;
+    }
+
+    cheese_camera_device_get_highest_framerate (framerate, max_rate, &num, &den);
+    offered |= den != 0;
+    if (den != 0 && (float)num / den > highest)
+    {
+      highest = (float)num / den;
+      *numerator = num;
+      *denominator = den;
+    }
+  }
+
+  gst_caps_unref (subset);
+  gst_caps_unref (desired);
+
+  return offered;
+}
+
+/*
+ * cheese_camera_device_score_format:
+ * @device: a #CheeseCameraDevice
+ * @format: the #CheeseVideoFormatFull to score
+ * @target_fps: the framerate to aim for
+ * @effect_cost: the CPU time which the effects take per pixel, in
+ * nanoseconds
+ * @compressed: (out): return location for whether JPEG scores better than
+ * raw video for the @format
+ * @reason: (out) (allow-none) (transfer full): return location for the
+ * reason of the score
+ *
+ * Rate the @format with the cost model, in whichever of raw video and JPEG
+ * suits it better.
+ *
+ * Returns: the score, 0 if the @device does not offer the @format
+ */
+static gdouble
+cheese_camera_device_score_format (CheeseCameraDevice *device,
+                                   CheeseVideoFormatFull *format,
+                                   guint target_fps, gdouble effect_cost,
+                                   gboolean *compressed, gchar **reason)
+{
+  gdouble best = 0;
+  gsize i;
+
+  *compressed = FALSE;
+
+  for (i = 0; supported_formats[i] != NULL; i++)
+  {
+    gboolean is_jpeg = g_str_equal (supported_formats[i], "image/jpeg");
+    gint numerator, denominator;
+    gdouble fps, score;
+    gchar *why = NULL;
+
+    if (!cheese_camera_device_get_type_framerate (device, supported_formats[i],
+                                                  format, target_fps,
+                                                  &numerator, &denominator))
+      continue;
+
+    /* The decoding cost is only calibrated when JPEG is on offer. */
+    fps = denominator != 0 ? (gdouble) numerator / denominator : 0;
+    score = cheese_format_cost_score (format->width, format->height, fps,
+                                      is_jpeg, target_fps, effect_cost,
+                                      is_jpeg ? cheese_format_cost_get_decode_cost ()
+                                              : 0,
+                                      reason != NULL ? &why : NULL);
+    if (score > best)
+    {
+      best = score;
+      *compressed = is_jpeg;
+      if (reason != NULL)
+      {
+        g_free (*reason);
+        *reason = why;
+        why = NULL;
+      }
+    }
+
+    g_free (why);
+  }
+
+  return best;
+}
+
 /**
- * cheese_camera_device_get_best_format:
+ * cheese_camera_device_choose_format:
  * @device: a #CheeseCameraDevice
+ * @target_fps: the framerate to aim for
+ * @effect_cost: the CPU time which the effects applied to the video take,
+ * in nanoseconds per pixel, or 0
+ * @reason: (out) (allow-none) (transfer full): return location for a
+ * description of the chosen format and of what limits it, or %NULL
  *
- * Get the #CheeseVideoFormat with the highest resolution with a width greater
- * than 640 pixels and a framerate of greater than 15 FPS for this @device. If
- * no such format is found, get the highest available resolution instead.
+ * Choose the #CheeseVideoFormat of this @device with a cost model, which
+ * estimates the framerate that each format can sustain given the framerate
+ * offered by the @device, the bandwidth of the bus, the cost of decoding JPEG
+ * as measured on this machine and the @effect_cost. The largest format which
+ * sustains @target_fps wins. Whether to capture it as raw video or JPEG is
+ * decided the same way by cheese_camera_device_get_caps_for_format().
  *
- * Returns: (transfer full): the highest-resolution supported
- * #CheeseVideoFormat
+ * Returns: (transfer full): the chosen #CheeseVideoFormat
  */
 CheeseVideoFormat *
-cheese_camera_device_get_best_format (CheeseCameraDevice *device)
+cheese_camera_device_choose_format (CheeseCameraDevice *device,
+                                    guint               target_fps,
+                                    gdouble             effect_cost,
+                                    gchar             **reason)
 {
     CheeseCameraDevicePrivate *priv;
   CheeseVideoFormatFull *format = NULL;
+  gdouble best = -1;
   GList *l;
 
   g_return_val_if_fail (CHEESE_IS_CAMERA_DEVICE (device), NULL);
 
     priv = cheese_camera_device_get_instance_private (device);
 
-    /* Check for the highest resolution with width >= 640 and FPS >= 15. */
+  if (reason != NULL)
+    *reason = NULL;
+
     for (l = priv->formats; l != NULL; l = g_list_next (l))
     {
         CheeseVideoFormatFull *item = l->data;
-        float frame_rate = (float)item->fr_numerator
-                           / (float)item->fr_denominator;
-
-        if (item->width >= 640 && frame_rate >= 15)
+        gboolean compressed;
+        gchar *why = NULL;
+        gdouble score;
+
+        score = cheese_camera_device_score_format (device, item, target_fps,
+                                                   effect_cost, &compressed,
+                                                   reason != NULL ? &why : NULL);
+        if (score > best)
         {
+            best = score;
             format = item;
-            break;
+            if (reason != NULL)
+            {
+                g_free (*reason);
+                *reason = why;
+                why = NULL;
+            }
         }
-    }
 
-    /* Else simply return the highest resolution. */
-    if (!format)
-    {
-        format = priv->formats->data;
+        g_free (why);
     }
 
   GST_INFO ("%dx%d@%d/%d", format->width, format->height,
@@ -916,6 +1213,32 @@ cheese_camera_device_get_best_format (CheeseCameraDevice *device)
   return g_boxed_copy (CHEESE_TYPE_VIDEO_FORMAT, format);
 }
 
+/**
+ * cheese_camera_device_get_best_format:
+ * @device: a #CheeseCameraDevice
+ *
+ * Get the #CheeseVideoFormat of this @device which the cost model of
+ * cheese_camera_device_choose_format() prefers for 30 FPS without effects.
+ *
+ * Returns: (transfer full): the best supported #CheeseVideoFormat
+ */
+CheeseVideoFormat *
+cheese_camera_device_get_best_format (CheeseCameraDevice *device)
+{
+  CheeseVideoFormat *format;
+  gchar *reason = NULL;
+
+  g_return_val_if_fail (CHEESE_IS_CAMERA_DEVICE (device), NULL);
+
+  format = cheese_camera_device_choose_format (device,
+                                              CHEESE_FORMAT_COST_TARGET_FPS,
+                                              0, &reason);
+  GST_INFO ("Best format: %s", reason);
+  g_free (reason);
+
+  return format;
+}
+
 static GstCaps *
 cheese_camera_device_format_to_caps (const char *media_type,
                                      CheeseVideoFormatFull *format)
@@ -941,23 +1264,50 @@ cheese_camera_device_format_to_caps (const char *media_type,
  * @device: a #CheeseCameraDevice
  * @format: a #CheeseVideoFormat
  *
- * Get the #GstCaps for the given @format on the @device.
+ * Get the #GstCaps for the given @format on the @device, at up to 30 FPS.
  *
  * Returns: (transfer full): the #GstCaps for the given @format
  */
 GstCaps *
 cheese_camera_device_get_caps_for_format (CheeseCameraDevice *device,
                                           CheeseVideoFormat  *format)
+{
+  return cheese_camera_device_get_caps_for_format_at_rate (device, format, 0);
+}
+
+/**
+ * cheese_camera_device_get_caps_for_format_at_rate:
+ * @device: a #CheeseCameraDevice
+ * @format: a #CheeseVideoFormat
+ * @max_rate: the highest framerate to capture at, up to
+ * %CHEESE_CAMERA_DEVICE_MAX_FRAMERATE, or 0 for the default of 30 FPS
+ *
+ * Get the #GstCaps for the given @format on the @device, at the highest
+ * framerate up to @max_rate which the @device offers.
+ *
+ * Returns: (transfer full): the #GstCaps for the given @format
+ */
+GstCaps *
+cheese_camera_device_get_caps_for_format_at_rate (CheeseCameraDevice *device,
+                                                  CheeseVideoFormat  *format,
+                                                  guint               max_rate)
 {
     CheeseCameraDevicePrivate *priv;
     CheeseVideoFormatFull *full_format;
+    CheeseVideoFormatFull high_format = { format->width, format->height, 0, 0 };
     GstCaps *result_caps;
+    const gchar *order[2];
+    gboolean compressed;
     gsize i;
 
   g_return_val_if_fail (CHEESE_IS_CAMERA_DEVICE (device), NULL);
 
   full_format = cheese_camera_device_find_full_format (device, format);
 
+  /* The formats only offered above 30 FPS are not in the list. */
+  if (!full_format && max_rate > CHEESE_MAXIMUM_RATE)
+    full_format = &high_format;
+
   if (!full_format)
   {
     GST_INFO ("Getting caps for %dx%d: no such format!",
@@ -973,13 +1323,33 @@ cheese_camera_device_get_caps_for_format (CheeseCameraDevice *device,
 
     result_caps = gst_caps_new_empty ();
 
-    for (i = 0; supported_formats[i] != NULL; i++)
+    if (max_rate == 0)
+        max_rate = CHEESE_MAXIMUM_RATE;
+    max_rate = MIN (max_rate, CHEESE_CAMERA_DEVICE_MAX_FRAMERATE);
+
+    /* List the media type which the cost model prefers first, each at its
+     * own highest framerate. */
+    cheese_camera_device_score_format (device, full_format, max_rate, 0,
+                                       &compressed, NULL);
+
+    order[0] = compressed ? "image/jpeg" : "video/x-raw";
+    order[1] = compressed ? "video/x-raw" : "image/jpeg";
+
+    for (i = 0; i < G_N_ELEMENTS (order); i++)
     {
+        const gchar *media_type = order[i];
+        CheeseVideoFormatFull type_format = *full_format;
         GstCaps *desired_caps;
         GstCaps *subset_caps;
 
-        desired_caps = cheese_camera_device_format_to_caps (supported_formats[i],
-                                                            full_format);
+        if (!cheese_camera_device_get_type_framerate (device, media_type,
+                                                      full_format, max_rate,
+                                                      &type_format.fr_numerator,
+                                                      &type_format.fr_denominator))
+            continue;
+
+        desired_caps = cheese_camera_device_format_to_caps (media_type,
+                                                            &type_format);
         subset_caps = gst_caps_intersect (desired_caps, priv->caps);
         subset_caps = gst_caps_simplify (subset_caps);
 
@@ -993,6 +1363,45 @@ cheese_camera_device_get_caps_for_format (CheeseCameraDevice *device,
     return result_caps;
 }
 
+/**
+ * cheese_camera_device_get_max_framerate:
+ * @device: a #CheeseCameraDevice
+ * @format: a #CheeseVideoFormat
+ *
+ * Get the highest framerate at which the @device offers the @format, up to
+ * %CHEESE_CAMERA_DEVICE_MAX_FRAMERATE, such as to list the formats suitable
+ * for high frame rate capture.
+ *
+ * Returns: the highest framerate, in frames per second, or 0 if the @device
+ * does not offer the @format or does not tell its framerate
+ */
+gdouble
+cheese_camera_device_get_max_framerate (CheeseCameraDevice *device,
+                                        CheeseVideoFormat  *format)
+{
+  /* Only the size matters, and the formats which are only offered above
+   * 30 FPS are not in the list. */
+  CheeseVideoFormatFull full_format = { format->width, format->height, 0, 0 };
+  gdouble highest = 0;
+  gsize i;
+
+  g_return_val_if_fail (CHEESE_IS_CAMERA_DEVICE (device), 0);
+
+  for (i = 0; supported_formats[i] != NULL; i++)
+  {
+    gint numerator, denominator;
+
+    if (cheese_camera_device_get_type_framerate (device, supported_formats[i],
+                                                 &full_format,
+                                                 CHEESE_CAMERA_DEVICE_MAX_FRAMERATE,
+                                                 &numerator, &denominator) &&
+        denominator != 0)
+      highest = MAX (highest, (gdouble) numerator / denominator);
+  }
+
+  return highest;
+}
+
 /**
  * cheese_camera_device_supported_format_caps:
  *
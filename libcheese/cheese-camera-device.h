@@ -40,6 +40,14 @@ struct _CheeseCameraDevice
   void *unused;
 };
 
+/**
+ * CHEESE_CAMERA_DEVICE_MAX_FRAMERATE:
+ *
+ * The highest framerate, in frames per second, which devices are probed for
+ * and which high frame rate capture can ask for.
+ */
+#define CHEESE_CAMERA_DEVICE_MAX_FRAMERATE 120
+
 #define CHEESE_TYPE_VIDEO_FORMAT (cheese_video_format_get_type ())
 
 /**
@@ -69,7 +77,16 @@ CheeseCameraDevice *cheese_camera_device_new (GstDevice   *device,
 
 GstCaps *cheese_camera_device_get_caps_for_format (CheeseCameraDevice *device,
                                                    CheeseVideoFormat  *format);
+GstCaps *cheese_camera_device_get_caps_for_format_at_rate (CheeseCameraDevice *device,
+                                                           CheeseVideoFormat  *format,
+                                                           guint               max_rate);
+gdouble  cheese_camera_device_get_max_framerate (CheeseCameraDevice *device,
+                                                 CheeseVideoFormat  *format);
 CheeseVideoFormat *cheese_camera_device_get_best_format (CheeseCameraDevice *device);
+CheeseVideoFormat *cheese_camera_device_choose_format (CheeseCameraDevice *device,
+                                                       guint               target_fps,
+                                                       gdouble             effect_cost,
+                                                       gchar             **reason);
 GList *            cheese_camera_device_get_format_list (CheeseCameraDevice *device);
 
 const gchar *cheese_camera_device_get_name (CheeseCameraDevice *device);
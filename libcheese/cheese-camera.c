@@ -31,6 +31,8 @@
 #include <clutter/clutter.h>
 #include <clutter-gst/clutter-gst.h>
 #include <gst/gst.h>
+#include <gst/app/gstappsink.h>
+#include <gst/video/video.h>
 /* Avoid a warning. */
 #define GST_USE_UNSTABLE_API
 #include <gst/basecamerabinsrc/gstcamerabin-enum.h>
@@ -40,9 +42,77 @@
 #include "cheese-camera.h"
 #include "cheese-camera-device.h"
 #include "cheese-camera-device-monitor.h"
+#include "cheese-effect-cache.h"
+#include "cheese-effect-optimizer.h"
+#include "cheese-fileutil.h"
+#include "cheese-frame-ring.h"
+#include "cheese-pixbuf.h"
+#include "cheese-encoder-governor.h"
+#include "cheese-encoder-profile.h"
+#include "cheese-still-writer.h"
+#include "cheese-stripe-bin.h"
+
+/* The most memory the pre-roll of a recording may take. */
+#define CHEESE_CAMERA_PREROLL_BUDGET (64 * 1024 * 1024)
+
+/* The span of recent frames to take photos from. The frames are shared with
+ * the pipeline, often with the few buffers the driver captures into, so at
+ * most a few of them are held, whatever the frame rate. */
+#define CHEESE_CAMERA_STILL_RING_DURATION (200 * GST_MSECOND)
+#define CHEESE_CAMERA_STILL_RING_FRAMES 3
+#define CHEESE_CAMERA_STILL_RING_BUDGET (64 * 1024 * 1024)
+
+/* The number of frames an open device is estimated to hold in its buffers. */
+#define CHEESE_CAMERA_WARM_SOURCE_BUFFERS 4
+
+/* How long a live format switch may take before the camera is restarted. */
+#define CHEESE_CAMERA_FORMAT_SWITCH_TIMEOUT 2000
+
+/* How long a recording may take to finish once stopped before it is torn
+ * down, in seconds. */
+#define CHEESE_CAMERA_FORCE_STOP_TIMEOUT 5
+
+/* A branch of the effects tee showing the preview of an effect. */
+typedef struct
+{
+  /* The effect and texture, or %NULL while the branch is free. */
+  CheeseEffect *effect;
+  ClutterActor *texture;
+  GstPad *tee_pad;
+  GstElement *valve, *input_queue, *filter, *queue, *sink;
+
+  /* Whether the last filter set has no converter in front, so that it only
+   * accepts the format which the branch had then. */
+  gboolean filter_elided;
+
+  /* The governor of the branch, only used from the streaming thread of the
+   * input queue: when the last frame entered the effect, the average time
+   * the effect takes per frame, and the earliest timestamp of the next frame
+   * to let through. */
+  gint64 frame_start;
+  gint64 frame_cost;
+  GstClockTime next_pts;
+} CheeseCameraPreviewBranch;
+
+/* The share of a CPU which the effect of a preview may take; the framerate
+ * of a slower effect is lowered to fit. */
+#define CHEESE_CAMERA_PREVIEW_BUDGET 0.1
+
+/* The default width of the effect previews, in pixels. */
+#define CHEESE_CAMERA_PREVIEW_MAX_WIDTH 640
+
+/* The gap between the cells of the effects mosaic, in pixels. */
+#define CHEESE_CAMERA_MOSAIC_SPACING 4
+
+/* The number of unused effect bins to keep parsed. */
+#define CHEESE_CAMERA_EFFECT_CACHE_SIZE 8
+
+/* The most stripes which stripe-safe effects are split into, on the main
+ * path. */
+#define CHEESE_CAMERA_MAX_STRIPES 4
 
-#define CHEESE_VIDEO_ENC_PRESET "Profile Realtime"
-#define CHEESE_VIDEO_ENC_ALT_PRESET "Cheese Realtime"
+/* How often the achieved framerate is updated, in milliseconds. */
+#define CHEESE_CAMERA_FRAME_RATE_INTERVAL 1000
 
 /**
  * SECTION:cheese-camera
@@ -66,15 +136,140 @@ struct _CheeseCameraPrivate
   GstElement *video_source;
   GstElement *camera_source;
 
+  /* The branch of the video_source with the selected device, and with
+   * max_warm_sources > 1 the branches of the other devices kept open behind
+   * the source_selector. */
+  GstElement *source_branch;
+  GstElement *source_selector;
+  GPtrArray *source_branches;
+  guint max_warm_sources;
+  guint warm_source_budget;
+
   ClutterActor *video_texture;
 
+  /* Headless viewfinder, used instead of a clutter-gst sink when no
+   * video_texture was given. */
+  GstElement *frame_sink;
+  GMutex frame_lock;
+  CheeseCameraFrameFunc frame_func;
+  gpointer frame_data;
+  GDestroyNotify frame_notify;
+
+  /* Last compressed frame of the source, for passthrough photos. Handed
+   * over from the streaming thread of the source_pad, the filter of the
+   * selected branch, by swapping the sample pointer atomically; only that pad
+   * is tracked. source_busy is set while a frame of the source is tracked, so
+   * that a branch which was just switched away from cannot overlap with the
+   * new one. The caps are only touched from the tracking thread. */
+  GstPad *volatile source_pad;
+  volatile gint source_switched;
+  volatile gint source_busy;
+  GstCaps *source_caps;
+  GstSample *volatile source_sample;
+  CheeseStillWriter *still_writer;
+
+  /* Recorder for the compressed frames of the source, linked to the
+   * video_source_tee while recording without transcoding. */
+  GstElement *recorder;
+  GstPad *recorder_tee_pad;
+  GstClockTime recorder_start;
+
+  /* The last seconds of compressed frames, to start recordings with. Only
+   * touched from the streaming thread of the source_pad, while source_busy
+   * is set. */
+  CheeseFrameRing *preroll_ring;
+  GstSegment source_segment;
+  volatile gint source_compressed;
+  volatile gint preroll_duration;
+  GstClockTime preroll_start;
+
+  /* The last frames after the balance, to take photos from without waiting
+   * for camerabin. The segment is only touched from the streaming thread. */
+  GMutex still_lock;
+  CheeseFrameRing *still_ring;
+  GstCaps *still_caps;
+  GstSegment still_segment;
+  volatile gint zero_shutter_lag;
+
+  /* The burst in progress: the names of the photos still to grab, protected
+   * by still_lock, and the photos not yet written, for the main thread. */
+  CheeseFileUtil *burst_fileutil;
+  GQueue burst_names;
+  GstTagList *burst_tags;
+  GstClockTime burst_interval;
+  GstClockTime burst_next;
+  guint burst_pending;
+
+  /* The format switch in progress. The expected size is set before the
+   * pending flag, which the streaming thread clears once the new caps arrive
+   * after the balance. */
+  volatile gint switch_pending;
+  gint switch_width, switch_height;
+  gint64 switch_start;
+  guint switch_source;
+  guint format_switch_time;
+
+  /* The framerate asked for in high frame rate mode, 0 when off, and the
+   * framerate achieved after the balance. The frames are counted from the
+   * streaming thread. */
+  guint high_frame_rate;
+  volatile gint rate_frames;
+  gint64 rate_start;
+  guint rate_source;
+  gdouble achieved_frame_rate;
+
+  /* The encoder profile selected for recording, whether it is still to be
+   * applied, and the profile and encoder in use. */
+  gchar *video_encoder;
+  gboolean video_encoder_pending;
+  const CheeseEncoderProfile *encoder_profile;
+  const gchar *encoder_factory;
+
+  /* The video encoder of camerabin, which encodebin only creates once, and
+   * the queue in front of it, kept for as long as camerabin. The governor
+   * keeps the encoder of the current recording up with the camera. The frame
+   * counters are written from the streaming threads. */
+  GstElement *encoder;
+  GstElement *encoder_queue;
+  CheeseEncoderGovernor *governor;
+  guint governor_source;
+  gint64 governor_time;
+  volatile gint encoder_frames_in;
+  volatile gint encoder_frames_out;
+  guint encoder_qos_events;
+
   GstElement *effect_filter, *effects_capsfilter;
   GstElement *video_balance;
   GstElement *camera_tee, *effects_tee;
   GstElement *main_valve, *effects_valve;
   gchar *current_effect_desc;
 
+  /* Effect bins which are not in use, the effects waiting to be parsed into
+   * it in the background, and the time the last effect switch kept the main
+   * valve closed. */
+  CheeseEffectCache *effect_cache;
+  GQueue prewarm_effects;
+  guint prewarm_source;
+  guint effect_switch_time;
+
+  /* The effect preview branches, in use or free for reuse, and the number
+   * of them to keep. */
+  GPtrArray *preview_branches;
+  guint max_effect_previews;
+
+  /* The size which the effect previews must fit, 0 for the default. */
+  guint preview_max_width, preview_max_height;
+
+  /* The mosaic of effect previews, its link to the effects tee, and its
+   * layout. */
+  GstElement *mosaic_bin;
+  GstPad *mosaic_tee_pad;
+  guint mosaic_columns, mosaic_cells;
+  gint mosaic_cell_width, mosaic_cell_height;
+
   gboolean is_recording;
+  /* Forces a stopped recording to end if it does not finish in time. */
+  guint force_stop_source;
   gboolean pipeline_is_playing;
   gboolean effect_pipeline_is_playing;
   gchar *photo_filename;
@@ -103,6 +298,16 @@ enum
   PROP_DEVICE,
   PROP_FORMAT,
   PROP_NUM_CAMERA_DEVICES,
+  PROP_VIDEO_ENCODER,
+  PROP_PREROLL_DURATION,
+  PROP_ZERO_SHUTTER_LAG,
+  PROP_FORMAT_SWITCH_TIME,
+  PROP_MAX_WARM_SOURCES,
+  PROP_WARM_SOURCE_BUDGET,
+  PROP_HIGH_FRAME_RATE,
+  PROP_ACHIEVED_FRAME_RATE,
+  PROP_EFFECT_SWITCH_TIME,
+  PROP_MAX_EFFECT_PREVIEWS,
   PROP_LAST
 };
 
@@ -112,6 +317,9 @@ enum
   PHOTO_TAKEN,
   VIDEO_SAVED,
   STATE_FLAGS_CHANGED,
+  ENCODER_ADJUSTED,
+  BURST_PHOTO_SAVED,
+  BURST_DONE,
   LAST_SIGNAL
 };
 
@@ -135,42 +343,327 @@ cheese_camera_error_quark (void)
  * @sample: the #GstSample containing photo data
  *
  * Create a #GdkPixbuf containing photo data captured from @camera, and emit it
- * in the ::photo-taken signal.
+ * in the ::photo-taken signal. The pixbuf is created directly over the mapped
+ * preview buffer, without copying it.
  */
 static void
 cheese_camera_photo_data (CheeseCamera *camera, GstSample *sample)
 {
-  GstBuffer          *buffer;
-  GstCaps            *caps;
-  const GstStructure *structure;
-  gint                width, height, stride;
-  GdkPixbuf          *pixbuf;
-  const gint          bits_per_pixel = 8;
-  guchar             *data = NULL;
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  GdkPixbuf           *pixbuf;
 
-    CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
-  GstMapInfo         mapinfo = {0, };
-
-  buffer = gst_sample_get_buffer (sample);
-  caps = gst_sample_get_caps (sample);
-  structure = gst_caps_get_structure (caps, 0);
-  gst_structure_get_int (structure, "width", &width);
-  gst_structure_get_int (structure, "height", &height);
-
-  gst_buffer_map (buffer, &mapinfo, GST_MAP_READ);
-  stride = mapinfo.size / height;
-  data = g_memdup (mapinfo.data, mapinfo.size);
-  pixbuf = gdk_pixbuf_new_from_data (data ? data : mapinfo.data,
-                                     GDK_COLORSPACE_RGB,
-                                     FALSE, bits_per_pixel, width, height, stride,
-                                     data ? (GdkPixbufDestroyNotify) g_free : NULL, NULL);
-
-  gst_buffer_unmap (buffer, &mapinfo);
   g_object_set (G_OBJECT (priv->camerabin), "post-previews", FALSE, NULL);
+
+  pixbuf = cheese_pixbuf_new_from_sample (sample);
+  if (pixbuf == NULL)
+    return;
+
   g_signal_emit (camera, camera_signals[PHOTO_TAKEN], 0, pixbuf);
   g_object_unref (pixbuf);
 }
 
+/*
+ * cheese_camera_set_error_element_not_found:
+ * @error: return location for errors, or %NULL
+ * @factoryname: the name of the #GstElement which was not found
+ *
+ * Create a #GError to warn that a required GStreamer element was not found.
+ */
+static void
+cheese_camera_set_error_element_not_found (GError **error, const gchar *factoryname)
+{
+  g_return_if_fail (error == NULL || *error == NULL);
+
+  g_set_error (error, CHEESE_CAMERA_ERROR, CHEESE_CAMERA_ERROR_ELEMENT_NOT_FOUND, "%s%s.", _("One or more needed GStreamer elements are missing: "), factoryname);
+}
+
+/*
+ * cheese_camera_set_video_recording:
+ * @camera: a #CheeseCamera
+ * @error: a return location for errors, or %NULL
+ *
+ * Set the encoding profile of camerabin from the selected encoder profile,
+ * falling back to the default profile if it has no encoder installed.
+ */
+static void
+cheese_camera_set_video_recording (CheeseCamera *camera, GError **error)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  const CheeseEncoderProfile *profile;
+  const gchar *encoder = NULL;
+  GstEncodingProfile *prof;
+
+  profile = cheese_encoder_profile_lookup (priv->video_encoder);
+  if (profile != NULL)
+    encoder = cheese_encoder_profile_find_encoder (profile);
+
+  if (encoder == NULL)
+  {
+    if (priv->video_encoder != NULL)
+      g_warning ("No encoder found for the \"%s\" profile, using \"%s\"",
+                 priv->video_encoder, CHEESE_ENCODER_PROFILE_DEFAULT);
+
+    profile = cheese_encoder_profile_lookup (CHEESE_ENCODER_PROFILE_DEFAULT);
+    encoder = cheese_encoder_profile_find_encoder (profile);
+    if (encoder == NULL)
+    {
+      cheese_camera_set_error_element_not_found (error, "vp8enc");
+      return;
+    }
+  }
+
+  GST_INFO ("Recording with the \"%s\" profile, using %s",
+            cheese_encoder_profile_get_name (profile), encoder);
+
+  priv->encoder_profile = profile;
+  priv->encoder_factory = encoder;
+
+  prof = cheese_encoder_profile_create (profile, encoder);
+  g_object_set (priv->camerabin, "video-profile", prof, NULL);
+  gst_encoding_profile_unref (prof);
+}
+
+/*
+ * cheese_camera_apply_video_encoder:
+ * @camera: a #CheeseCamera
+ *
+ * Switch to the selected encoder profile. camerabin only takes a new
+ * video-profile up when going from NULL to READY, so a playing camera is
+ * restarted, and a recording in progress keeps its profile until it is
+ * done. The profile, the encoder and the file suffix are all switched here,
+ * together.
+ */
+static void
+cheese_camera_apply_video_encoder (CheeseCamera *camera)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  gboolean playing;
+
+  if (priv->is_recording)
+  {
+    priv->video_encoder_pending = TRUE;
+    return;
+  }
+  priv->video_encoder_pending = FALSE;
+
+  playing = priv->pipeline_is_playing;
+  if (playing)
+    cheese_camera_stop (camera);
+  cheese_camera_set_video_recording (camera, NULL);
+  if (playing)
+    cheese_camera_play (camera);
+}
+
+/*
+ * cheese_camera_encoder_probe:
+ * @pad: the sink or source pad of the video encoder
+ * @info: the #GstPadProbeInfo
+ * @counter: the frame counter to increment
+ *
+ * Count the frames going into or coming out of the video encoder.
+ *
+ * Returns: %GST_PAD_PROBE_OK
+ */
+static GstPadProbeReturn
+cheese_camera_encoder_probe (GstPad *pad, GstPadProbeInfo *info,
+                             volatile gint *counter)
+{
+  g_atomic_int_inc (counter);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/*
+ * cheese_camera_find_encoder_queue:
+ * @encoder: the video encoder
+ *
+ * Follow the stream upstream of the @encoder, through the conversion
+ * elements of encodebin, to the queue in front of it.
+ *
+ * Returns: (transfer full) (allow-none): the queue, or %NULL
+ */
+static GstElement *
+cheese_camera_find_encoder_queue (GstElement *encoder)
+{
+  GstElement *element = gst_object_ref (encoder);
+  guint i;
+
+  for (i = 0; i < 8; i++)
+  {
+    GstElementFactory *factory;
+    GstPad *pad, *peer;
+
+    pad = gst_element_get_static_pad (element, "sink");
+    gst_object_unref (element);
+    if (pad == NULL)
+      return NULL;
+    peer = gst_pad_get_peer (pad);
+    gst_object_unref (pad);
+    if (peer == NULL)
+      return NULL;
+    element = gst_pad_get_parent_element (peer);
+    gst_object_unref (peer);
+    if (element == NULL)
+      return NULL;
+
+    factory = gst_element_get_factory (element);
+    if (factory != NULL && strcmp (GST_OBJECT_NAME (factory), "queue") == 0)
+      return element;
+  }
+
+  gst_object_unref (element);
+  return NULL;
+}
+
+/*
+ * cheese_camera_governor_tick:
+ * @data: a #CheeseCamera
+ *
+ * Feed the encoder statistics of the last period to the governor, and apply
+ * the adjustment it decides on.
+ *
+ * Returns: %G_SOURCE_CONTINUE
+ */
+static gboolean
+cheese_camera_governor_tick (gpointer data)
+{
+  CheeseCamera *camera = CHEESE_CAMERA (data);
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  CheeseEncoderGovernorAction action;
+  gint64 now;
+  gint width = 640, height = 480;
+  guint queued = 0;
+
+  if (priv->encoder == NULL)
+    return G_SOURCE_CONTINUE;
+
+  if (priv->encoder_queue == NULL)
+    priv->encoder_queue = cheese_camera_find_encoder_queue (priv->encoder);
+  if (priv->encoder_queue != NULL)
+    g_object_get (priv->encoder_queue, "current-level-buffers", &queued, NULL);
+
+  if (priv->current_format != NULL)
+  {
+    width = priv->current_format->width;
+    height = priv->current_format->height;
+  }
+
+  if (priv->governor == NULL)
+  {
+    gint fps_n = 30, fps_d = 1;
+    GstCaps *caps;
+    GstPad *pad;
+
+    pad = gst_element_get_static_pad (priv->encoder, "sink");
+    caps = gst_pad_get_current_caps (pad);
+    if (caps != NULL)
+    {
+      gst_structure_get_fraction (gst_caps_get_structure (caps, 0),
+                                  "framerate", &fps_n, &fps_d);
+      gst_caps_unref (caps);
+    }
+    gst_object_unref (pad);
+
+    if (fps_n <= 0 || fps_d <= 0)
+    {
+      fps_n = 30;
+      fps_d = 1;
+    }
+
+    priv->governor = cheese_encoder_governor_new ((gdouble) fps_n / fps_d,
+                                                  CHEESE_ENCODER_PROFILE_SPEED_STEPS);
+    priv->governor_time = 0;
+  }
+
+  now = g_get_monotonic_time ();
+  action = cheese_encoder_governor_update (priv->governor,
+                                           g_atomic_int_get (&priv->encoder_frames_in),
+                                           g_atomic_int_get (&priv->encoder_frames_out),
+                                           priv->encoder_qos_events,
+                                           queued,
+                                           priv->governor_time > 0 ?
+                                           (now - priv->governor_time) / (gdouble) G_USEC_PER_SEC : 0);
+  priv->governor_time = now;
+
+  switch (action)
+  {
+    case CHEESE_ENCODER_GOVERNOR_KEEP:
+      return G_SOURCE_CONTINUE;
+    default:
+      cheese_encoder_profile_adjust (priv->encoder, width, height,
+                                     cheese_encoder_governor_get_speed_step (priv->governor),
+                                     cheese_encoder_governor_get_bitrate_scale (priv->governor));
+      break;
+  }
+
+  GST_INFO ("Encoder governor: %s (speed step %u, bitrate scale %.2f, "
+            "%u frames queued)",
+            cheese_encoder_governor_action_to_string (action),
+            cheese_encoder_governor_get_speed_step (priv->governor),
+            cheese_encoder_governor_get_bitrate_scale (priv->governor),
+            queued);
+  g_signal_emit (camera, camera_signals[ENCODER_ADJUSTED], 0,
+                 cheese_encoder_governor_action_to_string (action));
+
+  return G_SOURCE_CONTINUE;
+}
+
+/*
+ * cheese_camera_start_governor:
+ * @camera: a #CheeseCamera
+ *
+ * Start watching the video encoder of a recording. The encoder is reused from
+ * the previous recording, so the adjustments made during it are undone.
+ */
+static void
+cheese_camera_start_governor (CheeseCamera *camera)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+
+  if (priv->encoder != NULL)
+  {
+    gint width = 640, height = 480;
+
+    if (priv->current_format != NULL)
+    {
+      width = priv->current_format->width;
+      height = priv->current_format->height;
+    }
+    cheese_encoder_profile_configure (priv->encoder, width, height);
+  }
+
+  g_clear_pointer (&priv->governor, cheese_encoder_governor_free);
+  priv->governor_time = 0;
+  g_atomic_int_set (&priv->encoder_frames_in, 0);
+  g_atomic_int_set (&priv->encoder_frames_out, 0);
+  priv->encoder_qos_events = 0;
+
+  if (priv->governor_source == 0)
+    priv->governor_source = g_timeout_add_seconds (1,
+                                                   cheese_camera_governor_tick,
+                                                   camera);
+}
+
+/*
+ * cheese_camera_stop_governor:
+ * @camera: a #CheeseCamera
+ *
+ * Stop watching the video encoder, at the end of a recording.
+ */
+static void
+cheese_camera_stop_governor (CheeseCamera *camera)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+
+  if (priv->governor_source != 0)
+  {
+    g_source_remove (priv->governor_source);
+    priv->governor_source = 0;
+  }
+
+  g_clear_pointer (&priv->governor, cheese_encoder_governor_free);
+}
+
 /*
  * cheese_camera_bus_message_cb:
  * @bus: a #GstBus
@@ -216,11 +709,32 @@ cheese_camera_bus_message_cb (GstBus *bus, GstMessage *message, CheeseCamera *ca
         g_warning ("Unparsable GST_MESSAGE_ERROR message.\n");
       }
 
+      /* The device rejected a live format switch, open it again instead. */
+      if (priv->switch_source != 0)
+      {
+        g_source_remove (priv->switch_source);
+        priv->switch_source = 0;
+        cheese_camera_stop (camera);
+        cheese_camera_play (camera);
+        g_free (debug);
+        return;
+      }
+
       cheese_camera_stop (camera);
       g_signal_emit (camera, camera_signals[STATE_FLAGS_CHANGED], 0,
                      GST_STATE_NULL);
       g_free (debug);
     }
+    else if (type == GST_MESSAGE_QOS)
+    {
+      GstObject *encodebin;
+
+      /* Frames dropped by the encoder, or elsewhere in its encodebin. */
+      if (priv->encoder != NULL &&
+          (encodebin = GST_OBJECT_PARENT (priv->encoder)) != NULL &&
+          gst_object_has_as_ancestor (GST_MESSAGE_SRC (message), encodebin))
+        priv->encoder_qos_events++;
+    }
     else if (type == GST_MESSAGE_STATE_CHANGED)
     {
       if (strcmp (GST_MESSAGE_SRC_NAME (message), "camerabin") == 0)
@@ -274,8 +788,16 @@ cheese_camera_bus_message_cb (GstBus *bus, GstMessage *message, CheeseCamera *ca
         }
         else if (strcmp (gst_structure_get_name (structure), "video-done") == 0)
         {
+          cheese_camera_stop_governor (camera);
+          if (priv->force_stop_source != 0)
+          {
+            g_source_remove (priv->force_stop_source);
+            priv->force_stop_source = 0;
+          }
           g_signal_emit (camera, camera_signals[VIDEO_SAVED], 0);
           priv->is_recording = FALSE;
+          if (priv->video_encoder_pending)
+            cheese_camera_apply_video_encoder (camera);
         }
       }
     }
@@ -326,6 +848,30 @@ cheese_camera_remove_device (CheeseCameraDeviceMonitor *monitor,
   }
 }
 
+/*
+ * cheese_camera_add_unknown_device:
+ * @camera: a #CheeseCamera
+ * @device: a #CheeseCameraDevice
+ *
+ * Add @device to the list of current devices, unless the device monitor has
+ * already found it, so that stand-in devices for testing can be switched to.
+ */
+static void
+cheese_camera_add_unknown_device (CheeseCamera       *camera,
+                                  CheeseCameraDevice *device)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  guint i;
+
+  for (i = 0; i < priv->num_camera_devices; i++)
+  {
+    if (g_ptr_array_index (priv->camera_devices, i) == device)
+      return;
+  }
+
+  cheese_camera_add_device (priv->monitor, g_object_ref (device), camera);
+}
+
 /*
  * cheese_camera_detect_camera_devices:
  * @camera: a #CheeseCamera
@@ -356,182 +902,688 @@ cheese_camera_detect_camera_devices (CheeseCamera *camera)
  * @pad: new decode bin #GstPad
  *
  * A callback fired when a new source pad appears on the video source decodebin.
- * Exposes the pad as the source pad of @video_source #GstBin.
+ * Exposes the pad as the source pad of the branch #GstBin of its device.
  */
 static void
 cheese_camera_on_decodebin_pad_added (CheeseCamera *camera, GstPad *pad)
 {
-    CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+    GstElement *branch;
     GstPad *ghostpad;
 
-    ghostpad = gst_element_get_static_pad (priv->video_source, "src");
+    /* The decodebin is in the branch of its device. */
+    branch = GST_ELEMENT_PARENT (GST_PAD_PARENT (pad));
+    ghostpad = gst_element_get_static_pad (branch, "src");
     gst_ghost_pad_set_target (GST_GHOST_PAD (ghostpad), pad);
     gst_object_unref (ghostpad);
 }
 
 /*
- * cheese_camera_set_camera_source:
+ * cheese_camera_exchange_sample:
  * @camera: a #CheeseCamera
+ * @sample: (transfer full) (nullable): the new last frame of the source
  *
- * Set the currently-selected video capture device as the source for a video
- * steam.
+ * Store @sample as the last frame of the source, atomically.
  *
- * Returns: %TRUE if successful, %FALSE otherwise
+ * Returns: (transfer full) (nullable): the previous last frame
  */
-static gboolean
-cheese_camera_set_camera_source (CheeseCamera *camera)
+static GstSample *
+cheese_camera_exchange_sample (CheeseCamera *camera, GstSample *sample)
 {
-    CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
-    guint i;
-    CheeseCameraDevice *selected_camera;
-    GstElement *src, *filter, *decodebin;
-
-  if (priv->video_source)
-    gst_object_unref (priv->video_source);
-
-  /* If we have a matching video device use that one, otherwise use the first */
-  priv->selected_device = 0;
-  selected_camera = g_ptr_array_index (priv->camera_devices, 0);
-
-  for (i = 1; i < priv->num_camera_devices; i++)
-  {
-    CheeseCameraDevice *dev = g_ptr_array_index (priv->camera_devices, i);
-    if (dev == priv->device)
-    {
-      selected_camera       = dev;
-      priv->selected_device = i;
-      break;
-    }
-  }
-
-  priv->video_source = gst_bin_new (NULL);
-  if (priv->video_source == NULL)
-  {
-    return FALSE;
-  }
-
-  src = cheese_camera_device_get_src (selected_camera);
-  gst_bin_add (GST_BIN (priv->video_source), src);
-
-  filter = gst_element_factory_make ("capsfilter", "video_source_filter");
-  gst_bin_add (GST_BIN (priv->video_source), filter);
-
-    decodebin = gst_element_factory_make ("decodebin", NULL);
-    g_signal_connect_swapped (decodebin, "pad-added",
-                              G_CALLBACK (cheese_camera_on_decodebin_pad_added),
-                              camera);
-    gst_bin_add (GST_BIN (priv->video_source), decodebin);
-
-    gst_element_link_many (src, filter, decodebin, NULL);
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  GstSample *old;
 
-    gst_element_add_pad (priv->video_source,
-                         gst_ghost_pad_new_no_target ("src", GST_PAD_SRC));
+  do
+    old = g_atomic_pointer_get (&priv->source_sample);
+  while (!g_atomic_pointer_compare_and_exchange (&priv->source_sample, old, sample));
 
-  return TRUE;
+  return old;
 }
 
 /*
- * cheese_camera_set_error_element_not_found:
- * @error: return location for errors, or %NULL
- * @factoryname: the name of the #GstElement which was not found
+ * cheese_camera_source_set_caps:
+ * @camera: a #CheeseCamera
+ * @caps: (allow-none): the new caps of the source
  *
- * Create a #GError to warn that a required GStreamer element was not found.
+ * Start tracking the frames of a source with @caps. Called from the tracking
+ * thread, or while no source is tracked.
  */
 static void
-cheese_camera_set_error_element_not_found (GError **error, const gchar *factoryname)
+cheese_camera_source_set_caps (CheeseCamera *camera, GstCaps *caps)
 {
-  g_return_if_fail (error == NULL || *error == NULL);
-
-  g_set_error (error, CHEESE_CAMERA_ERROR, CHEESE_CAMERA_ERROR_ELEMENT_NOT_FOUND, "%s%s.", _("One or more needed GStreamer elements are missing: "), factoryname);
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  GstSample *sample;
+  gboolean compressed;
+
+  compressed = caps != NULL &&
+               gst_structure_has_name (gst_caps_get_structure (caps, 0),
+                                       "image/jpeg");
+  g_atomic_int_set (&priv->source_compressed, compressed);
+  cheese_frame_ring_clear (priv->preroll_ring);
+
+  sample = cheese_camera_exchange_sample (camera, NULL);
+  if (sample != NULL)
+    gst_sample_unref (sample);
+  gst_caps_replace (&priv->source_caps, compressed ? caps : NULL);
 }
 
 /*
- * cheese_camera_set_video_recording:
+ * cheese_camera_source_switched:
  * @camera: a #CheeseCamera
- * @error: a return location for errors, or %NULL
+ * @pad: the source pad of the newly selected video_source_filter
  *
+ * Pick up the sticky caps and segment of @pad, which were sent before it was
+ * selected. Called from the tracking thread.
  */
 static void
-cheese_camera_set_video_recording (CheeseCamera *camera, GError **error)
+cheese_camera_source_switched (CheeseCamera *camera, GstPad *pad)
 {
   CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
-  GstEncodingContainerProfile *prof;
-  GstEncodingVideoProfile *v_prof;
+  GstEvent *event;
   GstCaps *caps;
-  GstElement *video_enc;
-  const gchar *video_preset;
-  gboolean res;
-
-  /* Check if we can use global preset for vp8enc. */
-  video_enc = gst_element_factory_make ("vp8enc", "vp8enc");
-  video_preset = (gchar *) &CHEESE_VIDEO_ENC_PRESET;
-  res = gst_preset_load_preset (GST_PRESET (video_enc), video_preset);
-  if (res == FALSE) {
-    g_warning("Can't find vp8enc preset: \"%s\", using alternate preset:"
-        " \"%s\". If you see this, make a bug report!",
-        video_preset, CHEESE_VIDEO_ENC_ALT_PRESET);
-
-    /* If global preset not found, then probably we use wrong preset name,
-     * or old gstreamer version. In any case, we should try to control
-     * keep poker face and not fail. DON'T FORGET TO MAKE A BUG REPORT!*/
-    video_preset = (gchar *) &CHEESE_VIDEO_ENC_ALT_PRESET;
-    res = gst_preset_load_preset (GST_PRESET (video_enc), video_preset);
-    if (res == FALSE) {
-      g_warning ("Can't find vp8enc preset: \"%s\", "
-          "creating new userspace preset.", video_preset);
-
-      /* Seems like we do first run and userspace preset do not exist.
-       * Let us create a new one. It will be probably located some where here:
-       * ~/.local/share/gstreamer-1.0/presets/GstVP8Enc.prs */
-      g_object_set (G_OBJECT (video_enc), "speed", 2, NULL);
-      g_object_set (G_OBJECT (video_enc), "max-latency", 1, NULL);
-      gst_preset_save_preset (GST_PRESET (video_enc), video_preset);
-    }
-  }
-  gst_object_unref(video_enc);
-
-  /* create profile for webm encoding */
-  caps = gst_caps_from_string("video/webm");
-  prof = gst_encoding_container_profile_new("WebM audio/video",
-      "Standard WebM/VP8/Vorbis",
-      caps, NULL);
-  gst_caps_unref (caps);
 
-  caps = gst_caps_from_string("video/x-vp8");
-  v_prof = gst_encoding_video_profile_new(caps, NULL, NULL, 0);
-  gst_encoding_video_profile_set_variableframerate(v_prof, TRUE);
-  gst_encoding_profile_set_preset((GstEncodingProfile*) v_prof, video_preset);
-  gst_encoding_container_profile_add_profile(prof, (GstEncodingProfile*) v_prof);
-  gst_caps_unref (caps);
-
-  caps = gst_caps_from_string("audio/x-vorbis");
-  gst_encoding_container_profile_add_profile(prof,
-      (GstEncodingProfile*) gst_encoding_audio_profile_new(caps, NULL, NULL, 0));
-  gst_caps_unref (caps);
+  event = gst_pad_get_sticky_event (pad, GST_EVENT_SEGMENT, 0);
+  if (event != NULL)
+  {
+    gst_event_copy_segment (event, &priv->source_segment);
+    gst_event_unref (event);
+  }
+  else
+  {
+    gst_segment_init (&priv->source_segment, GST_FORMAT_TIME);
+  }
 
-  g_object_set (priv->camerabin, "video-profile", prof, NULL);
-  gst_encoding_profile_unref (prof);
+  caps = gst_pad_get_current_caps (pad);
+  cheese_camera_source_set_caps (camera, caps);
+  if (caps != NULL)
+    gst_caps_unref (caps);
 }
 
 /*
- * cheese_camera_create_effects_preview_bin:
+ * cheese_camera_source_probe:
+ * @pad: the source pad of a video_source_filter
+ * @info: the #GstPadProbeInfo
  * @camera: a #CheeseCamera
- * @error: a return location for errors
  *
- * Create the #GstBin for effect previews.
+ * Keep a reference to the last frame coming from the camera while it produces
+ * JPEG, so that cheese_camera_take_photo() can save it without decoding and
+ * encoding it again, and keep the last seconds of frames for the pre-roll of
+ * recordings. Frames of the branches which are kept warm but not selected are
+ * ignored.
  *
- * Returns: %TRUE if the bin creation was successful, %FALSE otherwise
+ * Returns: %GST_PAD_PROBE_OK
  */
-static gboolean
-cheese_camera_create_effects_preview_bin (CheeseCamera *camera, GError **error)
+static GstPadProbeReturn
+cheese_camera_source_probe (GstPad *pad, GstPadProbeInfo *info,
+                            CheeseCamera *camera)
 {
-    CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
-
-  gboolean ok = TRUE;
-  GstElement *scale;
-  GstPad  *pad;
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  GstBuffer *copy = NULL;
+  GstClockTime duration = 0;
 
-  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+  if (pad != g_atomic_pointer_get (&priv->source_pad))
+    return GST_PAD_PROBE_OK;
+
+  /* Copy before claiming the source, the driver only has a few buffers to
+   * capture into. */
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER)
+  {
+    duration = g_atomic_int_get (&priv->preroll_duration) * GST_SECOND;
+    if (duration > 0 && g_atomic_int_get (&priv->source_compressed))
+      copy = gst_buffer_copy_deep (GST_PAD_PROBE_INFO_BUFFER (info));
+  }
+
+  /* Only while a branch is switched can a frame of the previous one still be
+   * in here; drop ours rather than wait for it, and let the previous branch
+   * go once it sees the switch. */
+  if (!g_atomic_int_compare_and_exchange (&priv->source_busy, FALSE, TRUE))
+  {
+    if (copy != NULL)
+      gst_buffer_unref (copy);
+    return GST_PAD_PROBE_OK;
+  }
+  if (pad != g_atomic_pointer_get (&priv->source_pad))
+  {
+    g_atomic_int_set (&priv->source_busy, FALSE);
+    if (copy != NULL)
+      gst_buffer_unref (copy);
+    return GST_PAD_PROBE_OK;
+  }
+
+  if (g_atomic_int_compare_and_exchange (&priv->source_switched, TRUE, FALSE))
+    cheese_camera_source_switched (camera, pad);
+
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER)
+  {
+    GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+    GstSample *sample;
+
+    if (priv->source_caps != NULL)
+    {
+      sample = gst_sample_new (buffer, priv->source_caps, NULL, NULL);
+      sample = cheese_camera_exchange_sample (camera, sample);
+      if (sample != NULL)
+        gst_sample_unref (sample);
+    }
+
+    cheese_frame_ring_set_max_duration (priv->preroll_ring, duration);
+    if (copy != NULL)
+    {
+      cheese_frame_ring_push (priv->preroll_ring, copy,
+                              gst_segment_to_running_time (&priv->source_segment,
+                                                           GST_FORMAT_TIME,
+                                                           GST_BUFFER_PTS (buffer)));
+    }
+  }
+  else if (GST_EVENT_TYPE (GST_PAD_PROBE_INFO_EVENT (info)) == GST_EVENT_SEGMENT)
+  {
+    gst_event_copy_segment (GST_PAD_PROBE_INFO_EVENT (info),
+                            &priv->source_segment);
+  }
+  else if (GST_EVENT_TYPE (GST_PAD_PROBE_INFO_EVENT (info)) == GST_EVENT_CAPS)
+  {
+    GstCaps *caps;
+
+    gst_event_parse_caps (GST_PAD_PROBE_INFO_EVENT (info), &caps);
+    cheese_camera_source_set_caps (camera, caps);
+  }
+
+  g_atomic_int_set (&priv->source_busy, FALSE);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/*
+ * cheese_camera_format_switched:
+ * @data: a #CheeseCamera
+ *
+ * Record the time the last format switch took, once frames of the new format
+ * are shown.
+ *
+ * Returns: %G_SOURCE_REMOVE
+ */
+static gboolean
+cheese_camera_format_switched (gpointer data)
+{
+  CheeseCamera *camera = CHEESE_CAMERA (data);
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+
+  if (priv->switch_source != 0)
+  {
+    g_source_remove (priv->switch_source);
+    priv->switch_source = 0;
+  }
+
+  priv->format_switch_time = (g_get_monotonic_time () - priv->switch_start) /
+                             G_TIME_SPAN_MILLISECOND;
+  GST_INFO_OBJECT (camera, "Switched to %dx%d in %u ms", priv->switch_width,
+                   priv->switch_height, priv->format_switch_time);
+  g_object_notify_by_pspec (G_OBJECT (camera),
+                            properties[PROP_FORMAT_SWITCH_TIME]);
+
+  return G_SOURCE_REMOVE;
+}
+
+/*
+ * cheese_camera_burst_photo_saved:
+ * @filename: the file which was written
+ * @error: the error which occurred, or %NULL
+ * @user_data: a #CheeseCamera
+ *
+ * Emit the ::burst-photo-saved signal, and ::burst-done after the last photo
+ * of the burst.
+ */
+static void
+cheese_camera_burst_photo_saved (const gchar  *filename,
+                                 const GError *error,
+                                 gpointer      user_data)
+{
+  CheeseCamera *camera = CHEESE_CAMERA (user_data);
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+
+  if (error != NULL)
+    g_warning ("Could not save %s: %s", filename, error->message);
+  else
+    g_signal_emit (camera, camera_signals[BURST_PHOTO_SAVED], 0, filename);
+
+  if (--priv->burst_pending == 0)
+  {
+    g_clear_pointer (&priv->burst_tags, gst_tag_list_unref);
+    g_signal_emit (camera, camera_signals[BURST_DONE], 0);
+  }
+
+  g_object_unref (camera);
+}
+
+/*
+ * cheese_camera_burst_frame:
+ * @camera: a #CheeseCamera
+ * @buffer: the frame as shown
+ * @running_time: the running time of @buffer
+ *
+ * Queue @buffer as the next photo of the burst, if it is due. Called from the
+ * streaming thread with the still_lock held.
+ */
+static void
+cheese_camera_burst_frame (CheeseCamera *camera, GstBuffer *buffer,
+                           GstClockTime running_time)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  GstSample *sample;
+  GstBuffer *copy;
+  gchar *filename;
+
+  if (g_queue_is_empty (&priv->burst_names) ||
+      (GST_CLOCK_TIME_IS_VALID (priv->burst_next) &&
+       GST_CLOCK_TIME_IS_VALID (running_time) &&
+       running_time < priv->burst_next))
+    return;
+
+  if (GST_CLOCK_TIME_IS_VALID (running_time))
+    priv->burst_next = running_time + priv->burst_interval;
+
+  /* Copy, a burst can queue up more frames than the pools have. */
+  copy = gst_buffer_copy_deep (buffer);
+  sample = gst_sample_new (copy, priv->still_caps, NULL, NULL);
+  filename = g_queue_pop_head (&priv->burst_names);
+
+  /* The callback runs in the default main context. */
+  cheese_still_writer_save (priv->still_writer, sample, filename,
+                            priv->burst_tags, cheese_camera_burst_photo_saved,
+                            g_object_ref (camera));
+
+  g_free (filename);
+  gst_sample_unref (sample);
+  gst_buffer_unref (copy);
+}
+
+/*
+ * cheese_camera_still_probe:
+ * @pad: the src pad of the video_balance
+ * @info: the #GstPadProbeInfo
+ * @camera: a #CheeseCamera
+ *
+ * Keep references to the last frames as shown, effect and balance applied,
+ * so that cheese_camera_take_photo() can save the one closest to the request,
+ * grab the frames of a burst, and count the frames for
+ * #CheeseCamera:achieved-frame-rate.
+ *
+ * Returns: %GST_PAD_PROBE_OK
+ */
+static GstPadProbeReturn
+cheese_camera_still_probe (GstPad *pad, GstPadProbeInfo *info,
+                           CheeseCamera *camera)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER)
+  {
+    GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+    GstClockTime running_time;
+
+    running_time = gst_segment_to_running_time (&priv->still_segment,
+                                                GST_FORMAT_TIME,
+                                                GST_BUFFER_PTS (buffer));
+    g_atomic_int_inc (&priv->rate_frames);
+
+    g_mutex_lock (&priv->still_lock);
+    if (priv->still_caps != NULL)
+    {
+      if (g_atomic_int_get (&priv->zero_shutter_lag))
+        cheese_frame_ring_push (priv->still_ring, gst_buffer_ref (buffer),
+                                running_time);
+      cheese_camera_burst_frame (camera, buffer, running_time);
+    }
+    g_mutex_unlock (&priv->still_lock);
+  }
+  else if (GST_EVENT_TYPE (GST_PAD_PROBE_INFO_EVENT (info)) == GST_EVENT_SEGMENT)
+  {
+    gst_event_copy_segment (GST_PAD_PROBE_INFO_EVENT (info),
+                            &priv->still_segment);
+  }
+  else if (GST_EVENT_TYPE (GST_PAD_PROBE_INFO_EVENT (info)) == GST_EVENT_CAPS)
+  {
+    GstCaps *caps;
+
+    gst_event_parse_caps (GST_PAD_PROBE_INFO_EVENT (info), &caps);
+
+    g_mutex_lock (&priv->still_lock);
+    cheese_frame_ring_clear (priv->still_ring);
+    gst_caps_replace (&priv->still_caps, caps);
+    g_mutex_unlock (&priv->still_lock);
+
+    if (g_atomic_int_get (&priv->switch_pending))
+    {
+      GstStructure *structure = gst_caps_get_structure (caps, 0);
+      gint width, height;
+
+      if (gst_structure_get_int (structure, "width", &width) &&
+          gst_structure_get_int (structure, "height", &height) &&
+          width == priv->switch_width && height == priv->switch_height &&
+          g_atomic_int_compare_and_exchange (&priv->switch_pending, TRUE, FALSE))
+        g_idle_add_full (G_PRIORITY_DEFAULT, cheese_camera_format_switched,
+                         g_object_ref (camera), g_object_unref);
+    }
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+/*
+ * cheese_camera_create_source_branch:
+ * @camera: a #CheeseCamera
+ * @device: the #CheeseCameraDevice to capture from
+ *
+ * Create the branch of the video_source for @device: src !
+ * video_source_filter ! video_source_tee ! decodebin, exposed through a "src"
+ * ghost pad. The filter asks for the current format, or the best format of
+ * @device if it does not support it.
+ *
+ * Returns: (transfer floating): a new #GstBin
+ */
+static GstElement *
+cheese_camera_create_source_branch (CheeseCamera *camera,
+                                    CheeseCameraDevice *device)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  GstElement *branch, *src, *filter, *tee, *decodebin;
+  GstCaps *caps;
+  GstPad *pad;
+
+  branch = gst_bin_new (NULL);
+  g_object_set_data_full (G_OBJECT (branch), "cheese-camera-device",
+                          g_object_ref (device), g_object_unref);
+
+  src = cheese_camera_device_get_src (device);
+  gst_bin_add (GST_BIN (branch), src);
+
+  filter = gst_element_factory_make ("capsfilter", "video_source_filter");
+  caps = cheese_camera_device_get_caps_for_format_at_rate (device,
+                                                          priv->current_format,
+                                                          priv->high_frame_rate);
+  if (gst_caps_is_empty (caps))
+  {
+    CheeseVideoFormat *format = cheese_camera_device_get_best_format (device);
+
+    gst_caps_unref (caps);
+    caps = cheese_camera_device_get_caps_for_format_at_rate (device, format,
+                                                            priv->high_frame_rate);
+    g_boxed_free (CHEESE_TYPE_VIDEO_FORMAT, format);
+  }
+  g_object_set (G_OBJECT (filter), "caps", caps, NULL);
+  gst_caps_unref (caps);
+  gst_bin_add (GST_BIN (branch), filter);
+
+  pad = gst_element_get_static_pad (filter, "src");
+  gst_pad_add_probe (pad,
+                     GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+                     (GstPadProbeCallback) cheese_camera_source_probe,
+                     camera, NULL);
+  gst_object_unref (pad);
+
+  /* The tee lets the compressed frames be recorded as they are. */
+  tee = gst_element_factory_make ("tee", "video_source_tee");
+  g_object_set (G_OBJECT (tee), "allow-not-linked", TRUE, NULL);
+  gst_bin_add (GST_BIN (branch), tee);
+
+  decodebin = gst_element_factory_make ("decodebin", NULL);
+  g_signal_connect_swapped (decodebin, "pad-added",
+                            G_CALLBACK (cheese_camera_on_decodebin_pad_added),
+                            camera);
+  gst_bin_add (GST_BIN (branch), decodebin);
+
+  gst_element_link_many (src, filter, tee, decodebin, NULL);
+
+  gst_element_add_pad (branch, gst_ghost_pad_new_no_target ("src", GST_PAD_SRC));
+
+  return branch;
+}
+
+/*
+ * cheese_camera_get_branch_device:
+ * @branch: a branch of the video_source
+ *
+ * Returns: (transfer none): the #CheeseCameraDevice @branch captures from
+ */
+static CheeseCameraDevice *
+cheese_camera_get_branch_device (GstElement *branch)
+{
+  return g_object_get_data (G_OBJECT (branch), "cheese-camera-device");
+}
+
+/*
+ * cheese_camera_select_branch:
+ * @camera: a #CheeseCamera
+ * @branch: the branch of the video_source to show
+ *
+ * Track the frames of @branch from now on, and show them if there is a
+ * source_selector.
+ */
+static void
+cheese_camera_select_branch (CheeseCamera *camera, GstElement *branch)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  GstElement *filter;
+  GstPad *pad;
+
+  priv->source_branch = branch;
+
+  filter = gst_bin_get_by_name (GST_BIN (branch), "video_source_filter");
+  pad = gst_element_get_static_pad (filter, "src");
+
+  g_atomic_int_set (&priv->source_switched, TRUE);
+  g_atomic_pointer_set (&priv->source_pad, pad);
+
+  /* The pad stays alive with its branch. */
+  gst_object_unref (pad);
+  gst_object_unref (filter);
+
+  if (priv->source_selector != NULL)
+  {
+    GstPad *src = gst_element_get_static_pad (branch, "src");
+    GstPad *peer = gst_pad_get_peer (src);
+
+    g_object_set (G_OBJECT (priv->source_selector), "active-pad", peer, NULL);
+    gst_object_unref (peer);
+    gst_object_unref (src);
+  }
+}
+
+/*
+ * cheese_camera_estimate_source_size:
+ * @device: a #CheeseCameraDevice
+ *
+ * Estimate the memory an open @device takes: a few frames of its best format
+ * in a packed 4:2:2 layout, as most webcams capture.
+ *
+ * Returns: the estimated size in bytes
+ */
+static guint64
+cheese_camera_estimate_source_size (CheeseCameraDevice *device)
+{
+  CheeseVideoFormat *format;
+  guint64 size;
+
+  format = cheese_camera_device_get_best_format (device);
+  size = (guint64) format->width * format->height * 2 *
+         CHEESE_CAMERA_WARM_SOURCE_BUFFERS;
+  g_boxed_free (CHEESE_TYPE_VIDEO_FORMAT, format);
+
+  return size;
+}
+
+/*
+ * cheese_camera_set_camera_source:
+ * @camera: a #CheeseCamera
+ *
+ * Build the video_source for the selected device. With
+ * #CheeseCamera:max-warm-sources above one, the following devices are opened
+ * as well, within #CheeseCamera:warm-source-budget, behind an input-selector,
+ * so that cheese_camera_switch_camera_device() can switch to them at once.
+ *
+ * Returns: %TRUE on success
+ */
+static gboolean
+cheese_camera_set_camera_source (CheeseCamera *camera)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  CheeseCameraDevice *selected_camera;
+  GstElement *branch;
+  guint64 budget, used;
+  guint i, warm;
+  GstPad *pad;
+
+  if (priv->video_source)
+    gst_object_unref (priv->video_source);
+  priv->source_branch = NULL;
+  priv->source_selector = NULL;
+  g_ptr_array_set_size (priv->source_branches, 0);
+
+  g_atomic_pointer_set (&priv->source_pad, NULL);
+  cheese_camera_source_set_caps (camera, NULL);
+
+  /* If we have a matching video device use that one, otherwise use the first */
+  priv->selected_device = 0;
+  selected_camera = g_ptr_array_index (priv->camera_devices, 0);
+
+  for (i = 1; i < priv->num_camera_devices; i++)
+  {
+    CheeseCameraDevice *dev = g_ptr_array_index (priv->camera_devices, i);
+    if (dev == priv->device)
+    {
+      selected_camera       = dev;
+      priv->selected_device = i;
+      break;
+    }
+  }
+
+  priv->video_source = gst_bin_new (NULL);
+  if (priv->video_source == NULL)
+  {
+    return FALSE;
+  }
+
+  branch = cheese_camera_create_source_branch (camera, selected_camera);
+  gst_bin_add (GST_BIN (priv->video_source), branch);
+  g_ptr_array_add (priv->source_branches, branch);
+
+  warm = MIN (priv->max_warm_sources, priv->num_camera_devices);
+  if (warm < 2)
+  {
+    pad = gst_element_get_static_pad (branch, "src");
+    gst_element_add_pad (priv->video_source, gst_ghost_pad_new ("src", pad));
+    gst_object_unref (pad);
+
+    cheese_camera_select_branch (camera, branch);
+    return TRUE;
+  }
+
+  priv->source_selector = gst_element_factory_make ("input-selector",
+                                                    "video_source_selector");
+  g_object_set (G_OBJECT (priv->source_selector), "sync-streams", FALSE, NULL);
+  gst_bin_add (GST_BIN (priv->video_source), priv->source_selector);
+  gst_element_link (branch, priv->source_selector);
+
+  /* Keep the devices after the selected one open, as far as the budget goes. */
+  budget = (guint64) priv->warm_source_budget * 1024 * 1024;
+  used = cheese_camera_estimate_source_size (selected_camera);
+  for (i = 1; i < warm; i++)
+  {
+    CheeseCameraDevice *dev;
+    guint64 size;
+
+    dev = g_ptr_array_index (priv->camera_devices,
+                             (priv->selected_device + i) % priv->num_camera_devices);
+    size = cheese_camera_estimate_source_size (dev);
+    if (budget > 0 && used + size > budget)
+      break;
+    used += size;
+
+    GST_INFO ("Keeping %s open", cheese_camera_device_get_name (dev));
+    branch = cheese_camera_create_source_branch (camera, dev);
+    gst_bin_add (GST_BIN (priv->video_source), branch);
+    gst_element_link (branch, priv->source_selector);
+    g_ptr_array_add (priv->source_branches, branch);
+  }
+
+  pad = gst_element_get_static_pad (priv->source_selector, "src");
+  gst_element_add_pad (priv->video_source, gst_ghost_pad_new ("src", pad));
+  gst_object_unref (pad);
+
+  cheese_camera_select_branch (camera, g_ptr_array_index (priv->source_branches, 0));
+
+  return TRUE;
+}
+
+/*
+ * cheese_camera_deep_element_added:
+ * @bin: the camerabin
+ * @sub_bin: the bin to which @element was added
+ * @element: the new #GstElement
+ * @camera: a #CheeseCamera
+ *
+ * Configure the video encoder when encodebin creates it, for the resolution
+ * which is being recorded.
+ */
+static void
+cheese_camera_deep_element_added (GstBin       *bin,
+                                  GstBin       *sub_bin,
+                                  GstElement   *element,
+                                  CheeseCamera *camera)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  GstElementFactory *factory;
+  gint width = 640, height = 480;
+  GstPad *pad;
+
+  factory = gst_element_get_factory (element);
+  if (factory == NULL || priv->encoder_factory == NULL ||
+      strcmp (GST_OBJECT_NAME (factory), priv->encoder_factory) != 0)
+    return;
+
+  if (priv->current_format != NULL)
+  {
+    width = priv->current_format->width;
+    height = priv->current_format->height;
+  }
+
+  cheese_encoder_profile_configure (element, width, height);
+
+  g_clear_object (&priv->encoder);
+  g_clear_object (&priv->encoder_queue);
+  priv->encoder = gst_object_ref (element);
+
+  pad = gst_element_get_static_pad (element, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER,
+                     (GstPadProbeCallback) cheese_camera_encoder_probe,
+                     (gpointer) &priv->encoder_frames_in, NULL);
+  gst_object_unref (pad);
+
+  pad = gst_element_get_static_pad (element, "src");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER,
+                     (GstPadProbeCallback) cheese_camera_encoder_probe,
+                     (gpointer) &priv->encoder_frames_out, NULL);
+  gst_object_unref (pad);
+}
+
+/*
+ * cheese_camera_create_effects_preview_bin:
+ * @camera: a #CheeseCamera
+ * @error: a return location for errors
+ *
+ * Create the #GstBin for effect previews.
+ *
+ * Returns: %TRUE if the bin creation was successful, %FALSE otherwise
+ */
+static gboolean
+cheese_camera_create_effects_preview_bin (CheeseCamera *camera, GError **error)
+{
+    CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+
+  gboolean ok = TRUE;
+  GstElement *scale;
+  GstPad  *pad;
+
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
   priv->effects_preview_bin = gst_bin_new ("effects_preview_bin");
 
@@ -546,6 +1598,8 @@ cheese_camera_create_effects_preview_bin (CheeseCamera *camera, GError **error)
     cheese_camera_set_error_element_not_found (error, "videoscale");
     return FALSE;
   }
+  /* The previews are small, nearest neighbour scaling is good enough. */
+  g_object_set (G_OBJECT (scale), "method", 0, NULL);
   if ((priv->effects_capsfilter = gst_element_factory_make ("capsfilter", "effects_capsfilter")) == NULL)
   {
     cheese_camera_set_error_element_not_found (error, "capsfilter");
@@ -613,7 +1667,11 @@ cheese_camera_create_video_filter_bin (CheeseCamera *camera, GError **error)
     return FALSE;
   }
   priv->current_effect_desc = g_strdup("identity");
-  if ((priv->video_balance = gst_element_factory_make ("videobalance", "video_balance")) == NULL)
+  /* The fused kernel passes frames through while the balance is neutral,
+   * and applies it from lookup tables otherwise. It has the properties of
+   * videobalance, which stands in if libcheese was not initialized. */
+  if ((priv->video_balance = gst_element_factory_make ("cheesekernel", "video_balance")) == NULL &&
+      (priv->video_balance = gst_element_factory_make ("videobalance", "video_balance")) == NULL)
   {
     cheese_camera_set_error_element_not_found (error, "videobalance");
     return FALSE;
@@ -634,6 +1692,10 @@ cheese_camera_create_video_filter_bin (CheeseCamera *camera, GError **error)
   /* add ghostpads */
 
   pad = gst_element_get_static_pad (priv->video_balance, "src");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER |
+                     GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+                     (GstPadProbeCallback) cheese_camera_still_probe,
+                     camera, NULL);
   gst_element_add_pad (priv->video_filter_bin, gst_ghost_pad_new ("src", pad));
   gst_object_unref (GST_OBJECT (pad));
 
@@ -689,16 +1751,72 @@ cheese_camera_get_selected_device (CheeseCamera *camera)
     return NULL;
 }
 
-/**
- * cheese_camera_switch_camera_device:
+/*
+ * cheese_camera_switch_to_warm_source:
  * @camera: a #CheeseCamera
  *
- * Toggle the playing/recording state of the @camera.
+ * Switch to #CheeseCamera:device if it is kept open behind the
+ * source_selector, without stopping the pipeline.
+ *
+ * Returns: %TRUE if the device was switched to, %FALSE if the video_source
+ * has to be rebuilt
  */
-void
-cheese_camera_switch_camera_device (CheeseCamera *camera)
+static gboolean
+cheese_camera_switch_to_warm_source (CheeseCamera *camera)
 {
-  CheeseCameraPrivate *priv;
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  GstElement *branch = NULL;
+  gint64 start;
+  guint i;
+
+  if (priv->source_selector == NULL)
+    return FALSE;
+
+  for (i = 0; i < priv->source_branches->len; i++)
+  {
+    GstElement *b = g_ptr_array_index (priv->source_branches, i);
+
+    if (cheese_camera_get_branch_device (b) == priv->device)
+    {
+      branch = b;
+      break;
+    }
+  }
+
+  if (branch == NULL)
+    return FALSE;
+
+  for (i = 0; i < priv->num_camera_devices; i++)
+  {
+    if (g_ptr_array_index (priv->camera_devices, i) == priv->device)
+    {
+      priv->selected_device = i;
+      break;
+    }
+  }
+  if (i == priv->num_camera_devices)
+    return FALSE;
+
+  start = g_get_monotonic_time ();
+  cheese_camera_select_branch (camera, branch);
+  cheese_camera_set_new_caps (camera);
+  GST_INFO ("Switched to %s in %" G_GINT64_FORMAT " us",
+            cheese_camera_device_get_name (priv->device),
+            g_get_monotonic_time () - start);
+
+  return TRUE;
+}
+
+/**
+ * cheese_camera_switch_camera_device:
+ * @camera: a #CheeseCamera
+ *
+ * Toggle the playing/recording state of the @camera.
+ */
+void
+cheese_camera_switch_camera_device (CheeseCamera *camera)
+{
+  CheeseCameraPrivate *priv;
   gboolean pipeline_was_playing;
 
   g_return_if_fail (CHEESE_IS_CAMERA (camera));
@@ -714,6 +1832,9 @@ cheese_camera_switch_camera_device (CheeseCamera *camera)
     /* was_recording = TRUE; */
   }
 
+  if (priv->pipeline_is_playing && cheese_camera_switch_to_warm_source (camera))
+    return;
+
   if (priv->pipeline_is_playing)
   {
     cheese_camera_stop (camera);
@@ -741,20 +1862,261 @@ cheese_camera_switch_camera_device (CheeseCamera *camera)
  * playing.
  */
 
+/*
+ * cheese_camera_update_frame_rate:
+ * @data: a #CheeseCamera
+ *
+ * Work out the framerate achieved after the balance since the last update,
+ * for #CheeseCamera:achieved-frame-rate.
+ *
+ * Returns: %G_SOURCE_CONTINUE
+ */
+static gboolean
+cheese_camera_update_frame_rate (gpointer data)
+{
+  CheeseCamera *camera = CHEESE_CAMERA (data);
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  gint64 now = g_get_monotonic_time ();
+  gint frames;
+  gdouble rate;
+
+  frames = g_atomic_int_get (&priv->rate_frames);
+  g_atomic_int_add (&priv->rate_frames, -frames);
+  rate = frames * (gdouble) G_TIME_SPAN_SECOND / MAX (now - priv->rate_start, 1);
+  priv->rate_start = now;
+
+  if (priv->high_frame_rate != 0 && rate < 0.9 * priv->high_frame_rate)
+    GST_INFO_OBJECT (camera, "Achieved %.1f of %u FPS", rate,
+                     priv->high_frame_rate);
+
+  if (ABS (rate - priv->achieved_frame_rate) >= 0.5)
+  {
+    priv->achieved_frame_rate = rate;
+    g_object_notify_by_pspec (G_OBJECT (camera),
+                              properties[PROP_ACHIEVED_FRAME_RATE]);
+  }
+
+  return G_SOURCE_CONTINUE;
+}
+
+/*
+ * cheese_camera_configure_preview_queue:
+ * @camera: a #CheeseCamera
+ * @queue: the queue of an effect preview
+ *
+ * In high frame rate mode, let the queues of the effect previews only hold
+ * the latest frame, dropping the older ones, rather than delaying the
+ * previews by up to a second of frames.
+ */
+static void
+cheese_camera_configure_preview_queue (CheeseCamera *camera, GObject *queue)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+
+  if (priv->high_frame_rate != 0)
+    g_object_set (queue, "leaky", 2, "max-size-buffers", 1,
+                  "max-size-bytes", 0, "max-size-time", G_GUINT64_CONSTANT (0),
+                  NULL);
+  else
+    g_object_set (queue, "leaky", 0, "max-size-buffers", 200,
+                  "max-size-bytes", 10 * 1024 * 1024,
+                  "max-size-time", GST_SECOND, NULL);
+}
+
+static void
+cheese_camera_configure_preview_queue_foreach (const GValue *item,
+                                               gpointer      data)
+{
+  GObject *element = g_value_get_object (item);
+
+  if (g_object_get_data (element, "cheese-preview-queue") != NULL)
+    cheese_camera_configure_preview_queue (CHEESE_CAMERA (data), element);
+}
+
+/*
+ * cheese_camera_apply_frame_rate_mode:
+ * @camera: a #CheeseCamera
+ *
+ * Tune the pipeline for the high frame rate mode, or back: the effect
+ * previews, which cannot keep up with a high framerate, are turned off,
+ * their queues made leaky, and a headless viewfinder only keeps the latest
+ * frame.
+ */
+static void
+cheese_camera_apply_frame_rate_mode (CheeseCamera *camera)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  gboolean high = priv->high_frame_rate != 0;
+  GstIterator *iter;
+
+  if (priv->video_filter_bin == NULL)
+    return;
+
+  iter = gst_bin_iterate_elements (GST_BIN (priv->video_filter_bin));
+  gst_iterator_foreach (iter, cheese_camera_configure_preview_queue_foreach,
+                        camera);
+  gst_iterator_free (iter);
+
+  if (priv->effect_pipeline_is_playing)
+    g_object_set (G_OBJECT (priv->effects_valve), "drop", high, NULL);
+
+  if (priv->frame_sink != NULL)
+    g_object_set (G_OBJECT (priv->frame_sink), "max-buffers", high ? 1 : 2,
+                  NULL);
+}
+
+/*
+ * cheese_camera_get_mosaic_cell_size:
+ * @camera: a #CheeseCamera
+ * @width: (out): return location for the width of a cell
+ * @height: (out): return location for the height of a cell
+ *
+ * Work out the size of the cells of a mosaic, one effect preview each.
+ */
+static void
+cheese_camera_get_mosaic_cell_size (CheeseCamera *camera,
+                                    gint *width, gint *height)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  gint preview_width = 640, preview_height = 480;
+  GstStructure *structure;
+  GstCaps *caps;
+
+  g_object_get (G_OBJECT (priv->effects_capsfilter), "caps", &caps, NULL);
+  if (caps != NULL && gst_caps_get_size (caps) > 0)
+  {
+    structure = gst_caps_get_structure (caps, 0);
+    if (!gst_structure_get_int (structure, "width", &preview_width) ||
+        !gst_structure_get_int (structure, "height", &preview_height))
+    {
+      preview_width = 640;
+      preview_height = 480;
+    }
+  }
+  if (caps != NULL)
+    gst_caps_unref (caps);
+
+  /* GStreamer will crash if this is not a multiple of 2! */
+  *width = MAX (preview_width, 2) & ~1;
+  *height = MAX (preview_height, 2) & ~1;
+}
+
+/*
+ * cheese_camera_layout_effects_mosaic:
+ * @camera: a #CheeseCamera
+ *
+ * Size the cells of the mosaic set up with
+ * cheese_camera_connect_effects_mosaic() for the current effect previews, and
+ * lay them out row by row.
+ */
+static void
+cheese_camera_layout_effects_mosaic (CheeseCamera *camera)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  GstElement *capsfilter, *compositor;
+  GstCaps *caps;
+  GstPad *pad;
+  gint width, height;
+  guint i;
+
+  if (priv->mosaic_bin == NULL)
+    return;
+
+  cheese_camera_get_mosaic_cell_size (camera, &width, &height);
+  if (width == priv->mosaic_cell_width && height == priv->mosaic_cell_height)
+    return;
+
+  capsfilter = gst_bin_get_by_name (GST_BIN (priv->mosaic_bin),
+                                    "mosaic_capsfilter");
+  caps = gst_caps_new_simple ("video/x-raw", "width", G_TYPE_INT, width,
+                              "height", G_TYPE_INT, height, NULL);
+  g_object_set (G_OBJECT (capsfilter), "caps", caps, NULL);
+  gst_caps_unref (caps);
+  gst_object_unref (capsfilter);
+
+  compositor = gst_bin_get_by_name (GST_BIN (priv->mosaic_bin),
+                                    "mosaic_compositor");
+  for (i = 0; i < priv->mosaic_cells; i++)
+  {
+    gchar *name = g_strdup_printf ("sink_%u", i);
+
+    pad = gst_element_get_static_pad (compositor, name);
+    g_free (name);
+    if (pad == NULL)
+      continue;
+    g_object_set (G_OBJECT (pad),
+                  "xpos", (gint) (i % priv->mosaic_columns) * (width + CHEESE_CAMERA_MOSAIC_SPACING),
+                  "ypos", (gint) (i / priv->mosaic_columns) * (height + CHEESE_CAMERA_MOSAIC_SPACING),
+                  "width", width, "height", height, NULL);
+    gst_object_unref (pad);
+  }
+  gst_object_unref (compositor);
+
+  priv->mosaic_cell_width = width;
+  priv->mosaic_cell_height = height;
+}
+
+/*
+ * cheese_camera_update_preview_caps:
+ * @camera: a #CheeseCamera
+ *
+ * Scale the frames for the effect previews, once before the effects tee, to
+ * fit the size set with cheese_camera_set_effects_preview_size(), keeping
+ * the aspect ratio of the current format.
+ */
+static void
+cheese_camera_update_preview_caps (CheeseCamera *camera)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  GstCaps *caps, *current;
+  gint width, height;
+
+  if (priv->effects_capsfilter == NULL || priv->current_format == NULL ||
+      priv->current_format->width <= 0 || priv->current_format->height <= 0)
+    return;
+
+  width = MIN (priv->current_format->width,
+               priv->preview_max_width != 0 ? (gint) priv->preview_max_width
+                                            : CHEESE_CAMERA_PREVIEW_MAX_WIDTH);
+  height = width * priv->current_format->height / priv->current_format->width;
+  if (priv->preview_max_height != 0 && height > (gint) priv->preview_max_height)
+  {
+    height = priv->preview_max_height;
+    width = height * priv->current_format->width / priv->current_format->height;
+  }
+  /* GStreamer will crash if this is not a multiple of 2! */
+  width = MAX ((width + 1) & ~1, 2);
+  height = MAX ((height + 1) & ~1, 2);
+
+  caps = gst_caps_new_simple ("video/x-raw", "width", G_TYPE_INT, width,
+                              "height", G_TYPE_INT, height, NULL);
+  g_object_get (priv->effects_capsfilter, "caps", &current, NULL);
+  if (current == NULL || !gst_caps_is_equal (caps, current))
+  {
+    GST_DEBUG_OBJECT (camera, "Effect previews are %dx%d", width, height);
+    g_object_set (priv->effects_capsfilter, "caps", caps, NULL);
+  }
+  if (current != NULL)
+    gst_caps_unref (current);
+  gst_caps_unref (caps);
+
+  cheese_camera_layout_effects_mosaic (camera);
+}
+
 static void
 cheese_camera_set_new_caps (CheeseCamera *camera)
 {
   CheeseCameraPrivate *priv;
   CheeseCameraDevice *device;
   GstCaps *caps;
-  gchar *caps_desc;
-  int width, height;
 
   g_return_if_fail (CHEESE_IS_CAMERA (camera));
 
     priv = cheese_camera_get_instance_private (camera);
   device = g_ptr_array_index (priv->camera_devices, priv->selected_device);
-  caps = cheese_camera_device_get_caps_for_format (device, priv->current_format);
+  caps = cheese_camera_device_get_caps_for_format_at_rate (device,
+                                                          priv->current_format,
+                                                          priv->high_frame_rate);
 
   if (gst_caps_is_empty (caps))
   {
@@ -762,7 +2124,9 @@ cheese_camera_set_new_caps (CheeseCamera *camera)
     g_boxed_free (CHEESE_TYPE_VIDEO_FORMAT, priv->current_format);
     priv->current_format = cheese_camera_device_get_best_format (device);
     g_object_notify_by_pspec (G_OBJECT (camera), properties[PROP_FORMAT]);
-    caps = cheese_camera_device_get_caps_for_format (device, priv->current_format);
+    caps = cheese_camera_device_get_caps_for_format_at_rate (device,
+                                                            priv->current_format,
+                                                            priv->high_frame_rate);
   }
 
   if (!gst_caps_is_empty (caps))
@@ -770,7 +2134,7 @@ cheese_camera_set_new_caps (CheeseCamera *camera)
         guint i;
 
     GST_INFO_OBJECT (camera, "SETTING caps %" GST_PTR_FORMAT, caps);
-    g_object_set (gst_bin_get_by_name (GST_BIN (priv->video_source),
+    g_object_set (gst_bin_get_by_name (GST_BIN (priv->source_branch),
                   "video_source_filter"), "caps", caps, NULL);
 
         /* If the selected caps are image/jpeg, video_source will convert them
@@ -794,19 +2158,10 @@ cheese_camera_set_new_caps (CheeseCamera *camera)
 
     gst_caps_unref (caps);
 
-    width = priv->current_format->width;
-    width = width > 640 ? 640 : width;
-    height = width * priv->current_format->height
-             / priv->current_format->width;
-    /* GStreamer will crash if this is not a multiple of 2! */
-    height = (height + 1) & ~1;
-    caps_desc = g_strdup_printf ("video/x-raw, width=%d, height=%d", width,
-                                 height);
-    caps = gst_caps_from_string (caps_desc);
-    g_free (caps_desc);
-    g_object_set (priv->effects_capsfilter, "caps", caps, NULL);
+    cheese_camera_update_preview_caps (camera);
   }
-  gst_caps_unref (caps);
+  else
+    gst_caps_unref (caps);
 }
 
 void
@@ -818,6 +2173,13 @@ cheese_camera_play (CheeseCamera *camera)
   g_object_set (priv->main_valve, "drop", FALSE, NULL);
   gst_element_set_state (priv->camerabin, GST_STATE_PLAYING);
   priv->pipeline_is_playing = TRUE;
+
+  g_atomic_int_set (&priv->rate_frames, 0);
+  priv->rate_start = g_get_monotonic_time ();
+  if (priv->rate_source == 0)
+    priv->rate_source = g_timeout_add (CHEESE_CAMERA_FRAME_RATE_INTERVAL,
+                                       cheese_camera_update_frame_rate,
+                                       camera);
 }
 
 /**
@@ -839,6 +2201,17 @@ cheese_camera_stop (CheeseCamera *camera)
   if (priv->camerabin != NULL)
     gst_element_set_state (priv->camerabin, GST_STATE_NULL);
   priv->pipeline_is_playing = FALSE;
+
+  if (priv->rate_source != 0)
+  {
+    g_source_remove (priv->rate_source);
+    priv->rate_source = 0;
+  }
+
+  /* Let go of the frames, so that the device can be closed. */
+  g_mutex_lock (&priv->still_lock);
+  cheese_frame_ring_clear (priv->still_ring);
+  g_mutex_unlock (&priv->still_lock);
 }
 
 /*
@@ -846,267 +2219,1693 @@ cheese_camera_stop (CheeseCamera *camera)
  * @camera: a #CheeseCamera
  * @new_filter: the new effect filter to apply
  *
- * Change the current effect to that of @element.
+ * Change the current effect to that of @element. The new filter is brought
+ * up before the main valve closes, and the old one shut down after it opens
+ * again, so that the valve is only closed for the relinking. The old filter
+ * is kept in the effect cache, under the current effect description.
  */
 static void
 cheese_camera_change_effect_filter (CheeseCamera *camera, GstElement *new_filter)
 {
   CheeseCameraPrivate *priv;
+  GstElement          *old_filter;
+  gint64               start;
   gboolean             ok;
 
   g_return_if_fail (CHEESE_IS_CAMERA (camera));
 
   priv = cheese_camera_get_instance_private (camera);
 
+  gst_bin_add (GST_BIN (priv->video_filter_bin), new_filter);
+  gst_element_set_state (new_filter, GST_STATE_PAUSED);
+
+  start = g_get_monotonic_time ();
   g_object_set (G_OBJECT (priv->main_valve), "drop", TRUE, NULL);
 
   gst_element_unlink_many (priv->main_valve, priv->effect_filter,
                            priv->video_balance, NULL);
-
-  g_object_ref (priv->effect_filter);
-  gst_bin_remove (GST_BIN (priv->video_filter_bin), priv->effect_filter);
-  gst_element_set_state (priv->effect_filter, GST_STATE_NULL);
-  g_object_unref (priv->effect_filter);
-
-  gst_bin_add (GST_BIN (priv->video_filter_bin), new_filter);
   ok = gst_element_link_many (priv->main_valve, new_filter,
                               priv->video_balance, NULL);
-  gst_element_set_state (new_filter, GST_STATE_PAUSED);
-
-  g_return_if_fail (ok);
 
   g_object_set (G_OBJECT (priv->main_valve), "drop", FALSE, NULL);
+  priv->effect_switch_time = g_get_monotonic_time () - start;
+  GST_INFO_OBJECT (camera, "Effect switch closed the valve for %u µs",
+                   priv->effect_switch_time);
+
+  old_filter = gst_object_ref (priv->effect_filter);
+  gst_bin_remove (GST_BIN (priv->video_filter_bin), old_filter);
+  gst_element_set_state (old_filter, GST_STATE_READY);
+  cheese_effect_cache_put (priv->effect_cache, priv->current_effect_desc,
+                           old_filter);
 
   priv->effect_filter = new_filter;
+  g_object_notify_by_pspec (G_OBJECT (camera),
+                            properties[PROP_EFFECT_SWITCH_TIME]);
+
+  g_return_if_fail (ok);
 }
 
 /*
- * cheese_camera_element_from_effect:
- * @camera: a #CheeseCamera
- * @effect: the #CheeseEffect to use as the template
+ * cheese_camera_make_converter:
+ * @name: the name of the converter
  *
- * Create a new #GstElement based on the @effect template.
+ * Create a videoconvert which converts with a thread per core.
+ *
+ * Returns: a new videoconvert, or %NULL if it is not installed
+ */
+static GstElement *
+cheese_camera_make_converter (const gchar *name)
+{
+  GstElement *convert;
+
+  if ((convert = gst_element_factory_make ("videoconvert", name)) == NULL)
+    return NULL;
+
+  if (g_object_class_find_property (G_OBJECT_GET_CLASS (convert), "n-threads"))
+    g_object_set (G_OBJECT (convert), "n-threads", 0, NULL);
+
+  return convert;
+}
+
+/*
+ * cheese_camera_element_from_desc:
+ * @effect_desc: the pipeline description of an effect
+ * @name: the name of the effect, for warnings
+ * @input_caps: (allow-none): the caps negotiated in front of the effect, or
+ * %NULL if they are not known
+ * @downstream: the element which the effect will be linked to
+ * @n_stripes: the number of stripes to apply the effect to in parallel, or 1
+ *
+ * Create a new #GstElement from @effect_desc, optimized with
+ * cheese_effect_optimizer_parse(). With more than one stripe, the effect
+ * runs in a stripe bin, see cheese_stripe_bin_new(). A converter is only
+ * left out in front of the effect if it accepts @input_caps, and behind it
+ * if @downstream accepts every format which the effect may produce. Without
+ * the converter in front, the caps which the effect accepts and @n_stripes
+ * are set as the "cheese-effect-caps" and "cheese-effect-stripes" data of
+ * the element, see cheese_camera_effect_accepts().
  *
  * Returns: a new #GstElement
  */
 static GstElement *
-cheese_camera_element_from_effect (CheeseCamera *camera, CheeseEffect *effect)
+cheese_camera_element_from_desc (const gchar *effect_desc, const gchar *name,
+                                 GstCaps *input_caps, GstElement *downstream,
+                                 guint n_stripes)
 {
-  gchar      *effects_pipeline_desc;
-  gchar      *name;
-  GstElement *effect_filter;
+  GstElement *effect_filter, *stripe_bin;
   GError     *err = NULL;
-  gchar      *effect_desc;
-  GstElement *colorspace1;
-  GstElement *colorspace2;
-  GstPad     *pad;
+  GstElement *colorspace;
+  GstPad     *sink_pad, *src_pad, *pad;
+  GstPadTemplate *templ;
+  GstCaps    *caps, *downstream_caps;
+  gboolean    convert_in, convert_out;
 
-  g_object_get (G_OBJECT (effect),
-                "pipeline-desc", &effect_desc,
-                "name", &name, NULL);
+  if (n_stripes > 1)
+  {
+    stripe_bin = cheese_stripe_bin_new (effect_desc, n_stripes, &err);
+    if (stripe_bin == NULL)
+    {
+      GST_INFO ("Effect %s cannot be striped: %s", name, err->message);
+      g_clear_error (&err);
+      return cheese_camera_element_from_desc (effect_desc, name, input_caps,
+                                              downstream, 1);
+    }
+    effect_filter = gst_bin_new (NULL);
+    gst_bin_add (GST_BIN (effect_filter), stripe_bin);
+    GST_INFO ("Effect %s: split into %u stripes", name, n_stripes);
+  }
+  else
+  {
+    effect_filter = cheese_effect_optimizer_parse (effect_desc, FALSE, &err);
+    if (!effect_filter || (err != NULL))
+    {
+      g_clear_error (&err);
+      g_warning ("Error with effect filter %s. Ignored", name);
+      if (effect_filter != NULL)
+        gst_object_unref (effect_filter);
+      return NULL;
+    }
+  }
 
-  effects_pipeline_desc = g_strconcat ("videoconvert name=colorspace1 ! ",
-                                       effect_desc,
-                                       " ! videoconvert name=colorspace2",
-                                       NULL);
-  g_free (effect_desc);
-  effect_filter = gst_parse_bin_from_description (effects_pipeline_desc, FALSE, &err);
-  g_free (effects_pipeline_desc);
-  if (!effect_filter || (err != NULL))
+  sink_pad = gst_bin_find_unlinked_pad (GST_BIN (effect_filter), GST_PAD_SINK);
+  src_pad = gst_bin_find_unlinked_pad (GST_BIN (effect_filter), GST_PAD_SRC);
+  if (sink_pad == NULL || src_pad == NULL)
   {
-    g_clear_error (&err);
     g_warning ("Error with effect filter %s. Ignored", name);
-    g_free (name);
+    g_clear_object (&sink_pad);
+    g_clear_object (&src_pad);
+    gst_object_unref (effect_filter);
     return NULL;
   }
-  g_free (name);
 
+  /* Keep the converter unless the format is known, the source may send any
+   * format which its driver or the JPEG decoder comes up with. */
+  caps = gst_pad_query_caps (sink_pad, NULL);
+  convert_in = input_caps == NULL || !gst_caps_is_fixed (input_caps) ||
+               !gst_caps_is_subset (input_caps, caps);
+  if (!convert_in)
+  {
+    g_object_set_data_full (G_OBJECT (effect_filter), "cheese-effect-caps",
+                            gst_caps_ref (caps), (GDestroyNotify) gst_caps_unref);
+    g_object_set_data (G_OBJECT (effect_filter), "cheese-effect-stripes",
+                       GUINT_TO_POINTER (n_stripes));
+  }
+  gst_caps_unref (caps);
 
-  /* Add ghost pads to effect_filter bin */
-  colorspace1 = gst_bin_get_by_name (GST_BIN (effect_filter), "colorspace1");
-  colorspace2 = gst_bin_get_by_name (GST_BIN (effect_filter), "colorspace2");
+  /* An aggregator such as the mosaic compositor only has request pads. */
+  if ((pad = gst_element_get_static_pad (downstream, "sink")) != NULL)
+  {
+    downstream_caps = gst_pad_get_pad_template_caps (pad);
+    gst_object_unref (pad);
+  }
+  else if ((templ = gst_element_class_get_pad_template (GST_ELEMENT_GET_CLASS (downstream),
+                                                       "sink_%u")) != NULL)
+    downstream_caps = gst_pad_template_get_caps (templ);
+  else
+    downstream_caps = gst_caps_new_empty ();
+  caps = gst_pad_query_caps (src_pad, NULL);
+  convert_out = !gst_caps_is_subset (caps, downstream_caps);
+  gst_caps_unref (caps);
+  gst_caps_unref (downstream_caps);
 
-  pad = gst_element_get_static_pad (colorspace1, "sink");
-  gst_element_add_pad (effect_filter, gst_ghost_pad_new ("sink", pad));
-  gst_object_unref (GST_OBJECT (pad));
-  gst_object_unref (GST_OBJECT (colorspace1));
+  GST_INFO ("Effect %s: %s input conversion, %s output conversion", name,
+            convert_in ? "kept" : "elided", convert_out ? "kept" : "elided");
 
-  pad = gst_element_get_static_pad (colorspace2, "src");
-  gst_element_add_pad (effect_filter, gst_ghost_pad_new ("src", pad));
-  gst_object_unref (GST_OBJECT (pad));
-  gst_object_unref (GST_OBJECT (colorspace2));
+  /* Add ghost pads to effect_filter bin, through the converters. */
+  if (convert_in && (colorspace = cheese_camera_make_converter ("colorspace1")) != NULL)
+  {
+    gst_bin_add (GST_BIN (effect_filter), colorspace);
+    pad = gst_element_get_static_pad (colorspace, "src");
+    gst_pad_link (pad, sink_pad);
+    gst_object_unref (GST_OBJECT (pad));
+    gst_object_unref (GST_OBJECT (sink_pad));
+    sink_pad = gst_element_get_static_pad (colorspace, "sink");
+  }
+  if (convert_out && (colorspace = cheese_camera_make_converter ("colorspace2")) != NULL)
+  {
+    gst_bin_add (GST_BIN (effect_filter), colorspace);
+    pad = gst_element_get_static_pad (colorspace, "sink");
+    gst_pad_link (src_pad, pad);
+    gst_object_unref (GST_OBJECT (pad));
+    gst_object_unref (GST_OBJECT (src_pad));
+    src_pad = gst_element_get_static_pad (colorspace, "src");
+  }
+
+  gst_element_add_pad (effect_filter, gst_ghost_pad_new ("sink", sink_pad));
+  gst_object_unref (GST_OBJECT (sink_pad));
+
+  gst_element_add_pad (effect_filter, gst_ghost_pad_new ("src", src_pad));
+  gst_object_unref (GST_OBJECT (src_pad));
 
   return effect_filter;
 }
 
-/**
- * cheese_camera_set_effect:
- * @camera: a #CheeseCamera
- * @effect: a #CheeseEffect
+/*
+ * cheese_camera_effect_accepts:
+ * @effect_filter: an effect filter
+ * @caps: (allow-none): the caps negotiated in front of @effect_filter, or
+ * %NULL if they are not known
  *
- * Set the @effect on the @camera.
+ * Check whether @effect_filter can take @caps. Only a filter without a
+ * converter in front may not.
+ *
+ * Returns: %TRUE if @effect_filter accepts @caps
  */
-void
-cheese_camera_set_effect (CheeseCamera *camera, CheeseEffect *effect)
+static gboolean
+cheese_camera_effect_accepts (GstElement *effect_filter, GstCaps *caps)
 {
-    CheeseCameraPrivate *priv;
-  const gchar *effect_desc = cheese_effect_get_pipeline_desc (effect);
-  GstElement *effect_filter;
-
-  g_return_if_fail (CHEESE_IS_CAMERA (camera));
+  GstCaps *effect_caps;
 
-    priv = cheese_camera_get_instance_private (camera);
+  effect_caps = g_object_get_data (G_OBJECT (effect_filter), "cheese-effect-caps");
 
-    if (strcmp (priv->current_effect_desc, effect_desc) == 0)
-    {
-        GST_INFO_OBJECT (camera, "Effect is: \"%s\", not updating",
-                         effect_desc);
-        return;
-    }
+  return effect_caps == NULL ||
+         (caps != NULL && gst_caps_is_subset (caps, effect_caps));
+}
 
-  GST_INFO_OBJECT (camera, "Changing effect to: \"%s\"", effect_desc);
+/*
+ * cheese_camera_get_current_caps:
+ * @upstream: the element in front of an effect
+ *
+ * Returns: (transfer full) (nullable): the caps negotiated on the source
+ * pad of @upstream, or %NULL if there are none yet
+ */
+static GstCaps *
+cheese_camera_get_current_caps (GstElement *upstream)
+{
+  GstCaps *caps;
+  GstPad *pad;
 
-  if (strcmp (effect_desc, "identity") == 0)
-    effect_filter = gst_element_factory_make ("identity", "effect");
-  else
-    effect_filter = cheese_camera_element_from_effect (camera, effect);
+  pad = gst_element_get_static_pad (upstream, "src");
+  caps = gst_pad_get_current_caps (pad);
+  gst_object_unref (pad);
 
-    if (effect_filter != NULL)
-    {
-        cheese_camera_change_effect_filter (camera, effect_filter);
-        g_free (priv->current_effect_desc);
-        priv->current_effect_desc = g_strdup (effect_desc);
-    }
+  return caps;
 }
 
-/**
- * cheese_camera_toggle_effects_pipeline:
- * @camera: a #CheeseCamera
- * @active: %TRUE if effects pipeline is active, %FALSE otherwise
+/*
+ * cheese_camera_get_stripes:
+ * @effect: a #CheeseEffect
+ *
+ * Get the number of stripes to split frames into for @effect on the main
+ * path: one per processor, up to %CHEESE_CAMERA_MAX_STRIPES, if the effect
+ * is stripe-safe.
+ *
+ * Returns: the number of stripes, 1 to apply the effect to whole frames
+ */
+static guint
+cheese_camera_get_stripes (CheeseEffect *effect)
+{
+  if (!cheese_effect_is_stripe_safe (effect))
+    return 1;
+
+  return CLAMP (g_get_num_processors (), 1, CHEESE_CAMERA_MAX_STRIPES);
+}
+
+/*
+ * cheese_camera_element_from_effect:
+ * @camera: a #CheeseCamera
+ * @effect: the #CheeseEffect to use as the template
+ * @input_caps: (allow-none): the caps negotiated in front of the effect, or
+ * %NULL if they are not known
+ * @downstream: the element which the effect will be linked to
+ * @striped: whether to split the frames into stripes, if @effect allows it
+ *
+ * Create a new #GstElement based on the @effect template.
+ *
+ * Returns: a new #GstElement
+ */
+static GstElement *
+cheese_camera_element_from_effect (CheeseCamera *camera, CheeseEffect *effect,
+                                   GstCaps *input_caps, GstElement *downstream,
+                                   gboolean striped)
+{
+  gchar      *name;
+  gchar      *effect_desc;
+  GstElement *effect_filter;
+
+  g_object_get (G_OBJECT (effect),
+                "pipeline-desc", &effect_desc,
+                "name", &name, NULL);
+
+  effect_filter = cheese_camera_element_from_desc (effect_desc, name,
+                                                   input_caps, downstream,
+                                                   striped ? cheese_camera_get_stripes (effect)
+                                                           : 1);
+
+  g_free (effect_desc);
+  g_free (name);
+
+  return effect_filter;
+}
+
+/*
+ * cheese_camera_prewarm_next:
+ * @data: a #CheeseCamera
+ *
+ * Parse the next effect waiting to be pre-warmed into the effect cache, one
+ * per main loop iteration.
+ *
+ * Returns: %G_SOURCE_CONTINUE while effects are waiting
+ */
+static gboolean
+cheese_camera_prewarm_next (gpointer data)
+{
+  CheeseCamera *camera = CHEESE_CAMERA (data);
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  GstElement *effect_filter;
+  CheeseEffect *effect;
+  const gchar *effect_desc;
+  GstCaps *caps;
+
+  effect = g_queue_pop_head (&priv->prewarm_effects);
+  if (effect == NULL)
+  {
+    priv->prewarm_source = 0;
+    return G_SOURCE_REMOVE;
+  }
+  effect_desc = cheese_effect_get_pipeline_desc (effect);
+
+  if (!cheese_effect_cache_contains (priv->effect_cache, effect_desc) &&
+      g_strcmp0 (priv->current_effect_desc, effect_desc) != 0)
+  {
+    caps = cheese_camera_get_current_caps (priv->main_valve);
+    effect_filter = cheese_camera_element_from_effect (camera, effect, caps,
+                                                       priv->video_balance,
+                                                       TRUE);
+    if (caps != NULL)
+      gst_caps_unref (caps);
+    if (effect_filter != NULL)
+    {
+      gst_object_ref_sink (effect_filter);
+      gst_element_set_state (effect_filter, GST_STATE_READY);
+      cheese_effect_cache_put (priv->effect_cache, effect_desc, effect_filter);
+      GST_DEBUG_OBJECT (camera, "Pre-warmed effect \"%s\"", effect_desc);
+    }
+  }
+  g_object_unref (effect);
+
+  return G_SOURCE_CONTINUE;
+}
+
+/**
+ * cheese_camera_prewarm_effect:
+ * @camera: a #CheeseCamera
+ * @effect: a #CheeseEffect which is likely to be selected next
+ *
+ * Parse @effect in the background, from the main loop, so that a later
+ * cheese_camera_set_effect() with it only has to relink the pipeline. Only
+ * the most recently used effects are kept parsed.
+ */
+void
+cheese_camera_prewarm_effect (CheeseCamera *camera, CheeseEffect *effect)
+{
+  CheeseCameraPrivate *priv;
+  const gchar *effect_desc;
+
+  g_return_if_fail (CHEESE_IS_CAMERA (camera));
+  g_return_if_fail (CHEESE_IS_EFFECT (effect));
+
+  priv = cheese_camera_get_instance_private (camera);
+  effect_desc = cheese_effect_get_pipeline_desc (effect);
+
+  if (strcmp (effect_desc, "identity") == 0 ||
+      cheese_effect_cache_contains (priv->effect_cache, effect_desc))
+    return;
+
+  g_queue_push_tail (&priv->prewarm_effects, g_object_ref (effect));
+  if (priv->prewarm_source == 0)
+    priv->prewarm_source = g_idle_add_full (G_PRIORITY_LOW,
+                                            cheese_camera_prewarm_next,
+                                            camera, NULL);
+}
+
+/**
+ * cheese_camera_set_effect:
+ * @camera: a #CheeseCamera
+ * @effect: a #CheeseEffect
+ *
+ * Set the @effect on the @camera.
+ */
+void
+cheese_camera_set_effect (CheeseCamera *camera, CheeseEffect *effect)
+{
+    CheeseCameraPrivate *priv;
+  const gchar *effect_desc = cheese_effect_get_pipeline_desc (effect);
+  GstElement *effect_filter;
+  GstCaps *caps;
+
+  g_return_if_fail (CHEESE_IS_CAMERA (camera));
+
+    priv = cheese_camera_get_instance_private (camera);
+
+    if (strcmp (priv->current_effect_desc, effect_desc) == 0)
+    {
+        GST_INFO_OBJECT (camera, "Effect is: \"%s\", not updating",
+                         effect_desc);
+        return;
+    }
+
+  GST_INFO_OBJECT (camera, "Changing effect to: \"%s\"", effect_desc);
+
+  caps = cheese_camera_get_current_caps (priv->main_valve);
+  effect_filter = cheese_effect_cache_take (priv->effect_cache, effect_desc);
+  if (effect_filter != NULL && !cheese_camera_effect_accepts (effect_filter, caps))
+  {
+    /* Cached for a format which the source no longer sends. */
+    gst_element_set_state (effect_filter, GST_STATE_NULL);
+    gst_object_unref (effect_filter);
+    effect_filter = NULL;
+  }
+
+  if (effect_filter != NULL)
+    GST_DEBUG_OBJECT (camera, "Reusing the cached effect bin");
+  else if (strcmp (effect_desc, "identity") == 0)
+    effect_filter = gst_element_factory_make ("identity", "effect");
+  else
+    effect_filter = cheese_camera_element_from_effect (camera, effect, caps,
+                                                       priv->video_balance,
+                                                       TRUE);
+  if (caps != NULL)
+    gst_caps_unref (caps);
+
+    if (effect_filter != NULL)
+    {
+        cheese_camera_change_effect_filter (camera, effect_filter);
+        g_free (priv->current_effect_desc);
+        priv->current_effect_desc = g_strdup (effect_desc);
+    }
+}
+
+/**
+ * cheese_camera_toggle_effects_pipeline:
+ * @camera: a #CheeseCamera
+ * @active: %TRUE if effects pipeline is active, %FALSE otherwise
  *
  * Control whether the effects pipeline is enabled for @camera.
  */
-void
-cheese_camera_toggle_effects_pipeline (CheeseCamera *camera, gboolean active)
+void
+cheese_camera_toggle_effects_pipeline (CheeseCamera *camera, gboolean active)
+{
+  CheeseCameraPrivate *priv;
+
+  g_return_if_fail (CHEESE_IS_CAMERA (camera));
+
+    priv = cheese_camera_get_instance_private (camera);
+
+  if (active)
+  {
+    /* The previews cannot keep up in high frame rate mode. */
+    g_object_set (G_OBJECT (priv->effects_valve), "drop",
+                  priv->high_frame_rate != 0, NULL);
+    if (!priv->is_recording)
+      g_object_set (G_OBJECT (priv->main_valve), "drop", TRUE, NULL);
+  }
+  else
+  {
+    g_object_set (G_OBJECT (priv->effects_valve), "drop", TRUE, NULL);
+    g_object_set (G_OBJECT (priv->main_valve), "drop", FALSE, NULL);
+  }
+  priv->effect_pipeline_is_playing = active;
+}
+
+static void
+cheese_camera_connected_size_change_cb (ClutterGstContent *content, gint width, gint height, ClutterActor *actor)
+{
+  clutter_actor_set_size (actor, width, height);
+}
+
+/*
+ * cheese_camera_find_preview_branch:
+ * @camera: a #CheeseCamera
+ * @effect: (allow-none): the effect previewed by the branch, or %NULL for a
+ * free branch
+ *
+ * Returns: (transfer none): the branch, or %NULL if there is none
+ */
+static CheeseCameraPreviewBranch *
+cheese_camera_find_preview_branch (CheeseCamera *camera, CheeseEffect *effect)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  guint i;
+
+  for (i = 0; i < priv->preview_branches->len; i++)
+  {
+    CheeseCameraPreviewBranch *branch = g_ptr_array_index (priv->preview_branches, i);
+
+    if (branch->effect == effect)
+      return branch;
+  }
+
+  return NULL;
+}
+
+/*
+ * cheese_camera_release_preview_branch:
+ * @branch: a #CheeseCameraPreviewBranch in use
+ *
+ * Close the valve of @branch and detach it from its effect and texture, so
+ * that it can be reused for another effect.
+ */
+static void
+cheese_camera_release_preview_branch (CheeseCameraPreviewBranch *branch)
+{
+  g_object_set (G_OBJECT (branch->valve), "drop", TRUE, NULL);
+
+  g_object_set (G_OBJECT (branch->effect), "control-valve", NULL, NULL);
+  g_clear_object (&branch->effect);
+
+  /* Dropping the content disconnects the texture from the sink. */
+  clutter_actor_set_content (branch->texture, NULL);
+  g_clear_object (&branch->texture);
+}
+
+/*
+ * cheese_camera_preview_branch_free:
+ * @branch: a #CheeseCameraPreviewBranch
+ *
+ * Free @branch, whose elements belong to the video_filter_bin.
+ */
+static void
+cheese_camera_preview_branch_free (CheeseCameraPreviewBranch *branch)
+{
+  g_clear_object (&branch->effect);
+  g_clear_object (&branch->texture);
+  g_clear_object (&branch->tee_pad);
+  g_slice_free (CheeseCameraPreviewBranch, branch);
+}
+
+/*
+ * cheese_camera_destroy_preview_branch:
+ * @camera: a #CheeseCamera
+ * @branch: a free #CheeseCameraPreviewBranch
+ *
+ * Unlink @branch from the effects tee, shut its elements down and free it,
+ * along with the streaming thread of its queue.
+ */
+static void
+cheese_camera_destroy_preview_branch (CheeseCamera *camera,
+                                      CheeseCameraPreviewBranch *branch)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  GstElement *elements[5];
+  guint i;
+
+  elements[0] = branch->valve;
+  elements[1] = branch->input_queue;
+  elements[2] = branch->filter;
+  elements[3] = branch->queue;
+  elements[4] = branch->sink;
+
+  gst_element_release_request_pad (priv->effects_tee, branch->tee_pad);
+  for (i = 0; i < G_N_ELEMENTS (elements); i++)
+  {
+    gst_element_set_locked_state (elements[i], FALSE);
+    gst_element_set_state (elements[i], GST_STATE_NULL);
+    gst_bin_remove (GST_BIN (priv->video_filter_bin), elements[i]);
+  }
+
+  g_ptr_array_remove (priv->preview_branches, branch);
+}
+
+/*
+ * cheese_camera_preview_input_probe:
+ *
+ * Govern the framerate of a preview branch: let a frame into the effect only
+ * once the time which the effect takes per frame, divided by the budget of
+ * the branch, has passed since the last one. Fast effects get every frame,
+ * slow ones fewer, rather than slowing the other previews down.
+ */
+static GstPadProbeReturn
+cheese_camera_preview_input_probe (GstPad *pad, GstPadProbeInfo *info,
+                                   CheeseCameraPreviewBranch *branch)
+{
+  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+  GstClockTime pts = GST_BUFFER_PTS (buffer);
+
+  if (GST_CLOCK_TIME_IS_VALID (pts) &&
+      GST_CLOCK_TIME_IS_VALID (branch->next_pts) && pts < branch->next_pts)
+    return GST_PAD_PROBE_DROP;
+
+  if (GST_CLOCK_TIME_IS_VALID (pts))
+    branch->next_pts = pts + (GstClockTime) (branch->frame_cost * GST_USECOND /
+                                             CHEESE_CAMERA_PREVIEW_BUDGET);
+  branch->frame_start = g_get_monotonic_time ();
+
+  return GST_PAD_PROBE_OK;
+}
+
+/*
+ * cheese_camera_preview_output_probe:
+ *
+ * Measure the time which the effect of a preview branch took for a frame.
+ * The effect is driven by the thread of the input queue, so this runs in the
+ * same thread as cheese_camera_preview_input_probe().
+ */
+static GstPadProbeReturn
+cheese_camera_preview_output_probe (GstPad *pad, GstPadProbeInfo *info,
+                                    CheeseCameraPreviewBranch *branch)
+{
+  gint64 cost;
+
+  if (branch->frame_start == 0)
+    return GST_PAD_PROBE_OK;
+
+  cost = g_get_monotonic_time () - branch->frame_start;
+  branch->frame_start = 0;
+
+  /* Average over the last few frames, so that the framerate changes
+   * smoothly. */
+  branch->frame_cost = branch->frame_cost == 0 ? cost
+                       : (3 * branch->frame_cost + cost) / 4;
+  GST_LOG ("Preview effect takes %" G_GINT64_FORMAT " µs per frame, "
+           "%.0f FPS at most", branch->frame_cost,
+           branch->frame_cost > 0 ? CHEESE_CAMERA_PREVIEW_BUDGET * G_USEC_PER_SEC
+                                    / branch->frame_cost : 0.0);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/*
+ * cheese_camera_new_preview_branch:
+ * @camera: a #CheeseCamera
+ *
+ * Create a free preview branch, valve ! queue ! identity ! queue ! sink,
+ * linked to the effects tee.
+ *
+ * Returns: (transfer none): the new branch
+ */
+static CheeseCameraPreviewBranch *
+cheese_camera_new_preview_branch (CheeseCamera *camera)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  CheeseCameraPreviewBranch *branch;
+  GstPad *pad;
+  gboolean ok;
+
+  branch = g_slice_new0 (CheeseCameraPreviewBranch);
+  branch->next_pts = GST_CLOCK_TIME_NONE;
+
+  branch->valve = gst_element_factory_make ("valve", NULL);
+  g_object_set (G_OBJECT (branch->valve), "drop", TRUE, NULL);
+
+  /* A slow effect must not hold the effects tee up: it only ever gets the
+   * latest frame, in a thread of its own. */
+  branch->input_queue = gst_element_factory_make ("queue", NULL);
+  g_object_set (G_OBJECT (branch->input_queue), "leaky", 2,
+                "max-size-buffers", 1, "max-size-bytes", 0,
+                "max-size-time", G_GUINT64_CONSTANT (0), NULL);
+
+  branch->filter = gst_element_factory_make ("identity", NULL);
+
+  branch->queue = gst_element_factory_make ("queue", NULL);
+  g_object_set_data (G_OBJECT (branch->queue), "cheese-preview-queue",
+                     GINT_TO_POINTER (TRUE));
+  cheese_camera_configure_preview_queue (camera, G_OBJECT (branch->queue));
+
+  branch->sink = GST_ELEMENT (clutter_gst_video_sink_new ());
+
+  gst_bin_add_many (GST_BIN (priv->video_filter_bin), branch->valve,
+                    branch->input_queue, branch->filter, branch->queue,
+                    branch->sink, NULL);
+
+  branch->tee_pad = gst_element_get_request_pad (priv->effects_tee, "src_%u");
+  pad = gst_element_get_static_pad (branch->valve, "sink");
+  ok = gst_pad_link (branch->tee_pad, pad) == GST_PAD_LINK_OK;
+  gst_object_unref (pad);
+  ok &= gst_element_link_many (branch->valve, branch->input_queue,
+                               branch->filter, branch->queue, branch->sink,
+                               NULL);
+  if (!ok)
+      g_warning ("Could not create effects pipeline");
+
+  pad = gst_element_get_static_pad (branch->input_queue, "src");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER,
+                     (GstPadProbeCallback) cheese_camera_preview_input_probe,
+                     branch, NULL);
+  gst_object_unref (pad);
+  pad = gst_element_get_static_pad (branch->queue, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER,
+                     (GstPadProbeCallback) cheese_camera_preview_output_probe,
+                     branch, NULL);
+  gst_object_unref (pad);
+
+  /* HACK: I don't understand GStreamer enough to know why this works. */
+  gst_element_set_state (branch->valve, GST_STATE_PLAYING);
+  gst_element_set_state (branch->input_queue, GST_STATE_PLAYING);
+  gst_element_set_state (branch->filter, GST_STATE_PLAYING);
+  gst_element_set_state (branch->queue, GST_STATE_PLAYING);
+  gst_element_set_state (branch->sink, GST_STATE_PLAYING);
+  gst_element_set_locked_state (branch->sink, TRUE);
+
+  g_ptr_array_add (priv->preview_branches, branch);
+
+  return branch;
+}
+
+/*
+ * CheeseCameraFilterSwap:
+ * @camera: the #CheeseCamera
+ * @branch: the #CheeseCameraPreviewBranch whose effect filter is replaced
+ * @filter: the new effect filter
+ *
+ * A replacement of the effect filter of a preview branch, pending until
+ * nothing is pushed into the old one.
+ */
+typedef struct
+{
+  CheeseCamera *camera;
+  CheeseCameraPreviewBranch *branch;
+  GstElement *filter;
+} CheeseCameraFilterSwap;
+
+static void
+cheese_camera_filter_swap_free (CheeseCameraFilterSwap *swap)
+{
+  gst_object_unref (swap->filter);
+  g_slice_free (CheeseCameraFilterSwap, swap);
+}
+
+/*
+ * cheese_camera_swap_preview_filter:
+ * @pad: the source pad of the input queue of the branch
+ * @info: the #GstPadProbeInfo
+ * @swap: the #CheeseCameraFilterSwap
+ *
+ * Replace the effect filter of a preview branch while @pad is blocked, so
+ * that the streaming thread of the input queue never pushes into a filter
+ * which is unlinked or shut down, which would pause the queue for good.
+ *
+ * Returns: %GST_PAD_PROBE_REMOVE
+ */
+static GstPadProbeReturn
+cheese_camera_swap_preview_filter (GstPad *pad, GstPadProbeInfo *info,
+                                   CheeseCameraFilterSwap *swap)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (swap->camera);
+  CheeseCameraPreviewBranch *branch = swap->branch;
+
+  gst_element_unlink_many (branch->input_queue, branch->filter, branch->queue,
+                           NULL);
+  gst_element_set_state (branch->filter, GST_STATE_NULL);
+  gst_bin_remove (GST_BIN (priv->video_filter_bin), branch->filter);
+
+  gst_bin_add (GST_BIN (priv->video_filter_bin), swap->filter);
+  if (!gst_element_link_many (branch->input_queue, swap->filter, branch->queue,
+                              NULL))
+      g_warning ("Could not create effects pipeline");
+  gst_element_set_state (swap->filter, GST_STATE_PLAYING);
+
+  /* The governor starts over for the new effect. */
+  branch->filter = swap->filter;
+  branch->frame_start = 0;
+  branch->frame_cost = 0;
+  branch->next_pts = GST_CLOCK_TIME_NONE;
+
+  return GST_PAD_PROBE_REMOVE;
+}
+
+/*
+ * cheese_camera_set_preview_filter:
+ * @camera: a #CheeseCamera
+ * @branch: a #CheeseCameraPreviewBranch
+ * @effect: the #CheeseEffect to preview
+ * @input_caps: (allow-none): the caps negotiated in front of the effect, or
+ * %NULL if they are not known
+ *
+ * Replace the effect filter of @branch with one for @effect. The filters are
+ * swapped from an idle probe on the input queue, at once if it is not
+ * pushing a frame, or else as soon as the frame went through.
+ */
+static void
+cheese_camera_set_preview_filter (CheeseCamera *camera,
+                                  CheeseCameraPreviewBranch *branch,
+                                  CheeseEffect *effect,
+                                  GstCaps *input_caps)
+{
+  CheeseCameraFilterSwap *swap;
+  GstElement *effect_filter;
+  GstPad *pad;
+
+  effect_filter = cheese_camera_element_from_effect (camera, effect,
+                                                     input_caps, branch->sink,
+                                                     FALSE);
+  if (effect_filter == NULL)
+    effect_filter = gst_element_factory_make ("identity", NULL);
+  branch->filter_elided = !cheese_camera_effect_accepts (effect_filter, NULL);
+
+  swap = g_slice_new (CheeseCameraFilterSwap);
+  swap->camera = camera;
+  swap->branch = branch;
+  swap->filter = gst_object_ref_sink (effect_filter);
+
+  pad = gst_element_get_static_pad (branch->input_queue, "src");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_IDLE,
+                     (GstPadProbeCallback) cheese_camera_swap_preview_filter,
+                     swap, (GDestroyNotify) cheese_camera_filter_swap_free);
+  gst_object_unref (pad);
+}
+
+/*
+ * cheese_camera_restore_converters:
+ * @camera: a #CheeseCamera
+ *
+ * Put the converters back in front of the main effect and the effect
+ * previews which left them out for the format of the source, before the
+ * device or its format changes. They are left out again the next time the
+ * effects are set.
+ */
+static void
+cheese_camera_restore_converters (CheeseCamera *camera)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  GstElement *effect_filter;
+  guint i, n_stripes;
+
+  if (!cheese_camera_effect_accepts (priv->effect_filter, NULL))
+  {
+    n_stripes = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (priv->effect_filter),
+                                                     "cheese-effect-stripes"));
+    effect_filter = cheese_camera_element_from_desc (priv->current_effect_desc,
+                                                     priv->current_effect_desc,
+                                                     NULL, priv->video_balance,
+                                                     n_stripes);
+    if (effect_filter != NULL)
+      cheese_camera_change_effect_filter (camera, effect_filter);
+  }
+
+  for (i = 0; i < priv->preview_branches->len; i++)
+  {
+    CheeseCameraPreviewBranch *branch = g_ptr_array_index (priv->preview_branches, i);
+
+    if (branch->effect != NULL && branch->filter_elided)
+      cheese_camera_set_preview_filter (camera, branch, branch->effect, NULL);
+  }
+}
+
+/**
+ * cheese_camera_connect_effect_texture:
+ * @camera: a #CheeseCamera
+ * @effect: a #CheeseEffect
+ * @texture: a #ClutterActor
+ *
+ * Connect the supplied @texture to the @camera, using @effect. The preview
+ * takes a branch released with cheese_camera_disconnect_effect_texture() if
+ * there is one, so that paging through the effects reuses the same
+ * branches.
+ */
+void
+cheese_camera_connect_effect_texture (CheeseCamera *camera, CheeseEffect *effect, ClutterActor *texture)
+{
+  CheeseCameraPrivate *priv;
+  CheeseCameraPreviewBranch *branch;
+  ClutterContent *content;
+  GstCaps *caps;
+
+  g_return_if_fail (CHEESE_IS_CAMERA (camera));
+  g_return_if_fail (CHEESE_IS_EFFECT (effect));
+
+    priv = cheese_camera_get_instance_private (camera);
+
+  g_object_set (G_OBJECT (priv->effects_valve), "drop", TRUE, NULL);
+
+  branch = cheese_camera_find_preview_branch (camera, effect);
+  if (branch != NULL)
+    cheese_camera_release_preview_branch (branch);
+  else if ((branch = cheese_camera_find_preview_branch (camera, NULL)) == NULL)
+    branch = cheese_camera_new_preview_branch (camera);
+
+  caps = cheese_camera_get_current_caps (branch->input_queue);
+  cheese_camera_set_preview_filter (camera, branch, effect, caps);
+  if (caps != NULL)
+    gst_caps_unref (caps);
+
+  content = g_object_new (CLUTTER_GST_TYPE_CONTENT, "sink", branch->sink,
+                          NULL);
+  clutter_actor_set_content (texture, content);
+  g_signal_connect (G_OBJECT (content), "size-change",
+                    G_CALLBACK (cheese_camera_connected_size_change_cb), texture);
+  g_object_unref (content);
+
+  branch->effect = g_object_ref (effect);
+  branch->texture = g_object_ref (texture);
+  g_object_set (G_OBJECT (effect), "control-valve", branch->valve, NULL);
+
+  g_object_set (G_OBJECT (priv->effects_valve), "drop",
+                priv->high_frame_rate != 0, NULL);
+}
+
+/**
+ * cheese_camera_disconnect_effect_texture:
+ * @camera: a #CheeseCamera
+ * @effect: a #CheeseEffect connected with
+ * cheese_camera_connect_effect_texture()
+ *
+ * Disconnect the preview of @effect, for instance as it is no longer shown.
+ * Its branch is kept for the next cheese_camera_connect_effect_texture(),
+ * unless more than #CheeseCamera:max-effect-previews branches exist, in
+ * which case it is torn down.
+ */
+void
+cheese_camera_disconnect_effect_texture (CheeseCamera *camera,
+                                         CheeseEffect *effect)
+{
+  CheeseCameraPrivate *priv;
+  CheeseCameraPreviewBranch *branch;
+
+  g_return_if_fail (CHEESE_IS_CAMERA (camera));
+  g_return_if_fail (CHEESE_IS_EFFECT (effect));
+
+  priv = cheese_camera_get_instance_private (camera);
+
+  branch = cheese_camera_find_preview_branch (camera, effect);
+  if (branch == NULL)
+    return;
+
+  cheese_camera_release_preview_branch (branch);
+
+  if (priv->preview_branches->len > priv->max_effect_previews)
+    cheese_camera_destroy_preview_branch (camera, branch);
+}
+
+/**
+ * cheese_camera_set_effects_preview_size:
+ * @camera: a #CheeseCamera
+ * @width: the width which the effect previews must fit, or 0 for the default
+ * of 640 pixels
+ * @height: the height which the effect previews must fit, or 0 for no limit
+ *
+ * Size the effect previews for where they are shown, such as a cell of the
+ * effects selector, rather than applying the effects to larger frames than
+ * needed. The frames are scaled down once, before they are split to the
+ * previews, keeping the aspect ratio of the camera format. Applies to a
+ * playing camera at once.
+ */
+void
+cheese_camera_set_effects_preview_size (CheeseCamera *camera, guint width,
+                                        guint height)
+{
+  CheeseCameraPrivate *priv;
+
+  g_return_if_fail (CHEESE_IS_CAMERA (camera));
+
+  priv = cheese_camera_get_instance_private (camera);
+
+  priv->preview_max_width = width;
+  priv->preview_max_height = height;
+  cheese_camera_update_preview_caps (camera);
+}
+
+/**
+ * cheese_camera_connect_effects_mosaic:
+ * @camera: a #CheeseCamera
+ * @effects: (element-type CheeseEffect): the effects to preview
+ * @columns: the number of columns of the mosaic
+ * @texture: a #ClutterActor
+ *
+ * Preview @effects in a single frame, a mosaic of @columns columns filled
+ * row by row, shown in @texture. Each cell is an effect preview, so size them
+ * for a tile of @texture with cheese_camera_set_effects_preview_size(). The
+ * frame is uploaded once, rather than once per effect as with
+ * cheese_camera_connect_effect_texture(). A mosaic connected before is
+ * replaced. Use cheese_camera_get_effects_mosaic_cell() to find the effect
+ * under a point of @texture.
+ *
+ * Returns: %TRUE if the mosaic was connected, %FALSE if the elements it
+ * needs are missing
+ */
+gboolean
+cheese_camera_connect_effects_mosaic (CheeseCamera *camera, GList *effects,
+                                      guint columns, ClutterActor *texture)
+{
+  CheeseCameraPrivate *priv;
+  GstElement *bin, *queue, *scale, *capsfilter, *tee, *compositor, *sink;
+  GstElement *effect_filter;
+  GstPad *pad;
+  GList *l;
+  guint i;
+  gboolean ok;
+
+  g_return_val_if_fail (CHEESE_IS_CAMERA (camera), FALSE);
+  g_return_val_if_fail (columns > 0, FALSE);
+
+  priv = cheese_camera_get_instance_private (camera);
+
+  cheese_camera_disconnect_effects_mosaic (camera);
+
+  if ((compositor = gst_element_factory_make ("compositor", NULL)) == NULL)
+  {
+    g_warning ("The compositor element is missing, cannot show a mosaic");
+    return FALSE;
+  }
+
+  g_object_set (G_OBJECT (priv->effects_valve), "drop", TRUE, NULL);
+
+  bin = gst_bin_new ("effects_mosaic_bin");
+  queue = gst_element_factory_make ("queue", NULL);
+  g_object_set (G_OBJECT (queue), "leaky", 2, "max-size-buffers", 1, NULL);
+  scale = gst_element_factory_make ("videoscale", NULL);
+  capsfilter = gst_element_factory_make ("capsfilter", "mosaic_capsfilter");
+  tee = gst_element_factory_make ("tee", NULL);
+  gst_object_set_name (GST_OBJECT (compositor), "mosaic_compositor");
+  g_object_set (G_OBJECT (compositor), "background", 1, NULL);
+  sink = GST_ELEMENT (clutter_gst_video_sink_new ());
+
+  gst_bin_add_many (GST_BIN (bin), queue, scale, capsfilter, tee, compositor,
+                    sink, NULL);
+  ok = gst_element_link_many (queue, scale, capsfilter, tee, NULL);
+  ok &= gst_element_link (compositor, sink);
+
+  for (l = effects, i = 0; l != NULL; l = l->next, i++)
+  {
+    GstElement *cell_queue;
+
+    /* The mosaic stays up across format switches, so its effects keep
+     * their converters. */
+    effect_filter = cheese_camera_element_from_effect (camera,
+                                                       CHEESE_EFFECT (l->data),
+                                                       NULL, compositor, FALSE);
+    if (effect_filter == NULL)
+      effect_filter = gst_element_factory_make ("identity", NULL);
+
+    cell_queue = gst_element_factory_make ("queue", NULL);
+    g_object_set (G_OBJECT (cell_queue), "leaky", 2, "max-size-buffers", 1,
+                  NULL);
+    gst_bin_add_many (GST_BIN (bin), cell_queue, effect_filter, NULL);
+    ok &= gst_element_link_many (tee, cell_queue, effect_filter, NULL);
+
+    pad = gst_element_get_request_pad (compositor, "sink_%u");
+    ok &= gst_element_link_pads (effect_filter, "src", compositor,
+                                 GST_OBJECT_NAME (pad));
+    gst_object_unref (pad);
+  }
+
+  pad = gst_element_get_static_pad (queue, "sink");
+  gst_element_add_pad (bin, gst_ghost_pad_new ("sink", pad));
+  gst_object_unref (pad);
+
+  g_object_set (G_OBJECT (texture),
+                "content", g_object_new (CLUTTER_GST_TYPE_CONTENT,
+                                         "sink", sink,
+                                         NULL),
+                NULL);
+  g_signal_connect (G_OBJECT (clutter_actor_get_content (texture)),
+                    "size-change", G_CALLBACK (cheese_camera_connected_size_change_cb), texture);
+
+  gst_bin_add (GST_BIN (priv->video_filter_bin), bin);
+  priv->mosaic_tee_pad = gst_element_get_request_pad (priv->effects_tee, "src_%u");
+  pad = gst_element_get_static_pad (bin, "sink");
+  ok &= gst_pad_link (priv->mosaic_tee_pad, pad) == GST_PAD_LINK_OK;
+  gst_object_unref (pad);
+
+  priv->mosaic_bin = bin;
+  priv->mosaic_columns = columns;
+  priv->mosaic_cells = i;
+  priv->mosaic_cell_width = 0;
+  priv->mosaic_cell_height = 0;
+  cheese_camera_layout_effects_mosaic (camera);
+
+  gst_element_set_state (bin, GST_STATE_PLAYING);
+
+  if (!ok)
+    g_warning ("Could not create effects mosaic");
+
+  g_object_set (G_OBJECT (priv->effects_valve), "drop",
+                priv->high_frame_rate != 0, NULL);
+
+  return TRUE;
+}
+
+/**
+ * cheese_camera_disconnect_effects_mosaic:
+ * @camera: a #CheeseCamera
+ *
+ * Tear down the mosaic set up with cheese_camera_connect_effects_mosaic(),
+ * if any.
+ */
+void
+cheese_camera_disconnect_effects_mosaic (CheeseCamera *camera)
+{
+  CheeseCameraPrivate *priv;
+  gboolean drop;
+
+  g_return_if_fail (CHEESE_IS_CAMERA (camera));
+
+  priv = cheese_camera_get_instance_private (camera);
+
+  if (priv->mosaic_bin == NULL)
+    return;
+
+  g_object_get (G_OBJECT (priv->effects_valve), "drop", &drop, NULL);
+  g_object_set (G_OBJECT (priv->effects_valve), "drop", TRUE, NULL);
+
+  gst_element_release_request_pad (priv->effects_tee, priv->mosaic_tee_pad);
+  g_clear_object (&priv->mosaic_tee_pad);
+
+  gst_element_set_state (priv->mosaic_bin, GST_STATE_NULL);
+  gst_bin_remove (GST_BIN (priv->video_filter_bin), priv->mosaic_bin);
+  priv->mosaic_bin = NULL;
+  priv->mosaic_cells = 0;
+
+  g_object_set (G_OBJECT (priv->effects_valve), "drop", drop, NULL);
+}
+
+/**
+ * cheese_camera_get_effects_mosaic_cell:
+ * @camera: a #CheeseCamera
+ * @x: the horizontal position in the mosaic, from 0 to 1
+ * @y: the vertical position in the mosaic, from 0 to 1
+ *
+ * Find the effect shown at a point of the mosaic set up with
+ * cheese_camera_connect_effects_mosaic().
+ *
+ * Returns: the index of the effect in the list passed to
+ * cheese_camera_connect_effects_mosaic(), or -1 if there is none at the point
+ */
+gint
+cheese_camera_get_effects_mosaic_cell (CheeseCamera *camera, gdouble x,
+                                       gdouble y)
+{
+  CheeseCameraPrivate *priv;
+  guint rows, column, row, index;
+  gdouble mosaic_width, mosaic_height;
+
+  g_return_val_if_fail (CHEESE_IS_CAMERA (camera), -1);
+
+  priv = cheese_camera_get_instance_private (camera);
+
+  if (priv->mosaic_cells == 0 || x < 0 || x >= 1 || y < 0 || y >= 1)
+    return -1;
+
+  /* The compositor sizes the frame to fit the cells, without spacing after
+   * the last row and column. */
+  rows = (priv->mosaic_cells + priv->mosaic_columns - 1) / priv->mosaic_columns;
+  column = MIN (priv->mosaic_cells, priv->mosaic_columns);
+  mosaic_width = column * (priv->mosaic_cell_width + CHEESE_CAMERA_MOSAIC_SPACING)
+                 - CHEESE_CAMERA_MOSAIC_SPACING;
+  mosaic_height = rows * (priv->mosaic_cell_height + CHEESE_CAMERA_MOSAIC_SPACING)
+                  - CHEESE_CAMERA_MOSAIC_SPACING;
+
+  column = x * mosaic_width / (priv->mosaic_cell_width + CHEESE_CAMERA_MOSAIC_SPACING);
+  row = y * mosaic_height / (priv->mosaic_cell_height + CHEESE_CAMERA_MOSAIC_SPACING);
+  index = row * priv->mosaic_columns + column;
+
+  return index < priv->mosaic_cells ? (gint) index : -1;
+}
+
+/**
+ * cheese_camera_set_frame_callback:
+ * @camera: a headless #CheeseCamera
+ * @func: (allow-none) (scope notified): the function to call for every
+ * viewfinder frame, or %NULL to stop receiving frames
+ * @user_data: (closure): data to pass to @func
+ * @notify: (allow-none): function to free @user_data when @func is replaced
+ *
+ * Set the function which receives the viewfinder frames of a headless
+ * @camera. @func is called from a streaming thread, and must not call
+ * cheese_camera_set_frame_callback() itself.
+ */
+void
+cheese_camera_set_frame_callback (CheeseCamera         *camera,
+                                  CheeseCameraFrameFunc func,
+                                  gpointer              user_data,
+                                  GDestroyNotify        notify)
+{
+  CheeseCameraPrivate *priv;
+  GDestroyNotify       old_notify;
+  gpointer             old_data;
+
+  g_return_if_fail (CHEESE_IS_CAMERA (camera));
+
+  priv = cheese_camera_get_instance_private (camera);
+
+  g_mutex_lock (&priv->frame_lock);
+  old_notify = priv->frame_notify;
+  old_data = priv->frame_data;
+  priv->frame_func = func;
+  priv->frame_data = user_data;
+  priv->frame_notify = notify;
+  g_mutex_unlock (&priv->frame_lock);
+
+  if (old_notify != NULL)
+    old_notify (old_data);
+}
+
+/**
+ * cheese_camera_pull_sample:
+ * @camera: a headless #CheeseCamera
+ * @timeout: how long to wait for a frame, or %GST_CLOCK_TIME_NONE
+ *
+ * Get the next viewfinder frame of a headless @camera. Frames are only queued
+ * while no frame callback is set, and only the two most recent ones are kept.
+ *
+ * Returns: (transfer full) (nullable): a #GstSample holding the frame and its
+ * caps, or %NULL if no frame arrived within @timeout
+ */
+GstSample *
+cheese_camera_pull_sample (CheeseCamera *camera, GstClockTime timeout)
+{
+  CheeseCameraPrivate *priv;
+
+  g_return_val_if_fail (CHEESE_IS_CAMERA (camera), NULL);
+
+  priv = cheese_camera_get_instance_private (camera);
+
+  g_return_val_if_fail (priv->frame_sink != NULL, NULL);
+
+  return gst_app_sink_try_pull_sample (GST_APP_SINK (priv->frame_sink),
+                                       timeout);
+}
+
+/*
+ * cheese_camera_get_running_time:
+ * @camera: a #CheeseCamera
+ *
+ * Get the current running time of the pipeline, to compare with the running
+ * time of frames.
+ *
+ * Returns: the running time, or %GST_CLOCK_TIME_NONE if the pipeline has no
+ * clock
+ */
+static GstClockTime
+cheese_camera_get_running_time (CheeseCamera *camera)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  GstClockTime now;
+  GstClock *clock;
+
+  clock = gst_element_get_clock (priv->camerabin);
+  if (clock == NULL)
+    return GST_CLOCK_TIME_NONE;
+
+  now = gst_clock_get_time (clock) - gst_element_get_base_time (priv->camerabin);
+  gst_object_unref (clock);
+
+  return now;
+}
+
+/*
+ * cheese_camera_balance_is_neutral:
+ * @camera: a #CheeseCamera
+ *
+ * Check whether the video balance leaves the image untouched.
+ *
+ * Returns: %TRUE if all balance properties are at their default values
+ */
+static gboolean
+cheese_camera_balance_is_neutral (CheeseCamera *camera)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  const gchar * const properties[] = { "brightness", "contrast", "hue",
+                                       "saturation" };
+  guint i;
+
+  if (priv->video_balance == NULL)
+    return TRUE;
+
+  for (i = 0; i < G_N_ELEMENTS (properties); i++)
+  {
+    GParamSpec *pspec;
+    gdouble value;
+
+    pspec = g_object_class_find_property (
+      G_OBJECT_GET_CLASS (G_OBJECT (priv->video_balance)), properties[i]);
+    if (!G_IS_PARAM_SPEC_DOUBLE (pspec))
+      continue;
+
+    g_object_get (G_OBJECT (priv->video_balance), properties[i], &value, NULL);
+    if (ABS (value - G_PARAM_SPEC_DOUBLE (pspec)->default_value) > 1e-6)
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+/*
+ * cheese_camera_can_pass_through:
+ * @camera: a #CheeseCamera
+ *
+ * Check whether the compressed frames of the camera can be saved as they are:
+ * the camera produces JPEG, no effect is selected and the balance is neutral.
+ *
+ * Returns: %TRUE if the frames of the source can be saved without decoding
+ */
+static gboolean
+cheese_camera_can_pass_through (CheeseCamera *camera)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+
+  if (priv->current_effect_desc != NULL &&
+      strcmp (priv->current_effect_desc, "identity") != 0)
+    return FALSE;
+
+  if (!cheese_camera_balance_is_neutral (camera))
+    return FALSE;
+
+  return g_atomic_int_get (&priv->source_compressed);
+}
+
+/*
+ * cheese_camera_create_tags:
+ * @camera: a #CheeseCamera
+ *
+ * Create the tags for a new capture, such as the stream creation time and the
+ * name of the application.
+ *
+ * Returns: (transfer full): a new #GstTagList
+ */
+static GstTagList *
+cheese_camera_create_tags (CheeseCamera *camera)
+{
+  CheeseCameraDevice *device;
+  const gchar *device_name;
+  GstDateTime *datetime;
+  GstTagList *taglist;
+
+  device = cheese_camera_get_selected_device (camera);
+  device_name = cheese_camera_device_get_name (device);
+
+  datetime = gst_date_time_new_now_local_time();
+
+  taglist = gst_tag_list_new (
+      GST_TAG_APPLICATION_NAME, PACKAGE_STRING,
+      GST_TAG_DATE_TIME, datetime,
+      GST_TAG_DEVICE_MODEL, device_name,
+      GST_TAG_KEYWORDS, PACKAGE_NAME, NULL);
+
+  gst_date_time_unref (datetime);
+
+  return taglist;
+}
+
+/*
+ * cheese_camera_set_tags:
+ * @camera: a #CheeseCamera
+ *
+ * Set tags on the camerabin element. Call this just before starting the
+ * capture process.
+ */
+static void
+cheese_camera_set_tags (CheeseCamera *camera)
 {
   CheeseCameraPrivate *priv;
+  GstTagList *taglist;
 
-  g_return_if_fail (CHEESE_IS_CAMERA (camera));
+  taglist = cheese_camera_create_tags (camera);
 
     priv = cheese_camera_get_instance_private (camera);
+  gst_tag_setter_merge_tags (GST_TAG_SETTER (priv->camerabin), taglist,
+        GST_TAG_MERGE_REPLACE);
 
-  if (active)
+  gst_tag_list_unref (taglist);
+}
+
+/*
+ * cheese_camera_create_recorder:
+ * @camera: a #CheeseCamera
+ * @filename: the file to record to
+ *
+ * Create a bin which muxes the compressed video of the source into Matroska,
+ * together with Opus audio if an audio source and encoder are available. The
+ * bin has a "sink" pad for the video.
+ *
+ * Returns: (transfer floating): the recorder bin, or %NULL if a needed element
+ * is missing
+ */
+static GstElement *
+cheese_camera_create_recorder (CheeseCamera *camera, const gchar *filename)
+{
+  GstElement *bin, *queue, *mux, *sink;
+  GstElement *audio_src, *audio_convert, *audio_resample, *audio_enc,
+             *audio_queue;
+  GstTagList *taglist;
+  GstPad *pad;
+
+  queue = gst_element_factory_make ("queue", NULL);
+  mux = gst_element_factory_make ("matroskamux", NULL);
+  sink = gst_element_factory_make ("filesink", "recorder_filesink");
+  if (queue == NULL || mux == NULL || sink == NULL)
   {
-    g_object_set (G_OBJECT (priv->effects_valve), "drop", FALSE, NULL);
-    if (!priv->is_recording)
-      g_object_set (G_OBJECT (priv->main_valve), "drop", TRUE, NULL);
+    GST_INFO ("Cannot record without transcoding, matroskamux is missing");
+    g_clear_object (&queue);
+    g_clear_object (&mux);
+    g_clear_object (&sink);
+    return NULL;
+  }
+
+  bin = gst_bin_new ("cheese_recorder");
+
+  /* Leave room for slow disks, a frame of compressed video is small. */
+  g_object_set (G_OBJECT (queue), "max-size-buffers", 0,
+                "max-size-bytes", 0, "max-size-time", 3 * GST_SECOND, NULL);
+  g_object_set (G_OBJECT (sink), "location", filename, "async", FALSE, NULL);
+
+  taglist = cheese_camera_create_tags (camera);
+  gst_tag_setter_merge_tags (GST_TAG_SETTER (mux), taglist,
+                             GST_TAG_MERGE_REPLACE);
+  gst_tag_list_unref (taglist);
+
+  gst_bin_add_many (GST_BIN (bin), queue, mux, sink, NULL);
+  gst_element_link_many (queue, mux, sink, NULL);
+
+  pad = gst_element_get_static_pad (queue, "sink");
+  gst_element_add_pad (bin, gst_ghost_pad_new ("sink", pad));
+  gst_object_unref (pad);
+
+  audio_src = gst_element_factory_make ("autoaudiosrc", "recorder_audio_src");
+  audio_convert = gst_element_factory_make ("audioconvert", NULL);
+  audio_resample = gst_element_factory_make ("audioresample", NULL);
+  audio_enc = gst_element_factory_make ("opusenc", NULL);
+  audio_queue = gst_element_factory_make ("queue", "recorder_audio_queue");
+  if (audio_src != NULL && audio_convert != NULL && audio_resample != NULL &&
+      audio_enc != NULL && audio_queue != NULL)
+  {
+    gst_bin_add_many (GST_BIN (bin), audio_src, audio_convert, audio_resample,
+                      audio_enc, audio_queue, NULL);
+    gst_element_link_many (audio_src, audio_convert, audio_resample, audio_enc,
+                           audio_queue, mux, NULL);
   }
   else
   {
-    g_object_set (G_OBJECT (priv->effects_valve), "drop", TRUE, NULL);
-    g_object_set (G_OBJECT (priv->main_valve), "drop", FALSE, NULL);
+    GST_INFO ("Recording without audio, an audio element is missing");
+    g_clear_object (&audio_src);
+    g_clear_object (&audio_convert);
+    g_clear_object (&audio_resample);
+    g_clear_object (&audio_enc);
+    g_clear_object (&audio_queue);
   }
-  priv->effect_pipeline_is_playing = active;
+
+  return bin;
 }
 
+/*
+ * cheese_camera_remove_recorder:
+ * @camera: a #CheeseCamera
+ *
+ * Shut down the recorder and remove it from the video source.
+ */
 static void
-cheese_camera_connected_size_change_cb (ClutterGstContent *content, gint width, gint height, ClutterActor *actor)
+cheese_camera_remove_recorder (CheeseCamera *camera)
 {
-  clutter_actor_set_size (actor, width, height);
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+
+  if (priv->recorder == NULL)
+    return;
+
+  if (priv->recorder_tee_pad != NULL)
+  {
+    GstElement *tee;
+
+    tee = gst_pad_get_parent_element (priv->recorder_tee_pad);
+    gst_element_release_request_pad (tee, priv->recorder_tee_pad);
+    gst_object_unref (tee);
+    g_clear_object (&priv->recorder_tee_pad);
+  }
+
+  gst_element_set_state (priv->recorder, GST_STATE_NULL);
+  gst_bin_remove (GST_BIN (GST_ELEMENT_PARENT (priv->recorder)), priv->recorder);
+  g_clear_object (&priv->recorder);
 }
 
-/**
- * cheese_camera_connect_effect_texture:
+/*
+ * cheese_camera_recorder_done:
+ * @data: a #CheeseCamera
+ *
+ * Remove the finished recorder, and post the same message camerabin posts at
+ * the end of a recording.
+ *
+ * Returns: %G_SOURCE_REMOVE
+ */
+static gboolean
+cheese_camera_recorder_done (gpointer data)
+{
+  CheeseCamera *camera = CHEESE_CAMERA (data);
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+
+  if (priv->recorder != NULL)
+  {
+    cheese_camera_remove_recorder (camera);
+    gst_element_post_message (priv->camerabin,
+        gst_message_new_element (GST_OBJECT (priv->camerabin),
+                                 gst_structure_new_empty ("video-done")));
+  }
+
+  return G_SOURCE_REMOVE;
+}
+
+/*
+ * cheese_camera_recorder_eos_probe:
+ * @pad: the sink pad of the recorder filesink
+ * @info: the #GstPadProbeInfo
  * @camera: a #CheeseCamera
- * @effect: a #CheeseEffect
- * @texture: a #ClutterActor
  *
- * Connect the supplied @texture to the @camera, using @effect.
+ * Finish the recording once the muxer has written the file.
+ *
+ * Returns: %GST_PAD_PROBE_OK
  */
-void
-cheese_camera_connect_effect_texture (CheeseCamera *camera, CheeseEffect *effect, ClutterActor *texture)
+static GstPadProbeReturn
+cheese_camera_recorder_eos_probe (GstPad *pad, GstPadProbeInfo *info,
+                                  CheeseCamera *camera)
 {
-  CheeseCameraPrivate *priv;
-  GstElement *effect_filter;
-  GstElement *display_element;
-  GstElement *display_queue;
-  GstElement *control_valve;
-  gboolean ok;
-  g_return_if_fail (CHEESE_IS_CAMERA (camera));
+  if (GST_EVENT_TYPE (GST_PAD_PROBE_INFO_EVENT (info)) != GST_EVENT_EOS)
+    return GST_PAD_PROBE_OK;
 
-    priv = cheese_camera_get_instance_private (camera);
-  ok = TRUE;
+  g_idle_add_full (G_PRIORITY_DEFAULT, cheese_camera_recorder_done,
+                   g_object_ref (camera), g_object_unref);
 
-  g_object_set (G_OBJECT (priv->effects_valve), "drop", TRUE, NULL);
+  return GST_PAD_PROBE_REMOVE;
+}
 
-  control_valve = gst_element_factory_make ("valve", NULL);
-  g_object_set (G_OBJECT (effect), "control-valve", control_valve, NULL);
+/*
+ * cheese_camera_recorder_unlink_probe:
+ * @pad: the request pad of the video_source_tee
+ * @info: the #GstPadProbeInfo
+ * @camera: a #CheeseCamera
+ *
+ * Unlink the recorder from the tee while no frame is being pushed, and send
+ * EOS to its video and audio branches so that the file gets finalized.
+ *
+ * Returns: %GST_PAD_PROBE_REMOVE
+ */
+static GstPadProbeReturn
+cheese_camera_recorder_unlink_probe (GstPad *pad, GstPadProbeInfo *info,
+                                     CheeseCamera *camera)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  GstElement *audio_src;
+  GstPad *peer;
 
-  display_queue = gst_element_factory_make ("queue", NULL);
+  peer = gst_pad_get_peer (pad);
+  if (peer != NULL)
+  {
+    gst_pad_unlink (pad, peer);
+    gst_pad_send_event (peer, gst_event_new_eos ());
+    gst_object_unref (peer);
+  }
 
-  effect_filter = cheese_camera_element_from_effect (camera, effect);
+  audio_src = gst_bin_get_by_name (GST_BIN (priv->recorder),
+                                   "recorder_audio_src");
+  if (audio_src != NULL)
+  {
+    gst_element_send_event (audio_src, gst_event_new_eos ());
+    gst_object_unref (audio_src);
+  }
 
-  display_element = GST_ELEMENT (clutter_gst_video_sink_new ());
-  g_object_set (G_OBJECT (texture),
-                "content", g_object_new (CLUTTER_GST_TYPE_CONTENT,
-                                         "sink", display_element,
-                                         NULL),
-                NULL);
+  return GST_PAD_PROBE_REMOVE;
+}
 
-  g_signal_connect (G_OBJECT (clutter_actor_get_content (texture)),
-                    "size-change", G_CALLBACK (cheese_camera_connected_size_change_cb), texture);
+/*
+ * cheese_camera_preroll_probe:
+ * @pad: the request pad of the video_source_tee linked to the recorder
+ * @info: the #GstPadProbeInfo
+ * @camera: a #CheeseCamera
+ *
+ * Before the first frame goes to a new recorder, push the frames of the
+ * pre-roll ring to it, from the same streaming thread which fills the ring.
+ *
+ * Returns: %GST_PAD_PROBE_REMOVE
+ */
+static GstPadProbeReturn
+cheese_camera_preroll_probe (GstPad *pad, GstPadProbeInfo *info,
+                             CheeseCamera *camera)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  GstClockTime current, running_time;
+  GstBuffer *buffer;
+  GstPad *peer;
+  guint count = 0;
 
-  gst_bin_add_many (GST_BIN (priv->video_filter_bin), control_valve, effect_filter, display_queue, display_element, NULL);
+  /* The current frame is already in the ring, and goes out through the tee. */
+  current = gst_segment_to_running_time (&priv->source_segment, GST_FORMAT_TIME,
+                                         GST_BUFFER_PTS (GST_PAD_PROBE_INFO_BUFFER (info)));
 
-  ok = gst_element_link_many (priv->effects_tee, control_valve, effect_filter, display_queue, display_element, NULL);
-  g_return_if_fail (ok);
+  peer = gst_pad_get_peer (pad);
+  while ((buffer = cheese_frame_ring_pop (priv->preroll_ring, &running_time)) != NULL)
+  {
+    if (peer == NULL || !GST_CLOCK_TIME_IS_VALID (running_time) ||
+        running_time < priv->preroll_start || running_time >= current)
+    {
+      gst_buffer_unref (buffer);
+      continue;
+    }
 
-  /* HACK: I don't understand GStreamer enough to know why this works. */
-  gst_element_set_state (control_valve, GST_STATE_PLAYING);
-  gst_element_set_state (effect_filter, GST_STATE_PLAYING);
-  gst_element_set_state (display_queue, GST_STATE_PLAYING);
-  gst_element_set_state (display_element, GST_STATE_PLAYING);
-  gst_element_set_locked_state (display_element, TRUE);
+    if (gst_pad_chain (peer, buffer) != GST_FLOW_OK)
+      break;
+    count++;
+  }
+  cheese_frame_ring_clear (priv->preroll_ring);
+  g_clear_object (&peer);
 
-  if (!ok)
-      g_warning ("Could not create effects pipeline");
+  GST_DEBUG ("Started the recording with %u frames of pre-roll", count);
 
-  g_object_set (G_OBJECT (priv->effects_valve), "drop", FALSE, NULL);
+  return GST_PAD_PROBE_REMOVE;
 }
 
 /*
- * cheese_camera_set_tags:
+ * cheese_camera_start_passthrough_recording:
  * @camera: a #CheeseCamera
+ * @filename: the file to record to
+ *
+ * Record the compressed video of the camera into a Matroska file, without
+ * decoding and encoding it again.
  *
- * Set tags on the camerabin element, such as the stream creation time and the
- * name of the application. Call this just before starting the capture process.
+ * Returns: %TRUE if the recording started, %FALSE if camerabin has to record
+ * instead
  */
-static void
-cheese_camera_set_tags (CheeseCamera *camera)
+static gboolean
+cheese_camera_start_passthrough_recording (CheeseCamera *camera,
+                                           const gchar  *filename)
 {
-  CheeseCameraPrivate *priv;
-  CheeseCameraDevice *device;
-  const gchar *device_name;
-  GstDateTime *datetime;
-  GstTagList *taglist;
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  GstElement *tee, *sink;
+  GstClockTime now, preroll;
+  GstPad *pad;
 
-  device = cheese_camera_get_selected_device (camera);
-  device_name = cheese_camera_device_get_name (device);
+  if (priv->recorder != NULL || !cheese_camera_can_pass_through (camera))
+    return FALSE;
 
-  datetime = gst_date_time_new_now_local_time();
+  now = cheese_camera_get_running_time (camera);
+  if (!GST_CLOCK_TIME_IS_VALID (now))
+    return FALSE;
 
-  taglist = gst_tag_list_new (
-      GST_TAG_APPLICATION_NAME, PACKAGE_STRING,
-      GST_TAG_DATE_TIME, datetime,
-      GST_TAG_DEVICE_MODEL, device_name,
-      GST_TAG_KEYWORDS, PACKAGE_NAME, NULL);
+  priv->recorder = cheese_camera_create_recorder (camera, filename);
+  if (priv->recorder == NULL)
+    return FALSE;
+  gst_object_ref_sink (priv->recorder);
+
+  sink = gst_bin_get_by_name (GST_BIN (priv->recorder), "recorder_filesink");
+  pad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+                     (GstPadProbeCallback) cheese_camera_recorder_eos_probe,
+                     camera, NULL);
+  gst_object_unref (pad);
+  gst_object_unref (sink);
+
+  /* Make the recording start at zero, for both video and audio, including
+   * the pre-roll. The audio only starts at the time of the request. */
+  priv->recorder_start = now;
+
+  preroll = g_atomic_int_get (&priv->preroll_duration) * GST_SECOND;
+  priv->preroll_start = priv->recorder_start > preroll ?
+                        priv->recorder_start - preroll : 0;
+
+  pad = gst_element_get_static_pad (priv->recorder, "sink");
+  gst_pad_set_offset (pad, -(gint64) priv->preroll_start);
+  gst_object_unref (pad);
+
+  sink = gst_bin_get_by_name (GST_BIN (priv->recorder), "recorder_audio_queue");
+  if (sink != NULL)
+  {
+    pad = gst_element_get_static_pad (sink, "src");
+    gst_pad_set_offset (pad, -(gint64) priv->preroll_start);
+    gst_object_unref (pad);
+    gst_object_unref (sink);
+  }
 
-    priv = cheese_camera_get_instance_private (camera);
-  gst_tag_setter_merge_tags (GST_TAG_SETTER (priv->camerabin), taglist,
-        GST_TAG_MERGE_REPLACE);
+  gst_bin_add (GST_BIN (priv->source_branch), priv->recorder);
+  gst_element_sync_state_with_parent (priv->recorder);
 
-  gst_date_time_unref (datetime);
-  gst_tag_list_unref (taglist);
+  tee = gst_bin_get_by_name (GST_BIN (priv->source_branch), "video_source_tee");
+  priv->recorder_tee_pad = gst_element_get_request_pad (tee, "src_%u");
+  gst_object_unref (tee);
+
+  if (preroll > 0)
+    gst_pad_add_probe (priv->recorder_tee_pad, GST_PAD_PROBE_TYPE_BUFFER,
+                       (GstPadProbeCallback) cheese_camera_preroll_probe,
+                       camera, NULL);
+
+  pad = gst_element_get_static_pad (priv->recorder, "sink");
+  if (gst_pad_link (priv->recorder_tee_pad, pad) != GST_PAD_LINK_OK)
+  {
+    GST_WARNING ("Cannot link the recorder, recording with camerabin");
+    gst_object_unref (pad);
+    cheese_camera_remove_recorder (camera);
+    return FALSE;
+  }
+  gst_object_unref (pad);
+
+  GST_DEBUG ("Recording the camera stream to %s", filename);
+
+  return TRUE;
 }
 
 /**
@@ -1115,7 +3914,9 @@ cheese_camera_set_tags (CheeseCamera *camera)
  * @filename: (type filename): the name of the video file to where the
  * recording will be saved
  *
- * Start a video recording with the @camera and save it to @filename.
+ * Start a video recording with the @camera and save it to @filename. If the
+ * camera produces JPEG and neither an effect nor a balance adjustment is
+ * applied, its frames are muxed into a Matroska file as they are.
  */
 void
 cheese_camera_start_video_recording (CheeseCamera *camera, const gchar *filename)
@@ -1126,11 +3927,15 @@ cheese_camera_start_video_recording (CheeseCamera *camera, const gchar *filename
 
     priv = cheese_camera_get_instance_private (camera);
 
+  priv->is_recording = TRUE;
+  if (cheese_camera_start_passthrough_recording (camera, filename))
+    return;
+
   g_object_set (priv->camerabin, "mode", MODE_VIDEO, NULL);
   g_object_set (priv->camerabin, "location", filename, NULL);
   cheese_camera_set_tags (camera);
+  cheese_camera_start_governor (camera);
   g_signal_emit_by_name (priv->camerabin, "start-capture", 0);
-  priv->is_recording = TRUE;
 }
 
 /*
@@ -1147,14 +3952,20 @@ cheese_camera_force_stop_video_recording (gpointer data)
   CheeseCamera        *camera = CHEESE_CAMERA (data);
     CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
 
+  priv->force_stop_source = 0;
+
   if (priv->is_recording)
   {
     GST_WARNING ("Cannot cleanly shutdown recording pipeline, forcing");
     g_signal_emit (camera, camera_signals[VIDEO_SAVED], 0);
 
+    cheese_camera_remove_recorder (camera);
+    cheese_camera_stop_governor (camera);
     cheese_camera_stop (camera);
-    cheese_camera_play (camera);
     priv->is_recording = FALSE;
+    if (priv->video_encoder_pending)
+      cheese_camera_apply_video_encoder (camera);
+    cheese_camera_play (camera);
   }
 
   return FALSE;
@@ -1169,23 +3980,174 @@ cheese_camera_force_stop_video_recording (gpointer data)
 void
 cheese_camera_stop_video_recording (CheeseCamera *camera)
 {
-  CheeseCameraPrivate *priv;
-  GstState             state;
-
-  g_return_if_fail (CHEESE_IS_CAMERA (camera));
+  CheeseCameraPrivate *priv;
+  GstState             state;
+
+  g_return_if_fail (CHEESE_IS_CAMERA (camera));
+
+    priv = cheese_camera_get_instance_private (camera);
+
+  gst_element_get_state (priv->camerabin, &state, NULL, 0);
+
+  if (state != GST_STATE_PLAYING)
+  {
+    if (priv->force_stop_source != 0)
+      g_source_remove (priv->force_stop_source);
+    cheese_camera_force_stop_video_recording (camera);
+    return;
+  }
+
+  if (priv->recorder != NULL)
+  {
+    gst_pad_add_probe (priv->recorder_tee_pad, GST_PAD_PROBE_TYPE_IDLE,
+                       (GstPadProbeCallback) cheese_camera_recorder_unlink_probe,
+                       camera, NULL);
+  }
+  else
+  {
+    g_signal_emit_by_name (priv->camerabin, "stop-capture", 0);
+  }
+
+  /* Neither the recorder nor camerabin may finish the file, if the stream
+   * stalls before EOS reaches the muxer. */
+  if (priv->force_stop_source == 0)
+    priv->force_stop_source =
+      g_timeout_add_seconds (CHEESE_CAMERA_FORCE_STOP_TIMEOUT,
+                             cheese_camera_force_stop_video_recording,
+                             camera);
+}
+
+/*
+ * cheese_camera_still_photo_saved:
+ * @filename: the file which was written
+ * @error: the error which occurred, or %NULL
+ * @user_data: a #CheeseCamera
+ *
+ * Emit the ::photo-saved signal for a photo written by the still writer.
+ */
+static void
+cheese_camera_still_photo_saved (const gchar  *filename,
+                                 const GError *error,
+                                 gpointer      user_data)
+{
+  CheeseCamera *camera = CHEESE_CAMERA (user_data);
+
+  if (error != NULL)
+    g_warning ("Could not save %s: %s", filename, error->message);
+  else
+    g_signal_emit (camera, camera_signals[PHOTO_SAVED], 0);
+
+  g_object_unref (camera);
+}
+
+/*
+ * cheese_camera_take_passthrough_photo:
+ * @camera: a #CheeseCamera
+ * @filename: name of the file to save a photo to
+ *
+ * Save the last JPEG frame of the camera as it is, if the image shown is the
+ * image the camera produced: no effect is selected and the balance is neutral.
+ *
+ * Returns: %TRUE if the photo is being saved, %FALSE if camerabin has to take
+ * it instead
+ */
+static gboolean
+cheese_camera_take_passthrough_photo (CheeseCamera *camera,
+                                      const gchar  *filename)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  GstSample *frame, *sample;
+  GstBuffer *buffer;
+  GstTagList *taglist;
+
+  if (!cheese_camera_can_pass_through (camera))
+    return FALSE;
+
+  /* Take the frame out of its slot, and put it back unless the streaming
+   * thread has stored a newer one meanwhile. */
+  frame = cheese_camera_exchange_sample (camera, NULL);
+  if (frame == NULL)
+    return FALSE;
+
+  /* Copy the frame, so that it does not hold on to the memory of the driver
+   * while it is written. */
+  buffer = gst_buffer_copy_deep (gst_sample_get_buffer (frame));
+  sample = gst_sample_new (buffer, gst_sample_get_caps (frame), NULL, NULL);
+  if (!g_atomic_pointer_compare_and_exchange (&priv->source_sample, NULL, frame))
+    gst_sample_unref (frame);
+
+  taglist = cheese_camera_create_tags (camera);
+
+  GST_DEBUG ("Saving the camera frame to %s", filename);
+  cheese_still_writer_save (priv->still_writer, sample, filename, taglist,
+                            cheese_camera_still_photo_saved,
+                            g_object_ref (camera));
+
+  gst_tag_list_unref (taglist);
+  gst_sample_unref (sample);
+  gst_buffer_unref (buffer);
+
+  return TRUE;
+}
+
+/*
+ * cheese_camera_take_zero_lag_photo:
+ * @camera: a #CheeseCamera
+ * @filename: name of the file to save a photo to
+ *
+ * Save the recent frame closest to now, as shown, encoding it in the still
+ * writer. Unlike camerabin, this never waits for a previous photo.
+ *
+ * Returns: %TRUE if the photo is being saved, %FALSE if camerabin has to take
+ * it instead
+ */
+static gboolean
+cheese_camera_take_zero_lag_photo (CheeseCamera *camera,
+                                   const gchar  *filename)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  GstClockTime now, found = GST_CLOCK_TIME_NONE;
+  GstBuffer *buffer = NULL;
+  GstCaps *caps = NULL;
+  GstSample *sample;
+  GstTagList *taglist;
 
-    priv = cheese_camera_get_instance_private (camera);
+  if (!g_atomic_int_get (&priv->zero_shutter_lag))
+    return FALSE;
 
-  gst_element_get_state (priv->camerabin, &state, NULL, 0);
+  now = cheese_camera_get_running_time (camera);
+  if (!GST_CLOCK_TIME_IS_VALID (now))
+    return FALSE;
 
-  if (state == GST_STATE_PLAYING)
+  g_mutex_lock (&priv->still_lock);
+  if (priv->still_caps != NULL)
   {
-    g_signal_emit_by_name (priv->camerabin, "stop-capture", 0);
+    buffer = cheese_frame_ring_find (priv->still_ring, now, &found);
+    caps = gst_caps_ref (priv->still_caps);
   }
-  else
+  g_mutex_unlock (&priv->still_lock);
+
+  if (buffer == NULL)
   {
-    cheese_camera_force_stop_video_recording (camera);
+    g_clear_pointer (&caps, gst_caps_unref);
+    return FALSE;
   }
+
+  sample = gst_sample_new (buffer, caps, NULL, NULL);
+  taglist = cheese_camera_create_tags (camera);
+
+  GST_DEBUG ("Saving the frame %" G_GINT64_FORMAT " ms from the request to %s",
+             GST_CLOCK_DIFF (now, found) / GST_MSECOND, filename);
+  cheese_still_writer_save (priv->still_writer, sample, filename, taglist,
+                            cheese_camera_still_photo_saved,
+                            g_object_ref (camera));
+
+  gst_tag_list_unref (taglist);
+  gst_sample_unref (sample);
+  gst_caps_unref (caps);
+  gst_buffer_unref (buffer);
+
+  return TRUE;
 }
 
 /**
@@ -1193,7 +4155,12 @@ cheese_camera_stop_video_recording (CheeseCamera *camera)
  * @camera: a #CheeseCamera
  * @filename: (type filename): name of the file to save a photo to
  *
- * Save a photo taken with the @camera to a new file at @filename.
+ * Save a photo taken with the @camera to a new file at @filename. If the
+ * camera produces JPEG and neither an effect nor a balance adjustment is
+ * applied, the frame of the camera is saved as it is. Otherwise, with
+ * #CheeseCamera:zero-shutter-lag, the frame shown closest to the call is
+ * encoded in the background, and requests are not refused while earlier
+ * photos are still being saved.
  *
  * Returns: %TRUE on success, %FALSE if an error occurred
  */
@@ -1207,6 +4174,12 @@ cheese_camera_take_photo (CheeseCamera *camera, const gchar *filename)
 
     priv = cheese_camera_get_instance_private (camera);
 
+  if (filename != NULL && cheese_camera_take_passthrough_photo (camera, filename))
+    return TRUE;
+
+  if (filename != NULL && cheese_camera_take_zero_lag_photo (camera, filename))
+    return TRUE;
+
   g_object_get (priv->camera_source, "ready-for-capture", &ready, NULL);
   if (!ready)
   {
@@ -1244,7 +4217,6 @@ gboolean
 cheese_camera_take_photo_pixbuf (CheeseCamera *camera)
 {
   CheeseCameraPrivate *priv;
-  GstCaps             *caps;
   gboolean             ready;
 
   g_return_val_if_fail (CHEESE_IS_CAMERA (camera), FALSE);
@@ -1258,12 +4230,7 @@ cheese_camera_take_photo_pixbuf (CheeseCamera *camera)
     return FALSE;
   }
 
-  caps = gst_caps_new_simple ("video/x-raw",
-                              "format", G_TYPE_STRING, "RGB",
-                              NULL);
   g_object_set (G_OBJECT (priv->camerabin), "post-previews", TRUE, NULL);
-  g_object_set (G_OBJECT (priv->camerabin), "preview-caps", caps, NULL);
-  gst_caps_unref (caps);
 
   if (priv->photo_filename)
     g_free (priv->photo_filename);
@@ -1278,6 +4245,88 @@ cheese_camera_take_photo_pixbuf (CheeseCamera *camera)
   return TRUE;
 }
 
+/**
+ * cheese_camera_take_burst:
+ * @camera: a #CheeseCamera
+ * @count: the number of photos to take
+ * @interval: the time between photos, in milliseconds, or 0 for every frame
+ *
+ * Take a burst of @count photos from the frames shown by the @camera, as fast
+ * as the camera delivers them if @interval is shorter than a frame. The
+ * photos are encoded in parallel in the background and named with the burst
+ * names of #CheeseFileUtil. The ::burst-photo-saved signal is emitted for
+ * every photo written, then ::burst-done once the burst is over.
+ *
+ * Returns: %TRUE if the burst started, %FALSE if the camera is not playing or
+ * a burst is still in progress
+ */
+gboolean
+cheese_camera_take_burst (CheeseCamera *camera, guint count, guint interval)
+{
+  CheeseCameraPrivate *priv;
+  guint i;
+
+  g_return_val_if_fail (CHEESE_IS_CAMERA (camera), FALSE);
+  g_return_val_if_fail (count > 0, FALSE);
+
+  priv = cheese_camera_get_instance_private (camera);
+
+  if (!priv->pipeline_is_playing || priv->burst_pending > 0)
+    return FALSE;
+
+  if (priv->burst_fileutil == NULL)
+    priv->burst_fileutil = cheese_fileutil_new ();
+  cheese_fileutil_reset_burst (priv->burst_fileutil);
+
+  priv->burst_tags = cheese_camera_create_tags (camera);
+  priv->burst_pending = count;
+
+  g_mutex_lock (&priv->still_lock);
+  for (i = 0; i < count; i++)
+    g_queue_push_tail (&priv->burst_names,
+                       cheese_fileutil_get_new_media_filename (priv->burst_fileutil,
+                                                               CHEESE_MEDIA_MODE_BURST));
+  priv->burst_interval = interval * GST_MSECOND;
+  priv->burst_next = GST_CLOCK_TIME_NONE;
+  g_mutex_unlock (&priv->still_lock);
+
+  return TRUE;
+}
+
+/**
+ * cheese_camera_stop_burst:
+ * @camera: a #CheeseCamera
+ *
+ * Stop the burst in progress. The photos already taken are still written,
+ * and ::burst-done is emitted once they are.
+ */
+void
+cheese_camera_stop_burst (CheeseCamera *camera)
+{
+  CheeseCameraPrivate *priv;
+  guint dropped;
+
+  g_return_if_fail (CHEESE_IS_CAMERA (camera));
+
+  priv = cheese_camera_get_instance_private (camera);
+
+  g_mutex_lock (&priv->still_lock);
+  dropped = g_queue_get_length (&priv->burst_names);
+  g_queue_foreach (&priv->burst_names, (GFunc) g_free, NULL);
+  g_queue_clear (&priv->burst_names);
+  g_mutex_unlock (&priv->still_lock);
+
+  if (dropped == 0)
+    return;
+
+  priv->burst_pending -= dropped;
+  if (priv->burst_pending == 0)
+  {
+    g_clear_pointer (&priv->burst_tags, gst_tag_list_unref);
+    g_signal_emit (camera, camera_signals[BURST_DONE], 0);
+  }
+}
+
 static void
 cheese_camera_finalize (GObject *object)
 {
@@ -1289,12 +4338,48 @@ cheese_camera_finalize (GObject *object)
 
   cheese_camera_stop (camera);
 
+  if (priv->switch_source != 0)
+    g_source_remove (priv->switch_source);
+  if (priv->force_stop_source != 0)
+    g_source_remove (priv->force_stop_source);
+
   if (priv->camerabin != NULL)
     gst_object_unref (priv->camerabin);
 
+  if (priv->frame_notify != NULL)
+    priv->frame_notify (priv->frame_data);
+  g_clear_pointer (&priv->frame_sink, gst_object_unref);
+  g_mutex_clear (&priv->frame_lock);
+
+  cheese_still_writer_free (priv->still_writer);
+  g_clear_pointer (&priv->source_sample, gst_sample_unref);
+  g_clear_pointer (&priv->source_caps, gst_caps_unref);
+  g_ptr_array_unref (priv->source_branches);
+  g_clear_object (&priv->recorder_tee_pad);
+  g_clear_object (&priv->recorder);
+  cheese_frame_ring_free (priv->preroll_ring);
+  cheese_frame_ring_free (priv->still_ring);
+  g_clear_pointer (&priv->still_caps, gst_caps_unref);
+  g_mutex_clear (&priv->still_lock);
+  g_queue_foreach (&priv->burst_names, (GFunc) g_free, NULL);
+  g_queue_clear (&priv->burst_names);
+  g_clear_pointer (&priv->burst_tags, gst_tag_list_unref);
+  g_clear_object (&priv->burst_fileutil);
+
   if (priv->photo_filename)
     g_free (priv->photo_filename);
   g_free (priv->current_effect_desc);
+  g_clear_object (&priv->mosaic_tee_pad);
+  g_ptr_array_unref (priv->preview_branches);
+  if (priv->prewarm_source != 0)
+    g_source_remove (priv->prewarm_source);
+  g_queue_foreach (&priv->prewarm_effects, (GFunc) g_object_unref, NULL);
+  g_queue_clear (&priv->prewarm_effects);
+  cheese_effect_cache_free (priv->effect_cache);
+  g_free (priv->video_encoder);
+  cheese_camera_stop_governor (camera);
+  g_clear_object (&priv->encoder_queue);
+  g_clear_object (&priv->encoder);
   g_clear_object (&priv->device);
   g_boxed_free (CHEESE_TYPE_VIDEO_FORMAT, priv->current_format);
 
@@ -1331,6 +4416,36 @@ cheese_camera_get_property (GObject *object, guint prop_id, GValue *value,
     case PROP_NUM_CAMERA_DEVICES:
       g_value_set_uint (value, priv->num_camera_devices);
       break;
+    case PROP_VIDEO_ENCODER:
+      g_value_set_string (value, priv->video_encoder);
+      break;
+    case PROP_PREROLL_DURATION:
+      g_value_set_uint (value, g_atomic_int_get (&priv->preroll_duration));
+      break;
+    case PROP_ZERO_SHUTTER_LAG:
+      g_value_set_boolean (value, g_atomic_int_get (&priv->zero_shutter_lag));
+      break;
+    case PROP_FORMAT_SWITCH_TIME:
+      g_value_set_uint (value, priv->format_switch_time);
+      break;
+    case PROP_MAX_WARM_SOURCES:
+      g_value_set_uint (value, priv->max_warm_sources);
+      break;
+    case PROP_WARM_SOURCE_BUDGET:
+      g_value_set_uint (value, priv->warm_source_budget);
+      break;
+    case PROP_HIGH_FRAME_RATE:
+      g_value_set_uint (value, priv->high_frame_rate);
+      break;
+    case PROP_ACHIEVED_FRAME_RATE:
+      g_value_set_double (value, priv->achieved_frame_rate);
+      break;
+    case PROP_EFFECT_SWITCH_TIME:
+      g_value_set_uint (value, priv->effect_switch_time);
+      break;
+    case PROP_MAX_EFFECT_PREVIEWS:
+      g_value_set_uint (value, priv->max_effect_previews);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1353,14 +4468,48 @@ cheese_camera_set_property (GObject *object, guint prop_id, const GValue *value,
       priv->video_texture = g_value_get_pointer (value);
       break;
     case PROP_DEVICE:
+      if (priv->video_filter_bin != NULL && priv->device != g_value_get_object (value))
+        cheese_camera_restore_converters (self);
       g_clear_object (&priv->device);
       priv->device = g_value_dup_object (value);
+      if (priv->device != NULL && priv->camera_devices != NULL)
+        cheese_camera_add_unknown_device (self, priv->device);
       break;
     case PROP_FORMAT:
       if (priv->current_format != NULL)
         g_boxed_free (CHEESE_TYPE_VIDEO_FORMAT, priv->current_format);
       priv->current_format = g_value_dup_boxed (value);
       break;
+    case PROP_VIDEO_ENCODER:
+      g_free (priv->video_encoder);
+      priv->video_encoder = g_value_dup_string (value);
+      if (priv->camerabin != NULL)
+        cheese_camera_apply_video_encoder (self);
+      break;
+    case PROP_PREROLL_DURATION:
+      g_atomic_int_set (&priv->preroll_duration, g_value_get_uint (value));
+      break;
+    case PROP_ZERO_SHUTTER_LAG:
+      g_atomic_int_set (&priv->zero_shutter_lag, g_value_get_boolean (value));
+      if (!g_value_get_boolean (value))
+      {
+        g_mutex_lock (&priv->still_lock);
+        cheese_frame_ring_clear (priv->still_ring);
+        g_mutex_unlock (&priv->still_lock);
+      }
+      break;
+    case PROP_MAX_WARM_SOURCES:
+      priv->max_warm_sources = g_value_get_uint (value);
+      break;
+    case PROP_WARM_SOURCE_BUDGET:
+      priv->warm_source_budget = g_value_get_uint (value);
+      break;
+    case PROP_HIGH_FRAME_RATE:
+      cheese_camera_set_high_frame_rate (self, g_value_get_uint (value));
+      break;
+    case PROP_MAX_EFFECT_PREVIEWS:
+      priv->max_effect_previews = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1437,6 +4586,47 @@ cheese_camera_class_init (CheeseCameraClass *klass)
                                                 g_cclosure_marshal_VOID__INT,
                                                 G_TYPE_NONE, 1, G_TYPE_INT);
 
+  /**
+   * CheeseCamera::encoder-adjusted:
+   * @camera: a #CheeseCamera
+   * @adjustment: what was adjusted: "speed-up", "speed-down", "bitrate-down"
+   * or "bitrate-up"
+   *
+   * Emitted while recording a video, when the video encoder was adjusted to
+   * keep up with the frame rate of the camera.
+   */
+  camera_signals[ENCODER_ADJUSTED] = g_signal_new ("encoder-adjusted", G_OBJECT_CLASS_TYPE (klass),
+                                                   G_SIGNAL_RUN_LAST,
+                                                   0, NULL, NULL,
+                                                   g_cclosure_marshal_VOID__STRING,
+                                                   G_TYPE_NONE, 1, G_TYPE_STRING);
+
+  /**
+   * CheeseCamera::burst-photo-saved:
+   * @camera: a #CheeseCamera
+   * @filename: the file of the photo
+   *
+   * Emitted for every photo of a burst started with
+   * cheese_camera_take_burst() once it was written.
+   */
+  camera_signals[BURST_PHOTO_SAVED] = g_signal_new ("burst-photo-saved", G_OBJECT_CLASS_TYPE (klass),
+                                                    G_SIGNAL_RUN_LAST,
+                                                    0, NULL, NULL,
+                                                    g_cclosure_marshal_VOID__STRING,
+                                                    G_TYPE_NONE, 1, G_TYPE_STRING);
+
+  /**
+   * CheeseCamera::burst-done:
+   * @camera: a #CheeseCamera
+   *
+   * Emitted when all the photos of a burst were written, or the burst was
+   * stopped and the photos taken until then were written.
+   */
+  camera_signals[BURST_DONE] = g_signal_new ("burst-done", G_OBJECT_CLASS_TYPE (klass),
+                                             G_SIGNAL_RUN_LAST,
+                                             0, NULL, NULL,
+                                             g_cclosure_marshal_VOID__VOID,
+                                             G_TYPE_NONE, 0);
 
   /**
    * CheeseCamera:video-texture:
@@ -1488,6 +4678,152 @@ cheese_camera_class_init (CheeseCameraClass *klass)
                                                            G_PARAM_READABLE |
                                                            G_PARAM_STATIC_STRINGS);
 
+  /**
+   * CheeseCamera:video-encoder:
+   *
+   * The name of the encoder profile to record videos with: "vp8", "vp9",
+   * "h264" or "av1". If no encoder for the profile is installed, videos are
+   * recorded with VP8. camerabin only takes a new profile up while it starts,
+   * so changing it restarts a playing camera, or, during a recording, takes
+   * effect once the recording is done.
+   */
+  properties[PROP_VIDEO_ENCODER] = g_param_spec_string ("video-encoder",
+                                                        "Video encoder",
+                                                        "The encoder profile to record videos with",
+                                                        CHEESE_ENCODER_PROFILE_DEFAULT,
+                                                        G_PARAM_READWRITE |
+                                                        G_PARAM_STATIC_STRINGS);
+
+  /**
+   * CheeseCamera:preroll-duration:
+   *
+   * The number of seconds of video before the call to
+   * cheese_camera_start_video_recording() to include in a recording, or 0 to
+   * start recording at the call. Only applies when the camera produces JPEG
+   * and the video is recorded without transcoding, and is limited to 64 MiB
+   * of frames.
+   */
+  properties[PROP_PREROLL_DURATION] = g_param_spec_uint ("preroll-duration",
+                                                         "Pre-roll duration",
+                                                         "Seconds of video before the start of a recording to include",
+                                                         0, 30, 0,
+                                                         G_PARAM_READWRITE |
+                                                         G_PARAM_STATIC_STRINGS);
+
+  /**
+   * CheeseCamera:zero-shutter-lag:
+   *
+   * Whether cheese_camera_take_photo() saves the frame shown closest to the
+   * call from the last frames of the stream, rather than capturing the next
+   * frame with camerabin.
+   */
+  properties[PROP_ZERO_SHUTTER_LAG] = g_param_spec_boolean ("zero-shutter-lag",
+                                                            "Zero shutter lag",
+                                                            "Whether to save photos from the recent frames of the stream",
+                                                            TRUE,
+                                                            G_PARAM_READWRITE |
+                                                            G_PARAM_STATIC_STRINGS);
+
+  /**
+   * CheeseCamera:format-switch-time:
+   *
+   * The time the last change of #CheeseCamera:format on a playing camera
+   * took, in milliseconds, until frames of the new format were shown.
+   */
+  properties[PROP_FORMAT_SWITCH_TIME] = g_param_spec_uint ("format-switch-time",
+                                                           "Format switch time",
+                                                           "The time the last format switch took, in milliseconds",
+                                                           0, G_MAXUINT, 0,
+                                                           G_PARAM_READABLE |
+                                                           G_PARAM_STATIC_STRINGS);
+
+  /**
+   * CheeseCamera:max-warm-sources:
+   *
+   * The number of devices to keep open at once, including the selected one.
+   * Above one, the devices following the selected one are kept streaming
+   * behind an input-selector, so that cheese_camera_switch_camera_device()
+   * to one of them only switches pads. Applies the next time the video
+   * source is built.
+   */
+  properties[PROP_MAX_WARM_SOURCES] = g_param_spec_uint ("max-warm-sources",
+                                                         "Maximum warm sources",
+                                                         "The number of devices to keep open at once",
+                                                         1, G_MAXUINT8, 1,
+                                                         G_PARAM_READWRITE |
+                                                         G_PARAM_STATIC_STRINGS);
+
+  /**
+   * CheeseCamera:warm-source-budget:
+   *
+   * The memory the devices kept open may take, in MiB, estimated from the
+   * size of their frames, or 0 for no limit besides
+   * #CheeseCamera:max-warm-sources.
+   */
+  properties[PROP_WARM_SOURCE_BUDGET] = g_param_spec_uint ("warm-source-budget",
+                                                           "Warm source budget",
+                                                           "The memory the devices kept open may take, in MiB",
+                                                           0, G_MAXUINT, 0,
+                                                           G_PARAM_READWRITE |
+                                                           G_PARAM_STATIC_STRINGS);
+
+  /**
+   * CheeseCamera:high-frame-rate:
+   *
+   * The framerate to capture at in high frame rate mode, up to
+   * %CHEESE_CAMERA_DEVICE_MAX_FRAMERATE, or 0 for the normal mode, which
+   * captures at up to 30 FPS. See cheese_camera_set_high_frame_rate().
+   */
+  properties[PROP_HIGH_FRAME_RATE] = g_param_spec_uint ("high-frame-rate",
+                                                        "High frame rate",
+                                                        "The framerate to capture at in high frame rate mode, or 0",
+                                                        0, CHEESE_CAMERA_DEVICE_MAX_FRAMERATE, 0,
+                                                        G_PARAM_READWRITE |
+                                                        G_PARAM_STATIC_STRINGS);
+
+  /**
+   * CheeseCamera:achieved-frame-rate:
+   *
+   * The framerate which the camera achieved over the last second, after the
+   * effect and the balance, to compare with the framerate asked for with
+   * #CheeseCamera:high-frame-rate.
+   */
+  properties[PROP_ACHIEVED_FRAME_RATE] = g_param_spec_double ("achieved-frame-rate",
+                                                              "Achieved frame rate",
+                                                              "The framerate achieved over the last second",
+                                                              0, G_MAXDOUBLE, 0,
+                                                              G_PARAM_READABLE |
+                                                              G_PARAM_STATIC_STRINGS);
+
+  /**
+   * CheeseCamera:effect-switch-time:
+   *
+   * The time the main valve was closed during the last
+   * cheese_camera_set_effect(), in microseconds. Effects which were used
+   * recently, or pre-warmed with cheese_camera_prewarm_effect(), are not
+   * parsed again.
+   */
+  properties[PROP_EFFECT_SWITCH_TIME] = g_param_spec_uint ("effect-switch-time",
+                                                           "Effect switch time",
+                                                           "The time the last effect switch closed the valve, in microseconds",
+                                                           0, G_MAXUINT, 0,
+                                                           G_PARAM_READABLE |
+                                                           G_PARAM_STATIC_STRINGS);
+
+  /**
+   * CheeseCamera:max-effect-previews:
+   *
+   * The number of effect preview branches to keep for reuse, which should be
+   * the number of previews shown at once. Branches beyond it are torn down
+   * by cheese_camera_disconnect_effect_texture().
+   */
+  properties[PROP_MAX_EFFECT_PREVIEWS] = g_param_spec_uint ("max-effect-previews",
+                                                            "Maximum effect previews",
+                                                            "The number of effect preview branches to keep",
+                                                            1, G_MAXUINT8, 9,
+                                                            G_PARAM_READWRITE |
+                                                            G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (object_class, PROP_LAST, properties);
 }
 
@@ -1498,16 +4834,39 @@ cheese_camera_init (CheeseCamera *camera)
 
   priv->is_recording            = FALSE;
   priv->pipeline_is_playing     = FALSE;
+  g_mutex_init (&priv->frame_lock);
+  priv->video_encoder = g_strdup (CHEESE_ENCODER_PROFILE_DEFAULT);
+  priv->still_writer = cheese_still_writer_new ();
+  priv->preroll_ring = cheese_frame_ring_new (CHEESE_CAMERA_PREROLL_BUDGET, 0);
+  gst_segment_init (&priv->source_segment, GST_FORMAT_TIME);
+  g_mutex_init (&priv->still_lock);
+  priv->still_ring = cheese_frame_ring_new (CHEESE_CAMERA_STILL_RING_BUDGET,
+                                            CHEESE_CAMERA_STILL_RING_DURATION);
+  cheese_frame_ring_set_max_frames (priv->still_ring,
+                                    CHEESE_CAMERA_STILL_RING_FRAMES);
+  gst_segment_init (&priv->still_segment, GST_FORMAT_TIME);
+  priv->zero_shutter_lag = TRUE;
+  g_queue_init (&priv->burst_names);
+  priv->source_branches = g_ptr_array_new ();
+  priv->max_warm_sources = 1;
+  priv->effect_cache = cheese_effect_cache_new (CHEESE_CAMERA_EFFECT_CACHE_SIZE);
+  g_queue_init (&priv->prewarm_effects);
+  priv->preview_branches = g_ptr_array_new_with_free_func ((GDestroyNotify) cheese_camera_preview_branch_free);
+  priv->max_effect_previews = 9;
 }
 
 /**
  * cheese_camera_new:
- * @video_texture: an actor in which to render the video
+ * @video_texture: (allow-none): an actor in which to render the video, or
+ * %NULL for a headless camera
  * @name: (allow-none): the name of the device
  * @x_resolution: the resolution width
  * @y_resolution: the resolution height
  *
- * Create a new #CheeseCamera object.
+ * Create a new #CheeseCamera object. A headless camera, created with a %NULL
+ * @video_texture, does not render its viewfinder; its frames are available
+ * through cheese_camera_set_frame_callback() and cheese_camera_pull_sample()
+ * instead.
  *
  * Returns: a new #CheeseCamera
  */
@@ -1536,7 +4895,8 @@ cheese_camera_new (ClutterActor *video_texture, const gchar *name,
  * @camera: a #CheeseCamera
  * @device: the device object
  *
- * Set the active video capture device of the @camera.
+ * Set the active video capture device of the @camera. If @device was not found
+ * by the device monitor, it is added to the list of devices of @camera.
  */
 void
 cheese_camera_set_device (CheeseCamera *camera, CheeseCameraDevice *device)
@@ -1554,13 +4914,49 @@ cheese_camera_size_change_cb (ClutterGstContent *content, gint width, gint heigh
   clutter_actor_set_size (priv->video_texture, width, height);
 }
 
+/*
+ * cheese_camera_frame_sink_new_sample:
+ * @appsink: the headless viewfinder sink
+ * @user_data: a #CheeseCamera
+ *
+ * Hand a new viewfinder frame to the frame callback, if one is set. Otherwise
+ * leave it queued in @appsink for cheese_camera_pull_sample().
+ *
+ * Returns: %GST_FLOW_OK
+ */
+static GstFlowReturn
+cheese_camera_frame_sink_new_sample (GstAppSink *appsink, gpointer user_data)
+{
+  CheeseCamera        *camera = CHEESE_CAMERA (user_data);
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  GstSample           *sample;
+
+  g_mutex_lock (&priv->frame_lock);
+
+  if (priv->frame_func != NULL)
+  {
+    sample = gst_app_sink_pull_sample (appsink);
+    if (sample != NULL)
+    {
+      priv->frame_func (camera, sample, priv->frame_data);
+      gst_sample_unref (sample);
+    }
+  }
+
+  g_mutex_unlock (&priv->frame_lock);
+
+  return GST_FLOW_OK;
+}
+
 /**
  * cheese_camera_setup:
  * @camera: a #CheeseCamera
  * @device: (allow-none): the video capture device, or %NULL
  * @error: return location for a #GError, or %NULL
  *
- * Setup a video capture device.
+ * Setup a video capture device. If @device was not found by the device
+ * monitor, for example because it is a stand-in for testing, it is added to
+ * the list of devices of @camera.
  */
 void
 cheese_camera_setup (CheeseCamera *camera, CheeseCameraDevice *device, GError **error)
@@ -1568,6 +4964,7 @@ cheese_camera_setup (CheeseCamera *camera, CheeseCameraDevice *device, GError **
   CheeseCameraPrivate *priv;
   GError  *tmp_error = NULL;
   GstElement *video_sink;
+  GstCaps *preview_caps;
 
   g_return_if_fail (error == NULL || *error == NULL);
   g_return_if_fail (CHEESE_IS_CAMERA (camera));
@@ -1576,6 +4973,9 @@ cheese_camera_setup (CheeseCamera *camera, CheeseCameraDevice *device, GError **
 
   cheese_camera_detect_camera_devices (camera);
 
+  if (device != NULL)
+    cheese_camera_add_unknown_device (camera, device);
+
   if (priv->num_camera_devices < 1)
   {
     g_set_error (error, CHEESE_CAMERA_ERROR, CHEESE_CAMERA_ERROR_NO_DEVICE, _("No device found"));
@@ -1613,17 +5013,49 @@ cheese_camera_setup (CheeseCamera *camera, CheeseCameraDevice *device, GError **
     cheese_camera_set_error_element_not_found (error, "wrappercamerabinsrc");
   }
   g_object_set (priv->camerabin, "camera-source", priv->camera_source, NULL);
+  g_signal_connect (G_OBJECT (priv->camerabin), "deep-element-added",
+                    G_CALLBACK (cheese_camera_deep_element_added), camera);
+
+  /* Previews are only posted for cheese_camera_take_photo_pixbuf(). Leave the
+   * size unset so that the preview is not scaled, and accept either layout
+   * that a GdkPixbuf can wrap without copying. */
+  preview_caps = gst_caps_from_string ("video/x-raw, format=(string){ RGB, RGBA }");
+  g_object_set (G_OBJECT (priv->camerabin), "post-previews", FALSE,
+                "preview-caps", preview_caps, NULL);
+  gst_caps_unref (preview_caps);
+
+  if (priv->video_texture != NULL)
+  {
+    /* Create a clutter-gst sink and set it as camerabin sink*/
+
+    video_sink = GST_ELEMENT (clutter_gst_video_sink_new ());
+    g_object_set (G_OBJECT (priv->video_texture),
+                  "content", g_object_new (CLUTTER_GST_TYPE_CONTENT,
+                                           "sink", video_sink,
+                                           NULL),
+                  NULL);
+    g_signal_connect (G_OBJECT (clutter_actor_get_content (priv->video_texture)),
+                      "size-change", G_CALLBACK(cheese_camera_size_change_cb), camera);
+  }
+  else
+  {
+    GstAppSinkCallbacks callbacks = { NULL, };
 
-  /* Create a clutter-gst sink and set it as camerabin sink*/
-
-  video_sink = GST_ELEMENT (clutter_gst_video_sink_new ());
-  g_object_set (G_OBJECT (priv->video_texture),
-                "content", g_object_new (CLUTTER_GST_TYPE_CONTENT,
-                                         "sink", video_sink,
-                                         NULL),
-                NULL);
-  g_signal_connect (G_OBJECT (clutter_actor_get_content (priv->video_texture)),
-                    "size-change", G_CALLBACK(cheese_camera_size_change_cb), camera);
+    /* Headless: hand frames out through an appsink, without rendering. */
+    if ((video_sink = gst_element_factory_make ("appsink", "frame_sink")) == NULL)
+    {
+      cheese_camera_set_error_element_not_found (error, "appsink");
+      return;
+    }
+    g_object_set (G_OBJECT (video_sink), "sync", FALSE,
+                  "max-buffers", priv->high_frame_rate != 0 ? 1 : 2,
+                  "drop", TRUE, "enable-last-sample", FALSE, NULL);
+
+    callbacks.new_sample = cheese_camera_frame_sink_new_sample;
+    gst_app_sink_set_callbacks (GST_APP_SINK (video_sink), &callbacks,
+                                camera, NULL);
+    priv->frame_sink = gst_object_ref (video_sink);
+  }
 
   g_object_set (G_OBJECT (priv->camerabin), "viewfinder-sink", video_sink, NULL);
 
@@ -1714,13 +5146,76 @@ cheese_camera_is_playing (CheeseCamera *camera)
   return priv->pipeline_is_playing;
 }
 
+/*
+ * cheese_camera_format_switch_timeout:
+ * @data: a #CheeseCamera
+ *
+ * Restart the camera if the live format switch did not complete in time. The
+ * switch stays pending, so that its time includes the restart.
+ *
+ * Returns: %G_SOURCE_REMOVE
+ */
+static gboolean
+cheese_camera_format_switch_timeout (gpointer data)
+{
+  CheeseCamera *camera = CHEESE_CAMERA (data);
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+
+  priv->switch_source = 0;
+
+  if (g_atomic_int_get (&priv->switch_pending) && priv->pipeline_is_playing)
+  {
+    GST_WARNING_OBJECT (camera, "Live switch to %dx%d timed out, restarting",
+                        priv->switch_width, priv->switch_height);
+    cheese_camera_stop (camera);
+    cheese_camera_play (camera);
+  }
+
+  return G_SOURCE_REMOVE;
+}
+
+/*
+ * cheese_camera_renegotiate:
+ * @camera: a #CheeseCamera
+ *
+ * Apply the current format to the playing pipeline: set the new caps on the
+ * video_source_filter and camerabin, and ask the source to reconfigure. If
+ * the new caps do not come through in time, or the device rejects them, the
+ * camera is restarted instead.
+ */
+static void
+cheese_camera_renegotiate (CheeseCamera *camera)
+{
+  CheeseCameraPrivate *priv = cheese_camera_get_instance_private (camera);
+  GstElement *filter;
+  GstPad *pad;
+
+  cheese_camera_restore_converters (camera);
+  cheese_camera_set_new_caps (camera);
+
+  filter = gst_bin_get_by_name (GST_BIN (priv->source_branch),
+                                "video_source_filter");
+  pad = gst_element_get_static_pad (filter, "sink");
+  gst_pad_push_event (pad, gst_event_new_reconfigure ());
+  gst_object_unref (pad);
+  gst_object_unref (filter);
+
+  if (priv->switch_source != 0)
+    g_source_remove (priv->switch_source);
+  priv->switch_source = g_timeout_add (CHEESE_CAMERA_FORMAT_SWITCH_TIMEOUT,
+                                       cheese_camera_format_switch_timeout,
+                                       camera);
+}
+
 /**
  * cheese_camera_set_video_format:
  * @camera: a #CheeseCamera
  * @format: a #CheeseVideoFormat
  *
- * Sets a #CheeseVideoFormat on a #CheeseCamera, restarting the video stream if
- * necessary.
+ * Sets a #CheeseVideoFormat on a #CheeseCamera. A playing camera switches to
+ * the new format without stopping, and is only restarted while recording or
+ * if the device does not accept the new format. The time the switch took is
+ * available in #CheeseCamera:format-switch-time.
  */
 void
 cheese_camera_set_video_format (CheeseCamera *camera, CheeseVideoFormat *format)
@@ -1736,11 +5231,69 @@ cheese_camera_set_video_format (CheeseCamera *camera, CheeseVideoFormat *format)
   {
     g_object_set (G_OBJECT (camera), "format", format, NULL);
     if (cheese_camera_is_playing (camera))
+    {
+      priv->switch_width = format->width;
+      priv->switch_height = format->height;
+      priv->switch_start = g_get_monotonic_time ();
+      g_atomic_int_set (&priv->switch_pending, TRUE);
+
+      /* A recording cannot change its size on the fly. */
+      if (priv->is_recording)
+      {
+        cheese_camera_stop (camera);
+        cheese_camera_play (camera);
+      }
+      else
+      {
+        cheese_camera_renegotiate (camera);
+      }
+    }
+  }
+}
+
+/**
+ * cheese_camera_set_high_frame_rate:
+ * @camera: a #CheeseCamera
+ * @rate: the framerate to capture at, up to
+ * %CHEESE_CAMERA_DEVICE_MAX_FRAMERATE, or 0 to go back to the normal mode
+ *
+ * Capture at up to @rate FPS, for formats of the device which offer it; see
+ * cheese_camera_device_get_max_framerate(). The pipeline is tuned for
+ * latency meanwhile: the effect previews are turned off and frames which the
+ * previews cannot keep up with are dropped. The framerate actually achieved
+ * is available in #CheeseCamera:achieved-frame-rate. A playing camera
+ * switches without stopping, unless it is recording.
+ */
+void
+cheese_camera_set_high_frame_rate (CheeseCamera *camera, guint rate)
+{
+  CheeseCameraPrivate *priv;
+
+  g_return_if_fail (CHEESE_IS_CAMERA (camera));
+
+  priv = cheese_camera_get_instance_private (camera);
+
+  rate = MIN (rate, CHEESE_CAMERA_DEVICE_MAX_FRAMERATE);
+  if (rate == priv->high_frame_rate)
+    return;
+
+  priv->high_frame_rate = rate;
+  cheese_camera_apply_frame_rate_mode (camera);
+
+  if (cheese_camera_is_playing (camera))
+  {
+    if (priv->is_recording)
     {
       cheese_camera_stop (camera);
       cheese_camera_play (camera);
     }
+    else
+    {
+      cheese_camera_renegotiate (camera);
+    }
   }
+
+  g_object_notify_by_pspec (G_OBJECT (camera), properties[PROP_HIGH_FRAME_RATE]);
 }
 
 /**
@@ -1824,6 +5377,11 @@ cheese_camera_set_balance_property (CheeseCamera *camera, const gchar *property,
     priv = cheese_camera_get_instance_private (camera);
 
   g_object_set (G_OBJECT (priv->video_balance), property, value, NULL);
+
+  /* The balance element switches to passthrough by itself. */
+  GST_DEBUG_OBJECT (camera, "Balance %s",
+                    cheese_camera_balance_is_neutral (camera) ? "bypassed"
+                                                              : "engaged");
 }
 
 /**
@@ -1851,7 +5409,19 @@ cheese_camera_get_recorded_time (CheeseCamera *camera)
 
   g_return_val_if_fail (CHEESE_IS_CAMERA (camera), NULL);
 
-  videosink = gst_bin_get_by_name (GST_BIN_CAST (priv->camerabin), "videobin-filesink");
+  if (priv->recorder != NULL) {
+    GstClock *clock = gst_element_get_clock (priv->camerabin);
+
+    if (clock != NULL) {
+      curtime = gst_clock_get_time (clock) -
+                gst_element_get_base_time (priv->camerabin) -
+                priv->recorder_start;
+      gst_object_unref (clock);
+      ret = TRUE;
+    }
+  }
+
+  videosink = ret ? NULL : gst_bin_get_by_name (GST_BIN_CAST (priv->camerabin), "videobin-filesink");
   if (videosink) {
     ret = gst_element_query_position (videosink, format, &curtime);
     gst_object_unref (videosink);
@@ -1878,3 +5448,31 @@ cheese_camera_get_recorded_time (CheeseCamera *camera)
     return NULL;
   }
 }
+
+/**
+ * cheese_camera_get_video_file_suffix:
+ * @camera: A #CheeseCamera
+ *
+ * Get the filename suffix matching the container that the next video
+ * recording will be written in, such as ".webm". Pass it to
+ * cheese_fileutil_get_new_video_filename().
+ *
+ * Returns: the filename suffix, including the leading dot
+ */
+const gchar *
+cheese_camera_get_video_file_suffix (CheeseCamera *camera)
+{
+  CheeseCameraPrivate *priv;
+
+  g_return_val_if_fail (CHEESE_IS_CAMERA (camera), CHEESE_VIDEO_NAME_SUFFIX);
+
+  priv = cheese_camera_get_instance_private (camera);
+
+  if (cheese_camera_can_pass_through (camera))
+    return CHEESE_MATROSKA_VIDEO_NAME_SUFFIX;
+
+  if (priv->encoder_profile != NULL)
+    return cheese_encoder_profile_get_suffix (priv->encoder_profile);
+
+  return CHEESE_VIDEO_NAME_SUFFIX;
+}
@@ -94,6 +94,21 @@ typedef enum
   CHEESE_CAMERA_ERROR_NO_DEVICE
 } CheeseCameraError;
 
+/**
+ * CheeseCameraFrameFunc:
+ * @camera: the #CheeseCamera which captured the frame
+ * @sample: a #GstSample holding the frame buffer, with its timestamps, and
+ * the caps describing it
+ * @user_data: the data passed to cheese_camera_set_frame_callback()
+ *
+ * Called from a GStreamer streaming thread for every viewfinder frame of a
+ * headless #CheeseCamera. @sample is only valid for the duration of the call;
+ * take a reference to keep it.
+ */
+typedef void (*CheeseCameraFrameFunc) (CheeseCamera *camera,
+                                       GstSample    *sample,
+                                       gpointer      user_data);
+
 GType         cheese_camera_get_type (void);
 CheeseCamera *cheese_camera_new (ClutterActor *video_texture,
                                  const gchar  *name,
@@ -105,13 +120,38 @@ void                     cheese_camera_setup (CheeseCamera *camera, CheeseCamera
 void                     cheese_camera_play (CheeseCamera *camera);
 void                     cheese_camera_stop (CheeseCamera *camera);
 void                     cheese_camera_set_effect (CheeseCamera *camera, CheeseEffect *effect);
+void                     cheese_camera_prewarm_effect (CheeseCamera *camera, CheeseEffect *effect);
 void                     cheese_camera_connect_effect_texture (CheeseCamera *camera,
                                                                CheeseEffect *effect,
                                                                ClutterActor *texture);
+void                     cheese_camera_disconnect_effect_texture (CheeseCamera *camera,
+                                                                  CheeseEffect *effect);
+void                     cheese_camera_set_effects_preview_size (CheeseCamera *camera,
+                                                                 guint         width,
+                                                                 guint         height);
+gboolean                 cheese_camera_connect_effects_mosaic (CheeseCamera *camera,
+                                                               GList        *effects,
+                                                               guint         columns,
+                                                               ClutterActor *texture);
+void                     cheese_camera_disconnect_effects_mosaic (CheeseCamera *camera);
+gint                     cheese_camera_get_effects_mosaic_cell (CheeseCamera *camera,
+                                                                gdouble       x,
+                                                                gdouble       y);
+void                     cheese_camera_set_frame_callback (CheeseCamera         *camera,
+                                                           CheeseCameraFrameFunc func,
+                                                           gpointer              user_data,
+                                                           GDestroyNotify        notify);
+GstSample *              cheese_camera_pull_sample (CheeseCamera *camera,
+                                                    GstClockTime  timeout);
 void                cheese_camera_start_video_recording (CheeseCamera *camera, const gchar *filename);
 void                cheese_camera_stop_video_recording (CheeseCamera *camera);
 gboolean            cheese_camera_take_photo (CheeseCamera *camera, const gchar *filename);
 gboolean            cheese_camera_take_photo_pixbuf (CheeseCamera *camera);
+gboolean            cheese_camera_take_burst (CheeseCamera *camera,
+                                              guint         count,
+                                              guint         interval);
+void                cheese_camera_stop_burst (CheeseCamera *camera);
+const gchar *       cheese_camera_get_video_file_suffix (CheeseCamera *camera);
 CheeseCameraDevice *cheese_camera_get_selected_device (CheeseCamera *camera);
 GPtrArray *         cheese_camera_get_camera_devices (CheeseCamera *camera);
 void                cheese_camera_set_device (CheeseCamera *camera, CheeseCameraDevice *device);
@@ -119,6 +159,8 @@ void                cheese_camera_switch_camera_device (CheeseCamera *camera);
 GList *             cheese_camera_get_video_formats (CheeseCamera *camera);
 void                cheese_camera_set_video_format (CheeseCamera      *camera,
                                                     CheeseVideoFormat *format);
+void                cheese_camera_set_high_frame_rate (CheeseCamera *camera,
+                                                       guint         rate);
 gboolean cheese_camera_get_balance_property_range (CheeseCamera *camera,
                                                    const gchar *property,
                                                    gdouble *min, gdouble *max, gdouble *def);
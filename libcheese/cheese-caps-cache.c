@@ -0,0 +1,427 @@
+/*
+ * Copyright © 2026 Cheese contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+  #include <config.h>
+#endif
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+
+#include "cheese-caps-cache.h"
+
+/*
+ * CheeseCapsCache keeps the filtered caps and the format table of each video
+ * capture device on disk, so that they need not be worked out again on every
+ * start. An entry is only used if the path, the driver and a checksum of the
+ * caps reported by the device all match, and if it was written by the same
+ * version of the format table code. It also keeps values measured once per
+ * machine, such as the cost of decoding. The file is written in a worker
+ * thread, off the start-up path.
+ */
+
+/*
+ * CHEESE_CAPS_CACHE_VERSION:
+ *
+ * The version of the entries. Bump it whenever the filtering or the format
+ * table of #CheeseCameraDevice change, to drop the entries of older versions.
+ */
+#define CHEESE_CAPS_CACHE_VERSION 3
+
+/*
+ * CHEESE_CAPS_CACHE_MACHINE:
+ *
+ * The group of the values measured on this machine, rather than a device.
+ */
+#define CHEESE_CAPS_CACHE_MACHINE "machine"
+
+struct _CheeseCapsCache
+{
+  gchar       *filename;
+  GThreadPool *pool;
+
+  /* Protects all of the below. */
+  GMutex       lock;
+  GCond        idle;
+  GKeyFile    *keyfile;
+  gboolean     write_queued;
+  guint        pending;
+};
+
+GST_DEBUG_CATEGORY_STATIC (cheese_caps_cache_cat);
+#define GST_CAT_DEFAULT cheese_caps_cache_cat
+
+/*
+ * cheese_caps_cache_checksum:
+ * @caps: the caps reported by a device
+ *
+ * Returns: (transfer full): a checksum of @caps
+ */
+static gchar *
+cheese_caps_cache_checksum (const GstCaps *caps)
+{
+  gchar *string, *checksum;
+
+  string = gst_caps_to_string (caps);
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, string, -1);
+  g_free (string);
+
+  return checksum;
+}
+
+/*
+ * cheese_caps_cache_queue_write:
+ * @cache: a #CheeseCapsCache
+ *
+ * Write the cache to disk, unless a write is queued already, which will pick
+ * up the latest changes. Called with the lock held.
+ */
+static void
+cheese_caps_cache_queue_write (CheeseCapsCache *cache)
+{
+  if (cache->write_queued)
+    return;
+
+  cache->write_queued = TRUE;
+  cache->pending++;
+  g_thread_pool_push (cache->pool, cache, NULL);
+}
+
+/*
+ * cheese_caps_cache_write:
+ * @cache: a #CheeseCapsCache
+ *
+ * Write the cache to disk, atomically.
+ */
+static void
+cheese_caps_cache_write (CheeseCapsCache *cache)
+{
+  GError *error = NULL;
+  gchar *data, *dirname;
+  gsize length;
+
+  g_mutex_lock (&cache->lock);
+  cache->write_queued = FALSE;
+  data = g_key_file_to_data (cache->keyfile, &length, NULL);
+  g_mutex_unlock (&cache->lock);
+
+  dirname = g_path_get_dirname (cache->filename);
+  g_mkdir_with_parents (dirname, 0700);
+  g_free (dirname);
+
+  if (!g_file_set_contents (cache->filename, data, length, &error))
+  {
+    GST_WARNING ("Could not write %s: %s", cache->filename, error->message);
+    g_error_free (error);
+  }
+
+  g_free (data);
+}
+
+static void
+cheese_caps_cache_run (gpointer data, gpointer user_data)
+{
+  CheeseCapsCache *cache = user_data;
+
+  cheese_caps_cache_write (cache);
+
+  g_mutex_lock (&cache->lock);
+  if (--cache->pending == 0)
+    g_cond_broadcast (&cache->idle);
+  g_mutex_unlock (&cache->lock);
+}
+
+/*
+ * cheese_caps_cache_new:
+ * @filename: the file to keep the cache in
+ *
+ * Load the cache from @filename, if it exists.
+ *
+ * Returns: a new #CheeseCapsCache
+ */
+CheeseCapsCache *
+cheese_caps_cache_new (const gchar *filename)
+{
+  CheeseCapsCache *cache;
+
+  if (cheese_caps_cache_cat == NULL)
+    GST_DEBUG_CATEGORY_INIT (cheese_caps_cache_cat, "cheese-caps-cache",
+                             0, "Cheese Caps Cache");
+
+  cache = g_slice_new0 (CheeseCapsCache);
+  cache->filename = g_strdup (filename);
+  cache->keyfile = g_key_file_new ();
+  g_mutex_init (&cache->lock);
+  g_cond_init (&cache->idle);
+
+  /* A single thread, so that the writes run in order. */
+  cache->pool = g_thread_pool_new (cheese_caps_cache_run, cache, 1, FALSE,
+                                   NULL);
+
+  if (!g_key_file_load_from_file (cache->keyfile, filename, G_KEY_FILE_NONE,
+                                  NULL))
+    GST_DEBUG ("No usable cache in %s", filename);
+
+  return cache;
+}
+
+/*
+ * cheese_caps_cache_get_default:
+ *
+ * Returns: (transfer none): the cache in the user cache directory, shared
+ * by all devices
+ */
+CheeseCapsCache *
+cheese_caps_cache_get_default (void)
+{
+  static gsize initialized = 0;
+  static CheeseCapsCache *cache = NULL;
+
+  if (g_once_init_enter (&initialized))
+  {
+    gchar *filename;
+
+    filename = g_build_filename (g_get_user_cache_dir (), "cheese",
+                                 "devices.cache", NULL);
+    cache = cheese_caps_cache_new (filename);
+    g_free (filename);
+
+    g_once_init_leave (&initialized, 1);
+  }
+
+  return cache;
+}
+
+/*
+ * cheese_caps_cache_free:
+ * @cache: a #CheeseCapsCache
+ *
+ * Finish the pending jobs and free @cache.
+ */
+void
+cheese_caps_cache_free (CheeseCapsCache *cache)
+{
+  if (cache == NULL)
+    return;
+
+  g_thread_pool_free (cache->pool, FALSE, TRUE);
+  g_key_file_free (cache->keyfile);
+  g_mutex_clear (&cache->lock);
+  g_cond_clear (&cache->idle);
+  g_free (cache->filename);
+  g_slice_free (CheeseCapsCache, cache);
+}
+
+/*
+ * cheese_caps_cache_lookup:
+ * @cache: a #CheeseCapsCache
+ * @path: the path of the device
+ * @driver: (allow-none): the driver of the device
+ * @caps: the caps reported by the device
+ * @filtered: (out) (transfer full): return location for the filtered caps
+ * @formats: (out) (transfer full) (element-type CheeseCapsCacheFormat):
+ * return location for the format table
+ *
+ * Returns: %TRUE if @cache has a valid entry for the device
+ */
+gboolean
+cheese_caps_cache_lookup (CheeseCapsCache *cache, const gchar *path,
+                          const gchar *driver, const GstCaps *caps,
+                          GstCaps **filtered, GArray **formats)
+{
+  gchar *checksum, *cached_checksum, *cached_driver, *string;
+  gint *values = NULL;
+  gsize n_values = 0, i;
+  gboolean valid;
+
+  checksum = cheese_caps_cache_checksum (caps);
+
+  /* A hit is only validated by the checksum of @caps, which the device
+   * reported through gst_device_get_caps(), synchronously, when it was
+   * enumerated. Formats which the driver would fail to negotiate are not
+   * probed again. */
+  g_mutex_lock (&cache->lock);
+  cached_checksum = g_key_file_get_string (cache->keyfile, path, "checksum",
+                                           NULL);
+  cached_driver = g_key_file_get_string (cache->keyfile, path, "driver", NULL);
+  string = g_key_file_get_string (cache->keyfile, path, "caps", NULL);
+  valid = g_key_file_get_integer (cache->keyfile, path, "version", NULL) ==
+          CHEESE_CAPS_CACHE_VERSION &&
+          g_strcmp0 (cached_checksum, checksum) == 0 &&
+          g_strcmp0 (cached_driver, driver != NULL ? driver : "") == 0 &&
+          string != NULL;
+  if (valid)
+    values = g_key_file_get_integer_list (cache->keyfile, path, "formats",
+                                          &n_values, NULL);
+  g_mutex_unlock (&cache->lock);
+
+  *filtered = NULL;
+  *formats = NULL;
+
+  if (valid && values != NULL && n_values % 4 == 0)
+  {
+    *filtered = gst_caps_from_string (string);
+    if (*filtered != NULL && gst_caps_is_empty (*filtered))
+      gst_caps_replace (filtered, NULL);
+  }
+
+  if (*filtered != NULL)
+  {
+    *formats = g_array_sized_new (FALSE, FALSE, sizeof (CheeseCapsCacheFormat),
+                                  n_values / 4);
+    for (i = 0; i < n_values; i += 4)
+    {
+      CheeseCapsCacheFormat format = { values[i], values[i + 1],
+                                       values[i + 2], values[i + 3] };
+
+      g_array_append_val (*formats, format);
+    }
+  }
+
+  GST_DEBUG ("%s for %s", *filtered != NULL ? "Hit" : "Miss", path);
+
+  g_free (values);
+  g_free (string);
+  g_free (cached_driver);
+  g_free (cached_checksum);
+  g_free (checksum);
+
+  return *filtered != NULL;
+}
+
+/*
+ * cheese_caps_cache_store:
+ * @cache: a #CheeseCapsCache
+ * @path: the path of the device
+ * @driver: (allow-none): the driver of the device
+ * @caps: the caps reported by the device
+ * @filtered: the filtered caps of the device
+ * @formats: (element-type CheeseCapsCacheFormat): the format table of the
+ * device
+ *
+ * Replace the entry of a device, and write the cache to disk in the
+ * background.
+ */
+void
+cheese_caps_cache_store (CheeseCapsCache *cache, const gchar *path,
+                         const gchar *driver, const GstCaps *caps,
+                         const GstCaps *filtered, const GArray *formats)
+{
+  gchar *checksum, *string;
+  gint *values;
+  guint i;
+
+  checksum = cheese_caps_cache_checksum (caps);
+  string = gst_caps_to_string (filtered);
+  values = g_new (gint, formats->len * 4);
+  for (i = 0; i < formats->len; i++)
+  {
+    const CheeseCapsCacheFormat *format = &g_array_index (formats,
+                                                          CheeseCapsCacheFormat,
+                                                          i);
+
+    values[i * 4] = format->width;
+    values[i * 4 + 1] = format->height;
+    values[i * 4 + 2] = format->fr_numerator;
+    values[i * 4 + 3] = format->fr_denominator;
+  }
+
+  g_mutex_lock (&cache->lock);
+  g_key_file_remove_group (cache->keyfile, path, NULL);
+  g_key_file_set_integer (cache->keyfile, path, "version",
+                          CHEESE_CAPS_CACHE_VERSION);
+  g_key_file_set_string (cache->keyfile, path, "driver",
+                         driver != NULL ? driver : "");
+  g_key_file_set_string (cache->keyfile, path, "checksum", checksum);
+  g_key_file_set_string (cache->keyfile, path, "caps", string);
+  g_key_file_set_integer_list (cache->keyfile, path, "formats", values,
+                               formats->len * 4);
+  cheese_caps_cache_queue_write (cache);
+  g_mutex_unlock (&cache->lock);
+
+  g_free (values);
+  g_free (string);
+  g_free (checksum);
+}
+
+/*
+ * cheese_caps_cache_get_value:
+ * @cache: a #CheeseCapsCache
+ * @name: the name of the value
+ * @value: (out): return location for the value
+ *
+ * Get a value measured on this machine, such as the cost of decoding.
+ *
+ * Returns: %TRUE if @cache has the value
+ */
+gboolean
+cheese_caps_cache_get_value (CheeseCapsCache *cache, const gchar *name,
+                             gdouble *value)
+{
+  GError *error = NULL;
+
+  g_mutex_lock (&cache->lock);
+  *value = g_key_file_get_double (cache->keyfile, CHEESE_CAPS_CACHE_MACHINE,
+                                  name, &error);
+  g_mutex_unlock (&cache->lock);
+
+  if (error != NULL)
+  {
+    g_error_free (error);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/*
+ * cheese_caps_cache_set_value:
+ * @cache: a #CheeseCapsCache
+ * @name: the name of the value
+ * @value: the value
+ *
+ * Store a value measured on this machine, and write the cache to disk in the
+ * background.
+ */
+void
+cheese_caps_cache_set_value (CheeseCapsCache *cache, const gchar *name,
+                             gdouble value)
+{
+  g_mutex_lock (&cache->lock);
+  g_key_file_set_double (cache->keyfile, CHEESE_CAPS_CACHE_MACHINE, name,
+                         value);
+  cheese_caps_cache_queue_write (cache);
+  g_mutex_unlock (&cache->lock);
+}
+
+/*
+ * cheese_caps_cache_flush:
+ * @cache: a #CheeseCapsCache
+ *
+ * Wait for the pending writes.
+ */
+void
+cheese_caps_cache_flush (CheeseCapsCache *cache)
+{
+  g_mutex_lock (&cache->lock);
+  while (cache->pending > 0)
+    g_cond_wait (&cache->idle, &cache->lock);
+  g_mutex_unlock (&cache->lock);
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright © 2026 Cheese contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHEESE_CAPS_CACHE_H_
+#define CHEESE_CAPS_CACHE_H_
+
+#include <glib.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/*
+ * CheeseCapsCacheFormat:
+ * @width: the width of the format, in pixels
+ * @height: the height of the format, in pixels
+ * @fr_numerator: the numerator of the highest framerate
+ * @fr_denominator: the denominator of the highest framerate
+ *
+ * An entry of the format table of a device.
+ */
+typedef struct
+{
+  gint width;
+  gint height;
+  gint fr_numerator;
+  gint fr_denominator;
+} CheeseCapsCacheFormat;
+
+typedef struct _CheeseCapsCache CheeseCapsCache;
+
+CheeseCapsCache *cheese_caps_cache_new (const gchar *filename);
+CheeseCapsCache *cheese_caps_cache_get_default (void);
+void             cheese_caps_cache_free (CheeseCapsCache *cache);
+gboolean         cheese_caps_cache_lookup (CheeseCapsCache *cache,
+                                           const gchar     *path,
+                                           const gchar     *driver,
+                                           const GstCaps   *caps,
+                                           GstCaps        **filtered,
+                                           GArray         **formats);
+void             cheese_caps_cache_store (CheeseCapsCache *cache,
+                                          const gchar     *path,
+                                          const gchar     *driver,
+                                          const GstCaps   *caps,
+                                          const GstCaps   *filtered,
+                                          const GArray    *formats);
+gboolean         cheese_caps_cache_get_value (CheeseCapsCache *cache,
+                                              const gchar     *name,
+                                              gdouble         *value);
+void             cheese_caps_cache_set_value (CheeseCapsCache *cache,
+                                              const gchar     *name,
+                                              gdouble          value);
+void             cheese_caps_cache_flush (CheeseCapsCache *cache);
+
+G_END_DECLS
+
+#endif /* CHEESE_CAPS_CACHE_H_ */
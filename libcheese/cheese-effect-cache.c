@@ -0,0 +1,193 @@
+/*
+ * Copyright © 2026 Cheese contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+  #include <config.h>
+#endif
+
+#include <glib.h>
+#include <gst/gst.h>
+
+#include "cheese-effect-cache.h"
+
+/*
+ * CheeseEffectCache keeps the effect bins which are not in use, keyed by the
+ * pipeline description they were parsed from, so that switching back to an
+ * effect does not parse it again. The least recently used bin is dropped when
+ * the cache is full. A bin can only be in one pipeline, so it leaves the cache
+ * while it is in use. It takes no locks: it must only be used from the main
+ * thread.
+ */
+
+struct _CheeseEffectCache
+{
+  GQueue      entries;
+  GHashTable *index;
+  guint       capacity;
+};
+
+typedef struct
+{
+  gchar      *desc;
+  GstElement *element;
+} CheeseEffectCacheEntry;
+
+/*
+ * cheese_effect_cache_new:
+ * @capacity: the most bins to keep
+ *
+ * Returns: a new, empty #CheeseEffectCache
+ */
+CheeseEffectCache *
+cheese_effect_cache_new (guint capacity)
+{
+  CheeseEffectCache *cache;
+
+  cache = g_slice_new0 (CheeseEffectCache);
+  g_queue_init (&cache->entries);
+  cache->index = g_hash_table_new (g_str_hash, g_str_equal);
+  cache->capacity = capacity;
+
+  return cache;
+}
+
+/*
+ * cheese_effect_cache_entry_free:
+ * @entry: a #CheeseEffectCacheEntry
+ *
+ * Shut the bin of @entry down and free @entry.
+ */
+static void
+cheese_effect_cache_entry_free (CheeseEffectCacheEntry *entry)
+{
+  gst_element_set_state (entry->element, GST_STATE_NULL);
+  gst_object_unref (entry->element);
+  g_free (entry->desc);
+  g_slice_free (CheeseEffectCacheEntry, entry);
+}
+
+void
+cheese_effect_cache_free (CheeseEffectCache *cache)
+{
+  if (cache == NULL)
+    return;
+
+  g_queue_foreach (&cache->entries, (GFunc) cheese_effect_cache_entry_free,
+                   NULL);
+  g_queue_clear (&cache->entries);
+  g_hash_table_destroy (cache->index);
+  g_slice_free (CheeseEffectCache, cache);
+}
+
+/*
+ * cheese_effect_cache_take:
+ * @cache: a #CheeseEffectCache
+ * @desc: the pipeline description of the effect
+ *
+ * Take the bin of @desc out of @cache.
+ *
+ * Returns: (transfer full): the bin, or %NULL if it is not in @cache
+ */
+GstElement *
+cheese_effect_cache_take (CheeseEffectCache *cache, const gchar *desc)
+{
+  CheeseEffectCacheEntry *entry;
+  GstElement *element;
+  GList *link;
+
+  link = g_hash_table_lookup (cache->index, desc);
+  if (link == NULL)
+    return NULL;
+
+  entry = link->data;
+  g_hash_table_remove (cache->index, entry->desc);
+  g_queue_delete_link (&cache->entries, link);
+
+  element = entry->element;
+  g_free (entry->desc);
+  g_slice_free (CheeseEffectCacheEntry, entry);
+
+  return element;
+}
+
+/*
+ * cheese_effect_cache_put:
+ * @cache: a #CheeseEffectCache
+ * @desc: the pipeline description of the effect
+ * @element: (transfer full): the bin parsed from @desc, not in a pipeline and
+ * not floating
+ *
+ * Keep @element as the most recently used bin, dropping the least recently
+ * used one if @cache is full. A bin already kept for @desc is replaced.
+ */
+void
+cheese_effect_cache_put (CheeseEffectCache *cache, const gchar *desc,
+                         GstElement *element)
+{
+  CheeseEffectCacheEntry *entry;
+  GstElement *previous;
+
+  previous = cheese_effect_cache_take (cache, desc);
+  if (previous != NULL)
+  {
+    gst_element_set_state (previous, GST_STATE_NULL);
+    gst_object_unref (previous);
+  }
+
+  if (cache->capacity == 0)
+  {
+    gst_element_set_state (element, GST_STATE_NULL);
+    gst_object_unref (element);
+    return;
+  }
+
+  while (g_queue_get_length (&cache->entries) >= cache->capacity)
+  {
+    entry = g_queue_pop_head (&cache->entries);
+    g_hash_table_remove (cache->index, entry->desc);
+    cheese_effect_cache_entry_free (entry);
+  }
+
+  entry = g_slice_new (CheeseEffectCacheEntry);
+  entry->desc = g_strdup (desc);
+  entry->element = element;
+  g_queue_push_tail (&cache->entries, entry);
+  g_hash_table_insert (cache->index, entry->desc,
+                       g_queue_peek_tail_link (&cache->entries));
+}
+
+/*
+ * cheese_effect_cache_contains:
+ * @cache: a #CheeseEffectCache
+ * @desc: the pipeline description of an effect
+ *
+ * Returns: %TRUE if a bin of @desc is in @cache
+ */
+gboolean
+cheese_effect_cache_contains (const CheeseEffectCache *cache,
+                              const gchar             *desc)
+{
+  return g_hash_table_contains (cache->index, desc);
+}
+
+guint
+cheese_effect_cache_get_length (const CheeseEffectCache *cache)
+{
+  return g_queue_get_length ((GQueue *) &cache->entries);
+}
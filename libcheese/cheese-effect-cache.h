@@ -0,0 +1,43 @@
+/*
+ * Copyright © 2026 Cheese contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHEESE_EFFECT_CACHE_H_
+#define CHEESE_EFFECT_CACHE_H_
+
+#include <glib.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CheeseEffectCache CheeseEffectCache;
+
+CheeseEffectCache *cheese_effect_cache_new (guint capacity);
+void               cheese_effect_cache_free (CheeseEffectCache *cache);
+GstElement        *cheese_effect_cache_take (CheeseEffectCache *cache,
+                                             const gchar       *desc);
+void               cheese_effect_cache_put (CheeseEffectCache *cache,
+                                            const gchar       *desc,
+                                            GstElement        *element);
+gboolean           cheese_effect_cache_contains (const CheeseEffectCache *cache,
+                                                 const gchar             *desc);
+guint              cheese_effect_cache_get_length (const CheeseEffectCache *cache);
+
+G_END_DECLS
+
+#endif /* CHEESE_EFFECT_CACHE_H_ */
@@ -0,0 +1,470 @@
+/*
+ * Copyright © 2026 Cheese contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+  #include <config.h>
+#endif
+
+#include <string.h>
+#include <glib.h>
+#include <gst/gst.h>
+
+#include "cheese-effect-optimizer.h"
+
+/*
+ * The optimizer rewrites the element chain of a parsed effect description,
+ * so that effect authors need not tune descriptions by hand:
+ *
+ *  - elements which do nothing with their settings are removed, such as
+ *    identity or a videoflip with the identity method,
+ *  - adjacent videoconverts are merged into one,
+ *  - adjacent videoflips are merged into one, composing their methods,
+ *  - flips which keep the frame size are moved after a videoscale to a
+ *    fixed size, so that they work on the smaller frames.
+ *
+ * Only linear chains are rewritten, in which each element has one sink and
+ * one source pad. Anything else, such as a tee, is left as written.
+ */
+
+GST_DEBUG_CATEGORY_STATIC (cheese_effect_optimizer_cat);
+#define GST_CAT_DEFAULT cheese_effect_optimizer_cat
+
+/* The videoflip methods which form the symmetry group of the square, as
+ * matrices acting on pixel coordinates, with y pointing down. */
+static const gint cheese_effect_optimizer_flips[8][4] = {
+  {  1,  0,  0,  1 }, /* none */
+  {  0, -1,  1,  0 }, /* clockwise */
+  { -1,  0,  0, -1 }, /* rotate-180 */
+  {  0,  1, -1,  0 }, /* counterclockwise */
+  { -1,  0,  0,  1 }, /* horizontal-flip */
+  {  1,  0,  0, -1 }, /* vertical-flip */
+  {  0,  1,  1,  0 }, /* upper-left-diagonal */
+  {  0, -1, -1,  0 }  /* upper-right-diagonal */
+};
+
+static gboolean
+cheese_effect_optimizer_is (GstElement *element, const gchar *factory_name)
+{
+  GstElementFactory *factory = gst_element_get_factory (element);
+
+  return factory != NULL &&
+         strcmp (gst_plugin_feature_get_name (GST_PLUGIN_FEATURE (factory)),
+                 factory_name) == 0;
+}
+
+/*
+ * cheese_effect_optimizer_has_defaults:
+ * @element: a #GstElement
+ *
+ * Compare against a new element of the same factory, rather than the
+ * defaults of the properties, as some elements change those in their
+ * instance init, such as the qos property of video filters.
+ *
+ * Returns: %TRUE if every property of @element which can be set still has
+ * the value it starts with
+ */
+static gboolean
+cheese_effect_optimizer_has_defaults (GstElement *element)
+{
+  GstElement *fresh;
+  GParamSpec **pspecs;
+  GValue value = G_VALUE_INIT, fresh_value = G_VALUE_INIT;
+  gboolean defaults = TRUE;
+  guint n_pspecs, i;
+
+  if (gst_element_get_factory (element) == NULL ||
+      (fresh = gst_element_factory_create (gst_element_get_factory (element),
+                                           NULL)) == NULL)
+    return FALSE;
+  gst_object_ref_sink (fresh);
+
+  pspecs = g_object_class_list_properties (G_OBJECT_GET_CLASS (element),
+                                           &n_pspecs);
+  for (i = 0; i < n_pspecs && defaults; i++)
+  {
+    if ((pspecs[i]->flags & G_PARAM_READWRITE) != G_PARAM_READWRITE ||
+        strcmp (pspecs[i]->name, "name") == 0 ||
+        strcmp (pspecs[i]->name, "parent") == 0)
+      continue;
+
+    g_value_init (&value, pspecs[i]->value_type);
+    g_value_init (&fresh_value, pspecs[i]->value_type);
+    g_object_get_property (G_OBJECT (element), pspecs[i]->name, &value);
+    g_object_get_property (G_OBJECT (fresh), pspecs[i]->name, &fresh_value);
+    defaults = g_param_values_cmp (pspecs[i], &value, &fresh_value) == 0;
+    g_value_unset (&value);
+    g_value_unset (&fresh_value);
+  }
+  g_free (pspecs);
+  gst_object_unref (fresh);
+
+  return defaults;
+}
+
+/*
+ * cheese_effect_optimizer_get_flip:
+ * @element: a #GstElement
+ *
+ * Returns: the method of @element if it is a videoflip with a fixed method,
+ * -1 otherwise
+ */
+static gint
+cheese_effect_optimizer_get_flip (GstElement *element)
+{
+  gint method;
+
+  if (!cheese_effect_optimizer_is (element, "videoflip"))
+    return -1;
+
+  g_object_get (G_OBJECT (element), "method", &method, NULL);
+
+  return method >= 0 && method < G_N_ELEMENTS (cheese_effect_optimizer_flips)
+         ? method : -1;
+}
+
+/*
+ * cheese_effect_optimizer_compose_flips:
+ * @first: the videoflip method applied first
+ * @second: the videoflip method applied second
+ *
+ * Returns: the videoflip method which does both
+ */
+static gint
+cheese_effect_optimizer_compose_flips (gint first, gint second)
+{
+  const gint *a = cheese_effect_optimizer_flips[first];
+  const gint *b = cheese_effect_optimizer_flips[second];
+  gint product[4];
+  gint i;
+
+  product[0] = b[0] * a[0] + b[1] * a[2];
+  product[1] = b[0] * a[1] + b[1] * a[3];
+  product[2] = b[2] * a[0] + b[3] * a[2];
+  product[3] = b[2] * a[1] + b[3] * a[3];
+
+  for (i = 0; i < G_N_ELEMENTS (cheese_effect_optimizer_flips); i++)
+    if (memcmp (product, cheese_effect_optimizer_flips[i], sizeof (product)) == 0)
+      return i;
+
+  g_assert_not_reached ();
+}
+
+/*
+ * cheese_effect_optimizer_is_noop:
+ * @element: a #GstElement
+ *
+ * Returns: %TRUE if @element passes frames on as they are
+ */
+static gboolean
+cheese_effect_optimizer_is_noop (GstElement *element)
+{
+  GstCaps *caps;
+  gboolean any;
+
+  if (cheese_effect_optimizer_is (element, "identity") ||
+      cheese_effect_optimizer_is (element, "videobalance") ||
+      cheese_effect_optimizer_is (element, "gamma"))
+    return cheese_effect_optimizer_has_defaults (element);
+
+  if (cheese_effect_optimizer_is (element, "capsfilter"))
+  {
+    g_object_get (G_OBJECT (element), "caps", &caps, NULL);
+    any = caps == NULL || gst_caps_is_any (caps);
+    if (caps != NULL)
+      gst_caps_unref (caps);
+    return any;
+  }
+
+  return cheese_effect_optimizer_get_flip (element) == 0;
+}
+
+/*
+ * cheese_effect_optimizer_keeps_size:
+ * @method: a videoflip method
+ *
+ * Returns: %TRUE if @method keeps the width and height of frames
+ */
+static gboolean
+cheese_effect_optimizer_keeps_size (gint method)
+{
+  return cheese_effect_optimizer_flips[method][0] != 0;
+}
+
+/*
+ * cheese_effect_optimizer_is_fixed_size:
+ * @element: a #GstElement
+ *
+ * Returns: %TRUE if @element is a capsfilter with a fixed width and height
+ */
+static gboolean
+cheese_effect_optimizer_is_fixed_size (GstElement *element)
+{
+  GstStructure *structure;
+  GstCaps *caps;
+  gboolean fixed = FALSE;
+
+  if (!cheese_effect_optimizer_is (element, "capsfilter"))
+    return FALSE;
+
+  g_object_get (G_OBJECT (element), "caps", &caps, NULL);
+  if (caps != NULL && gst_caps_get_size (caps) == 1)
+  {
+    structure = gst_caps_get_structure (caps, 0);
+    fixed = gst_structure_has_field_typed (structure, "width", G_TYPE_INT) &&
+            gst_structure_has_field_typed (structure, "height", G_TYPE_INT);
+  }
+  if (caps != NULL)
+    gst_caps_unref (caps);
+
+  return fixed;
+}
+
+/*
+ * cheese_effect_optimizer_get_chain:
+ * @bin: a #GstBin
+ *
+ * Returns: (transfer container): the children of @bin in stream order, or
+ * %NULL if they do not form a single linear chain
+ */
+static GList *
+cheese_effect_optimizer_get_chain (GstBin *bin)
+{
+  GstElement *element;
+  GstPad *pad, *peer;
+  GList *chain = NULL;
+
+  pad = gst_bin_find_unlinked_pad (bin, GST_PAD_SINK);
+  if (pad == NULL)
+    return NULL;
+  element = gst_pad_get_parent_element (pad);
+  gst_object_unref (pad);
+
+  while (element != NULL)
+  {
+    if (element->numsinkpads != 1 || element->numsrcpads != 1 ||
+        GST_ELEMENT_PARENT (element) != GST_OBJECT (bin))
+    {
+      gst_object_unref (element);
+      g_list_free (chain);
+      return NULL;
+    }
+
+    /* The bin holds a reference on its children. */
+    chain = g_list_prepend (chain, element);
+    gst_object_unref (element);
+
+    pad = gst_element_get_static_pad (element, "src");
+    peer = pad != NULL ? gst_pad_get_peer (pad) : NULL;
+    element = peer != NULL ? gst_pad_get_parent_element (peer) : NULL;
+    g_clear_object (&peer);
+    g_clear_object (&pad);
+  }
+
+  chain = g_list_reverse (chain);
+  if (g_list_length (chain) != bin->numchildren)
+  {
+    g_list_free (chain);
+    return NULL;
+  }
+
+  return chain;
+}
+
+/*
+ * cheese_effect_optimizer_rewrite:
+ * @chain: (inout): the elements of an effect, in stream order
+ * @removed: (inout): the elements dropped from @chain
+ *
+ * Apply the first rewrite which matches @chain.
+ *
+ * Returns: %TRUE if @chain was rewritten
+ */
+static gboolean
+cheese_effect_optimizer_rewrite (GList **chain, GList **removed)
+{
+  GList *l, *next;
+  GstElement *element, *following;
+  gint method, following_method;
+
+  for (l = *chain; l != NULL; l = l->next)
+  {
+    element = l->data;
+    next = l->next;
+    following = next != NULL ? next->data : NULL;
+
+    /* An effect needs at least one element. */
+    if (cheese_effect_optimizer_is_noop (element) &&
+        (l->prev != NULL || next != NULL))
+    {
+      GST_DEBUG ("Removing %s, which does nothing", GST_OBJECT_NAME (element));
+      *removed = g_list_prepend (*removed, element);
+      *chain = g_list_delete_link (*chain, l);
+      return TRUE;
+    }
+
+    if (following == NULL)
+      continue;
+
+    if (cheese_effect_optimizer_is (element, "videoconvert") &&
+        cheese_effect_optimizer_is (following, "videoconvert") &&
+        cheese_effect_optimizer_has_defaults (following))
+    {
+      GST_DEBUG ("Merging %s into %s", GST_OBJECT_NAME (following),
+                 GST_OBJECT_NAME (element));
+      *removed = g_list_prepend (*removed, following);
+      *chain = g_list_delete_link (*chain, next);
+      return TRUE;
+    }
+
+    method = cheese_effect_optimizer_get_flip (element);
+    following_method = cheese_effect_optimizer_get_flip (following);
+    if (method >= 0 && following_method >= 0)
+    {
+      GST_DEBUG ("Merging %s into %s", GST_OBJECT_NAME (following),
+                 GST_OBJECT_NAME (element));
+      g_object_set (G_OBJECT (element), "method",
+                    cheese_effect_optimizer_compose_flips (method,
+                                                           following_method),
+                    NULL);
+      *removed = g_list_prepend (*removed, following);
+      *chain = g_list_delete_link (*chain, next);
+      return TRUE;
+    }
+
+    /* Flipping commutes with scaling, as long as the flip does not swap the
+     * width and height which the scale is constrained to. */
+    if (method >= 0 && cheese_effect_optimizer_keeps_size (method) &&
+        cheese_effect_optimizer_is (following, "videoscale") &&
+        next->next != NULL &&
+        cheese_effect_optimizer_is_fixed_size (next->next->data))
+    {
+      GST_DEBUG ("Moving %s after %s", GST_OBJECT_NAME (element),
+                 GST_OBJECT_NAME (next->next->data));
+      *chain = g_list_remove_link (*chain, l);
+      *chain = g_list_insert_before (*chain, next->next->next, element);
+      g_list_free_1 (l);
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/*
+ * cheese_effect_optimizer_optimize:
+ * @bin: a #GstBin holding a parsed effect, without ghost pads
+ *
+ * Rewrite the chain of elements in @bin, see above.
+ *
+ * Returns: the number of elements removed from @bin
+ */
+guint
+cheese_effect_optimizer_optimize (GstBin *bin)
+{
+  GList *original, *chain, *removed = NULL, *l;
+  gboolean changed = FALSE;
+  guint n_removed;
+
+  if (cheese_effect_optimizer_cat == NULL)
+    GST_DEBUG_CATEGORY_INIT (cheese_effect_optimizer_cat,
+                             "cheese-effect-optimizer", 0,
+                             "Cheese Effect Optimizer");
+
+  original = cheese_effect_optimizer_get_chain (bin);
+  if (original == NULL)
+  {
+    GST_DEBUG ("Not a linear chain, leaving %s as written",
+               GST_OBJECT_NAME (bin));
+    return 0;
+  }
+
+  chain = g_list_copy (original);
+  while (cheese_effect_optimizer_rewrite (&chain, &removed))
+    changed = TRUE;
+
+  if (changed)
+  {
+    for (l = original; l->next != NULL; l = l->next)
+      gst_element_unlink (l->data, l->next->data);
+    for (l = removed; l != NULL; l = l->next)
+      gst_bin_remove (bin, l->data);
+    for (l = chain; l->next != NULL; l = l->next)
+      if (!gst_element_link (l->data, l->next->data))
+        g_warning ("Could not relink %s to %s", GST_OBJECT_NAME (l->data),
+                   GST_OBJECT_NAME (l->next->data));
+  }
+
+  n_removed = g_list_length (removed);
+  GST_INFO ("%u elements in, %u out", g_list_length (original),
+            g_list_length (chain));
+
+  g_list_free (original);
+  g_list_free (chain);
+  g_list_free (removed);
+
+  return n_removed;
+}
+
+/*
+ * cheese_effect_optimizer_parse:
+ * @effect_desc: the pipeline description of an effect
+ * @ghost_unlinked_pads: whether to ghost the unlinked pads of the effect, as
+ * a "sink" and a "src" pad
+ * @error: return location for a #GError, or %NULL
+ *
+ * Parse @effect_desc into a bin, as gst_parse_bin_from_description() does,
+ * and optimize it.
+ *
+ * Returns: (transfer floating): the bin, or %NULL and sets @error
+ */
+GstElement *
+cheese_effect_optimizer_parse (const gchar *effect_desc,
+                               gboolean ghost_unlinked_pads, GError **error)
+{
+  GstElement *bin;
+  GstPad *pad;
+  GError *err = NULL;
+
+  bin = gst_parse_bin_from_description (effect_desc, FALSE, &err);
+  if (err != NULL)
+  {
+    g_propagate_error (error, err);
+    if (bin != NULL)
+      gst_object_unref (gst_object_ref_sink (bin));
+    return NULL;
+  }
+
+  cheese_effect_optimizer_optimize (GST_BIN (bin));
+
+  if (ghost_unlinked_pads)
+  {
+    if ((pad = gst_bin_find_unlinked_pad (GST_BIN (bin), GST_PAD_SINK)) != NULL)
+    {
+      gst_element_add_pad (bin, gst_ghost_pad_new ("sink", pad));
+      gst_object_unref (pad);
+    }
+    if ((pad = gst_bin_find_unlinked_pad (GST_BIN (bin), GST_PAD_SRC)) != NULL)
+    {
+      gst_element_add_pad (bin, gst_ghost_pad_new ("src", pad));
+      gst_object_unref (pad);
+    }
+  }
+
+  return bin;
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright © 2026 Cheese contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHEESE_EFFECT_OPTIMIZER_H_
+#define CHEESE_EFFECT_OPTIMIZER_H_
+
+#include <glib.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+GstElement *cheese_effect_optimizer_parse (const gchar *effect_desc,
+                                           gboolean     ghost_unlinked_pads,
+                                           GError     **error);
+guint       cheese_effect_optimizer_optimize (GstBin *bin);
+
+G_END_DECLS
+
+#endif /* CHEESE_EFFECT_OPTIMIZER_H_ */
@@ -37,6 +37,7 @@ enum
   PROP_NAME,
   PROP_PIPELINE_DESC,
   PROP_CONTROL_VALVE,
+  PROP_STRIPE_SAFE,
   PROP_LAST
 };
 
@@ -47,6 +48,7 @@ typedef struct
   gchar *name;
   gchar *pipeline_desc;
   GstElement *control_valve;
+  gboolean stripe_safe;
 } CheeseEffectPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (CheeseEffect, cheese_effect, G_TYPE_OBJECT)
@@ -68,6 +70,9 @@ cheese_effect_get_property (GObject *object, guint property_id,
     case PROP_CONTROL_VALVE:
       g_value_set_object (value, priv->control_valve);
       break;
+    case PROP_STRIPE_SAFE:
+      g_value_set_boolean (value, priv->stripe_safe);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
   }
@@ -92,8 +97,11 @@ cheese_effect_set_property (GObject *object, guint property_id,
     case PROP_CONTROL_VALVE:
       if (priv->control_valve != NULL)
         g_object_unref (G_OBJECT (priv->control_valve));
-      priv->control_valve = GST_ELEMENT (g_value_get_object (value));
-      g_object_ref (G_OBJECT (priv->control_valve));
+      /* Unset when the preview is disconnected. */
+      priv->control_valve = g_value_dup_object (value);
+      break;
+    case PROP_STRIPE_SAFE:
+      priv->stripe_safe = g_value_get_boolean (value);
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -164,6 +172,21 @@ cheese_effect_class_init (CheeseEffectClass *klass)
                                                         G_PARAM_READWRITE |
                                                         G_PARAM_STATIC_STRINGS);
 
+  /**
+   * CheeseEffect:stripe-safe:
+   *
+   * Whether each pixel of the effect only depends on the pixel at the same
+   * position, and not on its neighbours or on its position in the frame, so
+   * that horizontal stripes of a frame can be processed separately, in
+   * parallel. Read from the StripeSafe key of the effect file.
+   */
+  properties[PROP_STRIPE_SAFE] = g_param_spec_boolean ("stripe-safe",
+                                                       "Stripe safe",
+                                                       "Whether stripes of a frame can be processed separately",
+                                                       FALSE,
+                                                       G_PARAM_READWRITE |
+                                                       G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (object_class, PROP_LAST, properties);
 }
 
@@ -208,6 +231,27 @@ cheese_effect_get_pipeline_desc (CheeseEffect *effect)
     return priv->pipeline_desc;
 }
 
+/**
+ * cheese_effect_is_stripe_safe:
+ * @effect: a #CheeseEffect
+ *
+ * Get whether horizontal stripes of a frame can be processed separately
+ * with the @effect. See #CheeseEffect:stripe-safe.
+ *
+ * Returns: %TRUE if the effect can be applied in stripes, %FALSE otherwise.
+ */
+gboolean
+cheese_effect_is_stripe_safe (CheeseEffect *effect)
+{
+    CheeseEffectPrivate *priv;
+
+  g_return_val_if_fail (CHEESE_IS_EFFECT (effect), FALSE);
+
+    priv = cheese_effect_get_instance_private (effect);
+
+    return priv->stripe_safe;
+}
+
 /**
  * cheese_effect_is_preview_connected:
  * @effect: a #CheeseEffect
@@ -243,7 +287,8 @@ cheese_effect_enable_preview (CheeseEffect *effect)
 
     priv = cheese_effect_get_instance_private (effect);
 
-    g_object_set (G_OBJECT (priv->control_valve), "drop", FALSE, NULL);
+    if (priv->control_valve != NULL)
+        g_object_set (G_OBJECT (priv->control_valve), "drop", FALSE, NULL);
 }
 
 /**
@@ -261,7 +306,8 @@ cheese_effect_disable_preview (CheeseEffect *effect)
 
     priv = cheese_effect_get_instance_private (effect);
 
-    g_object_set (G_OBJECT (priv->control_valve), "drop", TRUE, NULL);
+    if (priv->control_valve != NULL)
+        g_object_set (G_OBJECT (priv->control_valve), "drop", TRUE, NULL);
 }
 
 static void
@@ -301,6 +347,7 @@ cheese_effect_load_from_file (const gchar *filename)
 {
   const gchar GROUP_NAME[] = "Effect";
   gchar        *name, *desc;
+  gboolean      stripe_safe;
   GError       *err = NULL;
   CheeseEffect *effect = NULL;
   GKeyFile     *keyfile = g_key_file_new ();
@@ -317,9 +364,13 @@ cheese_effect_load_from_file (const gchar *filename)
   if (err != NULL)
     goto err_desc;
 
+  /* Optional, and false unless set. */
+  stripe_safe = g_key_file_get_boolean (keyfile, GROUP_NAME, "StripeSafe", NULL);
+
   g_key_file_free (keyfile);
 
   effect = cheese_effect_new (name, desc);
+  g_object_set (G_OBJECT (effect), "stripe-safe", stripe_safe, NULL);
   g_free (name);
   g_free (desc);
 
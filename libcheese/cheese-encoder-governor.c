@@ -0,0 +1,255 @@
+/*
+ * Copyright © 2026 Cheese contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+  #include <config.h>
+#endif
+
+#include <glib.h>
+
+#include "cheese-encoder-governor.h"
+
+/*
+ * CheeseEncoderGovernor decides how to keep a video encoder up with the
+ * camera. It is fed the number of frames which went into and came out of the
+ * encoder, the number of QoS events and the number of frames waiting in the
+ * queue in front of the encoder, once per period. When the encoder falls
+ * behind it first makes it faster, then lowers the bitrate. After a while
+ * without trouble it undoes these changes again.
+ *
+ * It does not touch GStreamer itself, so that it can be tested on its own.
+ */
+
+/* The fraction of the target frame rate below which the encoder is too slow. */
+#define CHEESE_GOVERNOR_MIN_RATE 0.9
+/* The number of healthy periods before relaxing an adjustment. */
+#define CHEESE_GOVERNOR_HEALTHY_PERIODS 5
+/* The bitrate is scaled by this factor per step, down to the minimum. */
+#define CHEESE_GOVERNOR_BITRATE_FACTOR 0.8
+#define CHEESE_GOVERNOR_MIN_BITRATE_SCALE 0.5
+
+struct _CheeseEncoderGovernor
+{
+  gdouble target_fps;
+  guint   max_speed_steps;
+
+  guint64 last_in;
+  guint64 last_out;
+  guint   last_qos;
+  gboolean started;
+
+  guint   speed_step;
+  gdouble bitrate_scale;
+
+  guint   healthy_periods;
+  gboolean settling;
+};
+
+/*
+ * cheese_encoder_governor_new:
+ * @target_fps: the frame rate to hold
+ * @max_speed_steps: the number of times the encoder can be made faster
+ *
+ * Returns: a new #CheeseEncoderGovernor
+ */
+CheeseEncoderGovernor *
+cheese_encoder_governor_new (gdouble target_fps, guint max_speed_steps)
+{
+  CheeseEncoderGovernor *governor;
+
+  governor = g_slice_new0 (CheeseEncoderGovernor);
+  governor->target_fps = target_fps;
+  governor->max_speed_steps = max_speed_steps;
+  governor->bitrate_scale = 1.0;
+
+  return governor;
+}
+
+void
+cheese_encoder_governor_free (CheeseEncoderGovernor *governor)
+{
+  if (governor != NULL)
+    g_slice_free (CheeseEncoderGovernor, governor);
+}
+
+/*
+ * cheese_encoder_governor_is_overloaded:
+ *
+ * Check whether the encoder fell behind during the last period: frames were
+ * dropped, the encoder produced fewer frames than the camera delivered, or
+ * more than half a second of frames is waiting in front of it.
+ */
+static gboolean
+cheese_encoder_governor_is_overloaded (CheeseEncoderGovernor *governor,
+                                       guint64 in, guint64 out, guint qos,
+                                       guint queued, gdouble elapsed)
+{
+  gdouble rate_in, rate_out, expected;
+
+  if (qos > 0)
+    return TRUE;
+
+  rate_in = in / elapsed;
+  rate_out = out / elapsed;
+  expected = MIN (governor->target_fps, rate_in);
+  if (rate_out < expected * CHEESE_GOVERNOR_MIN_RATE)
+    return TRUE;
+
+  return queued > governor->target_fps / 2;
+}
+
+/*
+ * cheese_encoder_governor_update:
+ * @governor: a #CheeseEncoderGovernor
+ * @frames_in: the total number of frames which went into the encoder
+ * @frames_out: the total number of frames which came out of the encoder
+ * @qos_events: the total number of QoS events of the recording
+ * @queued: the number of frames waiting in front of the encoder now
+ * @elapsed: the time since the last update, in seconds
+ *
+ * Feed the counters of the recording to the @governor, and get the adjustment
+ * it made. The first update only sets the starting point.
+ *
+ * Returns: the #CheeseEncoderGovernorAction to apply
+ */
+CheeseEncoderGovernorAction
+cheese_encoder_governor_update (CheeseEncoderGovernor *governor,
+                                guint64                frames_in,
+                                guint64                frames_out,
+                                guint                  qos_events,
+                                guint                  queued,
+                                gdouble                elapsed)
+{
+  guint64 in, out;
+  guint qos;
+
+  g_return_val_if_fail (governor != NULL, CHEESE_ENCODER_GOVERNOR_KEEP);
+
+  in = frames_in - governor->last_in;
+  out = frames_out - governor->last_out;
+  qos = qos_events - governor->last_qos;
+  governor->last_in = frames_in;
+  governor->last_out = frames_out;
+  governor->last_qos = qos_events;
+
+  if (!governor->started || elapsed <= 0)
+  {
+    governor->started = TRUE;
+    return CHEESE_ENCODER_GOVERNOR_KEEP;
+  }
+
+  /* Give the previous adjustment a period to take effect. */
+  if (governor->settling)
+  {
+    governor->settling = FALSE;
+    return CHEESE_ENCODER_GOVERNOR_KEEP;
+  }
+
+  if (cheese_encoder_governor_is_overloaded (governor, in, out, qos, queued,
+                                             elapsed))
+  {
+    governor->healthy_periods = 0;
+    governor->settling = TRUE;
+
+    if (governor->speed_step < governor->max_speed_steps)
+    {
+      governor->speed_step++;
+      return CHEESE_ENCODER_GOVERNOR_SPEED_UP;
+    }
+    if (governor->bitrate_scale > CHEESE_GOVERNOR_MIN_BITRATE_SCALE)
+    {
+      governor->bitrate_scale = MAX (CHEESE_GOVERNOR_MIN_BITRATE_SCALE,
+                                     governor->bitrate_scale *
+                                     CHEESE_GOVERNOR_BITRATE_FACTOR);
+      return CHEESE_ENCODER_GOVERNOR_BITRATE_DOWN;
+    }
+
+    governor->settling = FALSE;
+    return CHEESE_ENCODER_GOVERNOR_KEEP;
+  }
+
+  if (++governor->healthy_periods < CHEESE_GOVERNOR_HEALTHY_PERIODS)
+    return CHEESE_ENCODER_GOVERNOR_KEEP;
+
+  /* Relax in the opposite order. */
+  governor->healthy_periods = 0;
+  if (governor->bitrate_scale < 1.0)
+  {
+    governor->bitrate_scale = MIN (1.0, governor->bitrate_scale /
+                                        CHEESE_GOVERNOR_BITRATE_FACTOR);
+    return CHEESE_ENCODER_GOVERNOR_BITRATE_UP;
+  }
+  if (governor->speed_step > 0)
+  {
+    governor->speed_step--;
+    return CHEESE_ENCODER_GOVERNOR_SPEED_DOWN;
+  }
+
+  return CHEESE_ENCODER_GOVERNOR_KEEP;
+}
+
+/*
+ * cheese_encoder_governor_get_speed_step:
+ * @governor: a #CheeseEncoderGovernor
+ *
+ * Returns: how many steps faster than configured the encoder should run
+ */
+guint
+cheese_encoder_governor_get_speed_step (const CheeseEncoderGovernor *governor)
+{
+  return governor->speed_step;
+}
+
+/*
+ * cheese_encoder_governor_get_bitrate_scale:
+ * @governor: a #CheeseEncoderGovernor
+ *
+ * Returns: the factor to apply to the configured bitrate, at most 1.0
+ */
+gdouble
+cheese_encoder_governor_get_bitrate_scale (const CheeseEncoderGovernor *governor)
+{
+  return governor->bitrate_scale;
+}
+
+/*
+ * cheese_encoder_governor_action_to_string:
+ * @action: a #CheeseEncoderGovernorAction
+ *
+ * Returns: a short description of @action, for reporting
+ */
+const gchar *
+cheese_encoder_governor_action_to_string (CheeseEncoderGovernorAction action)
+{
+  switch (action)
+  {
+    case CHEESE_ENCODER_GOVERNOR_KEEP:
+      return "keep";
+    case CHEESE_ENCODER_GOVERNOR_SPEED_UP:
+      return "speed-up";
+    case CHEESE_ENCODER_GOVERNOR_SPEED_DOWN:
+      return "speed-down";
+    case CHEESE_ENCODER_GOVERNOR_BITRATE_DOWN:
+      return "bitrate-down";
+    case CHEESE_ENCODER_GOVERNOR_BITRATE_UP:
+      return "bitrate-up";
+    default:
+      g_assert_not_reached ();
+  }
+}
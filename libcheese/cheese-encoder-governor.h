@@ -0,0 +1,64 @@
+/*
+ * Copyright © 2026 Cheese contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHEESE_ENCODER_GOVERNOR_H_
+#define CHEESE_ENCODER_GOVERNOR_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * CheeseEncoderGovernorAction:
+ * @CHEESE_ENCODER_GOVERNOR_KEEP: leave the encoder as it is
+ * @CHEESE_ENCODER_GOVERNOR_SPEED_UP: make the encoder faster
+ * @CHEESE_ENCODER_GOVERNOR_SPEED_DOWN: let the encoder spend more time on
+ * quality again
+ * @CHEESE_ENCODER_GOVERNOR_BITRATE_DOWN: lower the bitrate
+ * @CHEESE_ENCODER_GOVERNOR_BITRATE_UP: raise the bitrate again
+ *
+ * The adjustment to make after an update of a #CheeseEncoderGovernor.
+ */
+typedef enum
+{
+  CHEESE_ENCODER_GOVERNOR_KEEP,
+  CHEESE_ENCODER_GOVERNOR_SPEED_UP,
+  CHEESE_ENCODER_GOVERNOR_SPEED_DOWN,
+  CHEESE_ENCODER_GOVERNOR_BITRATE_DOWN,
+  CHEESE_ENCODER_GOVERNOR_BITRATE_UP
+} CheeseEncoderGovernorAction;
+
+typedef struct _CheeseEncoderGovernor CheeseEncoderGovernor;
+
+CheeseEncoderGovernor      *cheese_encoder_governor_new (gdouble target_fps,
+                                                         guint   max_speed_steps);
+void                        cheese_encoder_governor_free (CheeseEncoderGovernor *governor);
+CheeseEncoderGovernorAction cheese_encoder_governor_update (CheeseEncoderGovernor *governor,
+                                                            guint64                frames_in,
+                                                            guint64                frames_out,
+                                                            guint                  qos_events,
+                                                            guint                  queued,
+                                                            gdouble                elapsed);
+guint                       cheese_encoder_governor_get_speed_step (const CheeseEncoderGovernor *governor);
+gdouble                     cheese_encoder_governor_get_bitrate_scale (const CheeseEncoderGovernor *governor);
+const gchar                *cheese_encoder_governor_action_to_string (CheeseEncoderGovernorAction action);
+
+G_END_DECLS
+
+#endif /* CHEESE_ENCODER_GOVERNOR_H_ */
@@ -0,0 +1,498 @@
+/*
+ * Copyright © 2026 Cheese contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+  #include <config.h>
+#endif
+
+#include <string.h>
+#include <glib.h>
+#include <gst/gst.h>
+
+#include "cheese-encoder-profile.h"
+
+/*
+ * The encoder profiles which can be selected for video recording. Each names
+ * the encoders which can produce its format, in order of preference, and the
+ * container and audio format to go with it.
+ */
+
+struct _CheeseEncoderProfile
+{
+  const gchar *name;
+  const gchar *encoders[4];
+  const gchar *video_caps;
+  const gchar *container_caps;
+  const gchar *audio_caps;
+  const gchar *suffix;
+};
+
+static const CheeseEncoderProfile encoder_profiles[] = {
+  { "vp8",  { "vp8enc", NULL }, "video/x-vp8", "video/webm",
+    "audio/x-vorbis", ".webm" },
+  { "vp9",  { "vp9enc", NULL }, "video/x-vp9", "video/webm",
+    "audio/x-opus", ".webm" },
+  { "h264", { "x264enc", "openh264enc", NULL }, "video/x-h264",
+    "video/x-matroska", "audio/x-opus", ".mkv" },
+  { "av1",  { "svtav1enc", "av1enc", "rav1enc", NULL }, "video/x-av1",
+    "video/webm", "audio/x-opus", ".webm" },
+};
+
+/* Encoder speed for each resolution class, see cheese_encoder_profile_level(). */
+typedef struct
+{
+  const gchar *encoder;
+  const gchar *property;
+  gint         values[3];
+} CheeseEncoderSpeed;
+
+static const CheeseEncoderSpeed encoder_speeds[] = {
+  { "vp8enc",    "cpu-used",     { 4, 8, 12 } },
+  { "vp9enc",    "cpu-used",     { 6, 7, 8 } },
+  { "av1enc",    "cpu-used",     { 8, 9, 10 } },
+  { "svtav1enc", "preset",       { 10, 11, 12 } },
+  { "rav1enc",   "speed-preset", { 8, 9, 10 } },
+};
+
+/* The x264 presets from slowest to fastest, indexed by resolution class plus
+ * speed step. */
+static const gchar * const x264_presets[] = { "veryfast", "superfast",
+                                              "ultrafast" };
+
+/*
+ * cheese_encoder_profile_level:
+ * @width: the width of the video
+ * @height: the height of the video
+ *
+ * Classify a resolution as below 720p, 720p or 1080p and above.
+ *
+ * Returns: 0, 1 or 2
+ */
+static guint
+cheese_encoder_profile_level (gint width, gint height)
+{
+  if (width * height >= 1920 * 1080)
+    return 2;
+  if (width * height >= 1280 * 720)
+    return 1;
+  return 0;
+}
+
+/*
+ * cheese_encoder_profile_set_int:
+ * @element: an encoder
+ * @property: the name of an integer property
+ * @value: the value to set, clamped to the range of @property
+ *
+ * Set an integer property if @element has it. Encoder versions differ in the
+ * ranges they accept, so clamp rather than warn.
+ */
+static void
+cheese_encoder_profile_set_int (GstElement *element, const gchar *property,
+                                gint value)
+{
+  GParamSpec *pspec;
+
+  pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (element),
+                                        property);
+  if (pspec == NULL)
+    return;
+
+  if (G_IS_PARAM_SPEC_INT (pspec))
+    g_object_set (G_OBJECT (element), property,
+                  CLAMP (value, G_PARAM_SPEC_INT (pspec)->minimum,
+                         G_PARAM_SPEC_INT (pspec)->maximum), NULL);
+  else if (G_IS_PARAM_SPEC_UINT (pspec))
+    g_object_set (G_OBJECT (element), property,
+                  (guint) CLAMP (value, (gint64) G_PARAM_SPEC_UINT (pspec)->minimum,
+                                 (gint64) G_PARAM_SPEC_UINT (pspec)->maximum),
+                  NULL);
+  else
+    GST_WARNING ("%s:%s is not an integer", GST_OBJECT_NAME (element),
+                 property);
+}
+
+/*
+ * cheese_encoder_profile_set_arg:
+ * @element: an encoder
+ * @property: the name of a property
+ * @value: the value to set, as a string
+ *
+ * Set a property, such as an enumeration or a boolean, if @element has it.
+ */
+static void
+cheese_encoder_profile_set_arg (GstElement *element, const gchar *property,
+                                const gchar *value)
+{
+  if (g_object_class_find_property (G_OBJECT_GET_CLASS (element), property))
+    gst_util_set_object_arg (G_OBJECT (element), property, value);
+}
+
+/*
+ * cheese_encoder_profile_lookup:
+ * @name: the name of a profile, such as "vp8"
+ *
+ * Find an encoder profile by name.
+ *
+ * Returns: the profile, or %NULL if @name is unknown
+ */
+const CheeseEncoderProfile *
+cheese_encoder_profile_lookup (const gchar *name)
+{
+  guint i;
+
+  if (name == NULL)
+    return NULL;
+
+  for (i = 0; i < G_N_ELEMENTS (encoder_profiles); i++)
+  {
+    if (strcmp (encoder_profiles[i].name, name) == 0)
+      return &encoder_profiles[i];
+  }
+
+  return NULL;
+}
+
+/*
+ * cheese_encoder_profile_get_name:
+ * @profile: a #CheeseEncoderProfile
+ *
+ * Returns: the name of @profile
+ */
+const gchar *
+cheese_encoder_profile_get_name (const CheeseEncoderProfile *profile)
+{
+  return profile->name;
+}
+
+/*
+ * cheese_encoder_profile_get_suffix:
+ * @profile: a #CheeseEncoderProfile
+ *
+ * Returns: the filename suffix of videos recorded with @profile
+ */
+const gchar *
+cheese_encoder_profile_get_suffix (const CheeseEncoderProfile *profile)
+{
+  return profile->suffix;
+}
+
+/*
+ * cheese_encoder_profile_find_encoder:
+ * @profile: a #CheeseEncoderProfile
+ *
+ * Find the preferred encoder of @profile which is installed.
+ *
+ * Returns: the name of the encoder factory, or %NULL if none is installed
+ */
+const gchar *
+cheese_encoder_profile_find_encoder (const CheeseEncoderProfile *profile)
+{
+  guint i;
+
+  for (i = 0; profile->encoders[i] != NULL; i++)
+  {
+    GstElementFactory *factory;
+
+    factory = gst_element_factory_find (profile->encoders[i]);
+    if (factory != NULL)
+    {
+      gst_object_unref (factory);
+      return profile->encoders[i];
+    }
+  }
+
+  return NULL;
+}
+
+/*
+ * cheese_encoder_profile_create:
+ * @profile: a #CheeseEncoderProfile
+ * @encoder: the encoder factory to use, from
+ * cheese_encoder_profile_find_encoder()
+ *
+ * Create an encoding profile for camerabin, which records with @encoder.
+ *
+ * Returns: (transfer full): a new #GstEncodingProfile
+ */
+GstEncodingProfile *
+cheese_encoder_profile_create (const CheeseEncoderProfile *profile,
+                               const gchar                *encoder)
+{
+  GstEncodingContainerProfile *container;
+  GstEncodingVideoProfile *video;
+  GstCaps *caps;
+
+  caps = gst_caps_from_string (profile->container_caps);
+  container = gst_encoding_container_profile_new (profile->name, NULL, caps,
+                                                  NULL);
+  gst_caps_unref (caps);
+
+  /* The preset name picks the encoder factory, the properties are set in
+   * cheese_encoder_profile_configure() once encodebin created it. */
+  caps = gst_caps_from_string (profile->video_caps);
+  video = gst_encoding_video_profile_new (caps, NULL, NULL, 0);
+  gst_encoding_video_profile_set_variableframerate (video, TRUE);
+  gst_encoding_profile_set_preset_name ((GstEncodingProfile *) video, encoder);
+  gst_encoding_container_profile_add_profile (container,
+                                              (GstEncodingProfile *) video);
+  gst_caps_unref (caps);
+
+  caps = gst_caps_from_string (profile->audio_caps);
+  gst_encoding_container_profile_add_profile (container,
+      (GstEncodingProfile *) gst_encoding_audio_profile_new (caps, NULL, NULL, 0));
+  gst_caps_unref (caps);
+
+  return (GstEncodingProfile *) container;
+}
+
+/*
+ * cheese_encoder_profile_get_threads:
+ * @width: the width of the video
+ * @height: the height of the video
+ *
+ * Get the number of encoder threads to use. Leave a core to capturing and
+ * decoding, and do not use more threads than there are rows of work in a
+ * frame.
+ *
+ * Returns: the number of threads, at least 1
+ */
+guint
+cheese_encoder_profile_get_threads (gint width, gint height)
+{
+  guint cores = g_get_num_processors ();
+  guint rows = MAX (2, height / 120);
+
+  if (cores > 2)
+    cores--;
+
+  return CLAMP (cores, 1, rows);
+}
+
+/*
+ * cheese_encoder_profile_get_tile_columns_log2:
+ * @width: the width of the video
+ * @threads: the number of encoder threads
+ *
+ * Get the number of tile columns for VP9 and AV1, as a power of two. Tiles are
+ * at least 256 pixels wide, and there is no point in having more tiles than
+ * threads.
+ *
+ * Returns: the log2 of the number of tile columns
+ */
+guint
+cheese_encoder_profile_get_tile_columns_log2 (gint width, guint threads)
+{
+  guint log2 = 0;
+
+  while (log2 < 6 && (width >> (log2 + 1)) >= 256 &&
+         (1u << (log2 + 1)) <= threads)
+    log2++;
+
+  return log2;
+}
+
+/*
+ * cheese_encoder_profile_get_speed:
+ * @name: the name of an encoder factory
+ * @level: the resolution class
+ * @speed_step: how many steps faster than usual to run
+ *
+ * Returns: the value of the speed property of the encoder, or -1 if it has
+ * none
+ */
+static gint
+cheese_encoder_profile_get_speed (const gchar *name, guint level,
+                                  guint speed_step)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (encoder_speeds); i++)
+  {
+    if (strcmp (encoder_speeds[i].encoder, name) == 0)
+      return encoder_speeds[i].values[level] + speed_step;
+  }
+
+  return -1;
+}
+
+/*
+ * cheese_encoder_profile_configure:
+ * @encoder: an encoder created for one of the profiles
+ * @width: the width of the video
+ * @height: the height of the video
+ *
+ * Configure @encoder for real-time encoding of @width x @height video, using
+ * the cores of the machine.
+ */
+void
+cheese_encoder_profile_configure (GstElement *encoder, gint width, gint height)
+{
+  GstElementFactory *factory;
+  const gchar *name;
+  gchar *partitions;
+  guint threads, level, tiles, i;
+
+  g_return_if_fail (GST_IS_ELEMENT (encoder));
+
+  factory = gst_element_get_factory (encoder);
+  if (factory == NULL)
+    return;
+
+  name = GST_OBJECT_NAME (factory);
+  threads = cheese_encoder_profile_get_threads (width, height);
+  level = cheese_encoder_profile_level (width, height);
+  tiles = cheese_encoder_profile_get_tile_columns_log2 (width, threads);
+
+  GST_DEBUG ("Configuring %s for %dx%d with %u threads", name, width, height,
+             threads);
+
+  for (i = 0; i < G_N_ELEMENTS (encoder_speeds); i++)
+  {
+    if (strcmp (encoder_speeds[i].encoder, name) == 0)
+      cheese_encoder_profile_set_int (encoder, encoder_speeds[i].property,
+                                      cheese_encoder_profile_get_speed (name, level, 0));
+  }
+
+  if (strcmp (name, "vp8enc") == 0 || strcmp (name, "vp9enc") == 0)
+  {
+    cheese_encoder_profile_set_int (encoder, "threads", threads);
+    cheese_encoder_profile_set_int (encoder, "lag-in-frames", 0);
+    cheese_encoder_profile_set_arg (encoder, "deadline", "1");
+    /* VP8 splits the bitstream in partitions that can be encoded in
+     * parallel, VP9 splits frames in tiles. The partitions are an
+     * enumeration, whose nicks are the counts. */
+    partitions = g_strdup_printf ("%u",
+                                  1u << g_bit_nth_msf (MIN (threads, 8), -1));
+    cheese_encoder_profile_set_arg (encoder, "token-partitions", partitions);
+    g_free (partitions);
+    cheese_encoder_profile_set_int (encoder, "tile-columns", tiles);
+    cheese_encoder_profile_set_arg (encoder, "row-mt", "true");
+  }
+  else if (strcmp (name, "x264enc") == 0)
+  {
+    cheese_encoder_profile_set_int (encoder, "threads", threads);
+    cheese_encoder_profile_set_arg (encoder, "tune", "zerolatency");
+    cheese_encoder_profile_set_arg (encoder, "speed-preset",
+                                    x264_presets[level]);
+  }
+  else if (strcmp (name, "openh264enc") == 0)
+  {
+    cheese_encoder_profile_set_int (encoder, "multi-thread", threads);
+    cheese_encoder_profile_set_arg (encoder, "usage-type", "camera");
+    cheese_encoder_profile_set_arg (encoder, "complexity",
+                                    level > 0 ? "low" : "medium");
+  }
+  else if (strcmp (name, "av1enc") == 0)
+  {
+    cheese_encoder_profile_set_int (encoder, "threads", threads);
+    cheese_encoder_profile_set_int (encoder, "lag-in-frames", 0);
+    cheese_encoder_profile_set_arg (encoder, "usage-profile", "realtime");
+    cheese_encoder_profile_set_arg (encoder, "row-mt", "true");
+    cheese_encoder_profile_set_int (encoder, "tile-columns", tiles);
+  }
+  else if (strcmp (name, "svtav1enc") == 0)
+  {
+    cheese_encoder_profile_set_int (encoder, "logical-processors", threads);
+  }
+  else if (strcmp (name, "rav1enc") == 0)
+  {
+    cheese_encoder_profile_set_int (encoder, "threads", threads);
+    cheese_encoder_profile_set_int (encoder, "tile-cols", 1 << tiles);
+    cheese_encoder_profile_set_arg (encoder, "low-latency", "true");
+  }
+}
+
+/*
+ * cheese_encoder_profile_adjust:
+ * @encoder: an encoder configured with cheese_encoder_profile_configure()
+ * @width: the width of the video
+ * @height: the height of the video
+ * @speed_step: how many steps faster than configured to run, at most
+ * %CHEESE_ENCODER_PROFILE_SPEED_STEPS
+ * @bitrate_scale: the factor to apply to the bitrate the encoder started with
+ *
+ * Change the speed and bitrate of a running encoder, to keep up with the
+ * camera.
+ */
+void
+cheese_encoder_profile_adjust (GstElement *encoder, gint width, gint height,
+                               guint speed_step, gdouble bitrate_scale)
+{
+  static const gchar * const bitrates[] = { "target-bitrate", "bitrate" };
+  GstElementFactory *factory;
+  const gchar *name;
+  guint level, i;
+
+  g_return_if_fail (GST_IS_ELEMENT (encoder));
+
+  factory = gst_element_get_factory (encoder);
+  if (factory == NULL)
+    return;
+
+  name = GST_OBJECT_NAME (factory);
+  level = cheese_encoder_profile_level (width, height);
+
+  for (i = 0; i < G_N_ELEMENTS (encoder_speeds); i++)
+  {
+    if (strcmp (encoder_speeds[i].encoder, name) == 0)
+      cheese_encoder_profile_set_int (encoder, encoder_speeds[i].property,
+                                      cheese_encoder_profile_get_speed (name, level, speed_step));
+  }
+
+  if (strcmp (name, "x264enc") == 0)
+    cheese_encoder_profile_set_arg (encoder, "speed-preset",
+                                    x264_presets[MIN (level + speed_step,
+                                                      G_N_ELEMENTS (x264_presets) - 1)]);
+  else if (strcmp (name, "openh264enc") == 0 && speed_step > 0)
+    cheese_encoder_profile_set_arg (encoder, "complexity", "low");
+
+  /* Scale from the bitrate the encoder started with, which is kept on it. */
+  for (i = 0; i < G_N_ELEMENTS (bitrates); i++)
+  {
+    GParamSpec *pspec;
+    gpointer base;
+
+    pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (encoder),
+                                          bitrates[i]);
+    if (pspec == NULL ||
+        !(G_IS_PARAM_SPEC_INT (pspec) || G_IS_PARAM_SPEC_UINT (pspec)))
+      continue;
+
+    base = g_object_get_data (G_OBJECT (encoder), "cheese-base-bitrate");
+    if (base == NULL)
+    {
+      GValue value = G_VALUE_INIT;
+
+      g_value_init (&value, G_PARAM_SPEC_VALUE_TYPE (pspec));
+      g_object_get_property (G_OBJECT (encoder), bitrates[i], &value);
+      base = GUINT_TO_POINTER (G_VALUE_HOLDS_INT (&value) ?
+                               (guint) MAX (g_value_get_int (&value), 0) :
+                               g_value_get_uint (&value));
+      g_value_unset (&value);
+      if (base == NULL)
+        break;
+      g_object_set_data (G_OBJECT (encoder), "cheese-base-bitrate", base);
+    }
+
+    cheese_encoder_profile_set_int (encoder, bitrates[i],
+                                    GPOINTER_TO_UINT (base) * bitrate_scale);
+    break;
+  }
+}
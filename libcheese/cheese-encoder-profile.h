@@ -0,0 +1,68 @@
+/*
+ * Copyright © 2026 Cheese contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHEESE_ENCODER_PROFILE_H_
+#define CHEESE_ENCODER_PROFILE_H_
+
+#include <glib.h>
+#include <gst/gst.h>
+#include <gst/pbutils/encoding-profile.h>
+
+G_BEGIN_DECLS
+
+/*
+ * CHEESE_ENCODER_PROFILE_DEFAULT:
+ *
+ * The name of the profile used when the selected one is unknown or has no
+ * encoder installed.
+ */
+#define CHEESE_ENCODER_PROFILE_DEFAULT "vp8"
+
+/*
+ * CHEESE_ENCODER_PROFILE_SPEED_STEPS:
+ *
+ * The number of steps by which cheese_encoder_profile_adjust() can make an
+ * encoder faster than configured.
+ */
+#define CHEESE_ENCODER_PROFILE_SPEED_STEPS 4
+
+typedef struct _CheeseEncoderProfile CheeseEncoderProfile;
+
+const CheeseEncoderProfile *cheese_encoder_profile_lookup (const gchar *name);
+const gchar                *cheese_encoder_profile_get_name (const CheeseEncoderProfile *profile);
+const gchar                *cheese_encoder_profile_get_suffix (const CheeseEncoderProfile *profile);
+const gchar                *cheese_encoder_profile_find_encoder (const CheeseEncoderProfile *profile);
+GstEncodingProfile         *cheese_encoder_profile_create (const CheeseEncoderProfile *profile,
+                                                           const gchar                *encoder);
+void                        cheese_encoder_profile_configure (GstElement *encoder,
+                                                              gint        width,
+                                                              gint        height);
+void                        cheese_encoder_profile_adjust (GstElement *encoder,
+                                                           gint        width,
+                                                           gint        height,
+                                                           guint       speed_step,
+                                                           gdouble     bitrate_scale);
+guint                       cheese_encoder_profile_get_threads (gint width,
+                                                                gint height);
+guint                       cheese_encoder_profile_get_tile_columns_log2 (gint  width,
+                                                                          guint threads);
+
+G_END_DECLS
+
+#endif /* CHEESE_ENCODER_PROFILE_H_ */
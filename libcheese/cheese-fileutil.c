@@ -105,20 +105,20 @@ cheese_fileutil_get_path_before_224 (CheeseFileUtil *fileutil)
   return g_build_filename (g_get_home_dir (), ".gnome2", "cheese", "media", NULL);
 }
 
-/**
- * cheese_fileutil_get_new_media_filename:
+/*
+ * cheese_fileutil_get_new_filename:
  * @fileutil: a #CheeseFileUtil
  * @mode: the type of media to create a filename for
+ * @video_suffix: the filename suffix for videos
  *
- * Creates a filename for one of the three media types: photo, photo burst or
- * video. If a filename for a photo burst image was previously created, this
- * function increments the burst count automatically. To start a new burst,
- * first call cheese_fileutil_reset_burst().
+ * Creates a filename for one of the three media types, see
+ * cheese_fileutil_get_new_media_filename().
  *
  * Returns: (transfer full) (type filename): a new filename
  */
-gchar *
-cheese_fileutil_get_new_media_filename (CheeseFileUtil *fileutil, CheeseMediaMode mode)
+static gchar *
+cheese_fileutil_get_new_filename (CheeseFileUtil *fileutil, CheeseMediaMode mode,
+                                  const gchar *video_suffix)
 {
   GDateTime *datetime;
   gchar       *time_string;
@@ -172,7 +172,7 @@ cheese_fileutil_get_new_media_filename (CheeseFileUtil *fileutil, CheeseMediaMod
       filename = g_strdup_printf ("%s_%d%s", priv->burst_raw_name, priv->burst_count, CHEESE_PHOTO_NAME_SUFFIX);
       break;
     case CHEESE_MEDIA_MODE_VIDEO:
-      filename = g_strdup_printf ("%s%s%s%s", path, G_DIR_SEPARATOR_S, time_string, CHEESE_VIDEO_NAME_SUFFIX);
+      filename = g_strdup_printf ("%s%s%s%s", path, G_DIR_SEPARATOR_S, time_string, video_suffix);
       break;
     default:
       g_assert_not_reached ();
@@ -197,7 +197,7 @@ cheese_fileutil_get_new_media_filename (CheeseFileUtil *fileutil, CheeseMediaMod
         filename = g_strdup_printf ("%s_%d (%d)%s", priv->burst_raw_name, priv->burst_count, num, CHEESE_PHOTO_NAME_SUFFIX);
         break;
       case CHEESE_MEDIA_MODE_VIDEO:
-        filename = g_strdup_printf ("%s%s%s (%d)%s", path, G_DIR_SEPARATOR_S, time_string, num, CHEESE_VIDEO_NAME_SUFFIX);
+        filename = g_strdup_printf ("%s%s%s (%d)%s", path, G_DIR_SEPARATOR_S, time_string, num, video_suffix);
         break;
       default:
         g_assert_not_reached ();
@@ -212,6 +212,45 @@ cheese_fileutil_get_new_media_filename (CheeseFileUtil *fileutil, CheeseMediaMod
   return filename;
 }
 
+/**
+ * cheese_fileutil_get_new_media_filename:
+ * @fileutil: a #CheeseFileUtil
+ * @mode: the type of media to create a filename for
+ *
+ * Creates a filename for one of the three media types: photo, photo burst or
+ * video. If a filename for a photo burst image was previously created, this
+ * function increments the burst count automatically. To start a new burst,
+ * first call cheese_fileutil_reset_burst().
+ *
+ * Returns: (transfer full) (type filename): a new filename
+ */
+gchar *
+cheese_fileutil_get_new_media_filename (CheeseFileUtil *fileutil, CheeseMediaMode mode)
+{
+  return cheese_fileutil_get_new_filename (fileutil, mode,
+                                           CHEESE_VIDEO_NAME_SUFFIX);
+}
+
+/**
+ * cheese_fileutil_get_new_video_filename:
+ * @fileutil: a #CheeseFileUtil
+ * @suffix: the filename suffix, such as the one returned by
+ * cheese_camera_get_video_file_suffix()
+ *
+ * Creates a filename for a video, like cheese_fileutil_get_new_media_filename()
+ * does, but for a video container other than WebM.
+ *
+ * Returns: (transfer full) (type filename): a new filename
+ */
+gchar *
+cheese_fileutil_get_new_video_filename (CheeseFileUtil *fileutil, const gchar *suffix)
+{
+  g_return_val_if_fail (suffix != NULL, NULL);
+
+  return cheese_fileutil_get_new_filename (fileutil, CHEESE_MEDIA_MODE_VIDEO,
+                                           suffix);
+}
+
 /**
  * cheese_fileutil_reset_burst:
  * @fileutil: a #CheeseFileUtil
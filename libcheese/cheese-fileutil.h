@@ -38,6 +38,13 @@
  */
 #define CHEESE_VIDEO_NAME_SUFFIX ".webm"
 
+/**
+ * CHEESE_MATROSKA_VIDEO_NAME_SUFFIX:
+ *
+ * The filename suffix for videos saved by Cheese in a Matroska container.
+ */
+#define CHEESE_MATROSKA_VIDEO_NAME_SUFFIX ".mkv"
+
 G_BEGIN_DECLS
 
 /**
@@ -76,6 +83,7 @@ CheeseFileUtil *cheese_fileutil_new (void);
 const gchar *cheese_fileutil_get_video_path (CheeseFileUtil *fileutil);
 const gchar *cheese_fileutil_get_photo_path (CheeseFileUtil *fileutil);
 gchar       *cheese_fileutil_get_new_media_filename (CheeseFileUtil *fileutil, CheeseMediaMode mode);
+gchar       *cheese_fileutil_get_new_video_filename (CheeseFileUtil *fileutil, const gchar *suffix);
 void         cheese_fileutil_reset_burst (CheeseFileUtil *fileutil);
 
 G_END_DECLS
@@ -0,0 +1,298 @@
+/*
+ * Copyright © 2026 Cheese contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+  #include <config.h>
+#endif
+
+#include <glib.h>
+#include <gst/gst.h>
+
+#include "cheese-caps-cache.h"
+#include "cheese-format-cost.h"
+
+/*
+ * The cost model rates a capture format by the framerate it can actually
+ * sustain, which is the lowest of the framerate offered by the device, the
+ * framerate the bus can carry and the framerate the CPU can decode, convert
+ * and apply effects to. Raw formats are bound by the bus, JPEG by the CPU.
+ * Among formats which reach the target framerate the largest one wins,
+ * slightly preferring the one which leaves the CPU more idle; formats which
+ * fall short are penalised steeply.
+ */
+
+GST_DEBUG_CATEGORY_STATIC (cheese_format_cost_cat);
+#define GST_CAT_DEFAULT cheese_format_cost_cat
+
+/* The bandwidth of a USB 2.0 bus which isochronous transfers can use, in
+ * bytes per second. */
+#define CHEESE_FORMAT_COST_BUS_BANDWIDTH 24e6
+
+/* The CPU time per second which capturing may take, in nanoseconds. */
+#define CHEESE_FORMAT_COST_CPU_BUDGET 0.8e9
+
+/* Bytes per pixel of raw frames, which are packed 4:2:2 on most webcams, and
+ * of JPEG frames, at typical webcam quality. */
+#define CHEESE_FORMAT_COST_RAW_BYTES_PER_PIXEL 2.0
+#define CHEESE_FORMAT_COST_JPEG_BYTES_PER_PIXEL 0.25
+
+/* The CPU time to convert a raw pixel, and to decode a JPEG pixel until the
+ * calibration has run or if it failed, in nanoseconds. */
+#define CHEESE_FORMAT_COST_CONVERT 1.0
+#define CHEESE_FORMAT_COST_DECODE 6.0
+
+/* The size and number of the frames decoded by the calibration. */
+#define CHEESE_FORMAT_COST_CALIBRATION_WIDTH 640
+#define CHEESE_FORMAT_COST_CALIBRATION_HEIGHT 480
+#define CHEESE_FORMAT_COST_CALIBRATION_FRAMES 20
+
+/* The test pattern has large flat areas, which decode faster than the noise
+ * and detail in the JPEG frames of a webcam, so the calibration
+ * underestimates the cost. This is a rough allowance for the difference. */
+#define CHEESE_FORMAT_COST_CALIBRATION_ALLOWANCE 1.5
+
+/* The decoding cost in picoseconds per pixel, so that it can be read and
+ * written atomically while the calibration runs in the background. */
+static volatile gint cheese_format_cost_decode_ps = CHEESE_FORMAT_COST_DECODE * 1000;
+
+typedef struct
+{
+  gint64 start;
+  gint64 total;
+  guint  frames;
+} CheeseFormatCostCalibration;
+
+static GstPadProbeReturn
+cheese_format_cost_decoder_sink_probe (GstPad *pad, GstPadProbeInfo *info,
+                                       CheeseFormatCostCalibration *calibration)
+{
+  calibration->start = g_get_monotonic_time ();
+
+  return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn
+cheese_format_cost_decoder_src_probe (GstPad *pad, GstPadProbeInfo *info,
+                                      CheeseFormatCostCalibration *calibration)
+{
+  /* The decoder pushes from its chain function, in the same thread. */
+  calibration->total += g_get_monotonic_time () - calibration->start;
+  calibration->frames++;
+
+  return GST_PAD_PROBE_OK;
+}
+
+/*
+ * cheese_format_cost_calibrate:
+ *
+ * Time how long jpegdec takes to decode a few frames.
+ *
+ * Returns: the CPU time to decode a JPEG pixel, in nanoseconds, or 0 if the
+ * calibration failed
+ */
+static gdouble
+cheese_format_cost_calibrate (void)
+{
+  CheeseFormatCostCalibration calibration = { 0, 0, 0 };
+  GstElement *pipeline, *decoder;
+  GstMessage *message;
+  GstBus *bus;
+  GstPad *pad;
+  gchar *description;
+  GError *error = NULL;
+  gdouble cost = 0;
+
+  description = g_strdup_printf ("videotestsrc num-buffers=%d pattern=smpte ! "
+                                 "video/x-raw, width=%d, height=%d ! "
+                                 "jpegenc ! jpegdec name=decoder ! "
+                                 "fakesink sync=false",
+                                 CHEESE_FORMAT_COST_CALIBRATION_FRAMES,
+                                 CHEESE_FORMAT_COST_CALIBRATION_WIDTH,
+                                 CHEESE_FORMAT_COST_CALIBRATION_HEIGHT);
+  pipeline = gst_parse_launch (description, &error);
+  g_free (description);
+  if (pipeline == NULL || error != NULL)
+  {
+    GST_INFO ("Cannot calibrate: %s", error != NULL ? error->message : "");
+    g_clear_error (&error);
+    if (pipeline != NULL)
+      gst_object_unref (pipeline);
+    return 0;
+  }
+
+  decoder = gst_bin_get_by_name (GST_BIN (pipeline), "decoder");
+  pad = gst_element_get_static_pad (decoder, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER,
+                     (GstPadProbeCallback) cheese_format_cost_decoder_sink_probe,
+                     &calibration, NULL);
+  gst_object_unref (pad);
+  pad = gst_element_get_static_pad (decoder, "src");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER,
+                     (GstPadProbeCallback) cheese_format_cost_decoder_src_probe,
+                     &calibration, NULL);
+  gst_object_unref (pad);
+  gst_object_unref (decoder);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  bus = gst_element_get_bus (pipeline);
+  message = gst_bus_timed_pop_filtered (bus, 5 * GST_SECOND,
+                                        GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  if (message != NULL && GST_MESSAGE_TYPE (message) == GST_MESSAGE_EOS &&
+      calibration.frames > 0)
+    cost = calibration.total * 1000.0 /
+           ((gdouble) calibration.frames * CHEESE_FORMAT_COST_CALIBRATION_WIDTH *
+            CHEESE_FORMAT_COST_CALIBRATION_HEIGHT);
+
+  if (message != NULL)
+    gst_message_unref (message);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+
+  return cost;
+}
+
+/*
+ * cheese_format_cost_calibrate_thread:
+ * @data: unused
+ *
+ * Run the calibration and store its result in the caps cache, a failure as
+ * 0, so that it is not run again on every start.
+ *
+ * Returns: %NULL
+ */
+static gpointer
+cheese_format_cost_calibrate_thread (gpointer data)
+{
+  gdouble measured;
+
+  measured = cheese_format_cost_calibrate () *
+             CHEESE_FORMAT_COST_CALIBRATION_ALLOWANCE;
+  if (measured > 0)
+  {
+    g_atomic_int_set (&cheese_format_cost_decode_ps, measured * 1000);
+    GST_INFO ("Decoding JPEG takes %.2f ns per pixel", measured);
+  }
+  else
+    GST_INFO ("Calibration failed, decoding JPEG is taken to cost %.2f ns "
+              "per pixel", CHEESE_FORMAT_COST_DECODE);
+
+  cheese_caps_cache_set_value (cheese_caps_cache_get_default (),
+                               "jpeg-decode-cost", measured);
+
+  return NULL;
+}
+
+/*
+ * cheese_format_cost_get_decode_cost:
+ *
+ * Get the CPU time to decode a JPEG pixel on this machine. Unless the caps
+ * cache has it already, the first call starts a short calibration run in
+ * the background, and the default cost is used until it has finished.
+ *
+ * Returns: the decoding cost, in nanoseconds per pixel
+ */
+gdouble
+cheese_format_cost_get_decode_cost (void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized))
+  {
+    CheeseCapsCache *cache = cheese_caps_cache_get_default ();
+    gdouble measured;
+
+    GST_DEBUG_CATEGORY_INIT (cheese_format_cost_cat, "cheese-format-cost",
+                             0, "Cheese Format Cost");
+
+    if (!cheese_caps_cache_get_value (cache, "jpeg-decode-cost", &measured))
+      g_thread_unref (g_thread_new ("cheese-calibrate",
+                                    cheese_format_cost_calibrate_thread, NULL));
+    else if (measured > 0)
+      g_atomic_int_set (&cheese_format_cost_decode_ps, measured * 1000);
+
+    g_once_init_leave (&initialized, 1);
+  }
+
+  return g_atomic_int_get (&cheese_format_cost_decode_ps) / 1000.0;
+}
+
+/*
+ * cheese_format_cost_score:
+ * @width: the width of the format
+ * @height: the height of the format
+ * @fps: the highest framerate which the device offers for the format
+ * @compressed: whether the format is JPEG rather than raw
+ * @target_fps: the framerate to aim for
+ * @effect_cost: the CPU time which the effects take per pixel, in
+ * nanoseconds
+ * @decode_cost: the CPU time to decode a JPEG pixel, in nanoseconds
+ * @reason: (out) (allow-none) (transfer full): return location for a
+ * description of what limits the format
+ *
+ * Rate a capture format.
+ *
+ * Returns: the score of the format, higher is better
+ */
+gdouble
+cheese_format_cost_score (gint width, gint height, gdouble fps,
+                          gboolean compressed, guint target_fps,
+                          gdouble effect_cost, gdouble decode_cost,
+                          gchar **reason)
+{
+  gdouble pixels = (gdouble) width * height;
+  gdouble bus_fps, cpu_fps, sustained, load, shortfall, score;
+  const gchar *limit;
+
+  bus_fps = CHEESE_FORMAT_COST_BUS_BANDWIDTH /
+            (pixels * (compressed ? CHEESE_FORMAT_COST_JPEG_BYTES_PER_PIXEL
+                                  : CHEESE_FORMAT_COST_RAW_BYTES_PER_PIXEL));
+  cpu_fps = CHEESE_FORMAT_COST_CPU_BUDGET /
+            (pixels * ((compressed ? decode_cost : CHEESE_FORMAT_COST_CONVERT) +
+                       effect_cost));
+
+  sustained = fps;
+  limit = "the device";
+  if (bus_fps < sustained)
+  {
+    sustained = bus_fps;
+    limit = "bus bandwidth";
+  }
+  if (cpu_fps < sustained)
+  {
+    sustained = cpu_fps;
+    limit = compressed ? "decoding" : "conversion";
+    if (effect_cost > (compressed ? decode_cost : CHEESE_FORMAT_COST_CONVERT))
+      limit = "effects";
+  }
+
+  shortfall = MIN (sustained / MAX (target_fps, 1), 1.0);
+  load = MIN (MIN (sustained, target_fps) / cpu_fps, 1.0);
+  score = pixels * shortfall * shortfall * shortfall * (1.0 - 0.25 * load);
+
+  if (reason != NULL)
+    *reason = g_strdup_printf ("%dx%d %s at %.0f fps, limited by %s, "
+                               "%.0f%% CPU",
+                               width, height, compressed ? "JPEG" : "raw",
+                               MIN (sustained, target_fps), limit,
+                               100.0 * load * CHEESE_FORMAT_COST_CPU_BUDGET / 1e9);
+
+  return score;
+}
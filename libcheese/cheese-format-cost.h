@@ -0,0 +1,46 @@
+/*
+ * Copyright © 2026 Cheese contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHEESE_FORMAT_COST_H_
+#define CHEESE_FORMAT_COST_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * CHEESE_FORMAT_COST_TARGET_FPS:
+ *
+ * The framerate which formats are chosen for by default.
+ */
+#define CHEESE_FORMAT_COST_TARGET_FPS 30
+
+gdouble cheese_format_cost_get_decode_cost (void);
+gdouble cheese_format_cost_score (gint      width,
+                                  gint      height,
+                                  gdouble   fps,
+                                  gboolean  compressed,
+                                  guint     target_fps,
+                                  gdouble   effect_cost,
+                                  gdouble   decode_cost,
+                                  gchar   **reason);
+
+G_END_DECLS
+
+#endif /* CHEESE_FORMAT_COST_H_ */
@@ -0,0 +1,306 @@
+/*
+ * Copyright © 2026 Cheese contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+  #include <config.h>
+#endif
+
+#include <glib.h>
+#include <gst/gst.h>
+
+#include "cheese-frame-ring.h"
+
+/*
+ * CheeseFrameRing keeps the most recent frames of a stream, oldest first,
+ * within a byte budget, a maximum duration and optionally a frame count. It takes no locks, so callers
+ * must serialize access to it. CheeseCamera guards its still ring with
+ * still_lock, because cheese_camera_take_photo() and the caps and zero
+ * shutter lag toggles use it from the main thread while the streaming thread
+ * pushes frames. Its pre-roll ring stays on the streaming thread of the
+ * source.
+ */
+
+struct _CheeseFrameRing
+{
+  GQueue       frames;
+  gsize        size;
+  gsize        max_bytes;
+  GstClockTime max_duration;
+  guint        max_frames;
+};
+
+typedef struct
+{
+  GstBuffer   *buffer;
+  GstClockTime running_time;
+} CheeseFrameRingEntry;
+
+/*
+ * cheese_frame_ring_new:
+ * @max_bytes: the most bytes of frames to keep
+ * @max_duration: the longest time span of frames to keep
+ *
+ * Returns: a new, empty #CheeseFrameRing
+ */
+CheeseFrameRing *
+cheese_frame_ring_new (gsize max_bytes, GstClockTime max_duration)
+{
+  CheeseFrameRing *ring;
+
+  ring = g_slice_new0 (CheeseFrameRing);
+  g_queue_init (&ring->frames);
+  ring->max_bytes = max_bytes;
+  ring->max_duration = max_duration;
+
+  return ring;
+}
+
+void
+cheese_frame_ring_free (CheeseFrameRing *ring)
+{
+  if (ring == NULL)
+    return;
+
+  cheese_frame_ring_clear (ring);
+  g_slice_free (CheeseFrameRing, ring);
+}
+
+/*
+ * cheese_frame_ring_drop:
+ * @ring: a #CheeseFrameRing
+ *
+ * Drop the oldest frame.
+ */
+static void
+cheese_frame_ring_drop (CheeseFrameRing *ring)
+{
+  GstClockTime running_time;
+  GstBuffer *buffer;
+
+  buffer = cheese_frame_ring_pop (ring, &running_time);
+  if (buffer != NULL)
+    gst_buffer_unref (buffer);
+}
+
+/*
+ * cheese_frame_ring_trim:
+ * @ring: a #CheeseFrameRing
+ * @newest: the running time of the newest frame
+ *
+ * Drop the oldest frames until @ring is within its limits again.
+ */
+static void
+cheese_frame_ring_trim (CheeseFrameRing *ring, GstClockTime newest)
+{
+  while (!g_queue_is_empty (&ring->frames))
+  {
+    CheeseFrameRingEntry *oldest = g_queue_peek_head (&ring->frames);
+
+    if (ring->size <= ring->max_bytes &&
+        (ring->max_frames == 0 || ring->frames.length <= ring->max_frames) &&
+        (!GST_CLOCK_TIME_IS_VALID (newest) ||
+         !GST_CLOCK_TIME_IS_VALID (oldest->running_time) ||
+         newest - oldest->running_time <= ring->max_duration))
+      break;
+
+    cheese_frame_ring_drop (ring);
+  }
+}
+
+/*
+ * cheese_frame_ring_set_max_duration:
+ * @ring: a #CheeseFrameRing
+ * @max_duration: the longest time span of frames to keep, 0 to keep none
+ */
+void
+cheese_frame_ring_set_max_duration (CheeseFrameRing *ring,
+                                    GstClockTime     max_duration)
+{
+  CheeseFrameRingEntry *newest;
+
+  ring->max_duration = max_duration;
+
+  if (max_duration == 0)
+  {
+    cheese_frame_ring_clear (ring);
+    return;
+  }
+
+  newest = g_queue_peek_tail (&ring->frames);
+  if (newest != NULL)
+    cheese_frame_ring_trim (ring, newest->running_time);
+}
+
+/*
+ * cheese_frame_ring_set_max_frames:
+ * @ring: a #CheeseFrameRing
+ * @max_frames: the most frames to keep, 0 for no limit
+ *
+ * Limit the number of frames, for frames which are shared with a buffer pool
+ * that only has a few of them.
+ */
+void
+cheese_frame_ring_set_max_frames (CheeseFrameRing *ring, guint max_frames)
+{
+  CheeseFrameRingEntry *newest;
+
+  ring->max_frames = max_frames;
+
+  newest = g_queue_peek_tail (&ring->frames);
+  if (newest != NULL)
+    cheese_frame_ring_trim (ring, newest->running_time);
+}
+
+/*
+ * cheese_frame_ring_push:
+ * @ring: a #CheeseFrameRing
+ * @buffer: (transfer full): the newest frame
+ * @running_time: the running time of @buffer
+ *
+ * Add a frame, dropping the oldest ones as needed to stay within the limits.
+ * A frame larger than the whole budget is not kept.
+ */
+void
+cheese_frame_ring_push (CheeseFrameRing *ring, GstBuffer *buffer,
+                        GstClockTime running_time)
+{
+  CheeseFrameRingEntry *entry;
+  gsize size;
+
+  size = gst_buffer_get_size (buffer);
+  if (ring->max_duration == 0 || size > ring->max_bytes)
+  {
+    gst_buffer_unref (buffer);
+    return;
+  }
+
+  entry = g_slice_new (CheeseFrameRingEntry);
+  entry->buffer = buffer;
+  entry->running_time = running_time;
+  g_queue_push_tail (&ring->frames, entry);
+  ring->size += size;
+
+  cheese_frame_ring_trim (ring, running_time);
+}
+
+/*
+ * cheese_frame_ring_pop:
+ * @ring: a #CheeseFrameRing
+ * @running_time: (out): return location for the running time of the frame
+ *
+ * Take the oldest frame out of @ring.
+ *
+ * Returns: (transfer full): the oldest frame, or %NULL if @ring is empty
+ */
+GstBuffer *
+cheese_frame_ring_pop (CheeseFrameRing *ring, GstClockTime *running_time)
+{
+  CheeseFrameRingEntry *entry;
+  GstBuffer *buffer;
+
+  entry = g_queue_pop_head (&ring->frames);
+  if (entry == NULL)
+    return NULL;
+
+  buffer = entry->buffer;
+  *running_time = entry->running_time;
+  ring->size -= gst_buffer_get_size (buffer);
+  g_slice_free (CheeseFrameRingEntry, entry);
+
+  return buffer;
+}
+
+/*
+ * cheese_frame_ring_find:
+ * @ring: a #CheeseFrameRing
+ * @running_time: the running time to look for
+ * @found_time: (out): return location for the running time of the frame
+ *
+ * Find the frame closest to @running_time, leaving it in @ring.
+ *
+ * Returns: (transfer full): a new reference to the closest frame with a
+ * valid running time, or %NULL if there is none
+ */
+GstBuffer *
+cheese_frame_ring_find (CheeseFrameRing *ring, GstClockTime running_time,
+                        GstClockTime *found_time)
+{
+  CheeseFrameRingEntry *closest = NULL;
+  GstClockTimeDiff best = G_MAXINT64;
+  GList *l;
+
+  for (l = ring->frames.head; l != NULL; l = l->next)
+  {
+    CheeseFrameRingEntry *entry = l->data;
+    GstClockTimeDiff diff;
+
+    if (!GST_CLOCK_TIME_IS_VALID (entry->running_time))
+      continue;
+
+    diff = ABS (GST_CLOCK_DIFF (entry->running_time, running_time));
+    if (diff < best)
+    {
+      best = diff;
+      closest = entry;
+    }
+  }
+
+  if (closest == NULL)
+    return NULL;
+
+  *found_time = closest->running_time;
+  return gst_buffer_ref (closest->buffer);
+}
+
+/*
+ * cheese_frame_ring_clear:
+ * @ring: a #CheeseFrameRing
+ *
+ * Drop all frames.
+ */
+void
+cheese_frame_ring_clear (CheeseFrameRing *ring)
+{
+  while (!g_queue_is_empty (&ring->frames))
+    cheese_frame_ring_drop (ring);
+}
+
+/*
+ * cheese_frame_ring_get_length:
+ * @ring: a #CheeseFrameRing
+ *
+ * Returns: the number of frames in @ring
+ */
+guint
+cheese_frame_ring_get_length (const CheeseFrameRing *ring)
+{
+  return g_queue_get_length ((GQueue *) &ring->frames);
+}
+
+/*
+ * cheese_frame_ring_get_size:
+ * @ring: a #CheeseFrameRing
+ *
+ * Returns: the number of bytes of the frames in @ring
+ */
+gsize
+cheese_frame_ring_get_size (const CheeseFrameRing *ring)
+{
+  return ring->size;
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright © 2026 Cheese contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHEESE_FRAME_RING_H_
+#define CHEESE_FRAME_RING_H_
+
+#include <glib.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CheeseFrameRing CheeseFrameRing;
+
+CheeseFrameRing *cheese_frame_ring_new (gsize        max_bytes,
+                                        GstClockTime max_duration);
+void             cheese_frame_ring_free (CheeseFrameRing *ring);
+void             cheese_frame_ring_set_max_duration (CheeseFrameRing *ring,
+                                                     GstClockTime     max_duration);
+void             cheese_frame_ring_set_max_frames (CheeseFrameRing *ring,
+                                                   guint            max_frames);
+void             cheese_frame_ring_push (CheeseFrameRing *ring,
+                                         GstBuffer       *buffer,
+                                         GstClockTime     running_time);
+GstBuffer       *cheese_frame_ring_pop (CheeseFrameRing *ring,
+                                        GstClockTime    *running_time);
+GstBuffer       *cheese_frame_ring_find (CheeseFrameRing *ring,
+                                         GstClockTime     running_time,
+                                         GstClockTime    *found_time);
+void             cheese_frame_ring_clear (CheeseFrameRing *ring);
+guint            cheese_frame_ring_get_length (const CheeseFrameRing *ring);
+gsize            cheese_frame_ring_get_size (const CheeseFrameRing *ring);
+
+G_END_DECLS
+
+#endif /* CHEESE_FRAME_RING_H_ */
@@ -0,0 +1,1004 @@
+/*
+ * Copyright © 2026 Cheese contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+  #include <config.h>
+#endif
+
+#include <math.h>
+#include <string.h>
+#include <glib.h>
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#if (defined (__x86_64__) || defined (__i386__)) && defined (__GNUC__)
+  #define CHEESE_KERNEL_X86 1
+  #include <immintrin.h>
+#endif
+
+#if defined (__ARM_NEON) || defined (__ARM_NEON__)
+  #define CHEESE_KERNEL_NEON 1
+  #include <arm_neon.h>
+#endif
+
+#include "cheese-kernel.h"
+
+/*
+ * CheeseKernel is a video filter which applies the common looks of the
+ * effects, mirroring, grayscale, sepia, vintage, hue and saturation
+ * changes, in a single pass, instead of a chain of elements which each take
+ * a pass and may need conversions in between. Effect files use it like any
+ * other element, for instance
+ *
+ *   PipelineDescription=cheesekernel look=sepia mirror=true
+ *
+ * It also has the brightness, contrast, hue and saturation properties of
+ * videobalance, with the same ranges, so that it stands in for it as the
+ * color balance of the camera.
+ *
+ * Every look maps luma through a table and chroma through an affine map, see
+ * #CheeseKernelParams. On planar YUV frames, the chroma map runs on SSE2,
+ * AVX2 or NEON where the CPU has them, picked at run time, and falls back to
+ * plain C. Other YUV layouts go through plain C, and RGB is converted to YUV
+ * and back, pixel by pixel, as videobalance does.
+ *
+ * Like videobalance, it works in place, so that frames need no new buffer.
+ * Only mirroring reads the frame back to front, from a copy kept for it.
+ */
+
+GST_DEBUG_CATEGORY_STATIC (cheese_kernel_cat);
+#define GST_CAT_DEFAULT cheese_kernel_cat
+
+#define CHEESE_KERNEL_CAPS \
+  GST_VIDEO_CAPS_MAKE ("{ AYUV, I420, YV12, Y42B, Y41B, Y444, NV12, NV21, " \
+                       "YUY2, UYVY, YVYU, GRAY8, RGB, BGR, RGBx, BGRx, " \
+                       "xRGB, xBGR, RGBA, BGRA, ARGB, ABGR }")
+
+struct _CheeseKernel
+{
+  GstVideoFilter parent;
+
+  CheeseKernelLook look;
+  gdouble brightness;
+  gdouble contrast;
+  gdouble hue;
+  gdouble saturation;
+  gboolean mirror;
+
+  /* Derived from the properties above, under the object lock. */
+  CheeseKernelParams params;
+  gboolean luma_identity;
+
+  CheeseKernelIsa isa;
+
+  /* The copy of the frame which a mirrored frame is read from, only used
+   * from the streaming thread. */
+  GstBuffer *scratch;
+};
+
+enum
+{
+  PROP_0,
+  PROP_LOOK,
+  PROP_BRIGHTNESS,
+  PROP_CONTRAST,
+  PROP_HUE,
+  PROP_SATURATION,
+  PROP_MIRROR,
+  PROP_LAST
+};
+
+static GParamSpec *properties[PROP_LAST];
+
+G_DEFINE_TYPE (CheeseKernel, cheese_kernel, GST_TYPE_VIDEO_FILTER)
+
+GType
+cheese_kernel_look_get_type (void)
+{
+  static gsize type = 0;
+  static const GEnumValue values[] = {
+    { CHEESE_KERNEL_LOOK_NORMAL, "Keep the colors", "normal" },
+    { CHEESE_KERNEL_LOOK_GRAYSCALE, "Drop the colors", "grayscale" },
+    { CHEESE_KERNEL_LOOK_SEPIA, "Brown tinted grays", "sepia" },
+    { CHEESE_KERNEL_LOOK_VINTAGE, "Faded, warm colors", "vintage" },
+    { 0, NULL, NULL }
+  };
+
+  if (g_once_init_enter (&type))
+    g_once_init_leave (&type, g_enum_register_static ("CheeseKernelLook",
+                                                      values));
+
+  return type;
+}
+
+/*
+ * cheese_kernel_params_init:
+ * @params: the #CheeseKernelParams to fill in
+ * @look: a #CheeseKernelLook
+ * @brightness: the brightness, from -1 to 1, as with videobalance
+ * @contrast: the contrast, from 0 to 2, as with videobalance
+ * @hue: the hue shift, from -1 to 1 for a half turn either way, as with
+ * videobalance
+ * @saturation: the saturation, from 0 to 2, as with videobalance
+ * @mirror: whether to mirror the rows
+ *
+ * Work out the luma table and the chroma map of a look, followed by the
+ * balance. Chroma gains are limited to just under 2, so that the map cannot
+ * overflow 16 bits.
+ */
+void
+cheese_kernel_params_init (CheeseKernelParams *params, CheeseKernelLook look,
+                           gdouble brightness, gdouble contrast,
+                           gdouble hue, gdouble saturation, gboolean mirror)
+{
+  gdouble scale = saturation;
+  gdouble u_tint = 0, v_tint = 0;
+  gdouble hue_cos, hue_sin;
+  gint i;
+
+  for (i = 0; i < 256; i++)
+    params->luma[i] = i;
+
+  switch (look)
+  {
+    case CHEESE_KERNEL_LOOK_GRAYSCALE:
+      scale = 0;
+      break;
+    case CHEESE_KERNEL_LOOK_SEPIA:
+      scale = 0;
+      u_tint = -24;
+      v_tint = 16;
+      break;
+    case CHEESE_KERNEL_LOOK_VINTAGE:
+      scale *= 0.5;
+      u_tint = -12;
+      v_tint = 8;
+      /* Lift the blacks and dim the whites, as on a faded print. */
+      for (i = 0; i < 256; i++)
+        params->luma[i] = 24 + i * 200 / 255;
+      break;
+    case CHEESE_KERNEL_LOOK_NORMAL:
+    default:
+      break;
+  }
+
+  /* The same luma curve as videobalance. */
+  if (brightness != 0.0 || contrast != 1.0)
+  {
+    for (i = 0; i < 256; i++)
+      params->luma[i] = CLAMP (lround ((params->luma[i] - 16) * contrast +
+                                       brightness * 255 + 16), 0, 255);
+  }
+
+  /* The same rotation as videobalance. */
+  hue_cos = cos (G_PI * hue) * scale;
+  hue_sin = sin (G_PI * hue) * scale;
+  params->matrix[0] = CLAMP (lround (hue_cos * 64), -127, 127);
+  params->matrix[1] = CLAMP (lround (hue_sin * 64), -127, 127);
+  params->matrix[2] = CLAMP (lround (-hue_sin * 64), -127, 127);
+  params->matrix[3] = CLAMP (lround (hue_cos * 64), -127, 127);
+  params->offset[0] = lround (u_tint);
+  params->offset[1] = lround (v_tint);
+  params->mirror = mirror;
+}
+
+/*
+ * cheese_kernel_isa_supported:
+ * @isa: a #CheeseKernelIsa
+ *
+ * Returns: %TRUE if the kernels for @isa are built in and the CPU runs them
+ */
+gboolean
+cheese_kernel_isa_supported (CheeseKernelIsa isa)
+{
+  switch (isa)
+  {
+    case CHEESE_KERNEL_ISA_SCALAR:
+      return TRUE;
+#ifdef CHEESE_KERNEL_X86
+    case CHEESE_KERNEL_ISA_SSE2:
+      __builtin_cpu_init ();
+      return __builtin_cpu_supports ("sse2");
+    case CHEESE_KERNEL_ISA_AVX2:
+      __builtin_cpu_init ();
+      return __builtin_cpu_supports ("avx2");
+#endif
+#ifdef CHEESE_KERNEL_NEON
+    case CHEESE_KERNEL_ISA_NEON:
+      return TRUE;
+#endif
+    default:
+      return FALSE;
+  }
+}
+
+/*
+ * cheese_kernel_get_isa:
+ *
+ * Returns: the best instruction set which the kernels can use on this CPU
+ */
+CheeseKernelIsa
+cheese_kernel_get_isa (void)
+{
+  static gsize isa = 0;
+
+  if (g_once_init_enter (&isa))
+  {
+    CheeseKernelIsa best = CHEESE_KERNEL_ISA_SCALAR;
+
+    if (cheese_kernel_isa_supported (CHEESE_KERNEL_ISA_AVX2))
+      best = CHEESE_KERNEL_ISA_AVX2;
+    else if (cheese_kernel_isa_supported (CHEESE_KERNEL_ISA_SSE2))
+      best = CHEESE_KERNEL_ISA_SSE2;
+    else if (cheese_kernel_isa_supported (CHEESE_KERNEL_ISA_NEON))
+      best = CHEESE_KERNEL_ISA_NEON;
+
+    /* Zero means not initialized yet, so store it shifted. */
+    g_once_init_leave (&isa, best + 1);
+  }
+
+  return isa - 1;
+}
+
+/*
+ * cheese_kernel_process_luma:
+ * @params: the #CheeseKernelParams of the look
+ * @src: a row of luma
+ * @dest: where to write the row, which may be @src unless mirroring
+ * @width: the width of the row
+ *
+ * Map a row of luma through the table, mirroring it if needed.
+ */
+void
+cheese_kernel_process_luma (const CheeseKernelParams *params,
+                            const guint8 *src, guint8 *dest, gint width)
+{
+  gint x;
+
+  if (params->mirror)
+  {
+    for (x = 0; x < width; x++)
+      dest[x] = params->luma[src[width - 1 - x]];
+  }
+  else
+  {
+    for (x = 0; x < width; x++)
+      dest[x] = params->luma[src[x]];
+  }
+}
+
+/* Map one pair of chroma values. */
+static inline void
+cheese_kernel_map_chroma (const CheeseKernelParams *params, gint u, gint v,
+                          guint8 *dest_u, guint8 *dest_v)
+{
+  const gint16 *m = params->matrix;
+
+  u -= 128;
+  v -= 128;
+  *dest_u = CLAMP (((m[0] * u + m[1] * v) >> 6) + params->offset[0] + 128,
+                   0, 255);
+  *dest_v = CLAMP (((m[2] * u + m[3] * v) >> 6) + params->offset[1] + 128,
+                   0, 255);
+}
+
+/*
+ * cheese_kernel_chroma_scalar:
+ * @start: the first pixel to process, those before are done already
+ *
+ * The plain C chroma kernel, which the SIMD ones must match bit for bit,
+ * and which finishes the rows they leave off.
+ */
+static void
+cheese_kernel_chroma_scalar (const CheeseKernelParams *params,
+                             const guint8 *src_u, const guint8 *src_v,
+                             guint8 *dest_u, guint8 *dest_v,
+                             gint width, gint start)
+{
+  gint x, s;
+
+  for (x = start; x < width; x++)
+  {
+    s = params->mirror ? width - 1 - x : x;
+    cheese_kernel_map_chroma (params, src_u[s], src_v[s], &dest_u[x],
+                              &dest_v[x]);
+  }
+}
+
+#ifdef CHEESE_KERNEL_X86
+/* Reverse the order of the eight 16-bit lanes. */
+__attribute__ ((target ("sse2")))
+static inline __m128i
+cheese_kernel_reverse_epi16 (__m128i x)
+{
+  x = _mm_shufflelo_epi16 (x, _MM_SHUFFLE (0, 1, 2, 3));
+  x = _mm_shufflehi_epi16 (x, _MM_SHUFFLE (0, 1, 2, 3));
+  return _mm_shuffle_epi32 (x, _MM_SHUFFLE (1, 0, 3, 2));
+}
+
+__attribute__ ((target ("sse2")))
+static inline __m128i
+cheese_kernel_affine_sse2 (__m128i u, __m128i v, __m128i mu, __m128i mv,
+                           __m128i offset)
+{
+  __m128i sum = _mm_add_epi16 (_mm_mullo_epi16 (u, mu), _mm_mullo_epi16 (v, mv));
+
+  return _mm_add_epi16 (_mm_srai_epi16 (sum, 6), offset);
+}
+
+/*
+ * cheese_kernel_chroma_sse2:
+ *
+ * Returns: the number of pixels processed, a multiple of 16
+ */
+__attribute__ ((target ("sse2")))
+static gint
+cheese_kernel_chroma_sse2 (const CheeseKernelParams *params,
+                           const guint8 *src_u, const guint8 *src_v,
+                           guint8 *dest_u, guint8 *dest_v, gint width)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128i bias = _mm_set1_epi16 (128);
+  const __m128i m0 = _mm_set1_epi16 (params->matrix[0]);
+  const __m128i m1 = _mm_set1_epi16 (params->matrix[1]);
+  const __m128i m2 = _mm_set1_epi16 (params->matrix[2]);
+  const __m128i m3 = _mm_set1_epi16 (params->matrix[3]);
+  const __m128i offset_u = _mm_set1_epi16 (params->offset[0] + 128);
+  const __m128i offset_v = _mm_set1_epi16 (params->offset[1] + 128);
+  __m128i u, v, u_lo, u_hi, v_lo, v_hi, tmp;
+  gint x, s;
+
+  for (x = 0; x + 16 <= width; x += 16)
+  {
+    s = params->mirror ? width - x - 16 : x;
+    u = _mm_loadu_si128 ((const __m128i *) (src_u + s));
+    v = _mm_loadu_si128 ((const __m128i *) (src_v + s));
+    u_lo = _mm_sub_epi16 (_mm_unpacklo_epi8 (u, zero), bias);
+    u_hi = _mm_sub_epi16 (_mm_unpackhi_epi8 (u, zero), bias);
+    v_lo = _mm_sub_epi16 (_mm_unpacklo_epi8 (v, zero), bias);
+    v_hi = _mm_sub_epi16 (_mm_unpackhi_epi8 (v, zero), bias);
+
+    if (params->mirror)
+    {
+      tmp = cheese_kernel_reverse_epi16 (u_hi);
+      u_hi = cheese_kernel_reverse_epi16 (u_lo);
+      u_lo = tmp;
+      tmp = cheese_kernel_reverse_epi16 (v_hi);
+      v_hi = cheese_kernel_reverse_epi16 (v_lo);
+      v_lo = tmp;
+    }
+
+    _mm_storeu_si128 ((__m128i *) (dest_u + x),
+                      _mm_packus_epi16 (cheese_kernel_affine_sse2 (u_lo, v_lo, m0, m1, offset_u),
+                                        cheese_kernel_affine_sse2 (u_hi, v_hi, m0, m1, offset_u)));
+    _mm_storeu_si128 ((__m128i *) (dest_v + x),
+                      _mm_packus_epi16 (cheese_kernel_affine_sse2 (u_lo, v_lo, m2, m3, offset_v),
+                                        cheese_kernel_affine_sse2 (u_hi, v_hi, m2, m3, offset_v)));
+  }
+
+  return x;
+}
+
+__attribute__ ((target ("avx2")))
+static inline __m256i
+cheese_kernel_affine_avx2 (__m256i u, __m256i v, __m256i mu, __m256i mv,
+                           __m256i offset)
+{
+  __m256i sum = _mm256_add_epi16 (_mm256_mullo_epi16 (u, mu),
+                                  _mm256_mullo_epi16 (v, mv));
+
+  return _mm256_add_epi16 (_mm256_srai_epi16 (sum, 6), offset);
+}
+
+/*
+ * cheese_kernel_chroma_avx2:
+ *
+ * As cheese_kernel_chroma_sse2(), 32 pixels at a time. Unpacking and
+ * packing both work within 128-bit lanes, so they cancel out and the pixels
+ * come back in order.
+ *
+ * Returns: the number of pixels processed, a multiple of 32
+ */
+__attribute__ ((target ("avx2")))
+static gint
+cheese_kernel_chroma_avx2 (const CheeseKernelParams *params,
+                           const guint8 *src_u, const guint8 *src_v,
+                           guint8 *dest_u, guint8 *dest_v, gint width)
+{
+  const __m256i reverse = _mm256_setr_epi8 (15, 14, 13, 12, 11, 10, 9, 8,
+                                            7, 6, 5, 4, 3, 2, 1, 0,
+                                            15, 14, 13, 12, 11, 10, 9, 8,
+                                            7, 6, 5, 4, 3, 2, 1, 0);
+  const __m256i zero = _mm256_setzero_si256 ();
+  const __m256i bias = _mm256_set1_epi16 (128);
+  const __m256i m0 = _mm256_set1_epi16 (params->matrix[0]);
+  const __m256i m1 = _mm256_set1_epi16 (params->matrix[1]);
+  const __m256i m2 = _mm256_set1_epi16 (params->matrix[2]);
+  const __m256i m3 = _mm256_set1_epi16 (params->matrix[3]);
+  const __m256i offset_u = _mm256_set1_epi16 (params->offset[0] + 128);
+  const __m256i offset_v = _mm256_set1_epi16 (params->offset[1] + 128);
+  __m256i u, v, u_lo, u_hi, v_lo, v_hi;
+  gint x, s;
+
+  for (x = 0; x + 32 <= width; x += 32)
+  {
+    s = params->mirror ? width - x - 32 : x;
+    u = _mm256_loadu_si256 ((const __m256i *) (src_u + s));
+    v = _mm256_loadu_si256 ((const __m256i *) (src_v + s));
+
+    if (params->mirror)
+    {
+      u = _mm256_permute4x64_epi64 (_mm256_shuffle_epi8 (u, reverse),
+                                    _MM_SHUFFLE (1, 0, 3, 2));
+      v = _mm256_permute4x64_epi64 (_mm256_shuffle_epi8 (v, reverse),
+                                    _MM_SHUFFLE (1, 0, 3, 2));
+    }
+
+    u_lo = _mm256_sub_epi16 (_mm256_unpacklo_epi8 (u, zero), bias);
+    u_hi = _mm256_sub_epi16 (_mm256_unpackhi_epi8 (u, zero), bias);
+    v_lo = _mm256_sub_epi16 (_mm256_unpacklo_epi8 (v, zero), bias);
+    v_hi = _mm256_sub_epi16 (_mm256_unpackhi_epi8 (v, zero), bias);
+
+    _mm256_storeu_si256 ((__m256i *) (dest_u + x),
+                         _mm256_packus_epi16 (cheese_kernel_affine_avx2 (u_lo, v_lo, m0, m1, offset_u),
+                                              cheese_kernel_affine_avx2 (u_hi, v_hi, m0, m1, offset_u)));
+    _mm256_storeu_si256 ((__m256i *) (dest_v + x),
+                         _mm256_packus_epi16 (cheese_kernel_affine_avx2 (u_lo, v_lo, m2, m3, offset_v),
+                                              cheese_kernel_affine_avx2 (u_hi, v_hi, m2, m3, offset_v)));
+  }
+
+  return x;
+}
+#endif /* CHEESE_KERNEL_X86 */
+
+#ifdef CHEESE_KERNEL_NEON
+static inline uint8x8_t
+cheese_kernel_affine_neon (int16x8_t u, int16x8_t v, int16x8_t mu,
+                           int16x8_t mv, int16x8_t offset)
+{
+  int16x8_t sum = vmlaq_s16 (vmulq_s16 (u, mu), v, mv);
+
+  return vqmovun_s16 (vaddq_s16 (vshrq_n_s16 (sum, 6), offset));
+}
+
+/*
+ * cheese_kernel_chroma_neon:
+ *
+ * Returns: the number of pixels processed, a multiple of 16
+ */
+static gint
+cheese_kernel_chroma_neon (const CheeseKernelParams *params,
+                           const guint8 *src_u, const guint8 *src_v,
+                           guint8 *dest_u, guint8 *dest_v, gint width)
+{
+  const int16x8_t bias = vdupq_n_s16 (128);
+  const int16x8_t m0 = vdupq_n_s16 (params->matrix[0]);
+  const int16x8_t m1 = vdupq_n_s16 (params->matrix[1]);
+  const int16x8_t m2 = vdupq_n_s16 (params->matrix[2]);
+  const int16x8_t m3 = vdupq_n_s16 (params->matrix[3]);
+  const int16x8_t offset_u = vdupq_n_s16 (params->offset[0] + 128);
+  const int16x8_t offset_v = vdupq_n_s16 (params->offset[1] + 128);
+  uint8x16_t u, v;
+  int16x8_t u_lo, u_hi, v_lo, v_hi;
+  gint x, s;
+
+  for (x = 0; x + 16 <= width; x += 16)
+  {
+    s = params->mirror ? width - x - 16 : x;
+    u = vld1q_u8 (src_u + s);
+    v = vld1q_u8 (src_v + s);
+
+    if (params->mirror)
+    {
+      u = vrev64q_u8 (u);
+      u = vcombine_u8 (vget_high_u8 (u), vget_low_u8 (u));
+      v = vrev64q_u8 (v);
+      v = vcombine_u8 (vget_high_u8 (v), vget_low_u8 (v));
+    }
+
+    u_lo = vsubq_s16 (vreinterpretq_s16_u16 (vmovl_u8 (vget_low_u8 (u))), bias);
+    u_hi = vsubq_s16 (vreinterpretq_s16_u16 (vmovl_u8 (vget_high_u8 (u))), bias);
+    v_lo = vsubq_s16 (vreinterpretq_s16_u16 (vmovl_u8 (vget_low_u8 (v))), bias);
+    v_hi = vsubq_s16 (vreinterpretq_s16_u16 (vmovl_u8 (vget_high_u8 (v))), bias);
+
+    vst1q_u8 (dest_u + x,
+              vcombine_u8 (cheese_kernel_affine_neon (u_lo, v_lo, m0, m1, offset_u),
+                           cheese_kernel_affine_neon (u_hi, v_hi, m0, m1, offset_u)));
+    vst1q_u8 (dest_v + x,
+              vcombine_u8 (cheese_kernel_affine_neon (u_lo, v_lo, m2, m3, offset_v),
+                           cheese_kernel_affine_neon (u_hi, v_hi, m2, m3, offset_v)));
+  }
+
+  return x;
+}
+#endif /* CHEESE_KERNEL_NEON */
+
+/*
+ * cheese_kernel_process_chroma:
+ * @isa: the #CheeseKernelIsa to use, which must be supported
+ * @params: the #CheeseKernelParams of the look
+ * @src_u: a row of the U plane
+ * @src_v: the same row of the V plane
+ * @dest_u: where to write the U row, which may be @src_u unless mirroring
+ * @dest_v: where to write the V row, which may be @src_v unless mirroring
+ * @width: the width of the rows
+ *
+ * Map a row of chroma through the affine map, mirroring it if needed.
+ */
+void
+cheese_kernel_process_chroma (CheeseKernelIsa isa,
+                              const CheeseKernelParams *params,
+                              const guint8 *src_u, const guint8 *src_v,
+                              guint8 *dest_u, guint8 *dest_v, gint width)
+{
+  gint done = 0;
+
+  switch (isa)
+  {
+#ifdef CHEESE_KERNEL_X86
+    case CHEESE_KERNEL_ISA_SSE2:
+      done = cheese_kernel_chroma_sse2 (params, src_u, src_v, dest_u, dest_v,
+                                        width);
+      break;
+    case CHEESE_KERNEL_ISA_AVX2:
+      done = cheese_kernel_chroma_avx2 (params, src_u, src_v, dest_u, dest_v,
+                                        width);
+      break;
+#endif
+#ifdef CHEESE_KERNEL_NEON
+    case CHEESE_KERNEL_ISA_NEON:
+      done = cheese_kernel_chroma_neon (params, src_u, src_v, dest_u, dest_v,
+                                        width);
+      break;
+#endif
+    case CHEESE_KERNEL_ISA_SCALAR:
+    default:
+      break;
+  }
+
+  cheese_kernel_chroma_scalar (params, src_u, src_v, dest_u, dest_v, width,
+                               done);
+}
+
+/*
+ * cheese_kernel_update:
+ * @kernel: a #CheeseKernel
+ *
+ * Work the parameters out again after a property changed, and let frames
+ * through untouched when the look does nothing.
+ */
+static void
+cheese_kernel_update (CheeseKernel *kernel)
+{
+  gboolean passthrough;
+  gint i;
+
+  GST_OBJECT_LOCK (kernel);
+  cheese_kernel_params_init (&kernel->params, kernel->look,
+                             kernel->brightness, kernel->contrast,
+                             kernel->hue, kernel->saturation, kernel->mirror);
+
+  kernel->luma_identity = TRUE;
+  for (i = 0; i < 256 && kernel->luma_identity; i++)
+    kernel->luma_identity = kernel->params.luma[i] == i;
+
+  passthrough = kernel->luma_identity && !kernel->mirror &&
+                kernel->params.matrix[0] == 64 && kernel->params.matrix[1] == 0 &&
+                kernel->params.matrix[2] == 0 && kernel->params.matrix[3] == 64 &&
+                kernel->params.offset[0] == 0 && kernel->params.offset[1] == 0;
+  GST_OBJECT_UNLOCK (kernel);
+
+  gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (kernel), passthrough);
+}
+
+/*
+ * cheese_kernel_transform_yuv:
+ *
+ * Process a YUV frame, plane by plane, into @out_frame, which may be
+ * @in_frame unless mirroring. Rows of planar chroma go through the SIMD
+ * kernels, interleaved and packed chroma through plain C.
+ */
+static void
+cheese_kernel_transform_yuv (CheeseKernel *kernel,
+                             const CheeseKernelParams *params,
+                             gboolean luma_identity,
+                             GstVideoFrame *in_frame, GstVideoFrame *out_frame)
+{
+  const guint8 *src, *src_u, *src_v;
+  guint8 *dest, *dest_u, *dest_v;
+  gint width, height, pstride, pstride_u, pstride_v, x, y, s;
+
+  width = GST_VIDEO_FRAME_COMP_WIDTH (in_frame, 0);
+  height = GST_VIDEO_FRAME_COMP_HEIGHT (in_frame, 0);
+  pstride = GST_VIDEO_FRAME_COMP_PSTRIDE (in_frame, 0);
+  for (y = 0; y < height; y++)
+  {
+    src = GST_VIDEO_FRAME_COMP_DATA (in_frame, 0) +
+          y * GST_VIDEO_FRAME_COMP_STRIDE (in_frame, 0);
+    dest = GST_VIDEO_FRAME_COMP_DATA (out_frame, 0) +
+           y * GST_VIDEO_FRAME_COMP_STRIDE (out_frame, 0);
+
+    if (pstride != 1)
+    {
+      for (x = 0; x < width; x++)
+      {
+        s = params->mirror ? width - 1 - x : x;
+        dest[x * pstride] = params->luma[src[s * pstride]];
+      }
+    }
+    else if (luma_identity && !params->mirror)
+    {
+      if (dest != src)
+        memcpy (dest, src, width);
+    }
+    else
+      cheese_kernel_process_luma (params, src, dest, width);
+  }
+
+  if (GST_VIDEO_FRAME_N_COMPONENTS (in_frame) < 3)
+    return;
+
+  width = GST_VIDEO_FRAME_COMP_WIDTH (in_frame, 1);
+  height = GST_VIDEO_FRAME_COMP_HEIGHT (in_frame, 1);
+  pstride_u = GST_VIDEO_FRAME_COMP_PSTRIDE (in_frame, 1);
+  pstride_v = GST_VIDEO_FRAME_COMP_PSTRIDE (in_frame, 2);
+  for (y = 0; y < height; y++)
+  {
+    src_u = GST_VIDEO_FRAME_COMP_DATA (in_frame, 1) +
+            y * GST_VIDEO_FRAME_COMP_STRIDE (in_frame, 1);
+    src_v = GST_VIDEO_FRAME_COMP_DATA (in_frame, 2) +
+            y * GST_VIDEO_FRAME_COMP_STRIDE (in_frame, 2);
+    dest_u = GST_VIDEO_FRAME_COMP_DATA (out_frame, 1) +
+             y * GST_VIDEO_FRAME_COMP_STRIDE (out_frame, 1);
+    dest_v = GST_VIDEO_FRAME_COMP_DATA (out_frame, 2) +
+             y * GST_VIDEO_FRAME_COMP_STRIDE (out_frame, 2);
+
+    if (pstride_u == 1 && pstride_v == 1)
+    {
+      cheese_kernel_process_chroma (kernel->isa, params, src_u, src_v,
+                                    dest_u, dest_v, width);
+      continue;
+    }
+
+    for (x = 0; x < width; x++)
+    {
+      s = params->mirror ? width - 1 - x : x;
+      cheese_kernel_map_chroma (params, src_u[s * pstride_u],
+                                src_v[s * pstride_v],
+                                &dest_u[x * pstride_u], &dest_v[x * pstride_v]);
+    }
+  }
+
+  /* Carry the alpha of AYUV over, which stays in place otherwise. */
+  if (GST_VIDEO_FRAME_N_COMPONENTS (in_frame) < 4 || in_frame == out_frame)
+    return;
+
+  width = GST_VIDEO_FRAME_COMP_WIDTH (in_frame, 3);
+  height = GST_VIDEO_FRAME_COMP_HEIGHT (in_frame, 3);
+  pstride = GST_VIDEO_FRAME_COMP_PSTRIDE (in_frame, 3);
+  for (y = 0; y < height; y++)
+  {
+    src = GST_VIDEO_FRAME_COMP_DATA (in_frame, 3) +
+          y * GST_VIDEO_FRAME_COMP_STRIDE (in_frame, 3);
+    dest = GST_VIDEO_FRAME_COMP_DATA (out_frame, 3) +
+           y * GST_VIDEO_FRAME_COMP_STRIDE (out_frame, 3);
+
+    for (x = 0; x < width; x++)
+    {
+      s = params->mirror ? width - 1 - x : x;
+      dest[x * pstride] = src[s * pstride];
+    }
+  }
+}
+
+/*
+ * cheese_kernel_transform_rgb:
+ *
+ * Process an RGB frame into @out_frame, which may be @in_frame unless
+ * mirroring, converting each pixel to BT.601 YUV and back. The whole pixel
+ * is copied first, to carry alpha or padding over.
+ */
+static void
+cheese_kernel_transform_rgb (const CheeseKernelParams *params,
+                             GstVideoFrame *in_frame, GstVideoFrame *out_frame)
+{
+  const guint8 *src, *pixel;
+  guint8 *dest, *out, u, v;
+  gint width, height, pstride, r, g, b, c, d, e, x, y;
+  gint offset_r, offset_g, offset_b;
+
+  width = GST_VIDEO_FRAME_WIDTH (in_frame);
+  height = GST_VIDEO_FRAME_HEIGHT (in_frame);
+  pstride = GST_VIDEO_FRAME_COMP_PSTRIDE (in_frame, 0);
+  offset_r = GST_VIDEO_FORMAT_INFO_POFFSET (in_frame->info.finfo, GST_VIDEO_COMP_R);
+  offset_g = GST_VIDEO_FORMAT_INFO_POFFSET (in_frame->info.finfo, GST_VIDEO_COMP_G);
+  offset_b = GST_VIDEO_FORMAT_INFO_POFFSET (in_frame->info.finfo, GST_VIDEO_COMP_B);
+
+  for (y = 0; y < height; y++)
+  {
+    src = (const guint8 *) GST_VIDEO_FRAME_PLANE_DATA (in_frame, 0) +
+          y * GST_VIDEO_FRAME_PLANE_STRIDE (in_frame, 0);
+    dest = (guint8 *) GST_VIDEO_FRAME_PLANE_DATA (out_frame, 0) +
+           y * GST_VIDEO_FRAME_PLANE_STRIDE (out_frame, 0);
+
+    for (x = 0; x < width; x++)
+    {
+      pixel = src + (params->mirror ? width - 1 - x : x) * pstride;
+      out = dest + x * pstride;
+      if (out != pixel)
+        memcpy (out, pixel, pstride);
+
+      r = pixel[offset_r];
+      g = pixel[offset_g];
+      b = pixel[offset_b];
+
+      c = params->luma[CLAMP (((66 * r + 129 * g + 25 * b + 128) >> 8) + 16,
+                              0, 255)] - 16;
+      cheese_kernel_map_chroma (params,
+                                ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128,
+                                ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128,
+                                &u, &v);
+      d = u - 128;
+      e = v - 128;
+
+      out[offset_r] = CLAMP ((298 * c + 409 * e + 128) >> 8, 0, 255);
+      out[offset_g] = CLAMP ((298 * c - 100 * d - 208 * e + 128) >> 8, 0, 255);
+      out[offset_b] = CLAMP ((298 * c + 516 * d + 128) >> 8, 0, 255);
+    }
+  }
+}
+
+static GstFlowReturn
+cheese_kernel_transform_frame_ip (GstVideoFilter *filter, GstVideoFrame *frame)
+{
+  CheeseKernel *kernel = CHEESE_KERNEL (filter);
+  CheeseKernelParams params;
+  GstVideoFrame copy, *in_frame = frame;
+  gboolean luma_identity;
+  gsize size;
+
+  GST_OBJECT_LOCK (kernel);
+  params = kernel->params;
+  luma_identity = kernel->luma_identity;
+  GST_OBJECT_UNLOCK (kernel);
+
+  /* A mirrored row would overwrite the pixels it has yet to read. */
+  if (params.mirror)
+  {
+    size = GST_VIDEO_INFO_SIZE (&filter->in_info);
+    if (kernel->scratch != NULL && gst_buffer_get_size (kernel->scratch) != size)
+      g_clear_pointer (&kernel->scratch, gst_buffer_unref);
+    if (kernel->scratch == NULL)
+      kernel->scratch = gst_buffer_new_allocate (NULL, size, NULL);
+
+    if (!gst_video_frame_map (&copy, &filter->in_info, kernel->scratch,
+                              GST_MAP_READWRITE) ||
+        !gst_video_frame_copy (&copy, frame))
+    {
+      GST_ELEMENT_ERROR (kernel, STREAM, FAILED, (NULL),
+                         ("Could not copy the frame to mirror"));
+      return GST_FLOW_ERROR;
+    }
+    in_frame = &copy;
+  }
+
+  if (GST_VIDEO_FRAME_IS_RGB (frame))
+    cheese_kernel_transform_rgb (&params, in_frame, frame);
+  else
+    cheese_kernel_transform_yuv (kernel, &params, luma_identity, in_frame,
+                                 frame);
+
+  if (in_frame == &copy)
+    gst_video_frame_unmap (&copy);
+
+  return GST_FLOW_OK;
+}
+
+static void
+cheese_kernel_get_property (GObject *object, guint property_id,
+                            GValue *value, GParamSpec *pspec)
+{
+  CheeseKernel *kernel = CHEESE_KERNEL (object);
+
+  GST_OBJECT_LOCK (kernel);
+  switch (property_id)
+  {
+    case PROP_LOOK:
+      g_value_set_enum (value, kernel->look);
+      break;
+    case PROP_BRIGHTNESS:
+      g_value_set_double (value, kernel->brightness);
+      break;
+    case PROP_CONTRAST:
+      g_value_set_double (value, kernel->contrast);
+      break;
+    case PROP_HUE:
+      g_value_set_double (value, kernel->hue);
+      break;
+    case PROP_SATURATION:
+      g_value_set_double (value, kernel->saturation);
+      break;
+    case PROP_MIRROR:
+      g_value_set_boolean (value, kernel->mirror);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+  }
+  GST_OBJECT_UNLOCK (kernel);
+}
+
+static void
+cheese_kernel_set_property (GObject *object, guint property_id,
+                            const GValue *value, GParamSpec *pspec)
+{
+  CheeseKernel *kernel = CHEESE_KERNEL (object);
+
+  GST_OBJECT_LOCK (kernel);
+  switch (property_id)
+  {
+    case PROP_LOOK:
+      kernel->look = g_value_get_enum (value);
+      break;
+    case PROP_BRIGHTNESS:
+      kernel->brightness = g_value_get_double (value);
+      break;
+    case PROP_CONTRAST:
+      kernel->contrast = g_value_get_double (value);
+      break;
+    case PROP_HUE:
+      kernel->hue = g_value_get_double (value);
+      break;
+    case PROP_SATURATION:
+      kernel->saturation = g_value_get_double (value);
+      break;
+    case PROP_MIRROR:
+      kernel->mirror = g_value_get_boolean (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      GST_OBJECT_UNLOCK (kernel);
+      return;
+  }
+  GST_OBJECT_UNLOCK (kernel);
+
+  cheese_kernel_update (kernel);
+}
+
+static void
+cheese_kernel_finalize (GObject *object)
+{
+  CheeseKernel *kernel = CHEESE_KERNEL (object);
+
+  g_clear_pointer (&kernel->scratch, gst_buffer_unref);
+
+  G_OBJECT_CLASS (cheese_kernel_parent_class)->finalize (object);
+}
+
+static void
+cheese_kernel_class_init (CheeseKernelClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstBaseTransformClass *trans_class = GST_BASE_TRANSFORM_CLASS (klass);
+  GstVideoFilterClass *filter_class = GST_VIDEO_FILTER_CLASS (klass);
+  GstCaps *caps;
+
+  GST_DEBUG_CATEGORY_INIT (cheese_kernel_cat, "cheesekernel", 0,
+                           "Cheese Kernel");
+
+  object_class->get_property = cheese_kernel_get_property;
+  object_class->set_property = cheese_kernel_set_property;
+  object_class->finalize = cheese_kernel_finalize;
+  /* As with videobalance, a look which does nothing is passed through, see
+   * cheese_kernel_update(), and there is no need to touch frames then. */
+  trans_class->transform_ip_on_passthrough = FALSE;
+  filter_class->transform_frame_ip = cheese_kernel_transform_frame_ip;
+
+  properties[PROP_LOOK] = g_param_spec_enum ("look",
+                                             "Look",
+                                             "The look to give the video",
+                                             cheese_kernel_look_get_type (),
+                                             CHEESE_KERNEL_LOOK_NORMAL,
+                                             G_PARAM_READWRITE |
+                                             G_PARAM_STATIC_STRINGS);
+
+  properties[PROP_BRIGHTNESS] = g_param_spec_double ("brightness",
+                                                     "Brightness",
+                                                     "The brightness, as with videobalance",
+                                                     -1.0, 1.0, 0.0,
+                                                     G_PARAM_READWRITE |
+                                                     G_PARAM_STATIC_STRINGS);
+
+  properties[PROP_CONTRAST] = g_param_spec_double ("contrast",
+                                                   "Contrast",
+                                                   "The contrast, as with videobalance",
+                                                   0.0, 2.0, 1.0,
+                                                   G_PARAM_READWRITE |
+                                                   G_PARAM_STATIC_STRINGS);
+
+  properties[PROP_HUE] = g_param_spec_double ("hue",
+                                              "Hue",
+                                              "The hue shift, as with videobalance",
+                                              -1.0, 1.0, 0.0,
+                                              G_PARAM_READWRITE |
+                                              G_PARAM_STATIC_STRINGS);
+
+  properties[PROP_SATURATION] = g_param_spec_double ("saturation",
+                                                     "Saturation",
+                                                     "The saturation, as with videobalance",
+                                                     0.0, 2.0, 1.0,
+                                                     G_PARAM_READWRITE |
+                                                     G_PARAM_STATIC_STRINGS);
+
+  properties[PROP_MIRROR] = g_param_spec_boolean ("mirror",
+                                                  "Mirror",
+                                                  "Whether to mirror the video horizontally",
+                                                  FALSE,
+                                                  G_PARAM_READWRITE |
+                                                  G_PARAM_STATIC_STRINGS);
+
+  g_object_class_install_properties (object_class, PROP_LAST, properties);
+
+  gst_element_class_set_static_metadata (element_class, "Cheese kernel",
+                                         "Filter/Effect/Video",
+                                         "Applies common looks to video in a single pass",
+                                         "Cheese contributors");
+
+  caps = gst_caps_from_string (CHEESE_KERNEL_CAPS);
+  gst_element_class_add_pad_template (element_class,
+                                      gst_pad_template_new ("sink", GST_PAD_SINK,
+                                                            GST_PAD_ALWAYS, caps));
+  gst_element_class_add_pad_template (element_class,
+                                      gst_pad_template_new ("src", GST_PAD_SRC,
+                                                            GST_PAD_ALWAYS, caps));
+  gst_caps_unref (caps);
+}
+
+static void
+cheese_kernel_init (CheeseKernel *kernel)
+{
+  kernel->look = CHEESE_KERNEL_LOOK_NORMAL;
+  kernel->brightness = 0.0;
+  kernel->contrast = 1.0;
+  kernel->hue = 0.0;
+  kernel->saturation = 1.0;
+  kernel->mirror = FALSE;
+  kernel->isa = cheese_kernel_get_isa ();
+
+  GST_DEBUG_OBJECT (kernel, "Using instruction set %d", kernel->isa);
+
+  gst_base_transform_set_in_place (GST_BASE_TRANSFORM (kernel), TRUE);
+
+  cheese_kernel_update (kernel);
+}
+
+/*
+ * cheese_kernel_register:
+ *
+ * Register #CheeseKernel as the cheesekernel element, so that effect
+ * descriptions can use it.
+ *
+ * Returns: %TRUE if the element was registered
+ */
+gboolean
+cheese_kernel_register (void)
+{
+  return gst_element_register (NULL, "cheesekernel", GST_RANK_NONE,
+                               CHEESE_TYPE_KERNEL);
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright © 2026 Cheese contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHEESE_KERNEL_H_
+#define CHEESE_KERNEL_H_
+
+#include <glib.h>
+#include <gst/gst.h>
+#include <gst/video/gstvideofilter.h>
+
+G_BEGIN_DECLS
+
+/*
+ * CheeseKernelLook:
+ * @CHEESE_KERNEL_LOOK_NORMAL: keep the colors
+ * @CHEESE_KERNEL_LOOK_GRAYSCALE: drop the colors
+ * @CHEESE_KERNEL_LOOK_SEPIA: a brown tint on the grays
+ * @CHEESE_KERNEL_LOOK_VINTAGE: faded, warm, washed out colors
+ *
+ * The looks of a #CheeseKernel.
+ */
+typedef enum
+{
+  CHEESE_KERNEL_LOOK_NORMAL,
+  CHEESE_KERNEL_LOOK_GRAYSCALE,
+  CHEESE_KERNEL_LOOK_SEPIA,
+  CHEESE_KERNEL_LOOK_VINTAGE
+} CheeseKernelLook;
+
+/*
+ * CheeseKernelIsa:
+ * @CHEESE_KERNEL_ISA_SCALAR: plain C
+ * @CHEESE_KERNEL_ISA_SSE2: x86 SSE2
+ * @CHEESE_KERNEL_ISA_AVX2: x86 AVX2
+ * @CHEESE_KERNEL_ISA_NEON: ARM NEON
+ *
+ * The instruction sets which the kernels are implemented with.
+ */
+typedef enum
+{
+  CHEESE_KERNEL_ISA_SCALAR,
+  CHEESE_KERNEL_ISA_SSE2,
+  CHEESE_KERNEL_ISA_AVX2,
+  CHEESE_KERNEL_ISA_NEON
+} CheeseKernelIsa;
+
+/*
+ * CheeseKernelParams:
+ * @luma: the table which maps luma values
+ * @matrix: the chroma matrix, in 1/64ths, applied to the chroma values
+ * centered on 0: (u, v) becomes (m[0] u + m[1] v, m[2] u + m[3] v)
+ * @offset: what is added to the chroma values after the matrix
+ * @mirror: whether rows are mirrored
+ *
+ * Every look reduces to a luma table and an affine map of the chroma, which
+ * are applied in a single pass.
+ */
+typedef struct
+{
+  guint8   luma[256];
+  gint16   matrix[4];
+  gint16   offset[2];
+  gboolean mirror;
+} CheeseKernelParams;
+
+#define CHEESE_TYPE_KERNEL cheese_kernel_get_type ()
+G_DECLARE_FINAL_TYPE (CheeseKernel, cheese_kernel, CHEESE, KERNEL, GstVideoFilter)
+
+GType           cheese_kernel_look_get_type (void);
+gboolean        cheese_kernel_register (void);
+
+void            cheese_kernel_params_init (CheeseKernelParams *params,
+                                           CheeseKernelLook    look,
+                                           gdouble             brightness,
+                                           gdouble             contrast,
+                                           gdouble             hue,
+                                           gdouble             saturation,
+                                           gboolean            mirror);
+CheeseKernelIsa cheese_kernel_get_isa (void);
+gboolean        cheese_kernel_isa_supported (CheeseKernelIsa isa);
+void            cheese_kernel_process_luma (const CheeseKernelParams *params,
+                                            const guint8             *src,
+                                            guint8                   *dest,
+                                            gint                      width);
+void            cheese_kernel_process_chroma (CheeseKernelIsa           isa,
+                                              const CheeseKernelParams *params,
+                                              const guint8             *src_u,
+                                              const guint8             *src_v,
+                                              guint8                   *dest_u,
+                                              guint8                   *dest_v,
+                                              gint                      width);
+
+G_END_DECLS
+
+#endif /* CHEESE_KERNEL_H_ */
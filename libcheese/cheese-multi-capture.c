@@ -0,0 +1,877 @@
+/*
+ * Copyright © 2026 Cheese contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+  #include <config.h>
+#endif
+
+#include <glib/gi18n-lib.h>
+#include <gst/gst.h>
+
+#include "cheese-multi-capture.h"
+#include "cheese-encoder-profile.h"
+
+/**
+ * SECTION:cheese-multi-capture
+ * @short_description: Record from several video capture devices at once
+ * @stability: Unstable
+ * @include: cheese/cheese-multi-capture.h
+ *
+ * #CheeseMultiCapture records from several #CheeseCameraDevice objects in a
+ * single pipeline, so that all streams share one clock. The streams are
+ * either written to separate Matroska files with a common time base, or
+ * composited into a mosaic and written to a single file.
+ */
+
+GST_DEBUG_CATEGORY_STATIC (cheese_multi_capture_cat);
+#define GST_CAT_DEFAULT cheese_multi_capture_cat
+
+/* The size of a stream in a mosaic. */
+#define CHEESE_MULTI_CAPTURE_TILE_WIDTH 640
+#define CHEESE_MULTI_CAPTURE_TILE_HEIGHT 480
+
+enum
+{
+  FINISHED,
+  LAST_SIGNAL
+};
+
+enum
+{
+  PROP_0,
+  PROP_DEVICES,
+  PROP_MOSAIC,
+  PROP_LAST
+};
+
+static guint signals[LAST_SIGNAL];
+static GParamSpec *properties[PROP_LAST];
+
+typedef struct
+{
+  CheeseCameraDevice *device;
+  gchar *location;
+  guint64 frames;
+  guint64 bytes;
+  GstClockTime first_timestamp;
+  GstClockTime last_timestamp;
+} CheeseMultiCaptureStream;
+
+typedef struct
+{
+  GPtrArray *devices;
+  gboolean mosaic;
+
+  GstElement *pipeline;
+  guint bus_watch;
+
+  /* Updated from the streaming threads of the sources. */
+  GMutex stats_lock;
+  CheeseMultiCaptureStream *streams;
+  guint n_streams;
+} CheeseMultiCapturePrivate;
+
+G_DEFINE_TYPE_WITH_PRIVATE (CheeseMultiCapture, cheese_multi_capture,
+                            G_TYPE_OBJECT)
+
+/*
+ * cheese_multi_capture_make:
+ * @factoryname: the element to create
+ * @error: return location for an error, set if @factoryname is missing
+ *
+ * Returns: (transfer floating): a new element, or %NULL
+ */
+static GstElement *
+cheese_multi_capture_make (const gchar *factoryname, GError **error)
+{
+  GstElement *element;
+
+  element = gst_element_factory_make (factoryname, NULL);
+  if (element == NULL && error != NULL && *error == NULL)
+    g_set_error (error, GST_CORE_ERROR, GST_CORE_ERROR_MISSING_PLUGIN,
+                 "%s%s.", _("One or more needed GStreamer elements are missing: "),
+                 factoryname);
+
+  return element;
+}
+
+/*
+ * cheese_multi_capture_pick_caps:
+ * @device: a #CheeseCameraDevice
+ * @is_jpeg: (out): whether the returned caps are JPEG
+ *
+ * Pick the caps of the best format of @device, preferring JPEG, which can be
+ * recorded as it is and takes less bandwidth from the devices.
+ *
+ * Returns: (transfer full): the caps to capture with
+ */
+static GstCaps *
+cheese_multi_capture_pick_caps (CheeseCameraDevice *device, gboolean *is_jpeg)
+{
+  CheeseVideoFormat *format;
+  GstCaps *caps, *picked;
+  guint i;
+
+  format = cheese_camera_device_get_best_format (device);
+  caps = cheese_camera_device_get_caps_for_format (device, format);
+  g_boxed_free (CHEESE_TYPE_VIDEO_FORMAT, format);
+
+  picked = gst_caps_new_empty ();
+  for (i = 0; i < gst_caps_get_size (caps); i++)
+  {
+    GstStructure *structure = gst_caps_get_structure (caps, i);
+
+    if (gst_structure_has_name (structure, "image/jpeg"))
+      gst_caps_append_structure (picked, gst_structure_copy (structure));
+  }
+
+  *is_jpeg = !gst_caps_is_empty (picked);
+  if (!*is_jpeg)
+  {
+    gst_caps_unref (picked);
+    return caps;
+  }
+
+  gst_caps_unref (caps);
+  return picked;
+}
+
+/*
+ * cheese_multi_capture_get_columns:
+ * @n_streams: the number of streams in the mosaic
+ *
+ * Returns: the number of columns of the smallest square grid which holds
+ * @n_streams tiles
+ */
+static guint
+cheese_multi_capture_get_columns (guint n_streams)
+{
+  guint columns = 1;
+
+  while (columns * columns < n_streams)
+    columns++;
+
+  return columns;
+}
+
+/*
+ * cheese_multi_capture_make_encoder:
+ * @width: the width of the video
+ * @height: the height of the video
+ * @error: return location for an error
+ *
+ * Returns: (transfer floating): a video encoder of the default profile,
+ * configured for the size, or %NULL
+ */
+static GstElement *
+cheese_multi_capture_make_encoder (gint width, gint height, GError **error)
+{
+  const CheeseEncoderProfile *profile;
+  const gchar *factoryname;
+  GstElement *encoder;
+
+  profile = cheese_encoder_profile_lookup (CHEESE_ENCODER_PROFILE_DEFAULT);
+  factoryname = cheese_encoder_profile_find_encoder (profile);
+  if (factoryname == NULL)
+    factoryname = "vp8enc";
+
+  encoder = cheese_multi_capture_make (factoryname, error);
+  if (encoder != NULL)
+    cheese_encoder_profile_configure (encoder, width, height);
+
+  return encoder;
+}
+
+/*
+ * cheese_multi_capture_add_file:
+ * @bin: the #GstBin to add to
+ * @location: the file to write
+ * @error: return location for an error
+ *
+ * Add a matroskamux ! filesink to @bin.
+ *
+ * Returns: (transfer none): the muxer, or %NULL
+ */
+static GstElement *
+cheese_multi_capture_add_file (GstBin *bin, const gchar *location,
+                               GError **error)
+{
+  GstElement *mux, *sink;
+
+  mux = cheese_multi_capture_make ("matroskamux", error);
+  sink = cheese_multi_capture_make ("filesink", error);
+  if (mux == NULL || sink == NULL)
+  {
+    g_clear_object (&mux);
+    g_clear_object (&sink);
+    return NULL;
+  }
+
+  g_object_set (G_OBJECT (sink), "location", location, NULL);
+  gst_bin_add_many (bin, mux, sink, NULL);
+  gst_element_link (mux, sink);
+
+  return mux;
+}
+
+/*
+ * cheese_multi_capture_stats_probe:
+ * @pad: the source pad of the capsfilter of a stream
+ * @info: the #GstPadProbeInfo
+ * @stream: the #CheeseMultiCaptureStream of @pad
+ *
+ * Count the frames of a stream.
+ *
+ * Returns: %GST_PAD_PROBE_OK
+ */
+static GstPadProbeReturn
+cheese_multi_capture_stats_probe (GstPad *pad, GstPadProbeInfo *info,
+                                  CheeseMultiCaptureStream *stream)
+{
+  CheeseMultiCapture *capture;
+  CheeseMultiCapturePrivate *priv;
+  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+
+  capture = g_object_get_data (G_OBJECT (pad), "cheese-multi-capture");
+  priv = cheese_multi_capture_get_instance_private (capture);
+
+  g_mutex_lock (&priv->stats_lock);
+  stream->frames++;
+  stream->bytes += gst_buffer_get_size (buffer);
+  if (GST_BUFFER_PTS_IS_VALID (buffer))
+  {
+    if (!GST_CLOCK_TIME_IS_VALID (stream->first_timestamp))
+      stream->first_timestamp = GST_BUFFER_PTS (buffer);
+    stream->last_timestamp = GST_BUFFER_PTS (buffer);
+  }
+  g_mutex_unlock (&priv->stats_lock);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/*
+ * cheese_multi_capture_add_stream:
+ * @capture: a #CheeseMultiCapture
+ * @index: the index of the stream
+ * @sink: (allow-none): the element to link the raw stream to, for a mosaic
+ * @location: (allow-none): the file to write the stream to, for separate
+ * files
+ * @error: return location for an error
+ *
+ * Add src ! capsfilter ! queue for the device of the stream to the pipeline.
+ * For separate files, JPEG is written as it is and raw video is encoded;
+ * for a mosaic, the stream is decoded and scaled to a tile.
+ *
+ * Returns: %TRUE on success
+ */
+static gboolean
+cheese_multi_capture_add_stream (CheeseMultiCapture *capture, guint index,
+                                 GstElement *sink, const gchar *location,
+                                 GError **error)
+{
+  CheeseMultiCapturePrivate *priv = cheese_multi_capture_get_instance_private (capture);
+  CheeseMultiCaptureStream *stream = &priv->streams[index];
+  GstBin *bin = GST_BIN (priv->pipeline);
+  GstElement *src, *filter, *queue, *last;
+  GstCaps *caps;
+  GstPad *pad;
+  gboolean is_jpeg;
+
+  src = cheese_camera_device_get_src (stream->device);
+  filter = cheese_multi_capture_make ("capsfilter", error);
+  queue = cheese_multi_capture_make ("queue", error);
+  if (src == NULL || filter == NULL || queue == NULL)
+  {
+    if (src == NULL && error != NULL && *error == NULL)
+      g_set_error (error, GST_CORE_ERROR, GST_CORE_ERROR_FAILED,
+                   "Could not open %s",
+                   cheese_camera_device_get_name (stream->device));
+    g_clear_object (&src);
+    g_clear_object (&filter);
+    g_clear_object (&queue);
+    return FALSE;
+  }
+
+  caps = cheese_multi_capture_pick_caps (stream->device, &is_jpeg);
+  g_object_set (G_OBJECT (filter), "caps", caps, NULL);
+  gst_caps_unref (caps);
+
+  pad = gst_element_get_static_pad (filter, "src");
+  g_object_set_data (G_OBJECT (pad), "cheese-multi-capture", capture);
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER,
+                     (GstPadProbeCallback) cheese_multi_capture_stats_probe,
+                     stream, NULL);
+  gst_object_unref (pad);
+
+  gst_bin_add_many (bin, src, filter, queue, NULL);
+  gst_element_link_many (src, filter, queue, NULL);
+  last = queue;
+
+  if (sink == NULL)
+  {
+    CheeseVideoFormat *format;
+    GstElement *mux;
+
+    stream->location = g_strdup (location);
+    mux = cheese_multi_capture_add_file (bin, location, error);
+    if (mux == NULL)
+      return FALSE;
+
+    if (!is_jpeg)
+    {
+      GstElement *convert, *encoder;
+
+      format = cheese_camera_device_get_best_format (stream->device);
+      convert = cheese_multi_capture_make ("videoconvert", error);
+      encoder = cheese_multi_capture_make_encoder (format->width,
+                                                   format->height, error);
+      g_boxed_free (CHEESE_TYPE_VIDEO_FORMAT, format);
+      if (convert == NULL || encoder == NULL)
+      {
+        g_clear_object (&convert);
+        g_clear_object (&encoder);
+        return FALSE;
+      }
+
+      gst_bin_add_many (bin, convert, encoder, NULL);
+      gst_element_link_many (last, convert, encoder, NULL);
+      last = encoder;
+    }
+
+    return gst_element_link (last, mux);
+  }
+  else
+  {
+    GstElement *decoder = NULL, *convert, *scale, *tile;
+    guint columns;
+
+    if (is_jpeg)
+      decoder = cheese_multi_capture_make ("jpegdec", error);
+    convert = cheese_multi_capture_make ("videoconvert", error);
+    scale = cheese_multi_capture_make ("videoscale", error);
+    tile = cheese_multi_capture_make ("capsfilter", error);
+    if ((is_jpeg && decoder == NULL) || convert == NULL || scale == NULL ||
+        tile == NULL)
+    {
+      g_clear_object (&decoder);
+      g_clear_object (&convert);
+      g_clear_object (&scale);
+      g_clear_object (&tile);
+      return FALSE;
+    }
+
+    caps = gst_caps_new_simple ("video/x-raw",
+                                "width", G_TYPE_INT, CHEESE_MULTI_CAPTURE_TILE_WIDTH,
+                                "height", G_TYPE_INT, CHEESE_MULTI_CAPTURE_TILE_HEIGHT,
+                                NULL);
+    g_object_set (G_OBJECT (tile), "caps", caps, NULL);
+    gst_caps_unref (caps);
+
+    if (decoder != NULL)
+    {
+      gst_bin_add (bin, decoder);
+      gst_element_link (last, decoder);
+      last = decoder;
+    }
+    gst_bin_add_many (bin, convert, scale, tile, NULL);
+    gst_element_link_many (last, convert, scale, tile, NULL);
+
+    /* Lay the streams out in rows of a square grid. */
+    columns = cheese_multi_capture_get_columns (priv->n_streams);
+    pad = gst_element_get_request_pad (sink, "sink_%u");
+    g_object_set (G_OBJECT (pad),
+                  "xpos", (index % columns) * CHEESE_MULTI_CAPTURE_TILE_WIDTH,
+                  "ypos", (index / columns) * CHEESE_MULTI_CAPTURE_TILE_HEIGHT,
+                  NULL);
+    gst_element_link_pads (tile, "src", sink, GST_OBJECT_NAME (pad));
+    gst_object_unref (pad);
+
+    return TRUE;
+  }
+}
+
+/*
+ * cheese_multi_capture_build:
+ * @capture: a #CheeseMultiCapture
+ * @location: the file, or the prefix of the files, to write
+ * @error: return location for an error
+ *
+ * Build the pipeline for all streams.
+ *
+ * Returns: %TRUE on success
+ */
+static gboolean
+cheese_multi_capture_build (CheeseMultiCapture *capture, const gchar *location,
+                            GError **error)
+{
+  CheeseMultiCapturePrivate *priv = cheese_multi_capture_get_instance_private (capture);
+  GstElement *compositor = NULL;
+  guint i;
+
+  priv->pipeline = gst_pipeline_new ("multi_capture");
+  gst_object_ref_sink (priv->pipeline);
+
+  if (priv->mosaic)
+  {
+    GstElement *convert, *encoder, *mux;
+    guint columns, rows;
+
+    columns = cheese_multi_capture_get_columns (priv->n_streams);
+    rows = (priv->n_streams + columns - 1) / columns;
+
+    compositor = cheese_multi_capture_make ("compositor", error);
+    convert = cheese_multi_capture_make ("videoconvert", error);
+    encoder = cheese_multi_capture_make_encoder (columns * CHEESE_MULTI_CAPTURE_TILE_WIDTH,
+                                                 rows * CHEESE_MULTI_CAPTURE_TILE_HEIGHT,
+                                                 error);
+    if (compositor == NULL || convert == NULL || encoder == NULL)
+    {
+      g_clear_object (&compositor);
+      g_clear_object (&convert);
+      g_clear_object (&encoder);
+      return FALSE;
+    }
+
+    gst_bin_add_many (GST_BIN (priv->pipeline), compositor, convert, encoder,
+                      NULL);
+    mux = cheese_multi_capture_add_file (GST_BIN (priv->pipeline), location,
+                                         error);
+    if (mux == NULL)
+      return FALSE;
+    gst_element_link_many (compositor, convert, encoder, mux, NULL);
+  }
+
+  for (i = 0; i < priv->n_streams; i++)
+  {
+    gchar *stream_location = NULL;
+    gboolean ok;
+
+    if (compositor == NULL)
+      stream_location = g_strdup_printf ("%s-%u.mkv", location, i + 1);
+
+    ok = cheese_multi_capture_add_stream (capture, i, compositor,
+                                          stream_location, error);
+    g_free (stream_location);
+    if (!ok)
+    {
+      if (error != NULL && *error == NULL)
+        g_set_error (error, GST_CORE_ERROR, GST_CORE_ERROR_NEGOTIATION,
+                     "Could not link the stream of %s",
+                     cheese_camera_device_get_name (priv->streams[i].device));
+      return FALSE;
+    }
+  }
+
+  if (compositor != NULL)
+    priv->streams[0].location = g_strdup (location);
+
+  return TRUE;
+}
+
+/*
+ * cheese_multi_capture_reset:
+ * @capture: a #CheeseMultiCapture
+ *
+ * Tear down the pipeline, if any.
+ */
+static void
+cheese_multi_capture_reset (CheeseMultiCapture *capture)
+{
+  CheeseMultiCapturePrivate *priv = cheese_multi_capture_get_instance_private (capture);
+
+  if (priv->bus_watch != 0)
+  {
+    g_source_remove (priv->bus_watch);
+    priv->bus_watch = 0;
+  }
+
+  if (priv->pipeline != NULL)
+  {
+    gst_element_set_state (priv->pipeline, GST_STATE_NULL);
+    g_clear_object (&priv->pipeline);
+  }
+}
+
+/*
+ * cheese_multi_capture_bus_cb:
+ * @bus: the #GstBus of the pipeline
+ * @message: a #GstMessage
+ * @data: a #CheeseMultiCapture
+ *
+ * Finish the capture once all files are complete, or on an error.
+ *
+ * Returns: %G_SOURCE_CONTINUE while the capture runs
+ */
+static gboolean
+cheese_multi_capture_bus_cb (GstBus *bus, GstMessage *message, gpointer data)
+{
+  CheeseMultiCapture *capture = CHEESE_MULTI_CAPTURE (data);
+  CheeseMultiCapturePrivate *priv = cheese_multi_capture_get_instance_private (capture);
+
+  switch (GST_MESSAGE_TYPE (message))
+  {
+    case GST_MESSAGE_ERROR:
+    {
+      GError *err = NULL;
+      gchar *debug = NULL;
+
+      gst_message_parse_error (message, &err, &debug);
+      g_warning ("%s: %s", err->message, debug);
+      g_error_free (err);
+      g_free (debug);
+    }
+      /* Fall through. */
+    case GST_MESSAGE_EOS:
+      priv->bus_watch = 0;
+      cheese_multi_capture_reset (capture);
+      g_signal_emit (capture, signals[FINISHED], 0);
+      return G_SOURCE_REMOVE;
+    default:
+      return G_SOURCE_CONTINUE;
+  }
+}
+
+/**
+ * cheese_multi_capture_start:
+ * @capture: a #CheeseMultiCapture
+ * @location: (type filename): for a mosaic, the file to write; otherwise the
+ * prefix of the files to write, to which "-1.mkv", "-2.mkv" and so on are
+ * appended for each device
+ * @error: return location for an error, or %NULL
+ *
+ * Start recording from all devices of @capture, on the clock of a single
+ * pipeline.
+ *
+ * Returns: %TRUE if the capture started, %FALSE and sets @error otherwise
+ */
+gboolean
+cheese_multi_capture_start (CheeseMultiCapture *capture,
+                            const gchar        *location,
+                            GError            **error)
+{
+  CheeseMultiCapturePrivate *priv;
+  GstBus *bus;
+  guint i;
+
+  g_return_val_if_fail (CHEESE_IS_MULTI_CAPTURE (capture), FALSE);
+  g_return_val_if_fail (location != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  priv = cheese_multi_capture_get_instance_private (capture);
+
+  g_return_val_if_fail (priv->pipeline == NULL, FALSE);
+
+  for (i = 0; i < priv->n_streams; i++)
+  {
+    CheeseMultiCaptureStream *stream = &priv->streams[i];
+
+    g_clear_pointer (&stream->location, g_free);
+    stream->frames = 0;
+    stream->bytes = 0;
+    stream->first_timestamp = GST_CLOCK_TIME_NONE;
+    stream->last_timestamp = GST_CLOCK_TIME_NONE;
+  }
+
+  if (!cheese_multi_capture_build (capture, location, error))
+  {
+    cheese_multi_capture_reset (capture);
+    return FALSE;
+  }
+
+  bus = gst_element_get_bus (priv->pipeline);
+  priv->bus_watch = gst_bus_add_watch (bus, cheese_multi_capture_bus_cb,
+                                       capture);
+  gst_object_unref (bus);
+
+  if (gst_element_set_state (priv->pipeline, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE)
+  {
+    g_set_error (error, GST_CORE_ERROR, GST_CORE_ERROR_STATE_CHANGE,
+                 "Could not start capturing from the devices");
+    cheese_multi_capture_reset (capture);
+    return FALSE;
+  }
+
+  GST_INFO ("Capturing from %u devices", priv->n_streams);
+
+  return TRUE;
+}
+
+/**
+ * cheese_multi_capture_stop:
+ * @capture: a #CheeseMultiCapture
+ *
+ * Stop recording. The ::finished signal is emitted once the files are
+ * complete.
+ */
+void
+cheese_multi_capture_stop (CheeseMultiCapture *capture)
+{
+  CheeseMultiCapturePrivate *priv;
+
+  g_return_if_fail (CHEESE_IS_MULTI_CAPTURE (capture));
+
+  priv = cheese_multi_capture_get_instance_private (capture);
+
+  if (priv->pipeline != NULL)
+    gst_element_send_event (priv->pipeline, gst_event_new_eos ());
+}
+
+/**
+ * cheese_multi_capture_is_running:
+ * @capture: a #CheeseMultiCapture
+ *
+ * Returns: %TRUE between cheese_multi_capture_start() and the ::finished
+ * signal
+ */
+gboolean
+cheese_multi_capture_is_running (CheeseMultiCapture *capture)
+{
+  CheeseMultiCapturePrivate *priv;
+
+  g_return_val_if_fail (CHEESE_IS_MULTI_CAPTURE (capture), FALSE);
+
+  priv = cheese_multi_capture_get_instance_private (capture);
+
+  return priv->pipeline != NULL;
+}
+
+/**
+ * cheese_multi_capture_get_n_streams:
+ * @capture: a #CheeseMultiCapture
+ *
+ * Returns: the number of devices @capture records from
+ */
+guint
+cheese_multi_capture_get_n_streams (CheeseMultiCapture *capture)
+{
+  CheeseMultiCapturePrivate *priv;
+
+  g_return_val_if_fail (CHEESE_IS_MULTI_CAPTURE (capture), 0);
+
+  priv = cheese_multi_capture_get_instance_private (capture);
+
+  return priv->n_streams;
+}
+
+/**
+ * cheese_multi_capture_get_stats:
+ * @capture: a #CheeseMultiCapture
+ * @index: the index of the device in the array passed to
+ * cheese_multi_capture_new()
+ *
+ * Get the statistics of a stream of the current or last capture, with the
+ * fields "device" (the name of the device), "location" (the file written, or
+ * %NULL for the streams after the first of a mosaic), "frames" and "bytes"
+ * (the frames captured), "framerate" (the average frame rate) and
+ * "timestamp" (the running time of the last frame, to compare the streams
+ * with each other).
+ *
+ * Returns: (transfer full): a new #GstStructure
+ */
+GstStructure *
+cheese_multi_capture_get_stats (CheeseMultiCapture *capture, guint index)
+{
+  CheeseMultiCapturePrivate *priv;
+  CheeseMultiCaptureStream *stream;
+  GstStructure *stats;
+  gdouble framerate = 0.0;
+
+  g_return_val_if_fail (CHEESE_IS_MULTI_CAPTURE (capture), NULL);
+
+  priv = cheese_multi_capture_get_instance_private (capture);
+
+  g_return_val_if_fail (index < priv->n_streams, NULL);
+
+  stream = &priv->streams[index];
+
+  g_mutex_lock (&priv->stats_lock);
+  if (stream->frames > 1 && stream->last_timestamp > stream->first_timestamp)
+    framerate = (stream->frames - 1) * (gdouble) GST_SECOND /
+                (stream->last_timestamp - stream->first_timestamp);
+
+  stats = gst_structure_new ("cheese-multi-capture-stats",
+                             "device", G_TYPE_STRING,
+                             cheese_camera_device_get_name (stream->device),
+                             "location", G_TYPE_STRING, stream->location,
+                             "frames", G_TYPE_UINT64, stream->frames,
+                             "bytes", G_TYPE_UINT64, stream->bytes,
+                             "framerate", G_TYPE_DOUBLE, framerate,
+                             "timestamp", G_TYPE_UINT64, stream->last_timestamp,
+                             NULL);
+  g_mutex_unlock (&priv->stats_lock);
+
+  return stats;
+}
+
+static void
+cheese_multi_capture_get_property (GObject *object, guint property_id,
+                                   GValue *value, GParamSpec *pspec)
+{
+  CheeseMultiCapturePrivate *priv = cheese_multi_capture_get_instance_private (CHEESE_MULTI_CAPTURE (object));
+
+  switch (property_id)
+  {
+    case PROP_DEVICES:
+      g_value_set_boxed (value, priv->devices);
+      break;
+    case PROP_MOSAIC:
+      g_value_set_boolean (value, priv->mosaic);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+  }
+}
+
+static void
+cheese_multi_capture_set_property (GObject *object, guint property_id,
+                                   const GValue *value, GParamSpec *pspec)
+{
+  CheeseMultiCapturePrivate *priv = cheese_multi_capture_get_instance_private (CHEESE_MULTI_CAPTURE (object));
+
+  switch (property_id)
+  {
+    case PROP_DEVICES:
+    {
+      GPtrArray *devices = g_value_get_boxed (value);
+      guint i;
+
+      priv->devices = g_ptr_array_new_with_free_func (g_object_unref);
+      for (i = 0; devices != NULL && i < devices->len; i++)
+        g_ptr_array_add (priv->devices,
+                         g_object_ref (g_ptr_array_index (devices, i)));
+
+      priv->n_streams = priv->devices->len;
+      priv->streams = g_new0 (CheeseMultiCaptureStream, priv->n_streams);
+      for (i = 0; i < priv->n_streams; i++)
+      {
+        priv->streams[i].device = g_ptr_array_index (priv->devices, i);
+        priv->streams[i].first_timestamp = GST_CLOCK_TIME_NONE;
+        priv->streams[i].last_timestamp = GST_CLOCK_TIME_NONE;
+      }
+      break;
+    }
+    case PROP_MOSAIC:
+      priv->mosaic = g_value_get_boolean (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+  }
+}
+
+static void
+cheese_multi_capture_finalize (GObject *object)
+{
+  CheeseMultiCapture *capture = CHEESE_MULTI_CAPTURE (object);
+  CheeseMultiCapturePrivate *priv = cheese_multi_capture_get_instance_private (capture);
+  guint i;
+
+  cheese_multi_capture_reset (capture);
+
+  for (i = 0; i < priv->n_streams; i++)
+    g_free (priv->streams[i].location);
+  g_free (priv->streams);
+  g_clear_pointer (&priv->devices, g_ptr_array_unref);
+  g_mutex_clear (&priv->stats_lock);
+
+  G_OBJECT_CLASS (cheese_multi_capture_parent_class)->finalize (object);
+}
+
+static void
+cheese_multi_capture_class_init (CheeseMultiCaptureClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT (cheese_multi_capture_cat, "cheese-multi-capture",
+                           0, "Cheese Multi Capture");
+
+  object_class->get_property = cheese_multi_capture_get_property;
+  object_class->set_property = cheese_multi_capture_set_property;
+  object_class->finalize = cheese_multi_capture_finalize;
+
+  /**
+   * CheeseMultiCapture::finished:
+   * @capture: a #CheeseMultiCapture
+   *
+   * Emitted when the capture stopped, after cheese_multi_capture_stop() once
+   * the files are complete, or on an error.
+   */
+  signals[FINISHED] = g_signal_new ("finished", G_OBJECT_CLASS_TYPE (klass),
+                                    G_SIGNAL_RUN_LAST,
+                                    0, NULL, NULL,
+                                    g_cclosure_marshal_VOID__VOID,
+                                    G_TYPE_NONE, 0);
+
+  /**
+   * CheeseMultiCapture:devices:
+   *
+   * The #CheeseCameraDevice objects to record from.
+   */
+  properties[PROP_DEVICES] = g_param_spec_boxed ("devices",
+                                                 "Devices",
+                                                 "The devices to record from",
+                                                 G_TYPE_PTR_ARRAY,
+                                                 G_PARAM_READWRITE |
+                                                 G_PARAM_CONSTRUCT_ONLY |
+                                                 G_PARAM_STATIC_STRINGS);
+
+  /**
+   * CheeseMultiCapture:mosaic:
+   *
+   * Whether to composite the streams into a mosaic in a single file, rather
+   * than writing a file for each device.
+   */
+  properties[PROP_MOSAIC] = g_param_spec_boolean ("mosaic",
+                                                  "Mosaic",
+                                                  "Whether to composite the streams into a single file",
+                                                  FALSE,
+                                                  G_PARAM_READWRITE |
+                                                  G_PARAM_CONSTRUCT_ONLY |
+                                                  G_PARAM_STATIC_STRINGS);
+
+  g_object_class_install_properties (object_class, PROP_LAST, properties);
+}
+
+static void
+cheese_multi_capture_init (CheeseMultiCapture *capture)
+{
+  CheeseMultiCapturePrivate *priv = cheese_multi_capture_get_instance_private (capture);
+
+  g_mutex_init (&priv->stats_lock);
+}
+
+/**
+ * cheese_multi_capture_new:
+ * @devices: (element-type CheeseCameraDevice): the devices to record from
+ * @mosaic: whether to composite the streams into a single file
+ *
+ * Create a new #CheeseMultiCapture for @devices, which can be stand-in
+ * devices as well as webcams. The devices must not be in use by a
+ * #CheeseCamera at the same time.
+ *
+ * Returns: a new #CheeseMultiCapture
+ */
+CheeseMultiCapture *
+cheese_multi_capture_new (GPtrArray *devices, gboolean mosaic)
+{
+  return g_object_new (CHEESE_TYPE_MULTI_CAPTURE,
+                       "devices", devices,
+                       "mosaic", mosaic,
+                       NULL);
+}
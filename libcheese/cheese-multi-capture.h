@@ -0,0 +1,59 @@
+/*
+ * Copyright © 2026 Cheese contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHEESE_MULTI_CAPTURE_H_
+#define CHEESE_MULTI_CAPTURE_H_
+
+#include <glib-object.h>
+#include <gst/gst.h>
+
+#include <cheese-camera-device.h>
+
+G_BEGIN_DECLS
+
+/**
+ * CheeseMultiCapture:
+ *
+ * Use the accessor functions below.
+ */
+struct _CheeseMultiCapture
+{
+  /*< private >*/
+  GObject parent;
+  void *unused;
+};
+
+#define CHEESE_TYPE_MULTI_CAPTURE (cheese_multi_capture_get_type ())
+G_DECLARE_FINAL_TYPE (CheeseMultiCapture, cheese_multi_capture, CHEESE,
+                      MULTI_CAPTURE, GObject)
+
+CheeseMultiCapture *cheese_multi_capture_new (GPtrArray *devices,
+                                              gboolean   mosaic);
+gboolean            cheese_multi_capture_start (CheeseMultiCapture *capture,
+                                                const gchar        *location,
+                                                GError            **error);
+void                cheese_multi_capture_stop (CheeseMultiCapture *capture);
+gboolean            cheese_multi_capture_is_running (CheeseMultiCapture *capture);
+guint               cheese_multi_capture_get_n_streams (CheeseMultiCapture *capture);
+GstStructure       *cheese_multi_capture_get_stats (CheeseMultiCapture *capture,
+                                                    guint               index);
+
+G_END_DECLS
+
+#endif /* CHEESE_MULTI_CAPTURE_H_ */
@@ -0,0 +1,103 @@
+/*
+ * Copyright © 2026 Cheese contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+  #include <config.h>
+#endif
+
+#include <glib.h>
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include "cheese-pixbuf.h"
+
+/*
+ * cheese_pixbuf_frame_free:
+ * @pixels: the pixel data of the pixbuf
+ * @data: the #GstVideoFrame which @pixels belongs to
+ *
+ * Unmap the frame backing a pixbuf, which also drops the reference on its
+ * #GstBuffer.
+ */
+static void
+cheese_pixbuf_frame_free (guchar *pixels, gpointer data)
+{
+  GstVideoFrame *frame = data;
+
+  gst_video_frame_unmap (frame);
+  g_slice_free (GstVideoFrame, frame);
+}
+
+/*
+ * cheese_pixbuf_new_from_sample:
+ * @sample: a #GstSample of RGB or RGBA video
+ *
+ * Create a #GdkPixbuf directly over the mapped buffer of @sample, without
+ * copying it, using the stride from its #GstVideoMeta. The buffer stays
+ * mapped for as long as the pixbuf lives.
+ *
+ * Returns: (transfer full): a new #GdkPixbuf, or %NULL if @sample cannot be
+ * wrapped
+ */
+GdkPixbuf *
+cheese_pixbuf_new_from_sample (GstSample *sample)
+{
+  GstVideoInfo   info;
+  GstVideoFrame *frame;
+  gboolean       has_alpha;
+  const gint     bits_per_sample = 8;
+
+  if (!gst_video_info_from_caps (&info, gst_sample_get_caps (sample)))
+  {
+    g_warning ("Could not parse the photo preview caps");
+    return NULL;
+  }
+
+  switch (GST_VIDEO_INFO_FORMAT (&info))
+  {
+    case GST_VIDEO_FORMAT_RGB:
+      has_alpha = FALSE;
+      break;
+    case GST_VIDEO_FORMAT_RGBA:
+      has_alpha = TRUE;
+      break;
+    default:
+      g_warning ("Unsupported photo preview format %s",
+                 GST_VIDEO_INFO_NAME (&info));
+      return NULL;
+  }
+
+  frame = g_slice_new (GstVideoFrame);
+
+  if (!gst_video_frame_map (frame, &info, gst_sample_get_buffer (sample),
+                            GST_MAP_READ))
+  {
+    g_slice_free (GstVideoFrame, frame);
+    g_warning ("Could not map the photo preview buffer");
+    return NULL;
+  }
+
+  return gdk_pixbuf_new_from_data (GST_VIDEO_FRAME_PLANE_DATA (frame, 0),
+                                   GDK_COLORSPACE_RGB, has_alpha,
+                                   bits_per_sample,
+                                   GST_VIDEO_FRAME_WIDTH (frame),
+                                   GST_VIDEO_FRAME_HEIGHT (frame),
+                                   GST_VIDEO_FRAME_PLANE_STRIDE (frame, 0),
+                                   cheese_pixbuf_frame_free, frame);
+}
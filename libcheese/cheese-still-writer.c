@@ -0,0 +1,323 @@
+/*
+ * Copyright © 2026 Cheese contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+  #include <config.h>
+#endif
+
+#include <glib.h>
+#include <glib/gi18n-lib.h>
+#include <gst/gst.h>
+#include <gst/app/gstappsrc.h>
+
+#include "cheese-still-writer.h"
+
+/*
+ * CheeseStillWriter saves single frames as JPEG files, outside of camerabin.
+ * Frames which are already JPEG-compressed are only muxed with their tags,
+ * raw frames are encoded first. Every frame is written by a short-lived
+ * pipeline in a pool of worker threads, so that several photos can be
+ * encoded in parallel without blocking the caller.
+ */
+
+struct _CheeseStillWriter
+{
+  GThreadPool *pool;
+};
+
+typedef struct
+{
+  GstSample            *sample;
+  gchar                *filename;
+  GstTagList           *tags;
+  CheeseStillWriterFunc func;
+  gpointer              user_data;
+  GMainContext         *context;
+  GError               *error;
+} CheeseStillWriterJob;
+
+GST_DEBUG_CATEGORY_STATIC (cheese_still_writer_cat);
+#define GST_CAT_DEFAULT cheese_still_writer_cat
+
+static void
+cheese_still_writer_job_free (CheeseStillWriterJob *job)
+{
+  gst_sample_unref (job->sample);
+  g_free (job->filename);
+  if (job->tags != NULL)
+    gst_tag_list_unref (job->tags);
+  g_main_context_unref (job->context);
+  g_clear_error (&job->error);
+  g_slice_free (CheeseStillWriterJob, job);
+}
+
+/*
+ * cheese_still_writer_job_done:
+ * @data: a #CheeseStillWriterJob
+ *
+ * Report the result of a job in the main context of its caller.
+ *
+ * Returns: %G_SOURCE_REMOVE
+ */
+static gboolean
+cheese_still_writer_job_done (gpointer data)
+{
+  CheeseStillWriterJob *job = data;
+
+  if (job->func != NULL)
+    job->func (job->filename, job->error, job->user_data);
+
+  return G_SOURCE_REMOVE;
+}
+
+/*
+ * cheese_still_writer_make:
+ * @factoryname: the element to create
+ * @error: return location for errors
+ *
+ * Create an element for a writer pipeline.
+ *
+ * Returns: (transfer floating): the new #GstElement, or %NULL
+ */
+static GstElement *
+cheese_still_writer_make (const gchar *factoryname, GError **error)
+{
+  GstElement *element;
+
+  element = gst_element_factory_make (factoryname, NULL);
+  if (element == NULL && error != NULL && *error == NULL)
+    g_set_error (error, GST_CORE_ERROR, GST_CORE_ERROR_MISSING_PLUGIN,
+                 "%s%s.", _("One or more needed GStreamer elements are missing: "),
+                 factoryname);
+
+  return element;
+}
+
+/*
+ * cheese_still_writer_write_file:
+ * @job: the job to run
+ * @buffer: the compressed frame
+ *
+ * Write a JPEG frame to disk as-is, for when there is no muxer to inject the
+ * tags.
+ */
+static void
+cheese_still_writer_write_file (CheeseStillWriterJob *job, GstBuffer *buffer)
+{
+  GstMapInfo mapinfo;
+
+  if (!gst_buffer_map (buffer, &mapinfo, GST_MAP_READ))
+  {
+    g_set_error_literal (&job->error, GST_RESOURCE_ERROR,
+                         GST_RESOURCE_ERROR_READ, "Could not map the frame");
+    return;
+  }
+
+  g_file_set_contents (job->filename, (const gchar *) mapinfo.data,
+                       mapinfo.size, &job->error);
+  gst_buffer_unmap (buffer, &mapinfo);
+}
+
+/*
+ * cheese_still_writer_run:
+ * @data: the #CheeseStillWriterJob to run
+ * @user_data: the #CheeseStillWriter
+ *
+ * Write a single frame with an appsrc ! [videoconvert ! jpegenc !] jifmux !
+ * filesink pipeline, and wait for it to finish.
+ */
+static void
+cheese_still_writer_run (gpointer data, gpointer user_data)
+{
+  CheeseStillWriterJob *job = data;
+  GstElement *pipeline, *src, *mux, *sink;
+  GstElement *convert = NULL, *encoder = NULL;
+  GstCaps    *caps;
+  GstBuffer  *buffer;
+  GstBus     *bus;
+  GstMessage *message;
+  GSource    *source;
+  gboolean    is_jpeg;
+
+  caps = gst_sample_get_caps (job->sample);
+  is_jpeg = gst_structure_has_name (gst_caps_get_structure (caps, 0),
+                                    "image/jpeg");
+
+  /* Restamp the frame, the writer pipeline has a segment of its own. */
+  buffer = gst_buffer_copy (gst_sample_get_buffer (job->sample));
+  GST_BUFFER_PTS (buffer) = 0;
+  GST_BUFFER_DTS (buffer) = GST_CLOCK_TIME_NONE;
+  GST_BUFFER_DURATION (buffer) = GST_CLOCK_TIME_NONE;
+
+  pipeline = gst_pipeline_new (NULL);
+  src = cheese_still_writer_make ("appsrc", &job->error);
+  mux = cheese_still_writer_make ("jifmux", NULL);
+  sink = cheese_still_writer_make ("filesink", &job->error);
+  if (!is_jpeg)
+  {
+    convert = cheese_still_writer_make ("videoconvert", &job->error);
+    encoder = cheese_still_writer_make ("jpegenc", &job->error);
+  }
+
+  if (job->error != NULL || (mux == NULL && !is_jpeg))
+  {
+    if (job->error == NULL)
+      cheese_still_writer_make ("jifmux", &job->error);
+    g_clear_object (&src);
+    g_clear_object (&mux);
+    g_clear_object (&sink);
+    g_clear_object (&convert);
+    g_clear_object (&encoder);
+    gst_object_unref (pipeline);
+    goto done;
+  }
+
+  if (mux == NULL)
+  {
+    GST_WARNING ("jifmux is missing, writing %s without tags", job->filename);
+    gst_object_unref (src);
+    gst_object_unref (sink);
+    gst_object_unref (pipeline);
+    cheese_still_writer_write_file (job, buffer);
+    goto done;
+  }
+
+  g_object_set (G_OBJECT (src), "caps", caps, "format", GST_FORMAT_TIME, NULL);
+  g_object_set (G_OBJECT (sink), "location", job->filename, NULL);
+  if (job->tags != NULL)
+    gst_tag_setter_merge_tags (GST_TAG_SETTER (mux), job->tags,
+                               GST_TAG_MERGE_REPLACE);
+
+  if (is_jpeg)
+  {
+    gst_bin_add_many (GST_BIN (pipeline), src, mux, sink, NULL);
+    gst_element_link_many (src, mux, sink, NULL);
+  }
+  else
+  {
+    gst_bin_add_many (GST_BIN (pipeline), src, convert, encoder, mux, sink, NULL);
+    gst_element_link_many (src, convert, encoder, mux, sink, NULL);
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  gst_app_src_push_buffer (GST_APP_SRC (src), gst_buffer_ref (buffer));
+  gst_app_src_end_of_stream (GST_APP_SRC (src));
+
+  bus = gst_element_get_bus (pipeline);
+  message = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+                                        GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  if (GST_MESSAGE_TYPE (message) == GST_MESSAGE_ERROR)
+    gst_message_parse_error (message, &job->error, NULL);
+
+  gst_message_unref (message);
+  gst_object_unref (bus);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+done:
+  gst_buffer_unref (buffer);
+
+  GST_DEBUG ("Wrote %s: %s", job->filename,
+             job->error != NULL ? job->error->message : "ok");
+
+  source = g_idle_source_new ();
+  g_source_set_callback (source, cheese_still_writer_job_done, job,
+                         (GDestroyNotify) cheese_still_writer_job_free);
+  g_source_attach (source, job->context);
+  g_source_unref (source);
+}
+
+/*
+ * cheese_still_writer_new:
+ *
+ * Create a writer with one worker thread per processor.
+ *
+ * Returns: a new #CheeseStillWriter
+ */
+CheeseStillWriter *
+cheese_still_writer_new (void)
+{
+  CheeseStillWriter *writer;
+
+#ifndef GST_DISABLE_GST_DEBUG
+  if (cheese_still_writer_cat == NULL)
+    GST_DEBUG_CATEGORY_INIT (cheese_still_writer_cat,
+                             "cheese-still-writer",
+                             0, "Cheese Still Writer");
+#endif
+
+  writer = g_slice_new0 (CheeseStillWriter);
+  writer->pool = g_thread_pool_new (cheese_still_writer_run, writer,
+                                    g_get_num_processors (), FALSE, NULL);
+
+  return writer;
+}
+
+/*
+ * cheese_still_writer_free:
+ * @writer: a #CheeseStillWriter
+ *
+ * Wait for the queued photos to be written, and free the @writer. The
+ * callbacks of the last photos may still be pending in their main contexts.
+ */
+void
+cheese_still_writer_free (CheeseStillWriter *writer)
+{
+  if (writer == NULL)
+    return;
+
+  g_thread_pool_free (writer->pool, FALSE, TRUE);
+  g_slice_free (CheeseStillWriter, writer);
+}
+
+/*
+ * cheese_still_writer_save:
+ * @writer: a #CheeseStillWriter
+ * @sample: the frame to save, either image/jpeg or raw video
+ * @filename: (type filename): the file to write
+ * @tags: (allow-none): tags to write into the file
+ * @func: (allow-none): function to call when the file was written
+ * @user_data: data to pass to @func
+ *
+ * Queue @sample to be written to @filename as a JPEG image.
+ */
+void
+cheese_still_writer_save (CheeseStillWriter    *writer,
+                          GstSample            *sample,
+                          const gchar          *filename,
+                          const GstTagList     *tags,
+                          CheeseStillWriterFunc func,
+                          gpointer              user_data)
+{
+  CheeseStillWriterJob *job;
+
+  g_return_if_fail (writer != NULL);
+  g_return_if_fail (GST_IS_SAMPLE (sample));
+  g_return_if_fail (filename != NULL);
+
+  job = g_slice_new0 (CheeseStillWriterJob);
+  job->sample = gst_sample_ref (sample);
+  job->filename = g_strdup (filename);
+  job->tags = tags != NULL ? gst_tag_list_copy (tags) : NULL;
+  job->func = func;
+  job->user_data = user_data;
+  job->context = g_main_context_ref_thread_default ();
+
+  g_thread_pool_push (writer->pool, job, NULL);
+}
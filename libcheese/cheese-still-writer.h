@@ -0,0 +1,54 @@
+/*
+ * Copyright © 2026 Cheese contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHEESE_STILL_WRITER_H_
+#define CHEESE_STILL_WRITER_H_
+
+#include <glib.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/*
+ * CheeseStillWriterFunc:
+ * @filename: the file which was written
+ * @error: the error which occurred, or %NULL on success
+ * @user_data: the data passed to cheese_still_writer_save()
+ *
+ * Called in the thread-default main context of the caller of
+ * cheese_still_writer_save() once a photo has been written.
+ */
+typedef void (*CheeseStillWriterFunc) (const gchar  *filename,
+                                       const GError *error,
+                                       gpointer      user_data);
+
+typedef struct _CheeseStillWriter CheeseStillWriter;
+
+CheeseStillWriter *cheese_still_writer_new (void);
+void               cheese_still_writer_free (CheeseStillWriter *writer);
+void               cheese_still_writer_save (CheeseStillWriter    *writer,
+                                             GstSample            *sample,
+                                             const gchar          *filename,
+                                             const GstTagList     *tags,
+                                             CheeseStillWriterFunc func,
+                                             gpointer              user_data);
+
+G_END_DECLS
+
+#endif /* CHEESE_STILL_WRITER_H_ */
@@ -0,0 +1,783 @@
+/*
+ * Copyright © 2026 Cheese contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+  #include <config.h>
+#endif
+
+#include <string.h>
+#include <glib.h>
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include "cheese-effect-optimizer.h"
+#include "cheese-stripe-bin.h"
+
+/*
+ * A stripe bin applies an effect to horizontal stripes of each frame in
+ * parallel:
+ *
+ *   tee ! queue ! videocrop ! effect ! join
+ *       ! queue ! videocrop ! effect ! join.
+ *       ...
+ *
+ * Each stripe has a copy of the effect and a queue, so a streaming thread of
+ * its own, and the join puts the stripes back together. The stripes are laid
+ * out once the height of the frames is known, from the caps. This is only
+ * right for effects which are stripe-safe, see #CheeseEffect:stripe-safe.
+ *
+ * The join waits for every stripe of a frame, however late, and copies them
+ * into the output frame once. An aggregator such as compositor would time
+ * out on late stripes in a live pipeline and show its background instead,
+ * and blend the whole frame in a single thread.
+ */
+
+GST_DEBUG_CATEGORY_STATIC (cheese_stripe_bin_cat);
+#define GST_CAT_DEFAULT cheese_stripe_bin_cat
+
+#define CHEESE_TYPE_STRIPE_JOIN (cheese_stripe_join_get_type ())
+#define CHEESE_STRIPE_JOIN(obj) (G_TYPE_CHECK_INSTANCE_CAST ((obj), CHEESE_TYPE_STRIPE_JOIN, CheeseStripeJoin))
+
+typedef struct
+{
+  GstElement parent;
+
+  GstPad *srcpad;
+  GstPad *sinkpads[CHEESE_STRIPE_BIN_MAX_STRIPES];
+  guint   n_stripes;
+
+  /* Protects all of the below, except the output format. */
+  GMutex        lock;
+  GCond         cond;
+  gboolean      flushing;
+  GstVideoInfo  pad_infos[CHEESE_STRIPE_BIN_MAX_STRIPES];
+  gboolean      caps_changed;
+  GstBuffer    *stripes[CHEESE_STRIPE_BIN_MAX_STRIPES];
+  GstVideoInfo  infos[CHEESE_STRIPE_BIN_MAX_STRIPES];
+  guint         n_eos;
+  GstFlowReturn last_ret;
+
+  /* Held while a frame is put together and pushed, so that the frames go
+   * out in order. Protects the output format. */
+  GMutex        push_lock;
+  GstVideoInfo  out_info;
+} CheeseStripeJoin;
+
+typedef struct
+{
+  GstElementClass parent_class;
+} CheeseStripeJoinClass;
+
+static GstStaticPadTemplate cheese_stripe_join_sink_template =
+  GST_STATIC_PAD_TEMPLATE ("sink_%u", GST_PAD_SINK, GST_PAD_REQUEST,
+                           GST_STATIC_CAPS ("video/x-raw"));
+static GstStaticPadTemplate cheese_stripe_join_src_template =
+  GST_STATIC_PAD_TEMPLATE ("src", GST_PAD_SRC, GST_PAD_ALWAYS,
+                           GST_STATIC_CAPS ("video/x-raw"));
+
+GType cheese_stripe_join_get_type (void);
+
+G_DEFINE_TYPE (CheeseStripeJoin, cheese_stripe_join, GST_TYPE_ELEMENT)
+
+/*
+ * cheese_stripe_join_clear:
+ * @join: a #CheeseStripeJoin
+ *
+ * Drop the stripes waiting for the rest of their frame. Called with the lock
+ * held.
+ */
+static void
+cheese_stripe_join_clear (CheeseStripeJoin *join)
+{
+  guint i;
+
+  for (i = 0; i < join->n_stripes; i++)
+    gst_buffer_replace (&join->stripes[i], NULL);
+  g_cond_broadcast (&join->cond);
+}
+
+/*
+ * cheese_stripe_join_complete:
+ * @join: a #CheeseStripeJoin
+ *
+ * Check whether all stripes of a frame are there. Stripes older than the
+ * newest one are dropped, so that a stripe which lost a frame cannot shift
+ * the others. Called with the lock held.
+ *
+ * Returns: %TRUE if the stripes make up a frame
+ */
+static gboolean
+cheese_stripe_join_complete (CheeseStripeJoin *join)
+{
+  GstClockTime newest = GST_CLOCK_TIME_NONE;
+  gboolean complete = TRUE;
+  guint i;
+
+  for (i = 0; i < join->n_stripes; i++)
+  {
+    if (join->stripes[i] == NULL)
+      return FALSE;
+    if (GST_BUFFER_PTS_IS_VALID (join->stripes[i]) &&
+        (!GST_CLOCK_TIME_IS_VALID (newest) ||
+         GST_BUFFER_PTS (join->stripes[i]) > newest))
+      newest = GST_BUFFER_PTS (join->stripes[i]);
+  }
+
+  for (i = 0; i < join->n_stripes; i++)
+  {
+    if (GST_BUFFER_PTS_IS_VALID (join->stripes[i]) &&
+        GST_BUFFER_PTS (join->stripes[i]) < newest)
+    {
+      GST_DEBUG_OBJECT (join, "Dropping a stale frame of stripe %u", i);
+      gst_buffer_replace (&join->stripes[i], NULL);
+      complete = FALSE;
+    }
+  }
+
+  if (!complete)
+    g_cond_broadcast (&join->cond);
+
+  return complete;
+}
+
+/*
+ * cheese_stripe_join_copy:
+ * @dest: the output frame
+ * @src: a stripe
+ * @top: the first row of @src in @dest
+ *
+ * Copy the rows of a stripe into the output frame.
+ */
+static void
+cheese_stripe_join_copy (GstVideoFrame *dest, GstVideoFrame *src, gint top)
+{
+  gboolean done[GST_VIDEO_MAX_PLANES] = { FALSE, };
+  guint comp;
+
+  for (comp = 0; comp < GST_VIDEO_FRAME_N_COMPONENTS (src); comp++)
+  {
+    guint plane = GST_VIDEO_FRAME_COMP_PLANE (src, comp);
+    gint sstride, dstride, rows, width, row;
+    const guint8 *s;
+    guint8 *d;
+
+    if (done[plane])
+      continue;
+    done[plane] = TRUE;
+
+    sstride = GST_VIDEO_FRAME_PLANE_STRIDE (src, plane);
+    dstride = GST_VIDEO_FRAME_PLANE_STRIDE (dest, plane);
+    rows = GST_VIDEO_FRAME_COMP_HEIGHT (src, comp);
+    width = GST_VIDEO_FRAME_COMP_WIDTH (src, comp) *
+            GST_VIDEO_FRAME_COMP_PSTRIDE (src, comp);
+    s = GST_VIDEO_FRAME_PLANE_DATA (src, plane);
+    d = (guint8 *) GST_VIDEO_FRAME_PLANE_DATA (dest, plane) +
+        GST_VIDEO_SUB_SCALE (GST_VIDEO_FORMAT_INFO_H_SUB (src->info.finfo, comp),
+                             top) * dstride;
+
+    for (row = 0; row < rows; row++)
+      memcpy (d + row * dstride, s + row * sstride, width);
+  }
+}
+
+/*
+ * cheese_stripe_join_push:
+ * @join: a #CheeseStripeJoin
+ * @stripes: the stripes of a frame, top to bottom
+ * @infos: the format of each stripe
+ * @caps_changed: whether the format of a stripe changed
+ *
+ * Put a frame together from its stripes and push it. Called with the push
+ * lock held.
+ *
+ * Returns: the #GstFlowReturn of the push
+ */
+static GstFlowReturn
+cheese_stripe_join_push (CheeseStripeJoin *join, GstBuffer **stripes,
+                         GstVideoInfo *infos, gboolean caps_changed)
+{
+  GstVideoFrame out_frame, frame;
+  GstBuffer *out;
+  gint top = 0;
+  guint i;
+
+  if (caps_changed)
+  {
+    GstEvent *event;
+    GstCaps *caps;
+    gint height = 0;
+
+    for (i = 0; i < join->n_stripes; i++)
+    {
+      if (GST_VIDEO_INFO_FORMAT (&infos[i]) != GST_VIDEO_INFO_FORMAT (&infos[0]) ||
+          GST_VIDEO_INFO_WIDTH (&infos[i]) != GST_VIDEO_INFO_WIDTH (&infos[0]))
+      {
+        GST_ELEMENT_ERROR (join, CORE, NEGOTIATION, (NULL),
+                           ("The stripes have different formats"));
+        return GST_FLOW_NOT_NEGOTIATED;
+      }
+      height += GST_VIDEO_INFO_HEIGHT (&infos[i]);
+    }
+
+    caps = gst_video_info_to_caps (&infos[0]);
+    gst_caps_set_simple (caps, "height", G_TYPE_INT, height, NULL);
+    gst_video_info_from_caps (&join->out_info, caps);
+    event = gst_event_new_caps (caps);
+    gst_pad_store_sticky_event (join->srcpad, event);
+    gst_event_unref (event);
+    gst_caps_unref (caps);
+  }
+
+  out = gst_buffer_new_allocate (NULL, GST_VIDEO_INFO_SIZE (&join->out_info),
+                                 NULL);
+  /* Not the metas, which describe the stripe. */
+  gst_buffer_copy_into (out, stripes[0],
+                        GST_BUFFER_COPY_FLAGS | GST_BUFFER_COPY_TIMESTAMPS, 0, -1);
+  if (!gst_video_frame_map (&out_frame, &join->out_info, out, GST_MAP_WRITE))
+  {
+    gst_buffer_unref (out);
+    return GST_FLOW_ERROR;
+  }
+
+  for (i = 0; i < join->n_stripes; i++)
+  {
+    if (gst_video_frame_map (&frame, &infos[i], stripes[i], GST_MAP_READ))
+    {
+      cheese_stripe_join_copy (&out_frame, &frame, top);
+      gst_video_frame_unmap (&frame);
+    }
+    top += GST_VIDEO_INFO_HEIGHT (&infos[i]);
+  }
+  gst_video_frame_unmap (&out_frame);
+
+  return gst_pad_push (join->srcpad, out);
+}
+
+/*
+ * cheese_stripe_join_chain:
+ *
+ * Keep a stripe until the other stripes of its frame arrived; the thread of
+ * the last one puts the frame together and pushes it, while the others go on
+ * with their next stripe.
+ */
+static GstFlowReturn
+cheese_stripe_join_chain (GstPad *pad, GstObject *parent, GstBuffer *buffer)
+{
+  CheeseStripeJoin *join = CHEESE_STRIPE_JOIN (parent);
+  GstBuffer *stripes[CHEESE_STRIPE_BIN_MAX_STRIPES];
+  GstVideoInfo infos[CHEESE_STRIPE_BIN_MAX_STRIPES];
+  guint index = GPOINTER_TO_UINT (gst_pad_get_element_private (pad));
+  gboolean caps_changed;
+  GstFlowReturn ret;
+  guint i;
+
+  g_mutex_lock (&join->lock);
+  while (!join->flushing && join->stripes[index] != NULL)
+    g_cond_wait (&join->cond, &join->lock);
+  if (join->flushing)
+  {
+    g_mutex_unlock (&join->lock);
+    gst_buffer_unref (buffer);
+    return GST_FLOW_FLUSHING;
+  }
+
+  join->stripes[index] = buffer;
+  join->infos[index] = join->pad_infos[index];
+  if (!cheese_stripe_join_complete (join))
+  {
+    ret = join->last_ret;
+    g_mutex_unlock (&join->lock);
+    return ret;
+  }
+
+  for (i = 0; i < join->n_stripes; i++)
+  {
+    stripes[i] = join->stripes[i];
+    infos[i] = join->infos[i];
+    join->stripes[i] = NULL;
+  }
+  caps_changed = join->caps_changed;
+  join->caps_changed = FALSE;
+  g_cond_broadcast (&join->cond);
+  g_mutex_lock (&join->push_lock);
+  g_mutex_unlock (&join->lock);
+
+  ret = cheese_stripe_join_push (join, stripes, infos, caps_changed);
+  g_mutex_unlock (&join->push_lock);
+
+  g_mutex_lock (&join->lock);
+  join->last_ret = ret;
+  if (ret == GST_FLOW_NOT_NEGOTIATED)
+    join->caps_changed = TRUE;
+  g_mutex_unlock (&join->lock);
+
+  for (i = 0; i < join->n_stripes; i++)
+    gst_buffer_unref (stripes[i]);
+
+  return ret;
+}
+
+static gboolean
+cheese_stripe_join_sink_event (GstPad *pad, GstObject *parent,
+                               GstEvent *event)
+{
+  CheeseStripeJoin *join = CHEESE_STRIPE_JOIN (parent);
+  guint index = GPOINTER_TO_UINT (gst_pad_get_element_private (pad));
+  gboolean last;
+
+  switch (GST_EVENT_TYPE (event))
+  {
+    case GST_EVENT_CAPS:
+    {
+      GstVideoInfo info;
+      GstCaps *caps;
+
+      gst_event_parse_caps (event, &caps);
+      gst_event_unref (event);
+      if (!gst_video_info_from_caps (&info, caps))
+        return FALSE;
+
+      g_mutex_lock (&join->lock);
+      join->pad_infos[index] = info;
+      join->caps_changed = TRUE;
+      g_mutex_unlock (&join->lock);
+      return TRUE;
+    }
+    case GST_EVENT_FLUSH_START:
+      g_mutex_lock (&join->lock);
+      join->flushing = TRUE;
+      g_cond_broadcast (&join->cond);
+      g_mutex_unlock (&join->lock);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      g_mutex_lock (&join->lock);
+      cheese_stripe_join_clear (join);
+      join->flushing = FALSE;
+      join->n_eos = 0;
+      join->last_ret = GST_FLOW_OK;
+      g_mutex_unlock (&join->lock);
+      break;
+    case GST_EVENT_EOS:
+      g_mutex_lock (&join->lock);
+      last = ++join->n_eos == join->n_stripes;
+      g_mutex_unlock (&join->lock);
+      if (!last)
+      {
+        gst_event_unref (event);
+        return TRUE;
+      }
+      return gst_pad_push_event (join->srcpad, event);
+    default:
+      break;
+  }
+
+  /* The stripes carry the same events, only those of the first go on. */
+  if (index != 0)
+  {
+    gst_event_unref (event);
+    return TRUE;
+  }
+
+  /* Sticky events go out before the next frame, after its caps. */
+  if (GST_EVENT_IS_STICKY (event))
+  {
+    gst_pad_store_sticky_event (join->srcpad, event);
+    gst_event_unref (event);
+    return TRUE;
+  }
+
+  return gst_pad_push_event (join->srcpad, event);
+}
+
+static gboolean
+cheese_stripe_join_src_event (GstPad *pad, GstObject *parent, GstEvent *event)
+{
+  /* Each stripe must produce every frame, so QoS does not go upstream. */
+  if (GST_EVENT_TYPE (event) == GST_EVENT_QOS)
+  {
+    gst_event_unref (event);
+    return TRUE;
+  }
+
+  return gst_pad_event_default (pad, parent, event);
+}
+
+/*
+ * cheese_stripe_join_query_caps:
+ * @pad: the pad to query the caps of
+ * @filter: (allow-none): the filter of the query
+ *
+ * Returns: (transfer full): the caps of the peer of @pad, of any height
+ */
+static GstCaps *
+cheese_stripe_join_query_caps (GstPad *pad, GstCaps *filter)
+{
+  GstCaps *caps, *result;
+  guint i;
+
+  caps = gst_caps_make_writable (gst_pad_peer_query_caps (pad, NULL));
+  for (i = 0; i < gst_caps_get_size (caps); i++)
+    gst_structure_remove_field (gst_caps_get_structure (caps, i), "height");
+
+  if (filter == NULL)
+    return caps;
+
+  result = gst_caps_intersect_full (filter, caps, GST_CAPS_INTERSECT_FIRST);
+  gst_caps_unref (caps);
+
+  return result;
+}
+
+static gboolean
+cheese_stripe_join_sink_query (GstPad *pad, GstObject *parent, GstQuery *query)
+{
+  CheeseStripeJoin *join = CHEESE_STRIPE_JOIN (parent);
+
+  switch (GST_QUERY_TYPE (query))
+  {
+    case GST_QUERY_CAPS:
+    {
+      GstCaps *filter, *caps;
+
+      gst_query_parse_caps (query, &filter);
+      caps = cheese_stripe_join_query_caps (join->srcpad, filter);
+      gst_query_set_caps_result (query, caps);
+      gst_caps_unref (caps);
+      return TRUE;
+    }
+    case GST_QUERY_ALLOCATION:
+      /* The frames downstream are larger than the stripes. */
+      return FALSE;
+    default:
+      return gst_pad_query_default (pad, parent, query);
+  }
+}
+
+static gboolean
+cheese_stripe_join_src_query (GstPad *pad, GstObject *parent, GstQuery *query)
+{
+  CheeseStripeJoin *join = CHEESE_STRIPE_JOIN (parent);
+
+  if (GST_QUERY_TYPE (query) == GST_QUERY_CAPS)
+  {
+    GstCaps *filter, *caps;
+
+    gst_query_parse_caps (query, &filter);
+    caps = cheese_stripe_join_query_caps (join->sinkpads[0], filter);
+    gst_query_set_caps_result (query, caps);
+    gst_caps_unref (caps);
+    return TRUE;
+  }
+
+  return gst_pad_query_default (pad, parent, query);
+}
+
+static GstStateChangeReturn
+cheese_stripe_join_change_state (GstElement *element, GstStateChange transition)
+{
+  CheeseStripeJoin *join = CHEESE_STRIPE_JOIN (element);
+  GstStateChangeReturn ret;
+
+  switch (transition)
+  {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      g_mutex_lock (&join->lock);
+      join->flushing = FALSE;
+      join->n_eos = 0;
+      join->last_ret = GST_FLOW_OK;
+      g_mutex_unlock (&join->lock);
+      break;
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      /* Release the waiting stripes, before their pads are deactivated. */
+      g_mutex_lock (&join->lock);
+      join->flushing = TRUE;
+      cheese_stripe_join_clear (join);
+      g_mutex_unlock (&join->lock);
+      break;
+    default:
+      break;
+  }
+
+  ret = GST_ELEMENT_CLASS (cheese_stripe_join_parent_class)->change_state (element,
+                                                                           transition);
+
+  if (transition == GST_STATE_CHANGE_PAUSED_TO_READY)
+  {
+    g_mutex_lock (&join->lock);
+    cheese_stripe_join_clear (join);
+    join->caps_changed = TRUE;
+    g_mutex_unlock (&join->lock);
+  }
+
+  return ret;
+}
+
+static void
+cheese_stripe_join_finalize (GObject *object)
+{
+  CheeseStripeJoin *join = CHEESE_STRIPE_JOIN (object);
+
+  cheese_stripe_join_clear (join);
+  g_mutex_clear (&join->lock);
+  g_mutex_clear (&join->push_lock);
+  g_cond_clear (&join->cond);
+
+  G_OBJECT_CLASS (cheese_stripe_join_parent_class)->finalize (object);
+}
+
+static void
+cheese_stripe_join_class_init (CheeseStripeJoinClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+
+  object_class->finalize = cheese_stripe_join_finalize;
+  element_class->change_state = cheese_stripe_join_change_state;
+
+  gst_element_class_add_static_pad_template (element_class,
+                                             &cheese_stripe_join_sink_template);
+  gst_element_class_add_static_pad_template (element_class,
+                                             &cheese_stripe_join_src_template);
+  gst_element_class_set_static_metadata (element_class, "Cheese stripe join",
+                                         "Filter/Video",
+                                         "Puts the stripes of frames back together",
+                                         "Cheese contributors");
+}
+
+static void
+cheese_stripe_join_init (CheeseStripeJoin *join)
+{
+  g_mutex_init (&join->lock);
+  g_mutex_init (&join->push_lock);
+  g_cond_init (&join->cond);
+  join->flushing = TRUE;
+  join->caps_changed = TRUE;
+  join->last_ret = GST_FLOW_OK;
+
+  join->srcpad = gst_pad_new_from_static_template (&cheese_stripe_join_src_template,
+                                                   "src");
+  gst_pad_set_event_function (join->srcpad, cheese_stripe_join_src_event);
+  gst_pad_set_query_function (join->srcpad, cheese_stripe_join_src_query);
+  gst_element_add_pad (GST_ELEMENT (join), join->srcpad);
+}
+
+/*
+ * cheese_stripe_join_new:
+ * @n_stripes: the number of stripes
+ *
+ * Returns: (transfer floating): a new join with a sink pad per stripe, from
+ * the top
+ */
+static GstElement *
+cheese_stripe_join_new (guint n_stripes)
+{
+  CheeseStripeJoin *join;
+  guint i;
+
+  join = g_object_new (CHEESE_TYPE_STRIPE_JOIN, NULL);
+  join->n_stripes = n_stripes;
+
+  for (i = 0; i < n_stripes; i++)
+  {
+    gchar *name = g_strdup_printf ("sink_%u", i);
+
+    join->sinkpads[i] = gst_pad_new_from_static_template (&cheese_stripe_join_sink_template,
+                                                          name);
+    g_free (name);
+    gst_pad_set_element_private (join->sinkpads[i], GUINT_TO_POINTER (i));
+    gst_pad_set_chain_function (join->sinkpads[i], cheese_stripe_join_chain);
+    gst_pad_set_event_function (join->sinkpads[i], cheese_stripe_join_sink_event);
+    gst_pad_set_query_function (join->sinkpads[i], cheese_stripe_join_sink_query);
+    gst_element_add_pad (GST_ELEMENT (join), join->sinkpads[i]);
+  }
+
+  return GST_ELEMENT (join);
+}
+
+typedef struct
+{
+  guint       n_stripes;
+  GstElement *crops[CHEESE_STRIPE_BIN_MAX_STRIPES];
+  gint        height;
+} CheeseStripeBinLayout;
+
+static void
+cheese_stripe_bin_layout_free (CheeseStripeBinLayout *layout)
+{
+  g_slice_free (CheeseStripeBinLayout, layout);
+}
+
+/*
+ * cheese_stripe_bin_caps_probe:
+ *
+ * Lay the stripes out for the height of the frames, before the new caps
+ * reach the croppers. Stripes start on even rows, for subsampled formats.
+ */
+static GstPadProbeReturn
+cheese_stripe_bin_caps_probe (GstPad *pad, GstPadProbeInfo *info,
+                              CheeseStripeBinLayout *layout)
+{
+  GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+  GstCaps *caps;
+  gint height, top, bottom;
+  guint i;
+
+  if (GST_EVENT_TYPE (event) != GST_EVENT_CAPS)
+    return GST_PAD_PROBE_OK;
+
+  gst_event_parse_caps (event, &caps);
+  if (!gst_structure_get_int (gst_caps_get_structure (caps, 0), "height",
+                              &height) || height == layout->height)
+    return GST_PAD_PROBE_OK;
+
+  layout->height = height;
+  GST_DEBUG ("Splitting %d rows into %u stripes", height, layout->n_stripes);
+
+  for (i = 0; i < layout->n_stripes; i++)
+  {
+    top = (height * i / layout->n_stripes) & ~1;
+    bottom = i + 1 == layout->n_stripes ? height
+                                        : (height * (i + 1) / layout->n_stripes) & ~1;
+
+    g_object_set (G_OBJECT (layout->crops[i]), "top", top,
+                  "bottom", height - bottom, NULL);
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+/*
+ * cheese_stripe_bin_make:
+ * @factory: the name of the element factory
+ * @error: return location for a #GError, or %NULL
+ *
+ * Returns: a new element, or %NULL and sets @error if it is not installed
+ */
+static GstElement *
+cheese_stripe_bin_make (const gchar *factory, GError **error)
+{
+  GstElement *element = gst_element_factory_make (factory, NULL);
+
+  if (element == NULL)
+    g_set_error (error, GST_CORE_ERROR, GST_CORE_ERROR_MISSING_PLUGIN,
+                 "%s element not found", factory);
+
+  return element;
+}
+
+/*
+ * cheese_stripe_bin_new:
+ * @effect_desc: the pipeline description of a stripe-safe effect
+ * @n_stripes: the number of stripes to split frames into, from 2 to
+ * %CHEESE_STRIPE_BIN_MAX_STRIPES
+ * @error: return location for a #GError, or %NULL
+ *
+ * Create a bin which applies @effect_desc to @n_stripes horizontal stripes
+ * of each frame in parallel. The bin has a "sink" and a "src" pad.
+ *
+ * Returns: (transfer floating): the bin, or %NULL and sets @error if the
+ * effect cannot be parsed or an element is missing
+ */
+GstElement *
+cheese_stripe_bin_new (const gchar *effect_desc, guint n_stripes,
+                       GError **error)
+{
+  CheeseStripeBinLayout *layout;
+  GstElement *bin, *tee, *join;
+  GstPad *pad;
+  gboolean ok = TRUE;
+  guint i;
+
+  g_return_val_if_fail (n_stripes >= 2 &&
+                        n_stripes <= CHEESE_STRIPE_BIN_MAX_STRIPES, NULL);
+
+  if (cheese_stripe_bin_cat == NULL)
+    GST_DEBUG_CATEGORY_INIT (cheese_stripe_bin_cat, "cheese-stripe-bin",
+                             0, "Cheese Stripe Bin");
+
+  if ((tee = cheese_stripe_bin_make ("tee", error)) == NULL)
+    return NULL;
+  join = cheese_stripe_join_new (n_stripes);
+
+  bin = gst_bin_new (NULL);
+  gst_bin_add_many (GST_BIN (bin), tee, join, NULL);
+
+  layout = g_slice_new0 (CheeseStripeBinLayout);
+  g_object_set_data_full (G_OBJECT (bin), "cheese-stripe-bin-layout", layout,
+                          (GDestroyNotify) cheese_stripe_bin_layout_free);
+
+  for (i = 0; i < n_stripes; i++)
+  {
+    GstElement *queue, *crop, *effect;
+
+    if ((queue = cheese_stripe_bin_make ("queue", error)) == NULL)
+      goto error;
+    if ((crop = cheese_stripe_bin_make ("videocrop", error)) == NULL)
+    {
+      gst_object_unref (queue);
+      goto error;
+    }
+    if ((effect = cheese_effect_optimizer_parse (effect_desc, TRUE, error)) == NULL)
+    {
+      gst_object_unref (queue);
+      gst_object_unref (crop);
+      goto error;
+    }
+
+    /* Keep the stripes of a frame together, a frame or two at most. */
+    g_object_set (G_OBJECT (queue), "max-size-buffers", 2,
+                  "max-size-bytes", 0, "max-size-time", G_GUINT64_CONSTANT (0),
+                  NULL);
+
+    gst_bin_add_many (GST_BIN (bin), queue, crop, effect, NULL);
+    ok &= gst_element_link_many (tee, queue, crop, effect, NULL);
+
+    layout->crops[i] = crop;
+    layout->n_stripes++;
+    pad = gst_element_get_static_pad (effect, "src");
+    ok &= pad != NULL &&
+          gst_pad_link (pad, CHEESE_STRIPE_JOIN (join)->sinkpads[i]) == GST_PAD_LINK_OK;
+    if (pad != NULL)
+      gst_object_unref (pad);
+  }
+
+  if (!ok)
+  {
+    g_set_error (error, GST_CORE_ERROR, GST_CORE_ERROR_NEGOTIATION,
+                 "Could not link the stripes of %s", effect_desc);
+    goto error;
+  }
+
+  pad = gst_element_get_static_pad (tee, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+                     (GstPadProbeCallback) cheese_stripe_bin_caps_probe,
+                     layout, NULL);
+  gst_element_add_pad (bin, gst_ghost_pad_new ("sink", pad));
+  gst_object_unref (pad);
+
+  pad = gst_element_get_static_pad (join, "src");
+  gst_element_add_pad (bin, gst_ghost_pad_new ("src", pad));
+  gst_object_unref (pad);
+
+  return bin;
+
+error:
+  gst_object_unref (gst_object_ref_sink (bin));
+  return NULL;
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright © 2026 Cheese contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHEESE_STRIPE_BIN_H_
+#define CHEESE_STRIPE_BIN_H_
+
+#include <glib.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/*
+ * CHEESE_STRIPE_BIN_MAX_STRIPES:
+ *
+ * The most stripes a frame is split into.
+ */
+#define CHEESE_STRIPE_BIN_MAX_STRIPES 8
+
+GstElement *cheese_stripe_bin_new (const gchar *effect_desc,
+                                   guint        n_stripes,
+                                   GError     **error);
+
+G_END_DECLS
+
+#endif /* CHEESE_STRIPE_BIN_H_ */
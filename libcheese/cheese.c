@@ -20,6 +20,7 @@
 #include <clutter-gst/clutter-gst.h>
 
 #include "cheese.h"
+#include "cheese-kernel.h"
 
 /**
  * SECTION:cheese-init
@@ -36,7 +37,8 @@
  * @argc: (allow-none): pointer to the argument list count
  * @argv: (allow-none): pointer to the argument list vector
  *
- * Initialize libcheese, by initializing Clutter and GStreamer.
+ * Initialize libcheese, by initializing Clutter and GStreamer, and register
+ * the elements which effects may use.
  *
  * Returns: %TRUE if the initialization was successful, %FALSE otherwise
  */
@@ -50,5 +52,5 @@ cheese_init (int *argc, char ***argv)
     if (error != CLUTTER_INIT_SUCCESS)
         return FALSE;
 
-    return TRUE;
+    return cheese_kernel_register ();
 }
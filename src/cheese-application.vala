@@ -251,6 +251,11 @@ public class Cheese.Application : Gtk.Application
             camera.set_balance_property ("saturation", value);
         }
 
+        settings.bind ("video-encoder", camera, "video-encoder",
+                       SettingsBindFlags.GET);
+        settings.bind ("video-preroll", camera, "preroll-duration",
+                       SettingsBindFlags.GET);
+
         camera.state_flags_changed.connect (on_camera_state_flags_changed);
         main_window.set_camera (camera);
         camera.play ();
@@ -89,6 +89,9 @@ public class Cheese.MainWindow : Gtk.ApplicationWindow
   private Clutter.Actor current_effects_grid;
   private uint current_effects_page = 0;
   private List<Clutter.Actor> effects_grids;
+  /* The single actor showing all effects of a page, in mosaic mode. */
+  private Clutter.Actor effects_mosaic;
+  private uint preview_size_timeout_id;
 
   private bool is_fullscreen;
   private bool is_wide_mode;
@@ -664,6 +667,53 @@ public class Cheese.MainWindow : Gtk.ApplicationWindow
     this.background_layer.set_size (viewport.width, viewport.height);
     this.timeout_layer.set_position (video_preview.width/3 + viewport.width/2,
                                 viewport.height-20);
+    update_effects_preview_size ();
+  }
+
+  /**
+   * Size the effect previews once the viewport has stopped changing size,
+   * as every new size renegotiates the effects pipeline.
+   */
+  private void update_effects_preview_size ()
+  {
+    if (preview_size_timeout_id != 0)
+      GLib.Source.remove (preview_size_timeout_id);
+
+    preview_size_timeout_id = GLib.Timeout.add (200, () => {
+      preview_size_timeout_id = 0;
+      apply_effects_preview_size ();
+      return false;
+    });
+  }
+
+  /**
+   * Size the effect previews for the cells of the effects selector, or for
+   * the tiles of the mosaic in mosaic mode, so that the effects are not
+   * applied to larger frames than shown.
+   */
+  private void apply_effects_preview_size ()
+  {
+    if (camera == null)
+      return;
+
+    if (effects_mosaic != null)
+    {
+      /* Three columns, filling the viewport. */
+      float tile_width = viewport.width / 3;
+      float tile_height = viewport.height / 3;
+
+      camera.set_effects_preview_size ((uint) (tile_width > 2 ? tile_width : 2),
+                                       (uint) (tile_height > 2 ? tile_height : 2));
+    }
+    else
+    {
+      /* Three rows and columns, with 10 pixels between them. */
+      float cell_width = (viewport.width - 20) / 3;
+      float cell_height = (viewport.height - 20) / 3;
+
+      camera.set_effects_preview_size ((uint) (cell_width > 2 ? cell_width : 2),
+                                       (uint) (cell_height > 2 ? cell_height : 2));
+    }
   }
 
   /**
@@ -717,6 +767,7 @@ public class Cheese.MainWindow : Gtk.ApplicationWindow
 
   private int  burst_count;
   private uint burst_callback_id;
+  private bool burst_is_native;
 
   /**
    * Take a photo during burst mode, and increment the burst count.
@@ -805,7 +856,7 @@ public class Cheese.MainWindow : Gtk.ApplicationWindow
   {
     if (is_start)
     {
-      camera.start_video_recording (fileutil.get_new_media_filename (this.current_mode));
+      camera.start_video_recording (fileutil.get_new_video_filename (camera.get_video_file_suffix ()));
       /* Will be called every 1 second while
        * update_timeout_layer returns true.
        */
@@ -861,6 +912,17 @@ public class Cheese.MainWindow : Gtk.ApplicationWindow
       this.disable_mode_change ();
       // FIXME: Set the effects action to be inactive.
       take_action_button.tooltip_text = _("Stop taking pictures");
+
+      /* Without a countdown or flash for every photo, let the camera take the
+       * burst from its stream, at up to its frame rate. */
+      if (!settings.get_boolean ("countdown") && !settings.get_boolean ("flash")
+          && camera.take_burst ((uint) settings.get_int ("burst-repeat"),
+                                (uint) settings.get_int ("burst-delay")))
+      {
+        burst_is_native = true;
+        return;
+      }
+
       burst_take_photo ();
 
       /* Use the countdown duration if it is greater than the burst delay, plus
@@ -886,7 +948,15 @@ public class Cheese.MainWindow : Gtk.ApplicationWindow
       take_action_button.tooltip_text = _("Take multiple photos");
       burst_count = 0;
       fileutil.reset_burst ();
-      GLib.Source.remove (burst_callback_id);
+      if (burst_is_native)
+      {
+        burst_is_native = false;
+        camera.stop_burst ();
+      }
+      else
+      {
+        GLib.Source.remove (burst_callback_id);
+      }
     }
   }
 
@@ -963,9 +1033,68 @@ public class Cheese.MainWindow : Gtk.ApplicationWindow
     /* Disable the effects selector after selecting an effect. */
     effects_toggle_button.set_active (false);
 
-    selected_effect = source.get_data ("effect");
+    select_effect (source.get_data ("effect"));
+  }
+
+  /**
+   * Change the selected effect, as a cell of the effects mosaic was tapped.
+   *
+   * @param tap the tap on the mosaic
+   * @param source the mosaic actor
+   */
+  private void on_effects_mosaic_tap (Clutter.TapAction tap,
+                                      Clutter.Actor source)
+  {
+    float stage_x, stage_y, x, y;
+    Clutter.ActorBox box;
+
+    tap.get_press_coords (0, out stage_x, out stage_y);
+    source.transform_stage_point (stage_x, stage_y, out x, out y);
+    source.get_content_box (out box);
+    if (box.get_width () <= 0 || box.get_height () <= 0)
+      return;
+
+    int cell = camera.get_effects_mosaic_cell ((x - box.x1) / box.get_width (),
+                                               (y - box.y1) / box.get_height ());
+    if (cell < 0)
+      return;
+
+    /* Disable the effects selector after selecting an effect. */
+    effects_toggle_button.set_active (false);
+
+    select_effect (effects_manager.effects.nth_data (current_effects_page * EFFECTS_PER_PAGE + cell));
+  }
+
+  /**
+   * Apply and remember the selected effect.
+   *
+   * @param effect the effect which was selected
+   */
+  private void select_effect (Effect effect)
+  {
+    selected_effect = effect;
     camera.set_effect (selected_effect);
     settings.set_string ("selected-effect", selected_effect.name);
+    prewarm_neighbouring_effects (selected_effect);
+  }
+
+  /**
+   * Parse the effects next to the selected one in the background, as they
+   * are the likeliest to be selected next.
+   *
+   * @param effect the selected effect
+   */
+  private void prewarm_neighbouring_effects (Effect effect)
+  {
+    int index = effects_manager.effects.index (effect);
+
+    if (index < 0)
+      return;
+
+    if (index > 0)
+      camera.prewarm_effect (effects_manager.effects.nth_data (index - 1));
+    if ((uint) (index + 1) < effects_manager.effects.length ())
+      camera.prewarm_effect (effects_manager.effects.nth_data (index + 1));
   }
 
     /**
@@ -1000,6 +1129,13 @@ public class Cheese.MainWindow : Gtk.ApplicationWindow
     if (!is_effects_selector_active)
       return;
     current_effects_page = number;
+
+    if (effects_mosaic != null && activate_effects_mosaic_page (number))
+    {
+      setup_effects_page_switch_sensitivity ();
+      return;
+    }
+
     if (viewport_layout.get_children ().index (current_effects_grid) != -1)
     {
       viewport_layout.remove_child (current_effects_grid);
@@ -1014,11 +1150,23 @@ public class Cheese.MainWindow : Gtk.ApplicationWindow
     current_effects_grid.restore_easing_state ();
 
 
+    /* Release the previews of the other pages first, so that their branches
+     * are reused for this page. */
     uint i = 0;
     foreach (var effect in effects_manager.effects)
     {
-        uint page_nr = i / EFFECTS_PER_PAGE;
-        if (page_nr == number)
+        if (i / EFFECTS_PER_PAGE != number && effect.is_preview_connected ())
+        {
+            camera.disconnect_effect_texture (effect);
+        }
+
+        i++;
+    }
+
+    i = 0;
+    foreach (var effect in effects_manager.effects)
+    {
+        if (i / EFFECTS_PER_PAGE == number)
         {
             if (!effect.is_preview_connected ())
             {
@@ -1027,20 +1175,47 @@ public class Cheese.MainWindow : Gtk.ApplicationWindow
             }
             effect.enable_preview ();
         }
-        else
-        {
-            if (effect.is_preview_connected ())
-            {
-                effect.disable_preview ();
-            }
-        }
 
-	    i++;
+        i++;
     }
 
     setup_effects_page_switch_sensitivity ();
   }
 
+  /**
+   * Show the supplied page of effects in the effects mosaic.
+   *
+   * @param number the effects page to show
+   * @return false if the mosaic cannot be shown, in which case a preview per
+   * effect is used from now on
+   */
+  private bool activate_effects_mosaic_page (int number)
+  {
+    var page = new List<Effect> ();
+    uint i = 0;
+    foreach (var effect in effects_manager.effects)
+    {
+      if (i / EFFECTS_PER_PAGE == number)
+        page.append (effect);
+      i++;
+    }
+
+    if (!camera.connect_effects_mosaic (page, 3, effects_mosaic))
+    {
+      if (viewport_layout.get_children ().index (effects_mosaic) != -1)
+        viewport_layout.remove_child (effects_mosaic);
+      effects_mosaic = null;
+      current_effects_grid = effects_grids.nth_data (number);
+      current_effects_grid.show ();
+      return false;
+    }
+
+    if (viewport_layout.get_children ().index (effects_mosaic) == -1)
+      viewport_layout.add_child (effects_mosaic);
+    current_effects_grid = effects_mosaic;
+    return true;
+  }
+
     /**
      * Control the sensitivity of the effects page navigation buttons.
      */
@@ -1089,6 +1264,8 @@ public class Cheese.MainWindow : Gtk.ApplicationWindow
         {
             current_effects_grid.hide ();
             video_preview.show ();
+            if (effects_mosaic != null)
+                camera.disconnect_effects_mosaic ();
         }
 
         camera.toggle_effects_pipeline (active);
@@ -1175,6 +1352,17 @@ public class Cheese.MainWindow : Gtk.ApplicationWindow
 
       setup_effects_page_switch_sensitivity ();
       current_effects_grid = effects_grids.nth_data (0);
+
+      if (settings.get_boolean ("effects-mosaic"))
+      {
+        effects_mosaic = new Clutter.Actor ();
+        effects_mosaic.content_gravity = Clutter.ContentGravity.RESIZE_ASPECT;
+        effects_mosaic.reactive = true;
+        var tap = new Clutter.TapAction ();
+        effects_mosaic.add_action (tap);
+        tap.tap.connect (on_effects_mosaic_tap);
+        current_effects_grid = effects_mosaic;
+      }
     }
   }
 
@@ -1456,6 +1644,11 @@ public class Cheese.MainWindow : Gtk.ApplicationWindow
     public void set_camera (Camera camera)
     {
         this.camera = camera;
+        this.camera.burst_done.connect (() => {
+            if (burst_is_native)
+                toggle_photo_bursting (false);
+        });
         set_switch_camera_button_state ();
+        apply_effects_preview_size ();
      }
 }
@@ -246,6 +246,7 @@ cheese_thumb_view_append_item (CheeseThumbView *thumb_view, GFile *file)
 
   if (!(g_str_has_suffix (filename, CHEESE_PHOTO_NAME_SUFFIX))
     && !(g_str_has_suffix (filename, CHEESE_VIDEO_NAME_SUFFIX))
+    && !(g_str_has_suffix (filename, CHEESE_MATROSKA_VIDEO_NAME_SUFFIX))
     && !(g_str_has_suffix (filename, CHEESE_OLD_VIDEO_NAME_SUFFIX)))
   {
     g_free (filename);
@@ -630,6 +631,7 @@ cheese_thumb_view_fill (CheeseThumbView *thumb_view)
     while ((name = g_dir_read_name (dir_videos)))
     {
       if (!(g_str_has_suffix (name, CHEESE_VIDEO_NAME_SUFFIX))
+        && !(g_str_has_suffix (name, CHEESE_MATROSKA_VIDEO_NAME_SUFFIX))
         && !(g_str_has_suffix (name, CHEESE_OLD_VIDEO_NAME_SUFFIX)))
         continue;
 
@@ -21,12 +21,475 @@
 
 #include <stdlib.h>
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+#include <gst/base/gstbasetransform.h>
+#include "cheese-camera.h"
 #include "cheese-camera-device.h"
 #include "cheese-camera-device-monitor.h"
+#include "cheese-caps-cache.h"
 #include "cheese-effect.h"
+#include "cheese-effect-cache.h"
+#include "cheese-effect-optimizer.h"
+#include "cheese-encoder-governor.h"
+#include "cheese-encoder-profile.h"
 #include "cheese-fileutil.h"
+#include "cheese-format-cost.h"
+#include "cheese-frame-ring.h"
+#include "cheese-kernel.h"
+#include "cheese-multi-capture.h"
+#include "cheese-pixbuf.h"
+#include "cheese-stripe-bin.h"
 #include "cheese.h"
 
+/* A GstDevice which creates a live videotestsrc, standing in for a webcam. */
+typedef struct
+{
+    GstDevice parent;
+} CheeseTestDevice;
+
+typedef struct
+{
+    GstDeviceClass parent_class;
+} CheeseTestDeviceClass;
+
+GType cheese_test_device_get_type (void);
+
+G_DEFINE_TYPE (CheeseTestDevice, cheese_test_device, GST_TYPE_DEVICE)
+
+static GstElement *
+cheese_test_device_create_element (GstDevice *device, const gchar *name)
+{
+    GstElement *src;
+
+    src = gst_element_factory_make ("videotestsrc", name);
+    g_object_set (src, "is-live", TRUE, NULL);
+
+    return src;
+}
+
+static void
+cheese_test_device_class_init (CheeseTestDeviceClass *klass)
+{
+    GST_DEVICE_CLASS (klass)->create_element = cheese_test_device_create_element;
+}
+
+static void
+cheese_test_device_init (CheeseTestDevice *device)
+{
+}
+
+static CheeseCameraDevice *
+cheese_test_device_new_with_caps (const gchar *path, const gchar *caps_string)
+{
+    CheeseCameraDevice *device;
+    GstDevice *gstdevice;
+    GstCaps *caps;
+    GstStructure *props;
+    GError *error = NULL;
+
+    caps = gst_caps_from_string (caps_string);
+    props = gst_structure_new ("properties",
+                               "api.v4l2.path", G_TYPE_STRING, path, NULL);
+    gstdevice = g_object_new (cheese_test_device_get_type (),
+                              "display-name", "Cheese test device",
+                              "device-class", "Video/Source",
+                              "caps", caps,
+                              "properties", props,
+                              NULL);
+    gst_caps_unref (caps);
+    gst_structure_free (props);
+
+    device = cheese_camera_device_new (gstdevice, &error);
+    g_assert_no_error (error);
+    g_object_unref (gstdevice);
+
+    return device;
+}
+
+static CheeseCameraDevice *
+cheese_test_device_new (const gchar *path)
+{
+    return cheese_test_device_new_with_caps (path,
+                                             "video/x-raw, format=(string)I420, "
+                                             "width=(int)640, height=(int)480, "
+                                             "framerate=(fraction)30/1; "
+                                             "video/x-raw, format=(string)I420, "
+                                             "width=(int)320, height=(int)240, "
+                                             "framerate=(fraction)30/1");
+}
+
+/* Check that the GStreamer elements needed by a test are installed. */
+static gboolean
+have_elements (const gchar * const *names)
+{
+    gsize i;
+
+    for (i = 0; names[i] != NULL; i++)
+    {
+        GstElementFactory *factory = gst_element_factory_find (names[i]);
+
+        if (factory == NULL)
+        {
+            gchar *message = g_strdup_printf ("%s is not installed", names[i]);
+            g_test_skip (message);
+            g_free (message);
+            return FALSE;
+        }
+
+        gst_object_unref (factory);
+    }
+
+    return TRUE;
+}
+
+/* Iterate the default main context until @counter reaches @count, or five
+ * seconds have passed. */
+static void
+wait_for_count (volatile gint *counter, gint count)
+{
+    gint64 end = g_get_monotonic_time () + 5 * G_TIME_SPAN_SECOND;
+
+    while (g_atomic_int_get (counter) < count
+           && g_get_monotonic_time () < end)
+    {
+        g_main_context_iteration (NULL, FALSE);
+        g_usleep (10000);
+    }
+}
+
+/* Run a filter on a few frames of a test pattern */
+static void
+run_filter_handoff_cb (GstElement *sink, GstBuffer *buffer, GstPad *pad,
+                       GstBuffer **last)
+{
+    gst_buffer_replace (last, buffer);
+}
+
+/*
+ * run_filter:
+ * @filter: the element to run the frames through
+ * @width: the width of the frames
+ * @height: the height of the frames
+ * @frames: the number of frames
+ * @live: whether the test pattern is produced in real time, like a camera
+ * @fps: (out): return location for the framerate achieved
+ *
+ * Returns: (transfer full): the last frame out of @filter
+ */
+static GstBuffer *
+run_filter (GstElement *filter, gint width, gint height, guint frames,
+            gboolean live, gdouble *fps)
+{
+    GstElement *pipeline, *src, *incaps, *outcaps, *sink;
+    GstBuffer *last = NULL;
+    GstCaps *caps;
+    GstMessage *message;
+    GstBus *bus;
+    gint64 start;
+
+    pipeline = gst_pipeline_new (NULL);
+    src = gst_element_factory_make ("videotestsrc", NULL);
+    g_object_set (src, "num-buffers", frames, "pattern", 0, "is-live", live,
+                  NULL);
+    incaps = gst_element_factory_make ("capsfilter", NULL);
+    outcaps = gst_element_factory_make ("capsfilter", NULL);
+    caps = gst_caps_new_simple ("video/x-raw", "format", G_TYPE_STRING, "I420",
+                                "width", G_TYPE_INT, width,
+                                "height", G_TYPE_INT, height,
+                                "framerate", GST_TYPE_FRACTION, 30, 1, NULL);
+    g_object_set (incaps, "caps", caps, NULL);
+    g_object_set (outcaps, "caps", caps, NULL);
+    gst_caps_unref (caps);
+    sink = gst_element_factory_make ("fakesink", NULL);
+    g_object_set (sink, "sync", FALSE, "signal-handoffs", TRUE, NULL);
+    g_signal_connect (sink, "handoff", G_CALLBACK (run_filter_handoff_cb),
+                      &last);
+
+    gst_bin_add_many (GST_BIN (pipeline), src, incaps, filter, outcaps, sink,
+                      NULL);
+    g_assert_true (gst_element_link_many (src, incaps, filter, outcaps, sink,
+                                          NULL));
+
+    start = g_get_monotonic_time ();
+    gst_element_set_state (pipeline, GST_STATE_PLAYING);
+    bus = gst_element_get_bus (pipeline);
+    message = gst_bus_timed_pop_filtered (bus, 30 * GST_SECOND,
+                                          GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+    *fps = frames * 1e6 / MAX (g_get_monotonic_time () - start, 1);
+    gst_element_set_state (pipeline, GST_STATE_NULL);
+
+    g_assert_nonnull (message);
+    g_assert_cmpint (GST_MESSAGE_TYPE (message), ==, GST_MESSAGE_EOS);
+    gst_message_unref (message);
+    gst_object_unref (bus);
+    gst_object_unref (pipeline);
+
+    g_assert_nonnull (last);
+    return last;
+}
+
+/* Test CheeseCamera */
+static void
+count_frame (CheeseCamera *camera, GstSample *sample, gpointer user_data)
+{
+    g_assert_nonnull (gst_sample_get_buffer (sample));
+    g_assert_nonnull (gst_sample_get_caps (sample));
+
+    g_atomic_int_inc ((volatile gint *) user_data);
+}
+
+static void
+camera_headless (void)
+{
+    static const gchar * const elements[] = { "camerabin", "appsink",
+                                              "videotestsrc", NULL };
+    CheeseCameraDevice *device;
+    CheeseCamera *camera;
+    GstSample *sample;
+    GError *error = NULL;
+    volatile gint frames = 0;
+
+    if (!have_elements (elements))
+        return;
+
+    device = cheese_test_device_new ("/dev/cheese-test0");
+    camera = cheese_camera_new (NULL, NULL, 640, 480);
+    g_assert_nonnull (camera);
+
+    cheese_camera_setup (camera, device, &error);
+    g_assert_no_error (error);
+    g_assert_true (cheese_camera_get_selected_device (camera) == device);
+
+    cheese_camera_set_frame_callback (camera, count_frame, (gpointer) &frames,
+                                      NULL);
+    cheese_camera_play (camera);
+    wait_for_count (&frames, 5);
+    g_assert_cmpint (g_atomic_int_get (&frames), >=, 5);
+
+    /* Without a callback, frames are queued for pulling. */
+    cheese_camera_set_frame_callback (camera, NULL, NULL, NULL);
+    sample = cheese_camera_pull_sample (camera, 5 * GST_SECOND);
+    g_assert_nonnull (sample);
+    g_assert_true (GST_BUFFER_PTS_IS_VALID (gst_sample_get_buffer (sample)));
+    gst_sample_unref (sample);
+
+    cheese_camera_stop (camera);
+    g_object_unref (camera);
+    g_object_unref (device);
+}
+
+/* Count all frames in the first counter, and frames 320 pixels wide in the
+ * second. */
+static void
+count_small_frame (CheeseCamera *camera, GstSample *sample, gpointer user_data)
+{
+    volatile gint *counters = user_data;
+    GstStructure *structure;
+    gint width;
+
+    g_atomic_int_inc (&counters[0]);
+
+    structure = gst_caps_get_structure (gst_sample_get_caps (sample), 0);
+    if (gst_structure_get_int (structure, "width", &width) && width == 320)
+        g_atomic_int_inc (&counters[1]);
+}
+
+static void
+count_notify (GObject *object, GParamSpec *pspec, gpointer user_data)
+{
+    g_atomic_int_inc ((volatile gint *) user_data);
+}
+
+/* Test switching the format of a playing camera */
+static void
+camera_format_switch (void)
+{
+    static const gchar * const elements[] = { "camerabin", "appsink",
+                                              "videotestsrc", NULL };
+    CheeseCameraDevice *device;
+    CheeseCamera *camera;
+    CheeseVideoFormat format = { 320, 240 };
+    GError *error = NULL;
+    volatile gint frames[2] = { 0, 0 };
+    volatile gint switched = 0;
+
+    if (!have_elements (elements))
+        return;
+
+    device = cheese_test_device_new ("/dev/cheese-test0");
+    camera = cheese_camera_new (NULL, NULL, 640, 480);
+    cheese_camera_setup (camera, device, &error);
+    g_assert_no_error (error);
+
+    g_signal_connect (camera, "notify::format-switch-time",
+                      G_CALLBACK (count_notify), (gpointer) &switched);
+    cheese_camera_set_frame_callback (camera, count_small_frame,
+                                      (gpointer) frames, NULL);
+    cheese_camera_play (camera);
+    wait_for_count (&frames[0], 5);
+    g_assert_cmpint (g_atomic_int_get (&frames[1]), ==, 0);
+
+    /* The new format comes through without restarting the camera. */
+    cheese_camera_set_video_format (camera, &format);
+    wait_for_count (&frames[1], 5);
+    g_assert_cmpint (g_atomic_int_get (&frames[1]), >=, 5);
+    wait_for_count (&switched, 1);
+    g_assert_cmpint (g_atomic_int_get (&switched), ==, 1);
+
+    cheese_camera_stop (camera);
+    g_object_unref (camera);
+    g_object_unref (device);
+}
+
+/* Test switching between two devices which are both kept open */
+static void
+camera_warm_switch (void)
+{
+    static const gchar * const elements[] = { "camerabin", "appsink",
+                                              "videotestsrc", "input-selector",
+                                              NULL };
+    CheeseCameraDevice *devices[2];
+    CheeseCamera *camera;
+    GError *error = NULL;
+    volatile gint frames = 0;
+    guint i;
+
+    if (!have_elements (elements))
+        return;
+
+    devices[0] = cheese_test_device_new ("/dev/cheese-test0");
+    devices[1] = cheese_test_device_new ("/dev/cheese-test1");
+    camera = cheese_camera_new (NULL, NULL, 640, 480);
+    g_object_set (camera, "max-warm-sources", G_MAXUINT8, NULL);
+    cheese_camera_setup (camera, devices[0], &error);
+    g_assert_no_error (error);
+
+    /* Rebuild the source once both devices are known, to open them both. */
+    cheese_camera_set_device (camera, devices[1]);
+    cheese_camera_set_frame_callback (camera, count_frame, (gpointer) &frames,
+                                      NULL);
+    cheese_camera_play (camera);
+    cheese_camera_switch_camera_device (camera);
+    wait_for_count (&frames, 5);
+    g_assert_cmpint (g_atomic_int_get (&frames), >=, 5);
+
+    /* Frames keep coming while the warm branches are switched between. */
+    for (i = 0; i < 4; i++)
+    {
+        gint before;
+
+        cheese_camera_set_device (camera, devices[i % 2]);
+        cheese_camera_switch_camera_device (camera);
+        g_assert_true (cheese_camera_get_selected_device (camera)
+                       == devices[i % 2]);
+
+        before = g_atomic_int_get (&frames);
+        wait_for_count (&frames, before + 5);
+        g_assert_cmpint (g_atomic_int_get (&frames), >=, before + 5);
+    }
+
+    cheese_camera_stop (camera);
+    g_object_unref (camera);
+    g_object_unref (devices[0]);
+    g_object_unref (devices[1]);
+}
+
+/* Test high frame rate mode on a device which only offers 30 FPS */
+static void
+camera_high_frame_rate (void)
+{
+    static const gchar * const elements[] = { "camerabin", "appsink",
+                                              "videotestsrc", NULL };
+    CheeseCameraDevice *device;
+    CheeseCamera *camera;
+    CheeseVideoFormat format = { 640, 480 };
+    GError *error = NULL;
+    volatile gint frames = 0;
+    volatile gint measured = 0;
+    gdouble rate;
+    guint high;
+
+    if (!have_elements (elements))
+        return;
+
+    device = cheese_test_device_new ("/dev/cheese-test0");
+    g_assert_cmpfloat (cheese_camera_device_get_max_framerate (device, &format),
+                       ==, 30.0);
+
+    camera = cheese_camera_new (NULL, NULL, 640, 480);
+    cheese_camera_set_high_frame_rate (camera, 1000);
+    g_object_get (camera, "high-frame-rate", &high, NULL);
+    g_assert_cmpuint (high, ==, CHEESE_CAMERA_DEVICE_MAX_FRAMERATE);
+    cheese_camera_set_high_frame_rate (camera, 60);
+
+    cheese_camera_setup (camera, device, &error);
+    g_assert_no_error (error);
+
+    g_signal_connect (camera, "notify::achieved-frame-rate",
+                      G_CALLBACK (count_notify), (gpointer) &measured);
+    cheese_camera_set_frame_callback (camera, count_frame, (gpointer) &frames,
+                                      NULL);
+    cheese_camera_play (camera);
+    wait_for_count (&frames, 5);
+    g_assert_cmpint (g_atomic_int_get (&frames), >=, 5);
+    wait_for_count (&measured, 1);
+    g_object_get (camera, "achieved-frame-rate", &rate, NULL);
+    g_assert_cmpfloat (rate, >, 0.0);
+
+    cheese_camera_stop (camera);
+    g_object_unref (camera);
+    g_object_unref (device);
+}
+
+/* Test CheeseCameraDevice with a format which is only offered at 60 FPS */
+static void
+cameradevice_high_rate_only (void)
+{
+    CheeseCameraDevice *device;
+    CheeseVideoFormat hd = { 1280, 720 };
+    CheeseVideoFormat *best;
+    GList *formats;
+    GstCaps *caps;
+    gint numerator, denominator;
+
+    device = cheese_test_device_new_with_caps ("/dev/cheese-test2",
+                                               "video/x-raw, format=(string)I420, "
+                                               "width=(int)640, height=(int)480, "
+                                               "framerate=(fraction)30/1; "
+                                               "video/x-raw, format=(string)I420, "
+                                               "width=(int)1280, height=(int)720, "
+                                               "framerate=(fraction)60/1");
+
+    /* The normal mode neither lists nor picks it. */
+    formats = cheese_camera_device_get_format_list (device);
+    g_assert_cmpuint (g_list_length (formats), ==, 1);
+    g_assert_cmpint (((CheeseVideoFormat *) formats->data)->width, ==, 640);
+    g_list_free (formats);
+
+    best = cheese_camera_device_get_best_format (device);
+    g_assert_cmpint (best->width, ==, 640);
+    g_boxed_free (CHEESE_TYPE_VIDEO_FORMAT, best);
+
+    caps = cheese_camera_device_get_caps_for_format (device, &hd);
+    g_assert_true (gst_caps_is_empty (caps));
+    gst_caps_unref (caps);
+
+    /* High frame rate mode still has it. */
+    g_assert_cmpfloat (cheese_camera_device_get_max_framerate (device, &hd),
+                       ==, 60.0);
+    caps = cheese_camera_device_get_caps_for_format_at_rate (device, &hd, 60);
+    g_assert_false (gst_caps_is_empty (caps));
+    g_assert_true (gst_structure_get_fraction (gst_caps_get_structure (caps, 0),
+                                               "framerate", &numerator,
+                                               &denominator));
+    g_assert_cmpint (numerator, ==, 60);
+    g_assert_cmpint (denominator, ==, 1);
+    gst_caps_unref (caps);
+
+    g_object_unref (device);
+}
+
 /* Test CheeseCameraDeviceMonitor */
 static void
 cameradevicemonitor_create (void)
@@ -41,6 +504,68 @@ cameradevicemonitor_create (void)
     g_object_unref (monitor);
 }
 
+/* Test CheeseCapsCache */
+static void
+capscache_roundtrip (void)
+{
+    CheeseCapsCache *cache;
+    CheeseCapsCacheFormat format = { 640, 480, 30, 1 };
+    GstCaps *caps, *other_caps, *filtered, *cached;
+    GArray *formats, *cached_formats;
+    GError *error = NULL;
+    gchar *dir, *filename;
+
+    dir = g_dir_make_tmp ("cheese-test-XXXXXX", &error);
+    g_assert_no_error (error);
+    filename = g_build_filename (dir, "devices.cache", NULL);
+
+    caps = gst_caps_from_string ("video/x-raw, width=(int)640, "
+                                 "height=(int)480, framerate=(fraction)30/1");
+    other_caps = gst_caps_from_string ("video/x-raw, width=(int)320, "
+                                       "height=(int)240, framerate=(fraction)30/1");
+    filtered = gst_caps_copy (caps);
+    formats = g_array_new (FALSE, FALSE, sizeof (CheeseCapsCacheFormat));
+    g_array_append_val (formats, format);
+
+    cache = cheese_caps_cache_new (filename);
+    g_assert_false (cheese_caps_cache_lookup (cache, "/dev/video0", "uvcvideo",
+                                              caps, &cached, &cached_formats));
+    cheese_caps_cache_store (cache, "/dev/video0", "uvcvideo", caps, filtered,
+                             formats);
+    cheese_caps_cache_free (cache);
+
+    /* The entry is read back from disk, and only for the same device. */
+    cache = cheese_caps_cache_new (filename);
+    g_assert_true (cheese_caps_cache_lookup (cache, "/dev/video0", "uvcvideo",
+                                             caps, &cached, &cached_formats));
+    g_assert_true (gst_caps_is_equal (cached, filtered));
+    g_assert_cmpuint (cached_formats->len, ==, 1);
+    g_assert_cmpint (g_array_index (cached_formats, CheeseCapsCacheFormat, 0).height,
+                     ==, 480);
+    g_assert_cmpint (g_array_index (cached_formats, CheeseCapsCacheFormat, 0).fr_numerator,
+                     ==, 30);
+    gst_caps_unref (cached);
+    g_array_unref (cached_formats);
+
+    g_assert_false (cheese_caps_cache_lookup (cache, "/dev/video0", "gspca",
+                                              caps, &cached, &cached_formats));
+    g_assert_false (cheese_caps_cache_lookup (cache, "/dev/video0", "uvcvideo",
+                                              other_caps, &cached,
+                                              &cached_formats));
+    g_assert_false (cheese_caps_cache_lookup (cache, "/dev/video1", "uvcvideo",
+                                              caps, &cached, &cached_formats));
+    cheese_caps_cache_free (cache);
+
+    g_array_unref (formats);
+    gst_caps_unref (filtered);
+    gst_caps_unref (other_caps);
+    gst_caps_unref (caps);
+    g_unlink (filename);
+    g_rmdir (dir);
+    g_free (filename);
+    g_free (dir);
+}
+
 /* Test CheeseEffect */
 static void
 effect_create (void)
@@ -58,6 +583,132 @@ effect_create (void)
     g_object_unref (effect);
 }
 
+/* Test CheeseEffectCache */
+static void
+effectcache_lru (void)
+{
+    CheeseEffectCache *cache;
+    GstElement *element, *first;
+
+    cache = cheese_effect_cache_new (2);
+    g_assert_null (cheese_effect_cache_take (cache, "identity"));
+
+    first = gst_object_ref_sink (gst_element_factory_make ("identity", NULL));
+    cheese_effect_cache_put (cache, "identity", gst_object_ref (first));
+    cheese_effect_cache_put (cache, "videoflip method=1",
+        gst_object_ref_sink (gst_element_factory_make ("identity", NULL)));
+    g_assert_cmpuint (cheese_effect_cache_get_length (cache), ==, 2);
+
+    /* Taking a bin makes it leave the cache, putting it back makes it the
+     * most recently used. */
+    element = cheese_effect_cache_take (cache, "identity");
+    g_assert_true (element == first);
+    g_assert_false (cheese_effect_cache_contains (cache, "identity"));
+    cheese_effect_cache_put (cache, "identity", element);
+
+    /* The least recently used bin is dropped when the cache is full. */
+    cheese_effect_cache_put (cache, "videoflip method=2",
+        gst_object_ref_sink (gst_element_factory_make ("identity", NULL)));
+    g_assert_cmpuint (cheese_effect_cache_get_length (cache), ==, 2);
+    g_assert_false (cheese_effect_cache_contains (cache, "videoflip method=1"));
+    g_assert_true (cheese_effect_cache_contains (cache, "identity"));
+    g_assert_true (cheese_effect_cache_contains (cache, "videoflip method=2"));
+
+    cheese_effect_cache_free (cache);
+    g_assert_cmpint (GST_OBJECT_REFCOUNT_VALUE (first), ==, 1);
+    gst_object_unref (first);
+}
+
+/* Test the effect optimizer */
+static gchar *
+effectoptimizer_describe (const gchar *effect_desc)
+{
+    GstElement *bin, *element;
+    GstPad *pad, *peer;
+    GString *chain;
+    GError *error = NULL;
+
+    bin = cheese_effect_optimizer_parse (effect_desc, FALSE, &error);
+    g_assert_no_error (error);
+    gst_object_ref_sink (bin);
+
+    chain = g_string_new (NULL);
+    pad = gst_bin_find_unlinked_pad (GST_BIN (bin), GST_PAD_SINK);
+    while (pad != NULL)
+    {
+        element = gst_pad_get_parent_element (pad);
+        gst_object_unref (pad);
+
+        if (chain->len > 0)
+            g_string_append (chain, " ! ");
+        g_string_append (chain, GST_OBJECT_NAME (gst_element_get_factory (element)));
+        if (g_str_equal (G_OBJECT_TYPE_NAME (element), "GstVideoFlip"))
+        {
+            gint method;
+
+            g_object_get (element, "method", &method, NULL);
+            g_string_append_printf (chain, " method=%d", method);
+        }
+
+        pad = gst_element_get_static_pad (element, "src");
+        peer = gst_pad_get_peer (pad);
+        gst_object_unref (pad);
+        gst_object_unref (element);
+        pad = peer;
+    }
+
+    gst_object_unref (bin);
+
+    return g_string_free (chain, FALSE);
+}
+
+static void
+effectoptimizer_rewrite (void)
+{
+    const gchar *elements[] = { "videoflip", "videoscale", "videobalance",
+                                NULL };
+    gchar *chain;
+
+    if (!have_elements (elements))
+        return;
+
+    /* No-ops are removed, flips which cancel out and their converters too. */
+    chain = effectoptimizer_describe ("identity ! videoconvert ! "
+                                      "videoflip method=horizontal-flip ! "
+                                      "videoflip method=horizontal-flip ! "
+                                      "videoconvert ! videobalance");
+    g_assert_cmpstr (chain, ==, "videoconvert");
+    g_free (chain);
+
+    /* Two quarter turns make a half turn. */
+    chain = effectoptimizer_describe ("videoflip method=clockwise ! "
+                                      "videoflip method=clockwise");
+    g_assert_cmpstr (chain, ==, "videoflip method=2");
+    g_free (chain);
+
+    /* A flip moves after a scale to a fixed size, a quarter turn cannot. */
+    chain = effectoptimizer_describe ("videoflip method=vertical-flip ! "
+                                      "videoscale ! "
+                                      "video/x-raw, width=160, height=120");
+    g_assert_cmpstr (chain, ==, "videoscale ! capsfilter ! videoflip method=5");
+    g_free (chain);
+    chain = effectoptimizer_describe ("videoflip method=clockwise ! "
+                                      "videoscale ! "
+                                      "video/x-raw, width=160, height=120");
+    g_assert_cmpstr (chain, ==, "videoflip method=1 ! videoscale ! capsfilter");
+    g_free (chain);
+
+    /* Set properties make an element count. */
+    chain = effectoptimizer_describe ("identity ! videobalance saturation=0");
+    g_assert_cmpstr (chain, ==, "videobalance");
+    g_free (chain);
+
+    /* The only element of an effect stays. */
+    chain = effectoptimizer_describe ("identity");
+    g_assert_cmpstr (chain, ==, "identity");
+    g_free (chain);
+}
+
 /* Test CheeseFileUtil */
 static void
 fileutil_burst (void)
@@ -151,6 +802,13 @@ fileutil_new_media_filename (void)
     g_assert_true (g_str_has_suffix (filename, CHEESE_VIDEO_NAME_SUFFIX));
     g_assert_false (g_file_test (filename, G_FILE_TEST_EXISTS));
 
+    filename = cheese_fileutil_get_new_video_filename (fileutil,
+        CHEESE_MATROSKA_VIDEO_NAME_SUFFIX);
+    g_assert_nonnull (filename);
+    g_assert_true (g_str_has_suffix (filename,
+        CHEESE_MATROSKA_VIDEO_NAME_SUFFIX));
+    g_assert_false (g_file_test (filename, G_FILE_TEST_EXISTS));
+
     g_object_unref (fileutil);
 }
 
@@ -188,6 +846,717 @@ fileutil_video_path (void)
     g_object_unref (fileutil);
 }
 
+/* Get the nick of the value of an enumeration property. */
+static const gchar *
+encoderprofile_get_nick (GstElement *element, const gchar *property)
+{
+    GParamSpec *pspec;
+    GEnumValue *value;
+    gint index;
+
+    pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (element),
+                                          property);
+    g_assert_true (G_IS_PARAM_SPEC_ENUM (pspec));
+    g_object_get (element, property, &index, NULL);
+    value = g_enum_get_value (G_PARAM_SPEC_ENUM (pspec)->enum_class, index);
+    g_assert_nonnull (value);
+
+    return value->value_nick;
+}
+
+/* Test the encoder profile registry used for video recording */
+static void
+encoderprofile_configure (void)
+{
+    const CheeseEncoderProfile *profile;
+    GstElement *encoder;
+    gchar *partitions;
+    guint threads;
+    gint value;
+
+    profile = cheese_encoder_profile_lookup (CHEESE_ENCODER_PROFILE_DEFAULT);
+    g_assert_nonnull (profile);
+    g_assert_cmpstr (cheese_encoder_profile_get_suffix (profile), ==,
+        CHEESE_VIDEO_NAME_SUFFIX);
+    profile = cheese_encoder_profile_lookup ("h264");
+    g_assert_nonnull (profile);
+    g_assert_cmpstr (cheese_encoder_profile_get_suffix (profile), ==,
+        CHEESE_MATROSKA_VIDEO_NAME_SUFFIX);
+    g_assert_null (cheese_encoder_profile_lookup ("theora"));
+
+    threads = cheese_encoder_profile_get_threads (1920, 1080);
+    g_assert_cmpuint (threads, >=, 1);
+    g_assert_cmpuint (threads, <=, 1080 / 120);
+
+    /* Tiles are at least 256 pixels wide, and no more than the threads. */
+    g_assert_cmpuint (cheese_encoder_profile_get_tile_columns_log2 (1920, 8), ==, 2);
+    g_assert_cmpuint (cheese_encoder_profile_get_tile_columns_log2 (1920, 2), ==, 1);
+    g_assert_cmpuint (cheese_encoder_profile_get_tile_columns_log2 (1920, 1), ==, 0);
+    g_assert_cmpuint (cheese_encoder_profile_get_tile_columns_log2 (320, 8), ==, 0);
+
+    encoder = gst_element_factory_make ("vp8enc", NULL);
+    if (encoder == NULL)
+    {
+        g_test_skip ("vp8enc is not installed");
+        return;
+    }
+
+    cheese_encoder_profile_configure (encoder, 1920, 1080);
+    g_object_get (encoder, "threads", &value, NULL);
+    g_assert_cmpint (value, ==, threads);
+    g_object_get (encoder, "lag-in-frames", &value, NULL);
+    g_assert_cmpint (value, ==, 0);
+    partitions = g_strdup_printf ("%u",
+                                  1u << g_bit_nth_msf (MIN (threads, 8), -1));
+    g_assert_cmpstr (encoderprofile_get_nick (encoder, "token-partitions"), ==,
+                     partitions);
+    g_free (partitions);
+
+    gst_object_unref (encoder);
+}
+
+/* Test that the x264 preset gets faster with each resolution class and speed
+ * step, and that step 0 keeps the configured preset. */
+static void
+encoderprofile_x264_presets (void)
+{
+    const gint sizes[][2] = { { 640, 480 }, { 1280, 720 }, { 1920, 1080 } };
+    const gchar * const presets[] = { "veryfast", "superfast", "ultrafast" };
+    GstElement *encoder;
+    guint level, step;
+
+    encoder = gst_element_factory_make ("x264enc", NULL);
+    if (encoder == NULL)
+    {
+        g_test_skip ("x264enc is not installed");
+        return;
+    }
+    gst_object_ref_sink (encoder);
+
+    for (level = 0; level < G_N_ELEMENTS (sizes); level++)
+    {
+        cheese_encoder_profile_configure (encoder, sizes[level][0],
+                                          sizes[level][1]);
+        g_assert_cmpstr (encoderprofile_get_nick (encoder, "speed-preset"), ==,
+                         presets[level]);
+
+        for (step = 0; step <= CHEESE_ENCODER_PROFILE_SPEED_STEPS; step++)
+        {
+            cheese_encoder_profile_adjust (encoder, sizes[level][0],
+                                           sizes[level][1], step, 1.0);
+            g_assert_cmpstr (encoderprofile_get_nick (encoder, "speed-preset"),
+                             ==, presets[MIN (level + step, 2)]);
+        }
+    }
+
+    gst_object_unref (encoder);
+}
+
+/* Feed the governor one second of an encoder which manages @out of @in
+ * frames, and return its decision. */
+static CheeseEncoderGovernorAction
+encodergovernor_step (CheeseEncoderGovernor *governor, guint64 *in,
+                      guint64 *out, guint in_frames, guint out_frames)
+{
+    *in += in_frames;
+    *out += out_frames;
+
+    return cheese_encoder_governor_update (governor, *in, *out, 0, 0, 1.0);
+}
+
+/* Test the encoder governor with an encoder throttled to 20 of 30 fps */
+static void
+encodergovernor_throttled (void)
+{
+    CheeseEncoderGovernor *governor;
+    CheeseEncoderGovernorAction action;
+    guint64 in = 0, out = 0;
+    guint i;
+
+    governor = cheese_encoder_governor_new (30, 2);
+
+    /* The first update only sets the starting point. */
+    g_assert_cmpint (encodergovernor_step (governor, &in, &out, 30, 30), ==,
+        CHEESE_ENCODER_GOVERNOR_KEEP);
+
+    /* Speed first, waiting a period after each change, then bitrate. */
+    g_assert_cmpint (encodergovernor_step (governor, &in, &out, 30, 20), ==,
+        CHEESE_ENCODER_GOVERNOR_SPEED_UP);
+    g_assert_cmpint (encodergovernor_step (governor, &in, &out, 30, 20), ==,
+        CHEESE_ENCODER_GOVERNOR_KEEP);
+    g_assert_cmpint (encodergovernor_step (governor, &in, &out, 30, 20), ==,
+        CHEESE_ENCODER_GOVERNOR_SPEED_UP);
+    g_assert_cmpuint (cheese_encoder_governor_get_speed_step (governor), ==, 2);
+    encodergovernor_step (governor, &in, &out, 30, 20);
+    g_assert_cmpint (encodergovernor_step (governor, &in, &out, 30, 20), ==,
+        CHEESE_ENCODER_GOVERNOR_BITRATE_DOWN);
+    g_assert_cmpfloat (cheese_encoder_governor_get_bitrate_scale (governor), <, 1.0);
+
+    /* The bitrate is bounded, then nothing is left to adjust. */
+    for (i = 0; i < 20; i++)
+    {
+        action = encodergovernor_step (governor, &in, &out, 30, 20);
+        g_assert_cmpint (action, !=, CHEESE_ENCODER_GOVERNOR_SPEED_UP);
+    }
+    g_assert_cmpfloat (cheese_encoder_governor_get_bitrate_scale (governor), >=, 0.5);
+    g_assert_cmpint (encodergovernor_step (governor, &in, &out, 30, 20), ==,
+        CHEESE_ENCODER_GOVERNOR_KEEP);
+
+    /* QoS events alone count as falling behind, and restart the wait before
+     * anything is relaxed. */
+    g_assert_cmpint (cheese_encoder_governor_update (governor, in + 30,
+        out + 30, 1, 0, 1.0), ==, CHEESE_ENCODER_GOVERNOR_KEEP);
+    in += 30;
+    out += 30;
+
+    /* Once the encoder keeps up, the bitrate is restored first. */
+    for (i = 0; i < 4; i++)
+        g_assert_cmpint (encodergovernor_step (governor, &in, &out, 30, 30), ==,
+            CHEESE_ENCODER_GOVERNOR_KEEP);
+    g_assert_cmpint (encodergovernor_step (governor, &in, &out, 30, 30), ==,
+        CHEESE_ENCODER_GOVERNOR_BITRATE_UP);
+
+    /* A camera slower than the target is not the encoder falling behind. */
+    cheese_encoder_governor_free (governor);
+    governor = cheese_encoder_governor_new (30, 2);
+    encodergovernor_step (governor, &in, &out, 15, 15);
+    for (i = 0; i < 4; i++)
+        g_assert_cmpint (encodergovernor_step (governor, &in, &out, 15, 15), ==,
+            CHEESE_ENCODER_GOVERNOR_KEEP);
+
+    /* Frames piling up in front of the encoder count as falling behind, even
+     * while it still produces as many as go in. */
+    in += 30;
+    out += 30;
+    g_assert_cmpint (cheese_encoder_governor_update (governor, in, out, 0, 20,
+        1.0), ==, CHEESE_ENCODER_GOVERNOR_SPEED_UP);
+
+    cheese_encoder_governor_free (governor);
+}
+
+/* Test the cost model of format selection */
+static void
+formatcost_score (void)
+{
+    gdouble raw, jpeg;
+    gchar *reason = NULL;
+
+    /* Raw 1080p is bound by the bus, JPEG 1080p30 wins. */
+    raw = cheese_format_cost_score (1920, 1080, 5, FALSE, 30, 0, 6, NULL);
+    jpeg = cheese_format_cost_score (1920, 1080, 30, TRUE, 30, 0, 6, &reason);
+    g_assert_cmpfloat (jpeg, >, raw);
+    g_assert_nonnull (g_strstr_len (reason, -1, "JPEG at 30 fps"));
+    g_free (reason);
+
+    /* At the same framerate, raw video spares the CPU. */
+    raw = cheese_format_cost_score (640, 480, 30, FALSE, 30, 0, 6, NULL);
+    jpeg = cheese_format_cost_score (640, 480, 30, TRUE, 30, 0, 6, NULL);
+    g_assert_cmpfloat (raw, >, jpeg);
+
+    /* Expensive effects make a smaller format the better choice. */
+    jpeg = cheese_format_cost_score (1920, 1080, 30, TRUE, 30, 50, 6, &reason);
+    raw = cheese_format_cost_score (640, 480, 30, FALSE, 30, 50, 6, NULL);
+    g_assert_cmpfloat (raw, >, jpeg);
+    g_assert_nonnull (g_strstr_len (reason, -1, "limited by effects"));
+    g_free (reason);
+}
+
+/* Test the limits of CheeseFrameRing */
+static void
+framering_limits (void)
+{
+    CheeseFrameRing *ring;
+    GstClockTime running_time;
+    GstBuffer *buffer;
+    guint i;
+
+    ring = cheese_frame_ring_new (1000, GST_SECOND);
+
+    /* The byte budget keeps the newest four frames of 250 bytes. */
+    for (i = 0; i < 6; i++)
+        cheese_frame_ring_push (ring, gst_buffer_new_allocate (NULL, 250, NULL),
+            i * 10 * GST_MSECOND);
+    g_assert_cmpuint (cheese_frame_ring_get_length (ring), ==, 4);
+    g_assert_cmpuint (cheese_frame_ring_get_size (ring), ==, 1000);
+
+    /* Frames come out oldest first. */
+    buffer = cheese_frame_ring_pop (ring, &running_time);
+    g_assert_nonnull (buffer);
+    g_assert_cmpuint (running_time, ==, 20 * GST_MSECOND);
+    gst_buffer_unref (buffer);
+    g_assert_cmpuint (cheese_frame_ring_get_size (ring), ==, 750);
+
+    /* A frame larger than the budget is not kept. */
+    cheese_frame_ring_push (ring, gst_buffer_new_allocate (NULL, 2000, NULL),
+        60 * GST_MSECOND);
+    g_assert_cmpuint (cheese_frame_ring_get_length (ring), ==, 3);
+
+    /* The duration drops frames more than a second older than the newest. */
+    cheese_frame_ring_push (ring, gst_buffer_new_allocate (NULL, 10, NULL),
+        GST_SECOND + 40 * GST_MSECOND);
+    g_assert_cmpuint (cheese_frame_ring_get_length (ring), ==, 3);
+    buffer = cheese_frame_ring_pop (ring, &running_time);
+    g_assert_cmpuint (running_time, ==, 40 * GST_MSECOND);
+    gst_buffer_unref (buffer);
+
+    /* Finding the closest frame leaves it in the ring. */
+    buffer = cheese_frame_ring_find (ring, 600 * GST_MSECOND, &running_time);
+    g_assert_nonnull (buffer);
+    g_assert_cmpuint (running_time, ==, 50 * GST_MSECOND);
+    gst_buffer_unref (buffer);
+    buffer = cheese_frame_ring_find (ring, 2 * GST_SECOND, &running_time);
+    g_assert_cmpuint (running_time, ==, GST_SECOND + 40 * GST_MSECOND);
+    gst_buffer_unref (buffer);
+    g_assert_cmpuint (cheese_frame_ring_get_length (ring), ==, 2);
+
+    /* A frame count bounds small frames at a high frame rate, newest kept. */
+    cheese_frame_ring_set_max_frames (ring, 1);
+    g_assert_cmpuint (cheese_frame_ring_get_length (ring), ==, 1);
+    for (i = 0; i < 4; i++)
+        cheese_frame_ring_push (ring, gst_buffer_new_allocate (NULL, 10, NULL),
+            GST_SECOND + (50 + i) * GST_MSECOND);
+    g_assert_cmpuint (cheese_frame_ring_get_length (ring), ==, 1);
+    buffer = cheese_frame_ring_find (ring, 0, &running_time);
+    g_assert_cmpuint (running_time, ==, GST_SECOND + 53 * GST_MSECOND);
+    gst_buffer_unref (buffer);
+
+    /* No duration keeps nothing. */
+    cheese_frame_ring_set_max_duration (ring, 0);
+    g_assert_cmpuint (cheese_frame_ring_get_length (ring), ==, 0);
+    g_assert_cmpuint (cheese_frame_ring_get_size (ring), ==, 0);
+    cheese_frame_ring_push (ring, gst_buffer_new_allocate (NULL, 10, NULL), 0);
+    g_assert_null (cheese_frame_ring_pop (ring, &running_time));
+
+    cheese_frame_ring_free (ring);
+}
+
+/* Test CheeseKernel */
+static void
+kernel_isa (void)
+{
+    const gdouble hues[] = { 0.0, 0.3, -0.7, 1.0 };
+    const gdouble saturations[] = { 1.0, 0.0, 2.0, 0.5 };
+    guint8 src_u[300], src_v[300];
+    guint8 expected_u[300], expected_v[300], dest_u[300], dest_v[300];
+    CheeseKernelParams params;
+    CheeseKernelIsa isa;
+    gint look, mirror, i, width;
+
+    for (i = 0; i < G_N_ELEMENTS (src_u); i++)
+    {
+        src_u[i] = g_test_rand_int_range (0, 256);
+        src_v[i] = g_test_rand_int_range (0, 256);
+    }
+
+    /* Every instruction set must give the same result as plain C, including
+     * on the pixels at the ends of rows of any width. */
+    for (isa = CHEESE_KERNEL_ISA_SSE2; isa <= CHEESE_KERNEL_ISA_NEON; isa++)
+    {
+        if (!cheese_kernel_isa_supported (isa))
+            continue;
+
+        for (look = CHEESE_KERNEL_LOOK_NORMAL; look <= CHEESE_KERNEL_LOOK_VINTAGE; look++)
+            for (mirror = 0; mirror < 2; mirror++)
+                for (i = 0; i < G_N_ELEMENTS (hues); i++)
+                    for (width = 1; width < G_N_ELEMENTS (src_u); width += 7)
+                    {
+                        cheese_kernel_params_init (&params, look, 0.0, 1.0,
+                                                   hues[i], saturations[i],
+                                                   mirror);
+                        cheese_kernel_process_chroma (CHEESE_KERNEL_ISA_SCALAR,
+                                                      &params, src_u, src_v,
+                                                      expected_u, expected_v,
+                                                      width);
+                        cheese_kernel_process_chroma (isa, &params,
+                                                      src_u, src_v,
+                                                      dest_u, dest_v, width);
+                        g_assert_cmpmem (dest_u, width, expected_u, width);
+                        g_assert_cmpmem (dest_v, width, expected_v, width);
+                    }
+    }
+}
+
+static void
+kernel_looks (void)
+{
+    guint8 src[64], dest[64], src_u[64], src_v[64], dest_u[64], dest_v[64];
+    CheeseKernelParams params;
+    gint i;
+
+    for (i = 0; i < G_N_ELEMENTS (src); i++)
+    {
+        src[i] = i * 4;
+        src_u[i] = 255 - i;
+        src_v[i] = i;
+    }
+
+    /* Grayscale drops the chroma and keeps the luma. */
+    cheese_kernel_params_init (&params, CHEESE_KERNEL_LOOK_GRAYSCALE, 0.0,
+                               1.0, 0.0, 1.0, FALSE);
+    cheese_kernel_process_luma (&params, src, dest, G_N_ELEMENTS (src));
+    g_assert_cmpmem (dest, sizeof (dest), src, sizeof (src));
+    cheese_kernel_process_chroma (cheese_kernel_get_isa (), &params,
+                                  src_u, src_v, dest_u, dest_v,
+                                  G_N_ELEMENTS (src_u));
+    for (i = 0; i < G_N_ELEMENTS (dest_u); i++)
+    {
+        g_assert_cmpuint (dest_u[i], ==, 128);
+        g_assert_cmpuint (dest_v[i], ==, 128);
+    }
+
+    /* Mirroring reverses the rows and leaves the pixels alone. */
+    cheese_kernel_params_init (&params, CHEESE_KERNEL_LOOK_NORMAL, 0.0,
+                               1.0, 0.0, 1.0, TRUE);
+    cheese_kernel_process_luma (&params, src, dest, G_N_ELEMENTS (src));
+    cheese_kernel_process_chroma (cheese_kernel_get_isa (), &params,
+                                  src_u, src_v, dest_u, dest_v,
+                                  G_N_ELEMENTS (src_u));
+    for (i = 0; i < G_N_ELEMENTS (src); i++)
+    {
+        g_assert_cmpuint (dest[i], ==, src[G_N_ELEMENTS (src) - 1 - i]);
+        g_assert_cmpuint (dest_u[i], ==, src_u[G_N_ELEMENTS (src) - 1 - i]);
+        g_assert_cmpuint (dest_v[i], ==, src_v[G_N_ELEMENTS (src) - 1 - i]);
+    }
+}
+
+static void
+kernel_balance (void)
+{
+    CheeseKernelParams params;
+    GstElement *kernel;
+
+    kernel = gst_object_ref_sink (gst_element_factory_make ("cheesekernel",
+                                                            NULL));
+    g_assert_nonnull (kernel);
+
+    /* Frames pass through while the balance is neutral, and are processed
+     * again as soon as a slider moves. */
+    g_assert_true (gst_base_transform_is_passthrough (GST_BASE_TRANSFORM (kernel)));
+    g_object_set (kernel, "brightness", 0.1, NULL);
+    g_assert_false (gst_base_transform_is_passthrough (GST_BASE_TRANSFORM (kernel)));
+    g_object_set (kernel, "brightness", 0.0, "saturation", 0.5, NULL);
+    g_assert_false (gst_base_transform_is_passthrough (GST_BASE_TRANSFORM (kernel)));
+    g_object_set (kernel, "saturation", 1.0, NULL);
+    g_assert_true (gst_base_transform_is_passthrough (GST_BASE_TRANSFORM (kernel)));
+
+    /* Processed frames are changed in place, without a new buffer. */
+    g_assert_true (gst_base_transform_is_in_place (GST_BASE_TRANSFORM (kernel)));
+
+    gst_object_unref (kernel);
+
+    /* The luma curve is that of videobalance. */
+    cheese_kernel_params_init (&params, CHEESE_KERNEL_LOOK_NORMAL, 0.2, 1.5,
+                               0.0, 1.0, FALSE);
+    g_assert_cmpuint (params.luma[16], ==, 67);
+    g_assert_cmpuint (params.luma[100], ==, 193);
+    g_assert_cmpuint (params.luma[200], ==, 255);
+    g_assert_cmpuint (params.luma[0], ==, 43);
+}
+
+static void
+kernel_benchmark (void)
+{
+    const gchar *isa_names[] = { "C", "SSE2", "AVX2", "NEON" };
+    const gint width = 1280, height = 720, rounds = 50;
+    guint8 *luma, *u, *v, *dest, *dest_u, *dest_v;
+    CheeseKernelParams params;
+    CheeseKernelIsa isa;
+    GstElement *filter;
+    GstBuffer *buffer;
+    GError *error = NULL;
+    gdouble chain_fps, kernel_fps;
+    gint64 start;
+    gint i, y;
+
+    luma = g_malloc (width * height);
+    dest = g_malloc (width * height);
+    u = g_malloc0 (width * height / 4);
+    v = g_malloc0 (width * height / 4);
+    dest_u = g_malloc (width * height / 4);
+    dest_v = g_malloc (width * height / 4);
+    cheese_kernel_params_init (&params, CHEESE_KERNEL_LOOK_SEPIA, 0.0, 1.0,
+                               0.0, 1.0, TRUE);
+
+    /* The kernels alone, on an I420 frame. */
+    for (isa = CHEESE_KERNEL_ISA_SCALAR; isa <= CHEESE_KERNEL_ISA_NEON; isa++)
+    {
+        if (!cheese_kernel_isa_supported (isa))
+            continue;
+
+        start = g_get_monotonic_time ();
+        for (i = 0; i < rounds; i++)
+        {
+            for (y = 0; y < height; y++)
+                cheese_kernel_process_luma (&params, luma + y * width,
+                                            dest + y * width, width);
+            for (y = 0; y < height / 2; y++)
+                cheese_kernel_process_chroma (isa, &params,
+                                              u + y * width / 2,
+                                              v + y * width / 2,
+                                              dest_u + y * width / 2,
+                                              dest_v + y * width / 2,
+                                              width / 2);
+        }
+        g_test_message ("sepia, mirrored, %s: %.3f ns per pixel",
+                        isa_names[isa],
+                        (g_get_monotonic_time () - start) * 1000.0 /
+                        ((gdouble) rounds * width * height));
+    }
+
+    g_free (luma);
+    g_free (dest);
+    g_free (u);
+    g_free (v);
+    g_free (dest_u);
+    g_free (dest_v);
+
+    /* The element against the chain of stock elements it replaces. */
+    filter = gst_parse_bin_from_description ("videoflip method=horizontal-flip ! "
+                                             "videobalance saturation=0",
+                                             TRUE, &error);
+    g_assert_no_error (error);
+    buffer = run_filter (filter, width, height, 200, FALSE, &chain_fps);
+    gst_buffer_unref (buffer);
+
+    filter = gst_parse_bin_from_description ("cheesekernel look=grayscale mirror=true",
+                                             TRUE, &error);
+    g_assert_no_error (error);
+    buffer = run_filter (filter, width, height, 200, FALSE, &kernel_fps);
+    gst_buffer_unref (buffer);
+
+    g_test_message ("grayscale, mirrored, at %dx%d: %.1f fps chained, "
+                    "%.1f fps fused", width, height, chain_fps, kernel_fps);
+    g_test_maximized_result (kernel_fps / chain_fps,
+                             "speed-up of the fused kernel: %.2f",
+                             kernel_fps / chain_fps);
+}
+
+/* Test CheeseMultiCapture */
+static guint64
+multicapture_get_frames (CheeseMultiCapture *capture, guint index)
+{
+    GstStructure *stats;
+    guint64 frames = 0;
+
+    stats = cheese_multi_capture_get_stats (capture, index);
+    gst_structure_get_uint64 (stats, "frames", &frames);
+    gst_structure_free (stats);
+
+    return frames;
+}
+
+static void
+count_finished (CheeseMultiCapture *capture, gpointer user_data)
+{
+    g_atomic_int_inc ((volatile gint *) user_data);
+}
+
+static void
+multicapture_separate (void)
+{
+    static const gchar * const elements[] = { "videotestsrc", "vp8enc",
+                                              "matroskamux", NULL };
+    CheeseMultiCapture *capture;
+    GPtrArray *devices;
+    GError *error = NULL;
+    gchar *dir, *location, *path;
+    volatile gint finished = 0;
+    gint64 end;
+    guint i;
+
+    if (!have_elements (elements))
+        return;
+
+    devices = g_ptr_array_new_with_free_func (g_object_unref);
+    g_ptr_array_add (devices, cheese_test_device_new ("/dev/cheese-test0"));
+    g_ptr_array_add (devices, cheese_test_device_new ("/dev/cheese-test1"));
+    capture = cheese_multi_capture_new (devices, FALSE);
+    g_ptr_array_unref (devices);
+    g_assert_cmpuint (cheese_multi_capture_get_n_streams (capture), ==, 2);
+
+    dir = g_dir_make_tmp ("cheese-test-XXXXXX", &error);
+    g_assert_no_error (error);
+    location = g_build_filename (dir, "capture", NULL);
+
+    g_signal_connect (capture, "finished", G_CALLBACK (count_finished),
+                      (gpointer) &finished);
+    cheese_multi_capture_start (capture, location, &error);
+    g_assert_no_error (error);
+    g_assert_true (cheese_multi_capture_is_running (capture));
+
+    /* Both streams run on the clock of the same pipeline. */
+    end = g_get_monotonic_time () + 5 * G_TIME_SPAN_SECOND;
+    while ((multicapture_get_frames (capture, 0) < 5
+            || multicapture_get_frames (capture, 1) < 5)
+           && g_get_monotonic_time () < end)
+    {
+        g_main_context_iteration (NULL, FALSE);
+        g_usleep (10000);
+    }
+    g_assert_cmpuint (multicapture_get_frames (capture, 0), >=, 5);
+    g_assert_cmpuint (multicapture_get_frames (capture, 1), >=, 5);
+
+    cheese_multi_capture_stop (capture);
+    wait_for_count (&finished, 1);
+    g_assert_cmpint (g_atomic_int_get (&finished), ==, 1);
+    g_assert_false (cheese_multi_capture_is_running (capture));
+
+    for (i = 1; i <= 2; i++)
+    {
+        path = g_strdup_printf ("%s-%u.mkv", location, i);
+        g_assert_true (g_file_test (path, G_FILE_TEST_IS_REGULAR));
+        g_unlink (path);
+        g_free (path);
+    }
+
+    g_rmdir (dir);
+    g_free (location);
+    g_free (dir);
+    g_object_unref (capture);
+}
+
+/* Test cheese_pixbuf_new_from_sample() */
+static void
+pixbuf_zero_copy (void)
+{
+    GstBuffer *buffer;
+    GstCaps *caps;
+    GstSample *sample;
+    GstMemory *memory;
+    GstMapInfo map;
+    GdkPixbuf *pixbuf;
+
+    /* Rows of three RGB pixels are padded to 12 bytes. */
+    buffer = gst_buffer_new_allocate (NULL, 24, NULL);
+    gst_buffer_memset (buffer, 0, 0x80, 24);
+    caps = gst_caps_new_simple ("video/x-raw", "format", G_TYPE_STRING, "RGB",
+        "width", G_TYPE_INT, 3, "height", G_TYPE_INT, 2, NULL);
+    sample = gst_sample_new (buffer, caps, NULL, NULL);
+    gst_caps_unref (caps);
+
+    pixbuf = cheese_pixbuf_new_from_sample (sample);
+    gst_sample_unref (sample);
+    g_assert_nonnull (pixbuf);
+    g_assert_cmpint (gdk_pixbuf_get_width (pixbuf), ==, 3);
+    g_assert_cmpint (gdk_pixbuf_get_height (pixbuf), ==, 2);
+    g_assert_cmpint (gdk_pixbuf_get_rowstride (pixbuf), ==, 12);
+
+    /* The pixbuf is the buffer, which stays mapped for reading and cannot
+     * be mapped for writing while the pixbuf lives. */
+    memory = gst_buffer_peek_memory (buffer, 0);
+    g_assert_true (gst_memory_map (memory, &map, GST_MAP_READ));
+    g_assert_true (gdk_pixbuf_get_pixels (pixbuf) == map.data);
+    gst_memory_unmap (memory, &map);
+    g_assert_false (gst_memory_map (memory, &map, GST_MAP_WRITE));
+    g_assert_cmpint (GST_MINI_OBJECT_REFCOUNT_VALUE (buffer), ==, 2);
+
+    /* Freeing the pixbuf unmaps the buffer and drops its reference. */
+    g_object_unref (pixbuf);
+    g_assert_cmpint (GST_MINI_OBJECT_REFCOUNT_VALUE (buffer), ==, 1);
+    g_assert_true (gst_memory_map (memory, &map, GST_MAP_WRITE));
+    gst_memory_unmap (memory, &map);
+
+    gst_buffer_unref (buffer);
+}
+
+/* Test CheeseStripeBin */
+static void
+stripebin_identical (void)
+{
+    const gchar *effect_desc = "videoflip method=horizontal-flip";
+    GstElement *filter;
+    GstBuffer *plain, *striped;
+    GstMapInfo plain_map, striped_map;
+    GError *error = NULL;
+    gdouble fps;
+
+    filter = gst_parse_bin_from_description (effect_desc, TRUE, &error);
+    g_assert_no_error (error);
+    plain = run_filter (filter, 320, 240, 5, FALSE, &fps);
+
+    filter = cheese_stripe_bin_new (effect_desc, 3, &error);
+    g_assert_no_error (error);
+    striped = run_filter (filter, 320, 240, 5, FALSE, &fps);
+
+    /* A stripe-safe effect looks the same when it is applied per stripe. */
+    gst_buffer_map (plain, &plain_map, GST_MAP_READ);
+    gst_buffer_map (striped, &striped_map, GST_MAP_READ);
+    g_assert_cmpmem (plain_map.data, plain_map.size,
+                     striped_map.data, striped_map.size);
+    gst_buffer_unmap (plain, &plain_map);
+    gst_buffer_unmap (striped, &striped_map);
+
+    gst_buffer_unref (plain);
+    gst_buffer_unref (striped);
+}
+
+/* Test CheeseStripeBin with stripes later than a frame interval allows for */
+static void
+stripebin_late (void)
+{
+    const gchar *effect_desc = "identity sleep-time=25000 ! "
+                               "videoflip method=horizontal-flip";
+    GstElement *filter;
+    GstBuffer *plain, *striped;
+    GstMapInfo plain_map, striped_map;
+    GError *error = NULL;
+    gdouble fps;
+
+    filter = gst_parse_bin_from_description (effect_desc, TRUE, &error);
+    g_assert_no_error (error);
+    plain = run_filter (filter, 320, 240, 10, TRUE, &fps);
+
+    filter = cheese_stripe_bin_new (effect_desc, 3, &error);
+    g_assert_no_error (error);
+    striped = run_filter (filter, 320, 240, 10, TRUE, &fps);
+
+    /* In a live pipeline, late stripes are waited for, not left out. */
+    gst_buffer_map (plain, &plain_map, GST_MAP_READ);
+    gst_buffer_map (striped, &striped_map, GST_MAP_READ);
+    g_assert_cmpmem (plain_map.data, plain_map.size,
+                     striped_map.data, striped_map.size);
+    gst_buffer_unmap (plain, &plain_map);
+    gst_buffer_unmap (striped, &striped_map);
+
+    gst_buffer_unref (plain);
+    gst_buffer_unref (striped);
+}
+
+static void
+stripebin_benchmark (void)
+{
+    const gchar *effect_desc = "gamma gamma=2.0";
+    GstElement *filter;
+    GstBuffer *buffer;
+    GError *error = NULL;
+    gdouble plain_fps, striped_fps;
+    guint n_stripes;
+
+    n_stripes = CLAMP (g_get_num_processors (), 2,
+                       CHEESE_STRIPE_BIN_MAX_STRIPES);
+
+    filter = gst_parse_bin_from_description (effect_desc, TRUE, &error);
+    if (filter == NULL)
+    {
+        g_test_skip ("gamma element not found");
+        g_clear_error (&error);
+        return;
+    }
+    buffer = run_filter (filter, 1280, 720, 200, FALSE, &plain_fps);
+    gst_buffer_unref (buffer);
+
+    filter = cheese_stripe_bin_new (effect_desc, n_stripes, &error);
+    g_assert_no_error (error);
+    buffer = run_filter (filter, 1280, 720, 200, FALSE, &striped_fps);
+    gst_buffer_unref (buffer);
+
+    g_test_message ("%s at 1280x720: %.1f fps whole, %.1f fps in %u stripes",
+                    effect_desc, plain_fps, striped_fps, n_stripes);
+    g_test_maximized_result (striped_fps / plain_fps,
+                             "speed-up of %u stripes: %.2f", n_stripes,
+                             striped_fps / plain_fps);
+}
+
 /* Test CheeseVideoFormat (part of CheeseCameraDevice) */
 static void
 videoformat_create (void)
@@ -211,11 +1580,33 @@ main(int argc, gchar *argv[])
     if (!cheese_init (&argc, &argv))
         return EXIT_FAILURE;
 
+    g_test_add_func ("/libcheese/camera/headless", camera_headless);
+    g_test_add_func ("/libcheese/camera/format_switch", camera_format_switch);
+    g_test_add_func ("/libcheese/camera/warm_switch", camera_warm_switch);
+    g_test_add_func ("/libcheese/camera/high_frame_rate",
+        camera_high_frame_rate);
+
+    g_test_add_func ("/libcheese/cameradevice/high_rate_only",
+                     cameradevice_high_rate_only);
     g_test_add_func ("/libcheese/cameradevicemonitor/create",
         cameradevicemonitor_create);
 
+    g_test_add_func ("/libcheese/capscache/roundtrip", capscache_roundtrip);
+
     g_test_add_func ("/libcheese/effect/create", effect_create);
 
+    g_test_add_func ("/libcheese/effectcache/lru", effectcache_lru);
+
+    g_test_add_func ("/libcheese/effectoptimizer/rewrite",
+        effectoptimizer_rewrite);
+
+    g_test_add_func ("/libcheese/encodergovernor/throttled",
+        encodergovernor_throttled);
+    g_test_add_func ("/libcheese/encoderprofile/configure",
+        encoderprofile_configure);
+    g_test_add_func ("/libcheese/encoderprofile/x264_presets",
+        encoderprofile_x264_presets);
+
     if (g_test_slow ())
     {
         g_test_add_func ("/libcheese/fileutil/burst", fileutil_burst);
@@ -226,6 +1617,25 @@ main(int argc, gchar *argv[])
     g_test_add_func ("/libcheese/fileutil/photo_path", fileutil_photo_path);
     g_test_add_func ("/libcheese/fileutil/video_path", fileutil_video_path);
 
+    g_test_add_func ("/libcheese/formatcost/score", formatcost_score);
+
+    g_test_add_func ("/libcheese/framering/limits", framering_limits);
+
+    g_test_add_func ("/libcheese/kernel/balance", kernel_balance);
+    g_test_add_func ("/libcheese/kernel/isa", kernel_isa);
+    g_test_add_func ("/libcheese/kernel/looks", kernel_looks);
+    if (g_test_perf ())
+        g_test_add_func ("/libcheese/kernel/benchmark", kernel_benchmark);
+
+    g_test_add_func ("/libcheese/multicapture/separate", multicapture_separate);
+
+    g_test_add_func ("/libcheese/pixbuf/zero_copy", pixbuf_zero_copy);
+
+    g_test_add_func ("/libcheese/stripebin/identical", stripebin_identical);
+    g_test_add_func ("/libcheese/stripebin/late", stripebin_late);
+    if (g_test_perf ())
+        g_test_add_func ("/libcheese/stripebin/benchmark", stripebin_benchmark);
+
     g_test_add_func ("/libcheese/videoformat/create", videoformat_create);
 
     return g_test_run ();